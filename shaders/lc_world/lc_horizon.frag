@@ -0,0 +1,44 @@
+#version 460 core
+
+#include "../scene_incl.incl"
+#include "lc_world_incl.incl"
+
+#ifdef GBUFFER_PASS
+layout(location = 0) out vec4 g_normalMetal;
+layout(location = 1) out vec4 g_colorRough;
+layout(location = 2) out float g_emissive;
+#endif
+
+in vec3 out_WorldPos;
+in vec3 out_Normal;
+flat in uint out_BlockType;
+
+uniform sampler2D texture_atlas;
+uniform sampler2D texture_atlas_mer;
+
+uniform vec4 u_holeBox; //min x, min z, max x, max z. The finer levels and the chunks draw the inside
+
+void main()
+{
+    if (all(greaterThanEqual(out_WorldPos.xz, u_holeBox.xy)) && all(lessThanEqual(out_WorldPos.xz, u_holeBox.zw)))
+    {
+        discard;
+    }
+
+#ifdef GBUFFER_PASS
+    //the average color of the top face, the blocks are smaller than a pixel this far away
+    int texture_offset = block_info.data[out_BlockType].texture_offsets[5];
+    vec2 texCoords = vec2((0.5 + texture_offset % 25) / 25, -(0.5 + texture_offset / 25) / 25);
+
+    vec3 AlbedoColor = textureLod(texture_atlas, texCoords, 8.0).rgb;
+    vec3 MerColor = textureLod(texture_atlas_mer, texCoords, 8.0).rgb;
+
+    g_normalMetal.rgb = normalize(out_Normal) * 0.5 + 0.5;
+    g_normalMetal.a = MerColor.r;
+
+    g_colorRough.rgb = AlbedoColor;
+    g_colorRough.a = MerColor.b;
+
+    g_emissive = 0.0;
+#endif
+}
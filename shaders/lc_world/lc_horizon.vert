@@ -0,0 +1,50 @@
+#version 460 core 
+
+#include "../scene_incl.incl"
+
+//Must match LC_HORIZON_GRID_SIZE in lc_world.h, a power of two
+#define GRID_SIZE 64
+
+//height and surface block type of every vertex, one layer per clipmap level. Addressed with the grid position modulo GRID_SIZE,
+//so moving the grid only rewrites the rows that enter it
+uniform sampler2DArray height_map;
+
+uniform ivec2 u_origin; //grid position of the first vertex, in cells of the level
+uniform float u_cellSize;
+uniform int u_level;
+
+out vec3 out_WorldPos;
+out vec3 out_Normal;
+flat out uint out_BlockType;
+
+vec2 fetchCell(ivec2 p_cell)
+{
+	//keep the neighbours inside the grid, the rows outside of it hold stale data
+	p_cell = clamp(p_cell, u_origin, u_origin + ivec2(GRID_SIZE - 1));
+
+	ivec2 texel = p_cell & (GRID_SIZE - 1);
+
+	return texelFetch(height_map, ivec3(texel, u_level), 0).rg;
+}
+
+//the gbuffer pass tests for equal depth with the prepass
+invariant gl_Position;
+
+void main()
+{
+	ivec2 grid_pos = ivec2(gl_VertexID % GRID_SIZE, gl_VertexID / GRID_SIZE);
+	ivec2 cell = u_origin + grid_pos;
+
+	vec2 sampled = fetchCell(cell);
+
+	float height_left = fetchCell(cell - ivec2(1, 0)).r;
+	float height_right = fetchCell(cell + ivec2(1, 0)).r;
+	float height_back = fetchCell(cell - ivec2(0, 1)).r;
+	float height_front = fetchCell(cell + ivec2(0, 1)).r;
+
+	out_Normal = normalize(vec3(height_left - height_right, 2.0 * u_cellSize, height_back - height_front));
+	out_WorldPos = vec3(cell.x * u_cellSize, sampled.r, cell.y * u_cellSize);
+	out_BlockType = uint(sampled.g);
+
+	gl_Position = cam.viewProjection * vec4(out_WorldPos, 1.0);
+}
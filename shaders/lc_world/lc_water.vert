@@ -3,12 +3,11 @@
 #include "../scene_incl.incl"
 #include "lc_world_incl.incl"
 
-layout (location = 0) in ivec2 a_Pos;
+layout (location = 0) in ivec3 a_Pos; //x, local height of the water surface, z
 
 const float PI = 3.1415926535897932384626433832795;
 
 const float waveAmplitude = 3.8;
-const float waterHeight = 15;
 
 out VS_OUT
 {
@@ -35,7 +34,9 @@ void main()
     vec4 worldPos = vec4(chunk_data.data[gl_BaseInstance].min_point.xyz, 1.0);
     worldPos.xz -= 0.5;
 
-    vec3 v0 = vec3(a_Pos.x, waterHeight, a_Pos.y) + worldPos.xyz;
+    //the surface is at the top block of the highest water cell
+    float scale = chunk_data.data[gl_BaseInstance].scale;
+    vec3 v0 = vec3(a_Pos.x, a_Pos.y + 1, a_Pos.z) * scale - vec3(0.0, 1.0, 0.0) + worldPos.xyz;
   
     //apply distortion
     v0 = calcDistortion(v0);
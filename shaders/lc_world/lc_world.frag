@@ -138,7 +138,10 @@ void main()
 #ifdef GBUFFER_PASS
    vec4 AlbedoColor = texture(texture_atlas, texCoords);
    vec3 MerColor = texture(texture_atlas_mer, texCoords).rgb;
-   vec3 NormalColor = texture(texture_atlas_normal, texCoords).rgb * 2.0 - 1.0;
+   //the normal atlas is BC5, only xy are stored
+   vec3 NormalColor;
+   NormalColor.xy = texture(texture_atlas_normal, texCoords).rg * 2.0 - 1.0;
+   NormalColor.z = sqrt(max(1.0 - dot(NormalColor.xy, NormalColor.xy), 0.0));
 
    g_normalMetal.rgb = normalize(out_TBN * NormalColor) * 0.5 + 0.5; //Normal. We convert the normal value to [0, 1] range so that we can store in a unsigned texture format
    g_normalMetal.a = MerColor.r; //Metal
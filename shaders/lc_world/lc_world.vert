@@ -151,7 +151,7 @@ void main()
 	chunk_index = gl_BaseInstance;
 #endif
 
-	vec3 WorldPos = (chunk_data.data[chunk_index].min_point.xyz + a_Pos.xyz);
+	vec3 WorldPos = (chunk_data.data[chunk_index].min_point.xyz + a_Pos.xyz * chunk_data.data[chunk_index].scale);
 	vec3 normal = CUBE_NORMALS_TABLE[a_NormalUnit];
 
 #ifdef USE_TEXCOORDS
@@ -182,8 +182,8 @@ void main()
 	switch(a_BlockType)
 	{
 		//LEAVES
-		case 6:
-		case 23:
+		case BLOCK_TYPE_TREELEAVES:
+		case BLOCK_TYPE_SNOWYLEAVES:
 		{
 			windOffset = calcMove2D(WorldPos.xyz,
 			0.0040,
@@ -197,9 +197,9 @@ void main()
 			break;
 		}
 		
-		case 9:
-		case 20:
-		case 22:
+		case BLOCK_TYPE_FLOWER:
+		case BLOCK_TYPE_GRASS_PROP:
+		case BLOCK_TYPE_DEAD_BUSH:
 		{
 			windOffset = calcMove2D(WorldPos.xyz,
 			0.0041,
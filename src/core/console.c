@@ -13,6 +13,10 @@
 #include "cvar.h"
 #include "utility/u_utility.h"
 #include "utility/u_math.h"
+#include "utility/u_queue.h"
+
+#define CON_MAX_LINE_LENGTH 2048
+#define CON_MAX_QUEUED_LINES 128
 
 typedef struct
 {
@@ -31,6 +35,10 @@ typedef struct
 
 	bool opened;
 	bool force_input_edit_focus;
+
+	//lines printed from any thread wait here until the main thread appends them to the scroll buffer
+	MPSC_Queue log_queue;
+	volatile LONG dropped_lines;
 } ConsoleCore;
 
 static ConsoleCore con_core;
@@ -362,27 +370,59 @@ static void Con_drawWindow()
 }
 
 
+static void Con_appendLine(const char* p_line)
+{
+	nk_str_append_str_char(&con_core.scroll_edit.string, p_line);
+
+	//append new line 
+	nk_rune rune = '\n';
+	nk_str_append_text_runes(&con_core.scroll_edit.string, &rune, 1);
+
+	con_core.scroll_total_lines++;
+}
+
+static void Con_FlushLog()
+{
+	char line[CON_MAX_LINE_LENGTH];
+
+	while (MPSC_Queue_Pop(&con_core.log_queue, line))
+	{
+		Con_appendLine(line);
+	}
+
+	LONG dropped = InterlockedExchange(&con_core.dropped_lines, 0);
+
+	if (dropped > 0)
+	{
+		sprintf(line, "%i lines dropped, the log queue was full", (int)dropped);
+		Con_appendLine(line);
+	}
+}
+
 void Con_printf(const char* fmt, ...)
 {
 	assert(!strchr(fmt, '\n') && "New line character not allowed in Con_printf(..)");
 
+	//not initialized yet
+	if (!con_core.log_queue.cells)
+	{
+		return;
+	}
+
     va_list args;
     va_start(args, fmt);
 
-    char buffer[2048];
+    char buffer[CON_MAX_LINE_LENGTH];
 	memset(buffer, 0, sizeof(buffer));
 
-    vsprintf(buffer, fmt, args);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
 
     va_end(args);
 	
-	nk_str_append_str_char(&con_core.scroll_edit.string, buffer);
-
-	//append new line 
-	nk_rune rune = '\n';
-	nk_str_append_text_runes(&con_core.scroll_edit.string, &rune, 1);
-
-	con_core.scroll_total_lines++;
+	if (!MPSC_Queue_Push(&con_core.log_queue, buffer))
+	{
+		InterlockedIncrement(&con_core.dropped_lines);
+	}
 }
 
 bool Con_isOpened()
@@ -392,6 +432,9 @@ bool Con_isOpened()
 
 void Con_Update()
 {
+	//always drain the log, even when the console is hidden
+	Con_FlushLog();
+
 	if (!nk.enabled)
 		return;
 
@@ -431,12 +474,21 @@ int Con_Init()
 	con_core.suggestion_selection = -1;
 
 	con_core.main_window_bounds = nk_rect(520, 50, 500, 500);
+
+	if (!MPSC_Queue_Init(&con_core.log_queue, CON_MAX_LINE_LENGTH, CON_MAX_QUEUED_LINES))
+	{
+		return 0;
+	}
+
+	return 1;
 }
 
 void Con_Cleanup()
 {
 	nk_textedit_free(&con_core.scroll_edit);
 	nk_textedit_free(&con_core.input_edit);
+
+	MPSC_Queue_Destruct(&con_core.log_queue);
 }
 
 
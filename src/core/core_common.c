@@ -1,5 +1,6 @@
 #include "core/core_common.h"
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -8,10 +9,18 @@ void Core_Printf(const char* fmt, ...)
 {
 	assert(!strchr(fmt, '\n') && "New line character not allowed in Core_Printf(..)");
 
+	va_list args;
+	va_start(args, fmt);
+
+	char buffer[2048];
+	vsnprintf(buffer, sizeof(buffer), fmt, args);
+
+	va_end(args);
+
 	//print to std out
-	printf("%s \n", fmt);
+	printf("%s \n", buffer);
 	//print to console
-	Con_printf(fmt);
+	Con_printf("%s", buffer);
 }
 void Core_ErrorPrintf(ErrorType p_errorType, const char* fmt, ...)
 {
@@ -111,8 +111,8 @@ bool Core_init()
 	if (!Init_Glfw()) return false;
 	if (!Window_Init()) return false;
 	if (!Init_Glad()) return false;
-	if (!Sound_Init()) return false;
 	if (!Cvar_Init()) return false;
+	if (!Sound_Init()) return false;
 	if (!Input_Init()) return false;
 	if (!Renderer_Init(0, 0))
 	{
@@ -133,11 +133,12 @@ bool Core_init()
 void Core_Exit()
 {
 	//ThreadCore_Cleanup();
+	//textures need the gl context and sounds have to be uninitialized before the sound engine
+	ResourceManager_Cleanup();
 	glfwTerminate();
 	Sound_Cleanup();
 	Cvar_Cleanup();
 	Cleanup_Nuklear();
 	Con_Cleanup();
-	ResourceManager_Cleanup();
 	Renderer_Exit();
 }
\ No newline at end of file
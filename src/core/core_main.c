@@ -7,6 +7,9 @@
 #include "core/cvar.h"
 #include "core/input.h"
 #include "core/core_common.h"
+#include "utility/u_queue.h"
+#include "utility/u_slab.h"
+#include "core/resource_manager.h"
 #include <Windows.h>
 
 /*
@@ -27,9 +30,11 @@ extern bool Core_init();
 extern void Core_Exit();
 extern void Input_processActions();
 extern void Con_Update();
+extern void Sound_Update();
 extern void ThreadCore_ShutdownInactiveThreads();
 extern void RCore_Start();
 extern void RCore_End();
+extern void RCore_Sync();
 extern void LC_Draw();
 extern void LC_World_StartFrame();
 extern void LC_World_EndFrame();
@@ -60,12 +65,16 @@ typedef struct
 typedef struct
 {
 	Cvar* master_volume;
+	Cvar* queue_benchmark;
+	Cvar* slab_benchmark;
+	Cvar* resource_upload_budget;
 } Core_Cvars;
 
 NK_Data nk;
 static Core_EngineTiming s_engineTiming;
 static Core_Cvars s_cvars;
 static bool s_blockedInput = false;
+static LARGE_INTEGER s_startupCounter;
 
 static void Core_UpdateCvars()
 {
@@ -74,6 +83,24 @@ static void Core_UpdateCvars()
 		Sound_setMasterVolume(s_cvars.master_volume->float_value);
 		s_cvars.master_volume->modified = false;
 	}
+	if (s_cvars.queue_benchmark->modified)
+	{
+		if (s_cvars.queue_benchmark->int_value == 1)
+		{
+			Queue_Benchmark(1000000);
+			Cvar_setValueDirectInt(s_cvars.queue_benchmark, 0);
+		}
+		s_cvars.queue_benchmark->modified = false;
+	}
+	if (s_cvars.slab_benchmark->modified)
+	{
+		if (s_cvars.slab_benchmark->int_value == 1)
+		{
+			Slab_Benchmark(10000);
+			Cvar_setValueDirectInt(s_cvars.slab_benchmark, 0);
+		}
+		s_cvars.slab_benchmark->modified = false;
+	}
 }
 
 static void Core_CalcMainTimer()
@@ -318,6 +345,9 @@ static void Core_Loop()
 		Core_UpdateCvars();
 		Core_CalcMainTimer();
 
+		//upload textures that finished decoding on the resource workers
+		Resource_Update(s_cvars.resource_upload_budget->float_value);
+
 		/*
 		* ~~~~~~~~~~~~~~~~~~~~~~~~~~
 		*	RENDER RELATED REQUESTS
@@ -354,6 +384,7 @@ static void Core_Loop()
 		* ~~~~~~~~~~~~~~~~~~
 		*/
 		Con_Update();
+		Sound_Update();
 		
 		/*
 		* ~~~~~~~~~~~~~~~~~~
@@ -384,6 +415,19 @@ static void Core_Loop()
 		if (nk.enabled) nk_glfw3_render(&nk.glfw, NK_ANTI_ALIASING_ON, NUKLEAR_MAX_VERTEX_BUFFER, NUKLEAR_MAX_ELEMENT_BUFFER);
 		glfwSwapBuffers(window);
 
+		if (s_engineTiming.frames_drawn == 0)
+		{
+			LARGE_INTEGER counter, frequency;
+			QueryPerformanceCounter(&counter);
+			QueryPerformanceFrequency(&frequency);
+
+			double time_to_first_frame = (double)(counter.QuadPart - s_startupCounter.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+			Core_Printf("Time to first frame: %.2f ms, %i resources still loading", time_to_first_frame, Resource_getPendingCount());
+		}
+
+		//Wait for the render thread before the world is modified again
+		RCore_Sync();
+
 		/*
 		* ~~~~~~~~~~~~~~~~~~
 		* END TICK
@@ -401,6 +445,8 @@ static void Core_Loop()
 
 int Core_entry()
 {
+	QueryPerformanceCounter(&s_startupCounter);
+
 	if (!Core_init()) return -1;
 	if (!LC_Init())
 	{
@@ -413,6 +459,9 @@ int Core_entry()
 	memset(&s_cvars, 0, sizeof(s_cvars));
 
 	s_cvars.master_volume = Cvar_Register("master_volume", "1", NULL, CVAR__SAVE_TO_FILE, 0, 24);
+	s_cvars.resource_upload_budget = Cvar_Register("resource_upload_budget", "2", "Milliseconds per frame spent uploading asynchronously loaded resources", CVAR__SAVE_TO_FILE, 0, 100);
+	s_cvars.queue_benchmark = Cvar_Register("queue_benchmark", "0", "Set to 1 to stress test the thread queues and print their throughput", 0, 0, 1);
+	s_cvars.slab_benchmark = Cvar_Register("slab_benchmark", "0", "Set to 1 to compare iterating malloc and slab allocated list nodes", 0, 0, 1);
 
 	nk.enabled = true;
 
@@ -1,27 +1,212 @@
 #include "core/resource_manager.h"
 
+#include <Windows.h>
+#include <GLFW/glfw3.h>
+
 #include "utility/u_object_pool.h"
 #include "utility/u_utility.h"
 #include "utility/Custom_Hashmap.h"
+#include "utility/u_queue.h"
 #include "render/r_texture.h"
+#include "render/r_texture_cache.h"
 #include "core/sound.h"
 
+#define RESOURCE_MAX_PATH_LENGTH 256
+#define RESOURCE_MAX_QUEUED_JOBS 256
+#define RESOURCE_MAX_WORKERS 4
+
 typedef struct
 {
 	ResourceType type;
+	ResourceState state;
 	int ref_counter;
 
 	void* data;
 } Resource;
 
+//A file that is decoded on a worker thread and finalized on the main thread
+typedef struct
+{
+	char path[RESOURCE_MAX_PATH_LENGTH];
+	ResourceType type; //RESOURCE__MAX tells the worker to exit
+	bool success;
+
+	void* data; //same as Resource::data, it doesn't move when the map grows
+	R_TextureData texture_data;
+} ResourceJob;
+
 typedef struct
 {
 	CHMap resource_map;
 
+	MPMC_Queue job_queue; //main thread -> workers
+	MPSC_Queue completed_queue; //workers -> main thread
+
+	HANDLE workers[RESOURCE_MAX_WORKERS];
+	int worker_count;
+
+	int pending_jobs[RESOURCE__MAX + 1]; //per type, the last one counts all of them
 } ResourceManagerCore;
 
 static ResourceManagerCore resource_core;
 
+static void Resource_destroy(Resource* res);
+
+static bool Resource_isTexture(ResourceType p_resType)
+{
+	return p_resType == RESOURCE__TEXTURE || p_resType == RESOURCE__TEXTURE_HDR || p_resType == RESOURCE__TEXTURE_BC7
+		|| p_resType == RESOURCE__TEXTURE_BC5 || p_resType == RESOURCE__TEXTURE_BC4;
+}
+
+static bool Resource_isCompressedTexture(ResourceType p_resType)
+{
+	return p_resType == RESOURCE__TEXTURE_BC7 || p_resType == RESOURCE__TEXTURE_BC5 || p_resType == RESOURCE__TEXTURE_BC4;
+}
+
+static bool Resource_decodeTexture(const char* p_path, ResourceType p_resType, R_TextureData* r_data)
+{
+	switch (p_resType)
+	{
+	case RESOURCE__TEXTURE_BC7:
+		return TextureCache_Load(p_path, TEXTURE_COMPRESSION__BC7, r_data);
+	case RESOURCE__TEXTURE_BC5:
+		return TextureCache_Load(p_path, TEXTURE_COMPRESSION__BC5, r_data);
+	case RESOURCE__TEXTURE_BC4:
+		return TextureCache_Load(p_path, TEXTURE_COMPRESSION__BC4, r_data);
+	default:
+		break;
+	}
+
+	return Texture_DecodeFile(p_path, p_resType == RESOURCE__TEXTURE_HDR, r_data);
+}
+
+static void* Resource_allocData(ResourceType p_resType)
+{
+	switch (p_resType)
+	{
+	case RESOURCE__SOUND:
+	{
+		return calloc(1, sizeof(ma_sound));
+	}
+	case RESOURCE__TEXTURE_BC7:
+	case RESOURCE__TEXTURE_BC5:
+	case RESOURCE__TEXTURE_BC4:
+	case RESOURCE__TEXTURE_HDR:
+	case RESOURCE__TEXTURE:
+	{
+		//id stays 0 until the texture is uploaded
+		return calloc(1, sizeof(R_Texture));
+	}
+	default:
+		break;
+	}
+
+	return NULL;
+}
+
+static void Resource_decodeJob(ResourceJob* const p_job)
+{
+	switch (p_job->type)
+	{
+	case RESOURCE__SOUND:
+	{
+		p_job->success = Sound_load(p_job->path, 0, p_job->data);
+		break;
+	}
+	case RESOURCE__TEXTURE_BC7:
+	case RESOURCE__TEXTURE_BC5:
+	case RESOURCE__TEXTURE_BC4:
+	case RESOURCE__TEXTURE_HDR:
+	case RESOURCE__TEXTURE:
+	{
+		p_job->success = Resource_decodeTexture(p_job->path, p_job->type, &p_job->texture_data);
+		break;
+	}
+	default:
+	{
+		p_job->success = false;
+		break;
+	}
+	}
+}
+
+static DWORD WINAPI Resource_WorkerLoop(LPVOID p_arg)
+{
+	ResourceJob job;
+
+	while (MPMC_Queue_PopWait(&resource_core.job_queue, &job, INFINITE))
+	{
+		if (job.type == RESOURCE__MAX)
+		{
+			break;
+		}
+
+		Resource_decodeJob(&job);
+
+		//the main thread might be busy, keep trying
+		while (!MPSC_Queue_Push(&resource_core.completed_queue, &job))
+		{
+			SwitchToThread();
+		}
+	}
+
+	return 0;
+}
+
+static void Resource_finalizeJob(ResourceJob* const p_job)
+{
+	//gl uploads have to happen on the main thread
+	if (p_job->success && Resource_isTexture(p_job->type))
+	{
+		R_Texture texture = Texture_Upload(&p_job->texture_data, NULL);
+		memcpy(p_job->data, &texture, sizeof(R_Texture));
+
+		p_job->success = texture.id != 0;
+	}
+	Texture_FreeData(&p_job->texture_data);
+
+	resource_core.pending_jobs[p_job->type]--;
+	resource_core.pending_jobs[RESOURCE__MAX]--;
+
+	Resource* res = CHMap_Find(&resource_core.resource_map, p_job->path);
+
+	if (!res)
+	{
+		return;
+	}
+
+	if (!p_job->success)
+	{
+		printf("Failed to load resource at path %s \n", p_job->path);
+	}
+
+	res->state = (p_job->success) ? RESOURCE_STATE__READY : RESOURCE_STATE__FAILED;
+	
+	//drop the reference the job was holding
+	Resource_release(p_job->path);
+}
+
+static Resource* Resource_finishLoad(const char* p_path)
+{
+	Resource* res = CHMap_Find(&resource_core.resource_map, p_path);
+
+	while (res && res->state == RESOURCE_STATE__LOADING)
+	{
+		//finalize whatever comes in until our resource is done
+		ResourceJob job;
+
+		if (MPSC_Queue_PopWait(&resource_core.completed_queue, &job, INFINITE))
+		{
+			Resource_finalizeJob(&job);
+		}
+
+		//the map might have moved
+		res = CHMap_Find(&resource_core.resource_map, p_path);
+	}
+
+	return res;
+}
+
 void* Resource_get(const char* p_path, ResourceType p_resType)
 {
 	//if the resource exists return it
@@ -30,6 +215,24 @@ void* Resource_get(const char* p_path, ResourceType p_resType)
 	{
 		assert(find_resource->type == p_resType);
 
+		//it was requested asynchronously, but it's needed now
+		if (find_resource->state == RESOURCE_STATE__LOADING)
+		{
+			find_resource = Resource_finishLoad(p_path);
+
+			//everyone released it while it was loading
+			if (!find_resource)
+			{
+				return Resource_get(p_path, p_resType);
+			}
+		}
+		if (find_resource->state == RESOURCE_STATE__FAILED)
+		{
+			return NULL;
+		}
+
+		find_resource->ref_counter++;
+
 		return find_resource->data;
 	}
 	
@@ -54,13 +257,25 @@ void* Resource_get(const char* p_path, ResourceType p_resType)
 
 		break;
 	}
+	case RESOURCE__TEXTURE_BC7:
+	case RESOURCE__TEXTURE_BC5:
+	case RESOURCE__TEXTURE_BC4:
 	case RESOURCE__TEXTURE_HDR:
 	case RESOURCE__TEXTURE:
 	{
 		R_Texture texture;
 		texture.id = 0;
 		
-		if (p_resType == RESOURCE__TEXTURE_HDR)
+		if (Resource_isCompressedTexture(p_resType))
+		{
+			R_TextureData texture_data;
+			if (Resource_decodeTexture(p_path, p_resType, &texture_data))
+			{
+				texture = Texture_Upload(&texture_data, NULL);
+			}
+			Texture_FreeData(&texture_data);
+		}
+		else if (p_resType == RESOURCE__TEXTURE_HDR)
 		{
 			texture = HDRTexture_Load(p_path, NULL);
 		}
@@ -113,11 +328,128 @@ void* Resource_get(const char* p_path, ResourceType p_resType)
 	memset(&res, 0, sizeof(res));
 	res.data = data;
 	res.type = p_resType;
+	res.state = RESOURCE_STATE__READY;
+	res.ref_counter = 1;
 	CHMap_Insert(&resource_core.resource_map, p_path, &res);
 	
 	return res.data;
 }
 
+void* Resource_getAsync(const char* p_path, ResourceType p_resType)
+{
+	Resource* find_resource = CHMap_Find(&resource_core.resource_map, p_path);
+	if (find_resource)
+	{
+		assert(find_resource->type == p_resType);
+
+		if (find_resource->state == RESOURCE_STATE__FAILED)
+		{
+			return NULL;
+		}
+
+		find_resource->ref_counter++;
+
+		return find_resource->data;
+	}
+
+	//only textures and sounds can be decoded on the workers
+	if (resource_core.worker_count <= 0 || strlen(p_path) >= RESOURCE_MAX_PATH_LENGTH
+		|| (p_resType != RESOURCE__SOUND && !Resource_isTexture(p_resType)))
+	{
+		return Resource_get(p_path, p_resType);
+	}
+
+	//report missing files right away, so callers can still fail early
+	FILE* file = NULL;
+	fopen_s(&file, p_path, "rb");
+
+	if (!file)
+	{
+		printf("Failed to open resource at path %s \n", p_path);
+		return NULL;
+	}
+	fclose(file);
+
+	ResourceJob job;
+	memset(&job, 0, sizeof(job));
+	strcpy_s(job.path, RESOURCE_MAX_PATH_LENGTH, p_path);
+	job.type = p_resType;
+	job.data = Resource_allocData(p_resType);
+
+	if (!job.data)
+	{
+		return NULL;
+	}
+
+	if (!MPMC_Queue_Push(&resource_core.job_queue, &job))
+	{
+		//the workers are backed up, just load it here
+		free(job.data);
+		return Resource_get(p_path, p_resType);
+	}
+
+	resource_core.pending_jobs[p_resType]++;
+	resource_core.pending_jobs[RESOURCE__MAX]++;
+
+	Resource res;
+	memset(&res, 0, sizeof(res));
+	res.data = job.data;
+	res.type = p_resType;
+	res.state = RESOURCE_STATE__LOADING;
+	res.ref_counter = 2; //one for the caller, one for the job
+	CHMap_Insert(&resource_core.resource_map, p_path, &res);
+
+	return res.data;
+}
+
+ResourceState Resource_getState(const char* p_path)
+{
+	Resource* res = CHMap_Find(&resource_core.resource_map, p_path);
+
+	if (!res)
+	{
+		return RESOURCE_STATE__FAILED;
+	}
+
+	return res->state;
+}
+
+void Resource_Update(double p_budgetMs)
+{
+	double start_time = glfwGetTime();
+
+	ResourceJob job;
+
+	while (MPSC_Queue_Pop(&resource_core.completed_queue, &job))
+	{
+		Resource_finalizeJob(&job);
+
+		//gl uploads are done one at a time, so a big texture can still go over the budget
+		if (p_budgetMs >= 0 && (glfwGetTime() - start_time) * 1000.0 >= p_budgetMs)
+		{
+			break;
+		}
+	}
+}
+
+void Resource_waitAll(ResourceType p_resType)
+{
+	while (resource_core.pending_jobs[p_resType] > 0)
+	{
+		ResourceJob job;
+
+		if (MPSC_Queue_PopWait(&resource_core.completed_queue, &job, INFINITE))
+		{
+			Resource_finalizeJob(&job);
+		}
+	}
+}
+
+int Resource_getPendingCount()
+{
+	return resource_core.pending_jobs[RESOURCE__MAX];
+}
+
 void* Resource_getFromMemory(const char* p_name, void* p_data, size_t p_bufLen, ResourceType p_resType)
 {
 	//if the resource exists return it
@@ -214,12 +546,24 @@ static void Resource_destroy(Resource* res)
 	{
 	case RESOURCE__SOUND:
 	{
+		if (res->state == RESOURCE_STATE__READY)
+		{
+			Sound_releaseVoices(res->data);
+			ma_sound_uninit(res->data);
+		}
 		break;
 	}
+	case RESOURCE__TEXTURE_BC7:
+	case RESOURCE__TEXTURE_BC5:
+	case RESOURCE__TEXTURE_BC4:
+	case RESOURCE__TEXTURE_HDR:
 	case RESOURCE__TEXTURE:
 	{
 		R_Texture* texture_data = res->data;
-		Texture_Destruct(texture_data);
+		if (texture_data->id > 0)
+		{
+			Texture_Destruct(texture_data);
+		}
 
 		break;
 	}
@@ -236,9 +580,12 @@ static void Resource_destroy(Resource* res)
 	default:
 		break;
 	}
+
+	free(res->data);
+	res->data = NULL;
 }
 
-void Resource_destruct(const char* p_path)
+void Resource_release(const char* p_path)
 {
 	Resource* res = CHMap_Find(&resource_core.resource_map, p_path);
 
@@ -247,6 +594,26 @@ void Resource_destruct(const char* p_path)
 		return;
 	}
 
+	res->ref_counter--;
+
+	if (res->ref_counter <= 0)
+	{
+		Resource_destroy(res);
+
+		CHMap_Erase(&resource_core.resource_map, p_path);
+	}
+}
+
+void Resource_destruct(const char* p_path)
+{
+	//a worker might still be writing into it
+	Resource* res = Resource_finishLoad(p_path);
+
+	if (!res)
+	{
+		return;
+	}
+
 	Resource_destroy(res);
 
 	CHMap_Erase(&resource_core.resource_map, p_path);
@@ -262,15 +629,81 @@ void ResourceManager_Init()
 	memset(&resource_core, 0, sizeof(resource_core));
 
 	resource_core.resource_map = CHMAP_INIT_STRING(Resource, 1);
+
+	if (!MPMC_Queue_Init(&resource_core.job_queue, sizeof(ResourceJob), RESOURCE_MAX_QUEUED_JOBS) 
+		|| !MPSC_Queue_Init(&resource_core.completed_queue, sizeof(ResourceJob), RESOURCE_MAX_QUEUED_JOBS))
+	{
+		//everything will be loaded synchronously
+		return;
+	}
+
+	//leave a core for the main thread
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+
+	int worker_count = (int)sys_info.dwNumberOfProcessors - 1;
+	worker_count = max(worker_count, 1);
+	worker_count = min(worker_count, RESOURCE_MAX_WORKERS);
+
+	for (int i = 0; i < worker_count; i++)
+	{
+		HANDLE handle = CreateThread(NULL, 0, Resource_WorkerLoop, NULL, 0, NULL);
+
+		if (!handle)
+		{
+			break;
+		}
+
+		resource_core.workers[resource_core.worker_count++] = handle;
+	}
 }
 
 void ResourceManager_Cleanup()
 {
+	//let the workers finish, but throw away anything that would need a gl upload
+	while (resource_core.pending_jobs[RESOURCE__MAX] > 0)
+	{
+		ResourceJob job;
+
+		if (!MPSC_Queue_PopWait(&resource_core.completed_queue, &job, INFINITE))
+		{
+			continue;
+		}
+
+		Texture_FreeData(&job.texture_data);
+		resource_core.pending_jobs[job.type]--;
+		resource_core.pending_jobs[RESOURCE__MAX]--;
+
+		Resource* res = CHMap_Find(&resource_core.resource_map, job.path);
+		if (res)
+		{
+			res->state = (job.success && job.type == RESOURCE__SOUND) ? RESOURCE_STATE__READY : RESOURCE_STATE__FAILED;
+		}
+	}
+
+	//stop the workers, one exit request each
+	ResourceJob exit_job;
+	memset(&exit_job, 0, sizeof(exit_job));
+	exit_job.type = RESOURCE__MAX;
+
+	for (int i = 0; i < resource_core.worker_count; i++)
+	{
+		MPMC_Queue_Push(&resource_core.job_queue, &exit_job);
+	}
+	for (int i = 0; i < resource_core.worker_count; i++)
+	{
+		WaitForSingleObject(resource_core.workers[i], INFINITE);
+		CloseHandle(resource_core.workers[i]);
+	}
+
 	for (int i = 0; i < resource_core.resource_map.num_items; i++)
 	{
-		Resource* res = resource_core.resource_map.item_data->data;
+		Resource* res = dA_at(resource_core.resource_map.item_data, i);
 		Resource_destroy(res);
 	}
 
 	CHMap_Destruct(&resource_core.resource_map);
+
+	MPMC_Queue_Destruct(&resource_core.job_queue);
+	MPSC_Queue_Destruct(&resource_core.completed_queue);
 }
\ No newline at end of file
@@ -2,19 +2,42 @@
 #define RESOURCE_MANAGER_H
 #pragma once
 
+#include <stddef.h>
+
 typedef enum
 {
 	RESOURCE__SOUND,
 	RESOURCE__TEXTURE,
 	RESOURCE__TEXTURE_HDR,
+	RESOURCE__TEXTURE_BC7, //block compressed through the texture cache
+	RESOURCE__TEXTURE_BC5,
+	RESOURCE__TEXTURE_BC4,
 	RESOURCE__FONT,
 	RESOURCE__MODEL,
 	RESOURCE__MAX
 } ResourceType;
 
+typedef enum
+{
+	RESOURCE_STATE__LOADING,
+	RESOURCE_STATE__READY,
+	RESOURCE_STATE__FAILED
+} ResourceState;
+
 typedef void*(*Resource_fun)(void*);
 
 void* Resource_get(const char* p_path, ResourceType p_resType);
+/*
+	Returns the handle right away and decodes the file on a worker thread.
+	Textures keep id 0 until Resource_Update uploads them on the main thread.
+	Calling Resource_get on a resource that is still loading waits for it
+*/
+void* Resource_getAsync(const char* p_path, ResourceType p_resType);
+ResourceState Resource_getState(const char* p_path);
+void Resource_Update(double p_budgetMs); //finalizes decoded resources, p_budgetMs < 0 for no limit
+void Resource_waitAll(ResourceType p_resType); //RESOURCE__MAX waits for every type
+int Resource_getPendingCount();
+void Resource_release(const char* p_path);
 void* Resource_getFromMemory(const char* p_name, void* p_data, size_t p_bufLen, ResourceType p_resType);
 void* Resource_getCustom(const char* p_name, Resource_fun p_function, void* p_args, ResourceType p_resType);
 void Resource_destruct(const char* p_path);
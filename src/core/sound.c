@@ -4,14 +4,110 @@
 #include "core/sound.h"
 #include "core/cvar.h"
 #include "utility/u_utility.h"
+#include "utility/u_queue.h"
+#include "core/resource_manager.h"
+#include "utility/Custom_Hashmap.h"
+
+#define SOUND_MAX_QUEUED_CMDS 256
+#define SOUND_MAX_NAME_LENGTH 128
+#define SOUND_MAX_VOICES 128 //upper limit of snd_max_voices
+#define SOUND_VOICES_PER_SOUND 4
+
+typedef enum
+{
+	SOUND_CMD__PLAY,
+	SOUND_CMD__STOP
+} SoundCmdType;
+
+typedef struct
+{
+	SoundCmdType type;
+	char name[SOUND_MAX_NAME_LENGTH];
+} SoundCmd;
+
+typedef struct
+{
+	Cvar* snd_max_voices;
+	Cvar* snd_cull_distance;
+	Cvar* snd_report;
+} SoundCvars;
+
+typedef struct
+{
+	ma_sound* source; //the loaded sound, the voices are copies of it
+	ma_sound voices[SOUND_VOICES_PER_SOUND];
+	int voice_count;
+	bool streamed; //can't be copied, the source is the only voice
+} SoundPool;
+
+typedef struct
+{
+	SoundPool* pool;
+	ma_sound* voice;
+	SoundPriority priority;
+	vec3 position;
+	bool spatial;
+	unsigned serial; //lower is older
+} SoundActiveVoice;
+
+typedef struct
+{
+	CHMap pool_map; //ma_sound* -> SoundPool*
+	SoundActiveVoice active[SOUND_MAX_VOICES];
+	int active_count;
+	int pooled_voices;
+	unsigned serial_counter;
+
+	unsigned culled;
+	unsigned stolen;
+	unsigned dropped;
+
+	//written by the audio thread
+	volatile LONG64 mix_ticks;
+	volatile LONG64 mix_frames;
+	double mix_ms_per_second;
+} SoundVoiceState;
 
 ma_engine sound_engine;
 
+//play and stop requests can come from any thread, they are executed on the main thread in Sound_Update
+static MPSC_Queue sound_cmd_queue;
+static SoundCvars sound_cvars;
+static SoundVoiceState sound_voices;
+
+static void Sound_pushCmd(SoundCmdType p_type, const char* p_soundName)
+{
+	SoundCmd cmd;
+	cmd.type = p_type;
+	strncpy(cmd.name, p_soundName, SOUND_MAX_NAME_LENGTH - 1);
+	cmd.name[SOUND_MAX_NAME_LENGTH - 1] = '\0';
+
+	if (!MPSC_Queue_Push(&sound_cmd_queue, &cmd))
+	{
+		printf("Sound command queue is full, dropping %s \n", p_soundName);
+	}
+}
+
 
 bool Sound_load(const char* p_filePath, uint32_t p_flags, ma_sound* r_sound)
 {
 	ma_result result;
 
+	//long files like ambience are streamed, short effects are decoded once and shared by their voices
+	if (!(p_flags & (MA_SOUND_FLAG_STREAM | MA_SOUND_FLAG_DECODE)))
+	{
+		FILE* file = fopen(p_filePath, "rb");
+		int length = 0;
+
+		if (file)
+		{
+			length = File_GetLength(file);
+			fclose(file);
+		}
+
+		p_flags |= (length >= SOUND_STREAM_MIN_BYTES) ? MA_SOUND_FLAG_STREAM : MA_SOUND_FLAG_DECODE;
+	}
+
 	result = ma_sound_init_from_file(&sound_engine, p_filePath, p_flags, NULL, NULL, r_sound);
 
 	if (result != MA_SUCCESS)
@@ -25,28 +121,444 @@ bool Sound_load(const char* p_filePath, uint32_t p_flags, ma_sound* r_sound)
 
 void Sound_play(const char* p_soundName)
 {
-	ma_sound* ma_handle = NULL;
+	Sound_pushCmd(SOUND_CMD__PLAY, p_soundName);
+}
+
+void Sound_stop(const char* p_soundName)
+{
+	Sound_pushCmd(SOUND_CMD__STOP, p_soundName);
+}
+
+/*
+~~~~~~~~~~~~~~~~~~
+VOICES
+~~~~~~~~~~~~~~~~~~
+*/
+static void Sound_DataCallback(ma_device* p_device, void* p_output, const void* p_input, ma_uint32 p_frameCount)
+{
+	LARGE_INTEGER start_time, end_time;
+	QueryPerformanceCounter(&start_time);
+
+	ma_engine_read_pcm_frames(p_device->pUserData, p_output, p_frameCount, NULL);
+
+	QueryPerformanceCounter(&end_time);
+
+	InterlockedExchangeAdd64(&sound_voices.mix_ticks, end_time.QuadPart - start_time.QuadPart);
+	InterlockedExchangeAdd64(&sound_voices.mix_frames, p_frameCount);
+}
+
+static float Sound_getListenerDistance(const vec3 p_position)
+{
+	ma_vec3f listener = ma_engine_listener_get_position(&sound_engine, 0);
+
+	float x = p_position[0] - listener.x;
+	float y = p_position[1] - listener.y;
+	float z = p_position[2] - listener.z;
+
+	return sqrtf(x * x + y * y + z * z);
+}
+
+static float Sound_getVoiceDistance(const SoundActiveVoice* const p_voice)
+{
+	return (p_voice->spatial) ? Sound_getListenerDistance(p_voice->position) : 0.0f;
+}
+
+static SoundPool* Sound_getPool(ma_sound* p_sound, bool p_create)
+{
+	SoundPool** found = CHMap_Find(&sound_voices.pool_map, &p_sound);
+
+	if (found)
+	{
+		return *found;
+	}
+	if (!p_create)
+	{
+		return NULL;
+	}
+
+	SoundPool* pool = calloc(1, sizeof(SoundPool));
+
+	if (!pool)
+	{
+		return NULL;
+	}
+
+	pool->source = p_sound;
+
+	if (!CHMap_Insert(&sound_voices.pool_map, &p_sound, &pool))
+	{
+		free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+static void Sound_removeActive(int p_index)
+{
+	sound_voices.active[p_index] = sound_voices.active[--sound_voices.active_count];
+}
+
+static int Sound_findActive(ma_sound* p_voice)
+{
+	for (int i = 0; i < sound_voices.active_count; i++)
+	{
+		if (sound_voices.active[i].voice == p_voice)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static bool Sound_isVoiceFinished(ma_sound* p_voice)
+{
+	//a sound that reached the end stays started, it's only silent
+	return !ma_sound_is_playing(p_voice) || ma_sound_at_end(p_voice);
+}
+
+static bool Sound_isVoiceFree(ma_sound* p_voice)
+{
+	int active = Sound_findActive(p_voice);
+
+	if (active < 0)
+	{
+		return true;
+	}
+	//Sound_Update hasn't seen that it finished yet
+	if (Sound_isVoiceFinished(p_voice))
+	{
+		Sound_removeActive(active);
+		return true;
+	}
+
+	return false;
+}
+
+//-1 if none of them can be replaced by the new one
+static int Sound_findVictim(SoundPool* p_pool, SoundPriority p_priority, float p_distance)
+{
+	int victim = -1;
+	float victim_distance = 0;
+
+	for (int i = 0; i < sound_voices.active_count; i++)
+	{
+		SoundActiveVoice* active = &sound_voices.active[i];
 
-	if (!ma_handle)
+		if (p_pool && active->pool != p_pool)
+		{
+			continue;
+		}
+
+		float distance = Sound_getVoiceDistance(active);
+
+		//lowest priority, then the furthest, then the oldest
+		if (victim >= 0)
+		{
+			SoundActiveVoice* best = &sound_voices.active[victim];
+
+			if (active->priority > best->priority)
+			{
+				continue;
+			}
+			if (active->priority == best->priority && (distance < victim_distance || (distance == victim_distance && active->serial > best->serial)))
+			{
+				continue;
+			}
+		}
+
+		victim = i;
+		victim_distance = distance;
+	}
+
+	if (victim < 0)
+	{
+		return -1;
+	}
+
+	SoundActiveVoice* best = &sound_voices.active[victim];
+
+	if (best->priority > p_priority || (best->priority == p_priority && victim_distance < p_distance))
+	{
+		return -1;
+	}
+
+	return victim;
+}
+
+static ma_sound* Sound_takePoolVoice(SoundPool* const p_pool, SoundPriority p_priority, float p_distance)
+{
+	for (int i = 0; i < p_pool->voice_count; i++)
+	{
+		if (Sound_isVoiceFree(&p_pool->voices[i]))
+		{
+			return &p_pool->voices[i];
+		}
+	}
+	if (p_pool->streamed && Sound_isVoiceFree(p_pool->source))
+	{
+		return p_pool->source;
+	}
+
+	if (!p_pool->streamed && p_pool->voice_count < SOUND_VOICES_PER_SOUND)
+	{
+		ma_sound* voice = &p_pool->voices[p_pool->voice_count];
+		ma_result result = ma_sound_init_copy(&sound_engine, p_pool->source, 0, NULL, voice);
+
+		if (result == MA_SUCCESS)
+		{
+			p_pool->voice_count++;
+			sound_voices.pooled_voices++;
+			return voice;
+		}
+		//streams can't share their data
+		if (result == MA_INVALID_OPERATION && p_pool->voice_count == 0)
+		{
+			p_pool->streamed = true;
+			return p_pool->source;
+		}
+		return NULL;
+	}
+
+	//every voice of the sound is playing
+	int victim = Sound_findVictim(p_pool, p_priority, p_distance);
+
+	if (victim < 0)
+	{
+		return NULL;
+	}
+
+	ma_sound* voice = sound_voices.active[victim].voice;
+
+	ma_sound_stop(voice);
+	Sound_removeActive(victim);
+	sound_voices.stolen++;
+
+	return voice;
+}
+
+static bool Sound_playVoice(ma_sound* p_sound, const vec3 p_position, SoundPriority p_priority)
+{
+	//still loading or failed
+	if (!p_sound || !p_sound->pDataSource)
+	{
+		return false;
+	}
+
+	float distance = (p_position) ? Sound_getListenerDistance(p_position) : 0.0f;
+
+	if (distance > sound_cvars.snd_cull_distance->float_value)
+	{
+		sound_voices.culled++;
+		return false;
+	}
+
+	SoundPool* pool = Sound_getPool(p_sound, true);
+
+	if (!pool)
+	{
+		return false;
+	}
+
+	ma_sound* voice = Sound_takePoolVoice(pool, p_priority, distance);
+
+	if (!voice)
+	{
+		sound_voices.dropped++;
+		return false;
+	}
+
+	int max_voices = min(sound_cvars.snd_max_voices->int_value, SOUND_MAX_VOICES);
+
+	while (sound_voices.active_count >= max_voices)
+	{
+		int victim = Sound_findVictim(NULL, p_priority, distance);
+
+		if (victim < 0)
+		{
+			sound_voices.dropped++;
+			return false;
+		}
+
+		ma_sound_stop(sound_voices.active[victim].voice);
+		Sound_removeActive(victim);
+		sound_voices.stolen++;
+	}
+
+	SoundActiveVoice* active = &sound_voices.active[sound_voices.active_count++];
+	active->pool = pool;
+	active->voice = voice;
+	active->priority = p_priority;
+	active->spatial = p_position != NULL;
+	active->serial = ++sound_voices.serial_counter;
+
+	if (p_position)
+	{
+		glm_vec3_copy((float*)p_position, active->position);
+
+		ma_sound_set_positioning(voice, ma_positioning_absolute);
+		ma_sound_set_position(voice, p_position[0], p_position[1], p_position[2]);
+	}
+	else
+	{
+		//played at the listener
+		ma_sound_set_positioning(voice, ma_positioning_relative);
+		ma_sound_set_position(voice, 0, 0, 0);
+	}
+
+	ma_sound_seek_to_pcm_frame(voice, 0);
+	ma_sound_start(voice);
+
+	return true;
+}
+
+static void Sound_stopVoices(ma_sound* p_sound)
+{
+	SoundPool* pool = Sound_getPool(p_sound, false);
+
+	if (!pool)
 	{
-		printf("Sound not found by name %s \n", p_soundName);
 		return;
 	}
-	
-	ma_sound_start(ma_handle);
+
+	for (int i = sound_voices.active_count - 1; i >= 0; i--)
+	{
+		if (sound_voices.active[i].pool == pool)
+		{
+			ma_sound_stop(sound_voices.active[i].voice);
+			Sound_removeActive(i);
+		}
+	}
 }
 
-void Sound_stop(const char* p_soundName)
+static void Sound_updateVoices()
 {
-	ma_sound* ma_handle = NULL;
+	float cull_distance = sound_cvars.snd_cull_distance->float_value;
+
+	for (int i = sound_voices.active_count - 1; i >= 0; i--)
+	{
+		SoundActiveVoice* active = &sound_voices.active[i];
+
+		if (Sound_isVoiceFinished(active->voice))
+		{
+			Sound_removeActive(i);
+			continue;
+		}
+
+		//the listener moved away from it
+		if (active->spatial && Sound_getListenerDistance(active->position) > cull_distance)
+		{
+			ma_sound_stop(active->voice);
+			Sound_removeActive(i);
+			sound_voices.culled++;
+		}
+	}
+
+	//a second of audio is enough to average out the callback sizes
+	ma_uint32 sample_rate = ma_engine_get_sample_rate(&sound_engine);
+
+	if (sample_rate > 0 && sound_voices.mix_frames >= sample_rate)
+	{
+		LONG64 ticks = InterlockedExchange64(&sound_voices.mix_ticks, 0);
+		LONG64 frames = InterlockedExchange64(&sound_voices.mix_frames, 0);
+
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+
+		double mix_ms = (double)ticks * 1000.0 / (double)freq.QuadPart;
+		double audio_seconds = (double)frames / (double)sample_rate;
+
+		sound_voices.mix_ms_per_second = mix_ms / audio_seconds;
+	}
 
-	if (!ma_handle)
+	if (sound_cvars.snd_report->modified)
+	{
+		if (sound_cvars.snd_report->int_value == 1)
+		{
+			printf("Sound: %i/%i voices playing, %i pooled, %u culled, %u stolen, %u dropped, mixing %.3f ms per second (%.2f%% of the audio thread) \n",
+				sound_voices.active_count, sound_cvars.snd_max_voices->int_value, sound_voices.pooled_voices, sound_voices.culled, sound_voices.stolen, sound_voices.dropped,
+				sound_voices.mix_ms_per_second, sound_voices.mix_ms_per_second / 10.0);
+			Cvar_setValueDirectInt(sound_cvars.snd_report, 0);
+		}
+		sound_cvars.snd_report->modified = false;
+	}
+}
+
+bool Sound_playAt(ma_sound* p_sound, vec3 p_position, SoundPriority p_priority)
+{
+	return Sound_playVoice(p_sound, p_position, p_priority);
+}
+
+void Sound_releaseVoices(ma_sound* p_sound)
+{
+	SoundPool* pool = Sound_getPool(p_sound, false);
+
+	if (!pool)
 	{
-		printf("Sound not found by name %s \n", p_soundName);
 		return;
 	}
 
-	ma_sound_stop(ma_handle);
+	Sound_stopVoices(p_sound);
+
+	for (int i = 0; i < pool->voice_count; i++)
+	{
+		ma_sound_uninit(&pool->voices[i]);
+	}
+	sound_voices.pooled_voices -= pool->voice_count;
+
+	CHMap_Erase(&sound_voices.pool_map, &p_sound);
+	free(pool);
+}
+
+SoundStats Sound_GetStats()
+{
+	SoundStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	stats.active_voices = sound_voices.active_count;
+	stats.max_voices = sound_cvars.snd_max_voices->int_value;
+	stats.pooled_voices = sound_voices.pooled_voices;
+	stats.culled = sound_voices.culled;
+	stats.stolen = sound_voices.stolen;
+	stats.dropped = sound_voices.dropped;
+	stats.mix_ms_per_second = sound_voices.mix_ms_per_second;
+
+	return stats;
+}
+
+void Sound_Update()
+{
+	SoundCmd cmd;
+
+	while (MPSC_Queue_Pop(&sound_cmd_queue, &cmd))
+	{
+		ma_sound* ma_handle = Resource_get(cmd.name, RESOURCE__SOUND);
+
+		if (!ma_handle)
+		{
+			printf("Sound not found by name %s \n", cmd.name);
+			continue;
+		}
+
+		switch (cmd.type)
+		{
+		case SOUND_CMD__PLAY:
+		{
+			Sound_playVoice(ma_handle, NULL, SOUND_PRIORITY__NORMAL);
+			break;
+		}
+		case SOUND_CMD__STOP:
+		{
+			Sound_stopVoices(ma_handle);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	Sound_updateVoices();
 }
 
 bool Sound_createGroup(uint32_t p_flags, ma_sound_group* r_group)
@@ -73,7 +585,18 @@ int Sound_Init()
 {
 	ma_result result;
 
-	result = ma_engine_init(NULL, &sound_engine);
+	memset(&sound_voices, 0, sizeof(sound_voices));
+	memset(&sound_cvars, 0, sizeof(sound_cvars));
+
+	sound_cvars.snd_max_voices = Cvar_Register("snd_max_voices", "32", "Sounds that can play at once, the lowest priority and furthest ones are stopped first", CVAR__SAVE_TO_FILE, 4, SOUND_MAX_VOICES);
+	sound_cvars.snd_cull_distance = Cvar_Register("snd_cull_distance", "48", "Sounds further away from the listener than this are not played", CVAR__SAVE_TO_FILE, 1, 1024);
+	sound_cvars.snd_report = Cvar_Register("snd_report", "0", "Set to 1 to print the voices and the time the audio thread spends mixing", 0, 0, 1);
+
+	//mixing goes through our callback so it can be timed
+	ma_engine_config engine_config = ma_engine_config_init();
+	engine_config.dataCallback = Sound_DataCallback;
+
+	result = ma_engine_init(&engine_config, &sound_engine);
 
 	if (result != MA_SUCCESS)
 	{
@@ -81,11 +604,29 @@ int Sound_Init()
 		return 0;
 	}
 
+	if (!MPSC_Queue_Init(&sound_cmd_queue, sizeof(SoundCmd), SOUND_MAX_QUEUED_CMDS))
+	{
+		printf("Failed to init sound command queue \n");
+		return 0;
+	}
+
+	sound_voices.pool_map = CHMAP_INIT(NULL, NULL, ma_sound*, SoundPool*, 64);
+
 	return 1;
 }
 
 void Sound_Cleanup()
 {
+	//the resources release their voices, these are whatever is left
+	while (CHMap_Size(&sound_voices.pool_map) > 0)
+	{
+		SoundPool** pool = CHMap_AtIndex(&sound_voices.pool_map, 0);
+
+		Sound_releaseVoices((*pool)->source);
+	}
+	CHMap_Destruct(&sound_voices.pool_map);
+
+	MPSC_Queue_Destruct(&sound_cmd_queue);
 	ma_engine_uninit(&sound_engine);
 }
 
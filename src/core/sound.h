@@ -3,11 +3,43 @@
 #include <cglm/cglm.h>
 #include "miniaudio/miniaudio.h"
 
+/*
+	Sounds are played through voices, copies of the loaded sound that share its decoded data, so a sound
+	can overlap itself. Every sound has a small pool of voices and snd_max_voices limits how many play at once,
+	a new voice takes the place of the lowest priority one, the furthest first. Voices past snd_cull_distance
+	are never started and are stopped when the listener moves away from them.
+	Files of SOUND_STREAM_MIN_BYTES and more are streamed from disk and only have one voice
+*/
+
+#define SOUND_STREAM_MIN_BYTES (1024 * 1024)
+
+typedef enum
+{
+	SOUND_PRIORITY__LOW, //steps and other frequent sounds
+	SOUND_PRIORITY__NORMAL,
+	SOUND_PRIORITY__HIGH, //only stolen by other high priority sounds
+	SOUND_PRIORITY__MAX
+} SoundPriority;
+
+typedef struct
+{
+	int active_voices;
+	int max_voices;
+	int pooled_voices;
+	unsigned culled;
+	unsigned stolen;
+	unsigned dropped; //no voice could be taken for them
+	double mix_ms_per_second; //time the audio thread spends mixing per second of audio
+} SoundStats;
 
 bool Sound_load(const char* p_filePath, uint32_t p_flags, ma_sound* r_sound);
 void Sound_play(const char* p_soundName);
 void Sound_stop(const char* p_soundName);
+bool Sound_playAt(ma_sound* p_sound, vec3 p_position, SoundPriority p_priority); //main thread only, false if it was culled or dropped
+void Sound_releaseVoices(ma_sound* p_sound); //before the sound is uninitialized
+void Sound_Update();
+SoundStats Sound_GetStats();
 
 bool Sound_createGroup(uint32_t p_flags, ma_sound_group* r_group);
 
-void Sound_setMasterVolume(float volume);
\ No newline at end of file
+void Sound_setMasterVolume(float volume);
@@ -0,0 +1,60 @@
+#ifndef LC_BLOCK_DEFS_H
+#define LC_BLOCK_DEFS_H
+#pragma once
+
+/*
+  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	Every block type and its properties. The LC_BlockType enum, the property tables in lc_common.h
+	and the block info uniform buffer are all generated from this list.
+	After changing it run lc_block_defs_generator.py, it writes the block count and the block types
+	to shaders/lc_world/lc_block_defs.incl
+  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+typedef enum
+{
+	LC_BF__OPAQUE = 1 << 0,
+	LC_BF__SEMI_TRANSPARENT = 1 << 1, //props are semi transparent too
+	LC_BF__WATER = 1 << 2,
+	LC_BF__PROP = 1 << 3,
+	LC_BF__COLLIDABLE = 1 << 4,
+	LC_BF__EMITS_LIGHT = 1 << 5
+} LC_BlockFlags;
+
+#define LC_BF__PROP_FLAGS (LC_BF__SEMI_TRANSPARENT | LC_BF__PROP)
+
+//no light data, for the blocks without LC_BF__EMITS_LIGHT
+#define LC_BLOCK_NO_LIGHT (0, 0, 0,	0, 0,	0, 0)
+
+/*
+	X(name, display name, flags, side face, bottom face, top face, light), the faces are x and y in the block atlas.
+	The light is (color r, g, b, ambient intensity, specular intensity, radius, attenuation)
+*/
+#define LC_BLOCK_LIST(X) \
+	X(NONE,				"None",				LC_BF__SEMI_TRANSPARENT,							0, 0,	0, 0,	0, 0,	LC_BLOCK_NO_LIGHT) \
+	X(GRASS,			"Grass",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					1, 0,	3, 0,	2, 0,	LC_BLOCK_NO_LIGHT) \
+	X(SAND,				"Sand",				LC_BF__OPAQUE | LC_BF__COLLIDABLE,					4, 0,	4, 0,	4, 0,	LC_BLOCK_NO_LIGHT) \
+	X(STONE,			"Stone",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					5, 0,	5, 0,	5, 0,	LC_BLOCK_NO_LIGHT) \
+	X(DIRT,				"Dirt",				LC_BF__OPAQUE | LC_BF__COLLIDABLE,					6, 0,	6, 0,	6, 0,	LC_BLOCK_NO_LIGHT) \
+	X(TRUNK,			"Trunk",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					7, 0,	8, 0,	8, 0,	LC_BLOCK_NO_LIGHT) \
+	X(TREELEAVES,		"Tree leaves",		LC_BF__SEMI_TRANSPARENT | LC_BF__COLLIDABLE,		9, 0,	9, 0,	9, 0,	LC_BLOCK_NO_LIGHT) \
+	X(WATER,			"Water",			LC_BF__WATER | LC_BF__COLLIDABLE,					2, 29,	2, 29,	2, 29,	LC_BLOCK_NO_LIGHT) \
+	X(GLASS,			"Glass",			LC_BF__SEMI_TRANSPARENT | LC_BF__COLLIDABLE,		10, 0,	10, 0,	10, 0,	LC_BLOCK_NO_LIGHT) \
+	X(FLOWER,			"Flower",			LC_BF__PROP_FLAGS,									23, 0,	23, 0,	23, 0,	LC_BLOCK_NO_LIGHT) \
+	X(GLOWSTONE,		"Glowstone",		LC_BF__OPAQUE | LC_BF__COLLIDABLE | LC_BF__EMITS_LIGHT,	11, 0,	11, 0,	11, 0,	(0.98, 0.85, 0.45,	24.8, 0.2,	6.42, 0.20)) \
+	X(MAGMA,			"Magma",			LC_BF__OPAQUE | LC_BF__COLLIDABLE | LC_BF__EMITS_LIGHT,	12, 0,	12, 0,	12, 0,	(0.95, 0.06, 0.12,	32.0, 12.4,	8.72, 0.20)) \
+	X(OBSIDIAN,			"Obsidian",			LC_BF__OPAQUE | LC_BF__COLLIDABLE | LC_BF__EMITS_LIGHT,	13, 0,	13, 0,	13, 0,	(0.51, 0.03, 0.89,	12.0, 0.4,	9.22, 0.20)) \
+	X(DIAMOND,			"Diamond",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					14, 0,	14, 0,	14, 0,	LC_BLOCK_NO_LIGHT) \
+	X(IRON,				"Iron",				LC_BF__OPAQUE | LC_BF__COLLIDABLE,					15, 0,	15, 0,	15, 0,	LC_BLOCK_NO_LIGHT) \
+	X(SPECULAR,			"Specular",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					0, 24,	0, 24,	0, 24,	LC_BLOCK_NO_LIGHT) \
+	X(CACTUS,			"Cactus",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					17, 0,	18, 0,	16, 0,	LC_BLOCK_NO_LIGHT) \
+	X(SNOW,				"Snow",				LC_BF__OPAQUE | LC_BF__COLLIDABLE,					19, 0,	19, 0,	19, 0,	LC_BLOCK_NO_LIGHT) \
+	X(GRASS_SNOW,		"Grass snow",		LC_BF__OPAQUE | LC_BF__COLLIDABLE,					20, 0,	3, 0,	21, 0,	LC_BLOCK_NO_LIGHT) \
+	X(SPRUCE_PLANKS,	"Spruce planks",	LC_BF__OPAQUE | LC_BF__COLLIDABLE,					22, 0,	22, 0,	22, 0,	LC_BLOCK_NO_LIGHT) \
+	X(GRASS_PROP,		"Grass prop",		LC_BF__PROP_FLAGS,									1, 1,	1, 1,	1, 1,	LC_BLOCK_NO_LIGHT) \
+	X(TORCH,			"Torch",			LC_BF__PROP_FLAGS | LC_BF__EMITS_LIGHT,				2, 1,	2, 1,	2, 1,	(0.95, 0.56, 0.01,	4.0, 0.4,	3.22, 1.20)) \
+	X(DEAD_BUSH,		"Dead bush",		LC_BF__PROP_FLAGS,									3, 1,	3, 1,	3, 1,	LC_BLOCK_NO_LIGHT) \
+	X(SNOWYLEAVES,		"Snowy leaves",		LC_BF__SEMI_TRANSPARENT | LC_BF__COLLIDABLE,		4, 1,	9, 0,	21, 0,	LC_BLOCK_NO_LIGHT) \
+	X(AMETHYST,			"Amethyst",			LC_BF__OPAQUE | LC_BF__COLLIDABLE,					5, 1,	5, 1,	5, 1,	LC_BLOCK_NO_LIGHT)
+
+#endif // !LC_BLOCK_DEFS_H
@@ -0,0 +1,43 @@
+import os
+import re
+
+#Writes the block count and the block types from lc_block_defs.h to a shader include,
+#so the block info uniform buffer in the shaders always matches LC_BT__MAX
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFS_FILE = os.path.join(SCRIPT_DIR, "lc_block_defs.h")
+OUTPUT_FILE = os.path.join(SCRIPT_DIR, "..", "..", "shaders", "lc_world", "lc_block_defs.incl")
+
+
+def parse_block_defs(filename):
+    blocks = []
+
+    sf = open(filename, "r")
+
+    for line in sf:
+        block_match = re.match(r"\s*X\((\w+),\s*\"", line)
+        if block_match:
+            blocks.append(block_match.group(1))
+
+    sf.close()
+
+    return blocks
+
+
+def write_block_defs_incl():
+    blocks = parse_block_defs(DEFS_FILE)
+
+    file = open(OUTPUT_FILE, "w")
+
+    file.write("/*\n ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ \n")
+    file.write("BLOCK DEFINITIONS. Block count and block types from lc_block_defs.h \nGenerated by a python script lc_block_defs_generator.py \n")
+    file.write("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ \n */ \n")
+
+    file.write("#define BLOCK_TYPE_COUNT " + str(len(blocks)) + "\n\n")
+
+    for index, name in enumerate(blocks):
+        file.write("#define BLOCK_TYPE_" + name + " " + str(index) + "\n")
+
+    file.close()
+
+write_block_defs_incl()
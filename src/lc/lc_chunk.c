@@ -10,7 +10,6 @@
 #define VERTICES_PER_CUBE 36
 #define FACES_PER_CUBE 6
 
-extern void LC_GenerateAdditionalBlocks(LC_Chunk* _chunk, int p_x, int p_y, int p_z, int p_gX, int p_gY, int p_gZ);
 
 static const vec3 CUBE_POSITION_VERTICES[] =
 {
@@ -71,16 +70,8 @@ static bool LC_Chunk_CompareBlocks(LC_Block const b1, LC_Block const b2)
 //#define CULL_SKIP_TRANSPARENT_FACES
 static inline bool LC_Chunk_skipCheck(LC_Block const b1, LC_Block const b2)
 {
-	//If the other block is none, dont skip
-	if (b2.type == LC_BT__NONE)
-	{
-		return false;
-	}
-	//Always skip props
-	if (LC_isBlockProp(b1.type) || LC_isBlockProp(b2.type))
-	{
-		return false;
-	}
+	unsigned flags1 = LC_BLOCK_FLAGS[b1.type];
+	unsigned flags2 = LC_BLOCK_FLAGS[b2.type];
 
 #ifdef CULL_SKIP_TRANSPARENT_FACES
 	//If the first and the second block are transparent don't skip
@@ -99,14 +90,11 @@ static inline bool LC_Chunk_skipCheck(LC_Block const b1, LC_Block const b2)
 		return false;
 	}
 #endif
-	//if the first one isn't water and the other is don't skip
-	if (!LC_IsBlockWater(b1.type) && LC_IsBlockWater(b2.type))
-	{
-		return false;
-	}
+	//Don't skip if the other block is none, if either is a prop
+	//or if the first one isn't water and the other is. No branches, this runs six times per block
+	unsigned draw = (b2.type == LC_BT__NONE) | ((flags1 | flags2) & LC_BF__PROP) | (~flags1 & flags2 & LC_BF__WATER);
 
-	//we skip
-	return true;
+	return draw == 0;
 }
 
 static void LC_Chunk_SetBit(uint16_t drawn_faces[LC_CHUNK_WIDTH][LC_CHUNK_HEIGHT][6], int x, int y, int z, int face, bool p_bool)
@@ -162,14 +150,6 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 		}
 	}
 
-	uint8_t min_water_x = LC_CHUNK_WIDTH;
-	uint8_t min_water_y = LC_CHUNK_HEIGHT;
-	uint8_t min_water_z = LC_CHUNK_LENGTH;
-
-	uint8_t max_water_x = 0;
-	uint8_t max_water_y = 0;
-	uint8_t max_water_z = 0;
-
 	uint16_t drawn_faces[LC_CHUNK_WIDTH][LC_CHUNK_HEIGHT][6];
 	memset(&drawn_faces, 0, sizeof(drawn_faces));
 
@@ -196,16 +176,11 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 				if (chunk->blocks[x][y][z].type == LC_BT__NONE)
 					continue;
 
+				const unsigned block_flags = LC_BLOCK_FLAGS[chunk->blocks[x][y][z].type];
+
 				//The water is done seperately
-				if (LC_IsBlockWater(chunk->blocks[x][y][z].type))
+				if (block_flags & LC_BF__WATER)
 				{
-					max_water_x = max(max_water_x, x);
-					max_water_y = max(max_water_y, y);
-					max_water_z = max(max_water_z, z);
-
-					min_water_x = min(min_water_x, x);
-					min_water_y = min(min_water_y, y);
-					min_water_z = min(min_water_z, z);
 					continue;
 				}
 
@@ -246,19 +221,19 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 				}
 				*/
 
-				if (LC_isBlockProp(chunk->blocks[x][y][z].type))
+				if (block_flags & LC_BF__PROP)
 				{
 					skip_bottom = true;
 					skip_top = true;
 				}
 
 				//choose buffer and index
-				if (LC_isBlockSemiTransparent(chunk->blocks[x][y][z].type) || LC_isBlockProp(chunk->blocks[x][y][z].type))
+				if (block_flags & LC_BF__SEMI_TRANSPARENT)
 				{
 					buffer = transparent_vertices;
 					index = &transparent_index;
 				}
-				else if (!LC_IsBlockWater(chunk->blocks[x][y][z].type))
+				else if (!(block_flags & LC_BF__WATER))
 				{
 					buffer = vertices;
 					index = &vert_index;
@@ -719,14 +694,30 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 		}
 	}
 
+	memset(result->water_surface, LC_CHUNK_NO_WATER_SURFACE, sizeof(result->water_surface));
+
 	if (chunk->water_blocks > 0)
 	{
-		//add a small offset
-		max_water_x += 1;
-		max_water_z += 1;
+		//the surface height of every column, only the columns with water get a quad
+		int surface_columns = 0;
 
-		size_t total_vertices = (max_water_x - min_water_x) * (max_water_z - min_water_z) * 6;
-		water_vertices = calloc(total_vertices, sizeof(ChunkWaterVertex));
+		for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+		{
+			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+			{
+				for (int y = LC_CHUNK_HEIGHT - 1; y >= 0; y--)
+				{
+					if (LC_IsBlockWater(chunk->blocks[x][y][z].type))
+					{
+						result->water_surface[x][z] = y;
+						surface_columns++;
+						break;
+					}
+				}
+			}
+		}
+
+		water_vertices = calloc(surface_columns * 6, sizeof(ChunkWaterVertex));
 
 		if (!water_vertices)
 		{
@@ -736,39 +727,52 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 
 		water_index = 0;
 
-		for (int x = min_water_x; x < max_water_x; x++)
+		for (int x = 0; x < LC_CHUNK_WIDTH; x++)
 		{
-			for (int z = min_water_z; z < max_water_z; z++)
+			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
 			{
+				const int8_t height = result->water_surface[x][z];
+
+				if (height == LC_CHUNK_NO_WATER_SURFACE)
+				{
+					continue;
+				}
+
 				//FIRST TRIANGLE
 				water_vertices[water_index].position[0] = x;
-				water_vertices[water_index].position[1] = z;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z;
 
 				water_index++;
 
 				water_vertices[water_index].position[0] = x + 1;
-				water_vertices[water_index].position[1] = z;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z;
 
 				water_index++;
 
 				water_vertices[water_index].position[0] = x + 1;
-				water_vertices[water_index].position[1] = z + 1;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z + 1;
 
 				water_index++;
 
 				//SECOND TRIANGLE
 				water_vertices[water_index].position[0] = x;
-				water_vertices[water_index].position[1] = z;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z;
 
 				water_index++;
 
 				water_vertices[water_index].position[0] = x;
-				water_vertices[water_index].position[1] = z + 1;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z + 1;
 
 				water_index++;
 
 				water_vertices[water_index].position[0] = x + 1;
-				water_vertices[water_index].position[1] = z + 1;
+				water_vertices[water_index].position[1] = height;
+				water_vertices[water_index].position[2] = z + 1;
 
 				water_index++;
 			}
@@ -787,10 +791,54 @@ GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk)
 	return result;
 }
 
+void LC_Chunk_RecountBlocks(LC_Chunk* const p_chunk)
+{
+	p_chunk->alive_blocks = 0;
+	p_chunk->opaque_blocks = 0;
+	p_chunk->transparent_blocks = 0;
+	p_chunk->water_blocks = 0;
+	p_chunk->light_blocks = 0;
+
+	for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+	{
+		for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
+		{
+			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+			{
+				uint8_t type = p_chunk->blocks[x][y][z].type;
+
+				if (type == LC_BT__NONE)
+				{
+					continue;
+				}
+
+				if (LC_isBlockSemiTransparent(type))
+				{
+					p_chunk->transparent_blocks++;
+				}
+				else if (LC_IsBlockWater(type))
+				{
+					p_chunk->water_blocks++;
+				}
+				else
+				{
+					p_chunk->opaque_blocks++;
+				}
+				if (LC_isblockEmittingLight(type))
+				{
+					p_chunk->light_blocks++;
+				}
+				p_chunk->alive_blocks++;
+			}
+		}
+	}
+}
+
 LC_Chunk LC_Chunk_Create(int p_x, int p_y, int p_z)
 {
 	LC_Chunk chunk;
 	memset(&chunk, 0, sizeof(LC_Chunk));
+	memset(chunk.water_surface, LC_CHUNK_NO_WATER_SURFACE, sizeof(chunk.water_surface));
 
 	chunk.global_position[0] = p_x;
 	chunk.global_position[1] = p_y;
@@ -930,11 +978,6 @@ void LC_Chunk_GenerateBlocks(LC_Chunk* const _chunk, int _seed)
 					generated_block.type = LC_Generate_Block(g_x, g_y, g_z);
 
 					LC_Chunk_SetBlock(_chunk, x, y, z, generated_block.type);
-
-					if (generated_block.type != LC_BT__NONE)
-					{
-						LC_GenerateAdditionalBlocks(_chunk, x, y, z, g_x, g_y, g_z);
-					}
 				}
 				
 			}
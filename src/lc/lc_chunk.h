@@ -7,6 +7,8 @@
 
 #include "lc/lc_common.h"
 
+#define LC_CHUNK_NO_WATER_SURFACE -1
+
 typedef struct
 {
 	uint8_t type;
@@ -37,17 +39,53 @@ typedef struct
 	int16_t water_blocks; //Num water blocks
 
 	int16_t light_blocks; //Num blocks that emit light
+
+	//local y of the highest water block in every column, LC_CHUNK_NO_WATER_SURFACE if there is none. Updated when the chunk is meshed
+	int8_t water_surface[LC_CHUNK_WIDTH][LC_CHUNK_LENGTH];
 	
 	bool is_deleted;
 
+	bool is_hidden; //past the render distance, kept loaded but not drawn until it leaves the unload distance
+
+	uint8_t lod_level; //0 for full detail chunks, the distant terrain has cells of 1 << lod_level blocks
+
+	//block edits are remeshed on the lc workers, see LC_World_QueueChunkEdit
+	uint8_t remesh_state;
+	unsigned edit_serial; //serial of the newest edit, 0 if never edited
+	unsigned remesh_serial; //edit serial of the snapshot that is being remeshed
+	int64_t pending_edit_time; //performance counter time of the oldest edit that isn't visible yet, 0 if none
+
 } LC_Chunk;
 
+#define LC_CHUNK_CELLS (LC_CHUNK_WIDTH * LC_CHUNK_HEIGHT * LC_CHUNK_LENGTH)
+
+//cell index of a block in its chunk
+#define LC_DECORATION_CELL(x, y, z) ((((x) * LC_CHUNK_HEIGHT) + (y)) * LC_CHUNK_LENGTH + (z))
+
+//A decoration block that landed in a neighbour of the chunk that was decorated
+typedef struct
+{
+	int8_t chunk_offset[3]; //neighbour chunk key - decorated chunk key
+	uint8_t block_type;
+	uint16_t cell; //LC_DECORATION_CELL in the neighbour
+} LC_DecorationSpill;
+
 
 GeneratedChunkVerticesResult* LC_Chunk_GenerateVertices(LC_Chunk* const chunk);
 LC_Chunk LC_Chunk_Create(int p_x, int p_y, int p_z);
-void LC_Chunk_GenerateBlocks(LC_Chunk* const _chunk, int _seed);
+void LC_Chunk_GenerateBlocks(LC_Chunk* const _chunk, int _seed); //terrain only, see LC_Generate_Decorate
 void LC_Chunk_SetBlock(LC_Chunk* const p_chunk, int x, int y, int z, uint8_t block_type);
+void LC_Chunk_RecountBlocks(LC_Chunk* const p_chunk); //for when the blocks were written directly
 uint8_t LC_Chunk_getType(LC_Chunk* const p_chunk, int x, int y, int z);
 LC_Block* LC_Chunk_GetBlock(LC_Chunk* const p_chunk, int x, int y, int z);
 
+/*
+	Second generation phase, after the terrain of the chunk. Trees and props are grown from the surface blocks of
+	the chunk and can reach into the neighbours, those blocks are returned as spills (malloced, NULL if none)
+	to be merged with LC_Generate_MergeDecoration when the neighbour is ready. The merge keeps the block with
+	the higher priority, so the result doesn't depend on the order the chunks are generated in
+*/
+int LC_Generate_Decorate(LC_Chunk* const p_chunk, LC_DecorationSpill** r_spills);
+bool LC_Generate_MergeDecoration(LC_Chunk* const p_chunk, int p_x, int p_y, int p_z, uint8_t p_blockType);
+
 #endif // !LC_CHUNK
\ No newline at end of file
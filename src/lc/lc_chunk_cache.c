@@ -0,0 +1,274 @@
+#include "lc/lc_chunk_cache.h"
+
+#include <string.h>
+
+#include "lc/lc_world_internal.h"
+#include "core/cvar.h"
+
+typedef struct LC_CachedChunk
+{
+	ivec3 key;
+	struct LC_CachedChunk* prev; //towards the most recently used
+	struct LC_CachedChunk* next;
+	uint8_t* runs; //run length encoded block types, the run length - 1 and the type, y major
+	size_t run_bytes;
+	GeneratedChunkVerticesResult* mesh; //NULL if it has to be meshed again
+	uint8_t* fluid_levels; //LC_FluidChunk levels, NULL if all of its water was still
+	size_t memory_size;
+} LC_CachedChunk;
+
+typedef struct
+{
+	CHMap map; //chunk key -> LC_CachedChunk*
+	LC_CachedChunk* head; //most recently unloaded
+	LC_CachedChunk* tail;
+	int count;
+	size_t memory_size;
+	unsigned hits;
+	unsigned misses;
+	uint8_t scratch[LC_CHUNK_CELLS * 2]; //worst case of the run length encoding
+} LC_ChunkCache;
+
+static LC_ChunkCache lc_chunk_cache;
+static Cvar* lc_chunk_cache_mb;
+
+static void LC_ChunkCache_Unlink(LC_CachedChunk* const p_entry)
+{
+	if (p_entry->prev)
+	{
+		p_entry->prev->next = p_entry->next;
+	}
+	else
+	{
+		lc_chunk_cache.head = p_entry->next;
+	}
+	if (p_entry->next)
+	{
+		p_entry->next->prev = p_entry->prev;
+	}
+	else
+	{
+		lc_chunk_cache.tail = p_entry->prev;
+	}
+
+	CHMap_Erase(&lc_chunk_cache.map, p_entry->key);
+
+	lc_chunk_cache.count--;
+	lc_chunk_cache.memory_size -= p_entry->memory_size;
+}
+
+static void LC_ChunkCache_FreeEntry(LC_CachedChunk* const p_entry)
+{
+	LC_World_FreeVerticesResult(p_entry->mesh);
+	free(p_entry->fluid_levels);
+	free(p_entry->runs);
+	free(p_entry);
+}
+
+static void LC_ChunkCache_Trim(size_t p_budgetBytes)
+{
+	while (lc_chunk_cache.tail && lc_chunk_cache.memory_size > p_budgetBytes)
+	{
+		LC_CachedChunk* entry = lc_chunk_cache.tail;
+
+		LC_ChunkCache_Unlink(entry);
+		LC_ChunkCache_FreeEntry(entry);
+	}
+}
+
+static size_t LC_ChunkCache_GetBudget()
+{
+	return (size_t)lc_chunk_cache_mb->int_value * 1024 * 1024;
+}
+
+//takes the mesh and the fluid levels
+void LC_ChunkCache_Store(const ivec3 p_key, LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* p_mesh, uint8_t* p_fluidLevels)
+{
+	size_t budget = LC_ChunkCache_GetBudget();
+
+	LC_CachedChunk** found = CHMap_Find(&lc_chunk_cache.map, p_key);
+
+	if (found)
+	{
+		LC_CachedChunk* old_entry = *found;
+
+		LC_ChunkCache_Unlink(old_entry);
+		LC_ChunkCache_FreeEntry(old_entry);
+	}
+
+	if (budget == 0)
+	{
+		LC_World_FreeVerticesResult(p_mesh);
+		free(p_fluidLevels);
+		return;
+	}
+
+	//y major, so the layers of air and stone become long runs
+	size_t run_bytes = 0;
+	uint8_t run_type = p_chunk->blocks[0][0][0].type;
+	int run_length = 0;
+
+	for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
+	{
+		for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+		{
+			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+			{
+				uint8_t type = p_chunk->blocks[x][y][z].type;
+
+				if (type != run_type || run_length == 256)
+				{
+					lc_chunk_cache.scratch[run_bytes++] = (uint8_t)(run_length - 1);
+					lc_chunk_cache.scratch[run_bytes++] = run_type;
+
+					run_type = type;
+					run_length = 0;
+				}
+				run_length++;
+			}
+		}
+	}
+	lc_chunk_cache.scratch[run_bytes++] = (uint8_t)(run_length - 1);
+	lc_chunk_cache.scratch[run_bytes++] = run_type;
+
+	LC_CachedChunk* entry = calloc(1, sizeof(LC_CachedChunk));
+	uint8_t* runs = malloc(run_bytes);
+
+	if (!entry || !runs)
+	{
+		free(entry);
+		free(runs);
+		LC_World_FreeVerticesResult(p_mesh);
+		free(p_fluidLevels);
+		return;
+	}
+
+	memcpy(runs, lc_chunk_cache.scratch, run_bytes);
+
+	memcpy(entry->key, p_key, sizeof(ivec3));
+	entry->runs = runs;
+	entry->run_bytes = run_bytes;
+	entry->mesh = p_mesh;
+	entry->fluid_levels = p_fluidLevels;
+	entry->memory_size = sizeof(LC_CachedChunk) + run_bytes + ((p_fluidLevels) ? LC_CHUNK_CELLS : 0);
+
+	if (p_mesh)
+	{
+		entry->memory_size += sizeof(GeneratedChunkVerticesResult) + sizeof(ChunkVertex) * (p_mesh->opaque_vertex_count + p_mesh->transparent_vertex_count)
+			+ sizeof(ChunkWaterVertex) * p_mesh->water_vertex_count;
+	}
+
+	if (!CHMap_Insert(&lc_chunk_cache.map, p_key, &entry))
+	{
+		LC_ChunkCache_FreeEntry(entry);
+		return;
+	}
+
+	entry->next = lc_chunk_cache.head;
+
+	if (lc_chunk_cache.head)
+	{
+		lc_chunk_cache.head->prev = entry;
+	}
+	else
+	{
+		lc_chunk_cache.tail = entry;
+	}
+	lc_chunk_cache.head = entry;
+
+	lc_chunk_cache.count++;
+	lc_chunk_cache.memory_size += entry->memory_size;
+
+	LC_ChunkCache_Trim(budget);
+}
+
+//the entry is handed to the chunk, r_mesh is NULL if it still has to be meshed and r_fluidLevels if all of its water was still
+bool LC_ChunkCache_Restore(const ivec3 p_key, LC_Chunk* const r_chunk, GeneratedChunkVerticesResult** r_mesh, uint8_t** r_fluidLevels)
+{
+	LC_CachedChunk** found = CHMap_Find(&lc_chunk_cache.map, p_key);
+
+	if (!found)
+	{
+		lc_chunk_cache.misses++;
+		return false;
+	}
+
+	LC_CachedChunk* entry = *found;
+
+	int cell = 0;
+	for (size_t i = 0; i < entry->run_bytes; i += 2)
+	{
+		int run_length = entry->runs[i] + 1;
+		uint8_t type = entry->runs[i + 1];
+
+		for (int k = 0; k < run_length && cell < LC_CHUNK_CELLS; k++, cell++)
+		{
+			int y = cell / (LC_CHUNK_WIDTH * LC_CHUNK_LENGTH);
+			int x = (cell / LC_CHUNK_LENGTH) % LC_CHUNK_WIDTH;
+			int z = cell % LC_CHUNK_LENGTH;
+
+			r_chunk->blocks[x][y][z].type = type;
+		}
+	}
+
+	LC_Chunk_RecountBlocks(r_chunk);
+
+	*r_mesh = entry->mesh;
+	entry->mesh = NULL;
+
+	*r_fluidLevels = entry->fluid_levels;
+	entry->fluid_levels = NULL;
+
+	LC_ChunkCache_Unlink(entry);
+	LC_ChunkCache_FreeEntry(entry);
+
+	lc_chunk_cache.hits++;
+
+	return true;
+}
+
+void LC_ChunkCache_Drop(const ivec3 p_key)
+{
+	LC_CachedChunk** found = CHMap_Find(&lc_chunk_cache.map, p_key);
+
+	if (found)
+	{
+		LC_CachedChunk* entry = *found;
+
+		LC_ChunkCache_Unlink(entry);
+		LC_ChunkCache_FreeEntry(entry);
+	}
+}
+
+bool LC_ChunkCache_Contains(const ivec3 p_key)
+{
+	return CHMap_Find(&lc_chunk_cache.map, p_key) != NULL;
+}
+
+bool LC_ChunkCache_IsEnabled()
+{
+	return LC_ChunkCache_GetBudget() > 0;
+}
+
+void LC_ChunkCache_GetStats(LC_ChunkCacheStats* const r_stats)
+{
+	r_stats->cached_chunks = lc_chunk_cache.count;
+	r_stats->cached_bytes = lc_chunk_cache.memory_size;
+	r_stats->budget_bytes = (lc_chunk_cache_mb) ? LC_ChunkCache_GetBudget() : 0;
+	r_stats->hits = lc_chunk_cache.hits;
+	r_stats->misses = lc_chunk_cache.misses;
+}
+
+void LC_ChunkCache_Init()
+{
+	memset(&lc_chunk_cache, 0, sizeof(lc_chunk_cache));
+	lc_chunk_cache.map = CHMAP_INIT_POOLED((CHMap_HashFun)Hash_ivec3, NULL, ivec3, LC_CachedChunk*, 256);
+
+	lc_chunk_cache_mb = Cvar_Register("lc_chunk_cache_mb", "64", "MB of unloaded chunk blocks and meshes that are kept, so they don't have to be generated again when they come back", CVAR__SAVE_TO_FILE, 0, 1024);
+}
+
+void LC_ChunkCache_Exit()
+{
+	LC_ChunkCache_Trim(0);
+	CHMap_Destruct(&lc_chunk_cache.map);
+}
@@ -0,0 +1,22 @@
+#ifndef LC_CHUNK_CACHE_H
+#define LC_CHUNK_CACHE_H
+#pragma once
+
+#include "lc/lc_world.h"
+
+/*
+	Unloaded chunks, so a chunk that comes back into the render distance doesn't have to be generated and meshed again.
+	The least recently unloaded chunks are dropped when it goes over lc_chunk_cache_mb
+*/
+
+void LC_ChunkCache_Init();
+void LC_ChunkCache_Exit();
+
+bool LC_ChunkCache_IsEnabled(); //lc_chunk_cache_mb is above 0
+void LC_ChunkCache_Store(const ivec3 p_key, LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* p_mesh, uint8_t* p_fluidLevels);
+bool LC_ChunkCache_Restore(const ivec3 p_key, LC_Chunk* const r_chunk, GeneratedChunkVerticesResult** r_mesh, uint8_t** r_fluidLevels);
+void LC_ChunkCache_Drop(const ivec3 p_key);
+bool LC_ChunkCache_Contains(const ivec3 p_key);
+void LC_ChunkCache_GetStats(LC_ChunkCacheStats* const r_stats); //fills the cache fields
+
+#endif // !LC_CHUNK_CACHE_H
@@ -4,49 +4,6 @@
 #include <glad/glad.h>
 #include <string.h>
 
-static void LC_AssertBoundType(uint8_t block_type)
-{
-	assert(block_type < LC_BT__MAX && "Block type invalid");
-}
-
-bool LC_IsBlockWater(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-	
-	return LC_BLOCK_MATERIAL_DATA[block_type].material_type == 2;
-}
-
-bool LC_isBlockOpaque(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-
-	return LC_BLOCK_MATERIAL_DATA[block_type].material_type == 0;
-}
-bool LC_isBlockSemiTransparent(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-
-	return LC_BLOCK_MATERIAL_DATA[block_type].material_type == 1 || LC_BLOCK_MATERIAL_DATA[block_type].material_type == 3;
-}
-bool LC_isBlockCollidable(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-
-	return LC_BLOCK_MATERIAL_DATA[block_type].collidable == 1;
-}
-bool LC_isblockEmittingLight(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-
-	return LC_BLOCK_MATERIAL_DATA[block_type].emits_light == 1;
-}
-bool LC_isBlockProp(uint8_t block_type)
-{
-	LC_AssertBoundType(block_type);
-
-	return LC_BLOCK_MATERIAL_DATA[block_type].material_type == 3;
-}
-
 const char* LC_getBlockName(uint8_t block_type)
 {
 	LC_AssertBoundType(block_type);
@@ -97,17 +54,7 @@ LC_Block_LightData LC_getBlockLightingData(uint8_t block_type)
 
 	assert(LC_isblockEmittingLight(block_type));
 
-	const int array_size = sizeof(LC_BLOCK_LIGHTING_DATA) / sizeof(LC_Block_LightData);
-
-	for (int i = 0; i < array_size; i++)
-	{
-		if (LC_BLOCK_LIGHTING_DATA[i].block_type == block_type)
-		{
-			return LC_BLOCK_LIGHTING_DATA[i];
-		}
-	}
-
-	return LC_BLOCK_LIGHTING_DATA[0];
+	return LC_BLOCK_LIGHTING_DATA[block_type];
 }
 
 void LC_getNormalizedChunkPosition(float p_x, float p_y, float p_z, ivec3 dest)
@@ -1,6 +1,7 @@
 #include "lc/lc_core.h"
 
 #include "core/core_common.h"
+#include "lc/lc_fluids.h"
 
 extern LC_CoreData lc_core_data;
 
@@ -79,5 +80,7 @@ void LC_Exit()
 */
 void LC_PhysUpdate(float delta)
 {
+	LC_Fluids_Tick();
+
 	PhysicsWorld_Step(LC_World_GetPhysWorld(), delta);
 }
\ No newline at end of file
@@ -20,6 +20,7 @@ void LC_EndFrame();
 void LC_Draw();
 void LC_PhysUpdate(float delta);
 int LC_Init();
+int LC_BuildTextureCache();
 void LC_Exit();
 
 typedef struct
@@ -0,0 +1,325 @@
+#include "lc/lc_decorations.h"
+
+#include <string.h>
+
+#include "lc/lc_world_internal.h"
+#include "lc/lc_chunk_cache.h"
+
+#define LC_DECORATION_PRUNE_PER_FRAME 16
+
+typedef struct
+{
+	ivec3 key;
+	dynamic_array* blocks; //LC_DecorationBlock, in the order they were added
+	uint32_t sources; //a bit for each neighbour that added its blocks, LC_Decorations_NeighbourIndex of the offset to it
+} LC_ChunkDecorations;
+
+typedef struct
+{
+	CHMap map; //chunk key -> LC_ChunkDecorations*
+	dynamic_array* keys; //ivec3, pruned a few at a time
+	int next_prune;
+} LC_DecorationState;
+
+static LC_DecorationState lc_decorations;
+
+static int LC_Decorations_NeighbourIndex(int p_x, int p_y, int p_z)
+{
+	return (p_x + 1) + (p_y + 1) * 3 + (p_z + 1) * 9;
+}
+
+static LC_ChunkDecorations* LC_Decorations_Find(const ivec3 p_key)
+{
+	LC_ChunkDecorations** found = CHMap_Find(&lc_decorations.map, p_key);
+
+	return (found) ? *found : NULL;
+}
+
+static LC_ChunkDecorations* LC_Decorations_Create(const ivec3 p_key)
+{
+	LC_ChunkDecorations* entry = calloc(1, sizeof(LC_ChunkDecorations));
+
+	if (!entry)
+	{
+		return NULL;
+	}
+
+	memcpy(entry->key, p_key, sizeof(ivec3));
+	entry->blocks = dA_INIT(LC_DecorationBlock, 0);
+
+	if (!CHMap_Insert(&lc_decorations.map, p_key, &entry))
+	{
+		dA_Destruct(entry->blocks);
+		free(entry);
+		return NULL;
+	}
+
+	dA_emplaceBackData(lc_decorations.keys, entry->key);
+
+	return entry;
+}
+
+static void LC_Decorations_Free(LC_ChunkDecorations* const p_entry)
+{
+	dA_Destruct(p_entry->blocks);
+	free(p_entry);
+}
+
+int LC_Decorations_Count(const ivec3 p_key)
+{
+	LC_ChunkDecorations* entry = LC_Decorations_Find(p_key);
+
+	return (entry) ? (int)dA_size(entry->blocks) : 0;
+}
+
+//the blocks can grow while the worker is generating
+LC_DecorationBlock* LC_Decorations_Copy(const ivec3 p_key, int p_count)
+{
+	LC_ChunkDecorations* entry = LC_Decorations_Find(p_key);
+
+	if (!entry || p_count <= 0)
+	{
+		return NULL;
+	}
+
+	LC_DecorationBlock* blocks = malloc(sizeof(LC_DecorationBlock) * p_count);
+
+	if (blocks)
+	{
+		memcpy(blocks, entry->blocks->data, sizeof(LC_DecorationBlock) * p_count);
+	}
+
+	return blocks;
+}
+
+bool LC_Decorations_Merge(LC_Chunk* const p_chunk, const LC_DecorationBlock* p_blocks, int p_count)
+{
+	bool changed = false;
+
+	for (int i = 0; i < p_count; i++)
+	{
+		int cell = p_blocks[i].cell;
+
+		int x = cell / (LC_CHUNK_HEIGHT * LC_CHUNK_LENGTH);
+		int y = (cell / LC_CHUNK_LENGTH) % LC_CHUNK_HEIGHT;
+		int z = cell % LC_CHUNK_LENGTH;
+
+		if (LC_Generate_MergeDecoration(p_chunk, x, y, z, p_blocks[i].block_type))
+		{
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+//the blocks that were added after the chunk was handed to a worker
+bool LC_Decorations_MergeLate(LC_Chunk* const p_chunk, const ivec3 p_key, int p_seen)
+{
+	LC_ChunkDecorations* entry = LC_Decorations_Find(p_key);
+
+	if (!entry || (int)dA_size(entry->blocks) <= p_seen)
+	{
+		return false;
+	}
+
+	return LC_Decorations_Merge(p_chunk, dA_at(entry->blocks, p_seen), (int)dA_size(entry->blocks) - p_seen);
+}
+
+static void LC_Decorations_MergeIntoWorld(LC_Chunk* const p_chunk, const LC_DecorationBlock* p_blocks, int p_count)
+{
+	int old_alive_blocks = p_chunk->alive_blocks;
+
+	if (!LC_Decorations_Merge(p_chunk, p_blocks, p_count))
+	{
+		return;
+	}
+
+	//a tree top can grow into an empty chunk
+	if (old_alive_blocks == 0 && p_chunk->alive_blocks > 0)
+	{
+		lc_world.num_alive_chunks++;
+	}
+
+	LC_World_QueueChunkRemesh(p_chunk);
+	LC_World_SubmitRemeshes();
+}
+
+void LC_Decorations_AddSpills(const ivec3 p_sourceKey, const LC_DecorationSpill* p_spills, int p_count)
+{
+	LC_ChunkDecorations* targets[27];
+	int first_blocks[27];
+	bool visited[27];
+
+	memset(targets, 0, sizeof(targets));
+	memset(visited, 0, sizeof(visited));
+
+	for (int i = 0; i < p_count; i++)
+	{
+		const LC_DecorationSpill* spill = &p_spills[i];
+		int neighbour = LC_Decorations_NeighbourIndex(spill->chunk_offset[0], spill->chunk_offset[1], spill->chunk_offset[2]);
+
+		if (!visited[neighbour])
+		{
+			visited[neighbour] = true;
+
+			ivec3 key;
+			key[0] = p_sourceKey[0] + spill->chunk_offset[0];
+			key[1] = p_sourceKey[1] + spill->chunk_offset[1];
+			key[2] = p_sourceKey[2] + spill->chunk_offset[2];
+
+			LC_ChunkDecorations* entry = LC_Decorations_Find(key);
+
+			if (!entry)
+			{
+				entry = LC_Decorations_Create(key);
+			}
+
+			uint32_t source_bit = 1u << LC_Decorations_NeighbourIndex(-spill->chunk_offset[0], -spill->chunk_offset[1], -spill->chunk_offset[2]);
+
+			//a chunk that was generated again grows the same blocks
+			if (entry && !(entry->sources & source_bit))
+			{
+				entry->sources |= source_bit;
+				targets[neighbour] = entry;
+				first_blocks[neighbour] = (int)dA_size(entry->blocks);
+			}
+		}
+
+		if (targets[neighbour])
+		{
+			LC_DecorationBlock block;
+			block.cell = spill->cell;
+			block.block_type = spill->block_type;
+
+			dA_emplaceBackData(targets[neighbour]->blocks, &block);
+		}
+	}
+
+	for (int i = 0; i < 27; i++)
+	{
+		LC_ChunkDecorations* entry = targets[i];
+
+		if (!entry)
+		{
+			continue;
+		}
+
+		LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, entry->key);
+
+		if (chunk && !chunk->is_deleted)
+		{
+			LC_Decorations_MergeIntoWorld(chunk, dA_at(entry->blocks, first_blocks[i]), (int)dA_size(entry->blocks) - first_blocks[i]);
+			continue;
+		}
+
+		//the cached blocks don't have them, it's generated again instead
+		LC_ChunkCache_Drop(entry->key);
+	}
+}
+
+static bool LC_Decorations_isChunkKept(const ivec3 p_key)
+{
+	return CHMap_Find(&lc_world.chunk_map, p_key) || LC_ChunkCache_Contains(p_key);
+}
+
+static bool LC_Decorations_CanPrune(LC_ChunkDecorations* const p_entry, ivec3 p_bounds[2])
+{
+	if (LC_World_isChunkKeyInBounds(p_entry->key, p_bounds) || LC_Decorations_isChunkKept(p_entry->key))
+	{
+		return false;
+	}
+
+	//a neighbour that comes back from the cache won't add its blocks again
+	for (int i = 0; i < 27; i++)
+	{
+		if (!(p_entry->sources & (1u << i)))
+		{
+			continue;
+		}
+
+		ivec3 key;
+		key[0] = p_entry->key[0] + (i % 3) - 1;
+		key[1] = p_entry->key[1] + ((i / 3) % 3) - 1;
+		key[2] = p_entry->key[2] + (i / 9) - 1;
+
+		if (LC_Decorations_isChunkKept(key))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void LC_Decorations_Prune(ivec3 p_unloadBounds[2])
+{
+	int key_count = dA_size(lc_decorations.keys);
+
+	if (key_count == 0)
+	{
+		return;
+	}
+
+	ivec3 bounds[2];
+	memcpy(bounds, p_unloadBounds, sizeof(bounds));
+
+	//so every neighbour that added to a pruned chunk is outside of the unload bounds too
+	for (int i = 0; i < 3; i++)
+	{
+		bounds[0][i] -= 1;
+		bounds[1][i] += 1;
+	}
+
+	for (int i = 0; i < LC_DECORATION_PRUNE_PER_FRAME && key_count > 0; i++)
+	{
+		if (lc_decorations.next_prune >= key_count)
+		{
+			lc_decorations.next_prune = 0;
+		}
+
+		ivec3* key = dA_at(lc_decorations.keys, lc_decorations.next_prune);
+		LC_ChunkDecorations* entry = LC_Decorations_Find(*key);
+
+		if (entry && !LC_Decorations_CanPrune(entry, bounds))
+		{
+			lc_decorations.next_prune++;
+			continue;
+		}
+
+		if (entry)
+		{
+			CHMap_Erase(&lc_decorations.map, entry->key);
+			LC_Decorations_Free(entry);
+		}
+
+		//swap with the last key
+		key_count--;
+		memcpy(key, dA_at(lc_decorations.keys, key_count), sizeof(ivec3));
+		dA_resize(lc_decorations.keys, key_count);
+	}
+}
+
+void LC_Decorations_Init()
+{
+	memset(&lc_decorations, 0, sizeof(lc_decorations));
+	lc_decorations.map = CHMAP_INIT_POOLED((CHMap_HashFun)Hash_ivec3, NULL, ivec3, LC_ChunkDecorations*, 256);
+	lc_decorations.keys = dA_INIT(ivec3, 256);
+}
+
+void LC_Decorations_Exit()
+{
+	for (int i = 0; i < dA_size(lc_decorations.keys); i++)
+	{
+		ivec3* key = dA_at(lc_decorations.keys, i);
+		LC_ChunkDecorations* entry = LC_Decorations_Find(*key);
+
+		if (entry)
+		{
+			LC_Decorations_Free(entry);
+		}
+	}
+
+	CHMap_Destruct(&lc_decorations.map);
+	dA_Destruct(lc_decorations.keys);
+}
@@ -0,0 +1,28 @@
+#ifndef LC_DECORATIONS_H
+#define LC_DECORATIONS_H
+#pragma once
+
+#include "lc/lc_world.h"
+
+/*
+	Trees and props that neighbours grew into a chunk, so the chunk gets them whenever it's generated.
+	Dropped once the chunk and every neighbour that added to it are gone and far away
+*/
+
+typedef struct
+{
+	uint16_t cell; //LC_DECORATION_CELL
+	uint8_t block_type;
+} LC_DecorationBlock;
+
+void LC_Decorations_Init();
+void LC_Decorations_Exit();
+
+int LC_Decorations_Count(const ivec3 p_key);
+LC_DecorationBlock* LC_Decorations_Copy(const ivec3 p_key, int p_count); //for a worker, free it when done
+bool LC_Decorations_Merge(LC_Chunk* const p_chunk, const LC_DecorationBlock* p_blocks, int p_count); //only touches the chunk
+bool LC_Decorations_MergeLate(LC_Chunk* const p_chunk, const ivec3 p_key, int p_seen);
+void LC_Decorations_AddSpills(const ivec3 p_sourceKey, const LC_DecorationSpill* p_spills, int p_count);
+void LC_Decorations_Prune(ivec3 p_unloadBounds[2]); //once per frame, when no chunk is generating outside of the bounds
+
+#endif // !LC_DECORATIONS_H
@@ -166,7 +166,7 @@ void LC_Draw_Hotbar(LC_Hotbar* const hotbar, int block_amounts[LC_BT__MAX])
 
 	Draw_ScreenTexture(gui_texture, &texture_region, (x_position - 160) + (40 * hotbar->active_index), y_position + 1, scale, scale, 0);
 
-	R_Texture* block_atlas_texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE);
+	R_Texture* block_atlas_texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7);
 
 	texture_region.width = 16;
 	texture_region.height = 16;
@@ -215,7 +215,7 @@ void LC_Draw_Inventory(LC_BlockType blocks[21][6], int block_amounts[LC_BT__MAX]
 	const float BOX_HEIGHT = 50;
 
 	//Render texture block slots
-	R_Texture* block_atlas_texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE);
+	R_Texture* block_atlas_texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7);
 
 	M_Rect2Df texture_region;
 	texture_region.width = 16;
@@ -0,0 +1,557 @@
+#include "lc/lc_fluids.h"
+
+#include <string.h>
+
+#include "lc/lc_world_internal.h"
+#include "core/cvar.h"
+
+//how far flowing water spreads sideways from where it landed
+#define LC_FLUID_MAX_SPREAD 7
+
+/*
+	Water that might still move. Only chunks that had water moving in them get one, every active cell
+	is a water block that is checked on the next fluid tick
+*/
+typedef struct
+{
+	dynamic_array* active_cells; //uint16_t cell indexes, (x * LC_CHUNK_HEIGHT + y) * LC_CHUNK_LENGTH + z
+	uint32_t active_bits[LC_CHUNK_CELLS / 32]; //cells that are in active_cells
+	uint8_t levels[LC_CHUNK_CELLS]; //0 for still water, otherwise how far it has spread sideways
+	bool queued; //key is in lc_fluids.active_chunks
+	bool changed; //key is in lc_fluids.changed_chunks
+} LC_FluidChunk;
+
+typedef struct
+{
+	CHMap chunk_map; //chunk key -> LC_FluidChunk*, so the pointers stay valid when the map grows
+	dynamic_array* active_chunks; //keys of the chunks with active cells
+	dynamic_array* changed_chunks; //keys of the chunks that are remeshed after the tick
+	int next_chunk; //where the next tick starts, so a small budget still reaches every chunk
+} LC_FluidState;
+
+static LC_FluidState lc_fluids;
+static Cvar* lc_fluid_budget;
+
+//directions water moves in, down first
+static const int lc_fluid_flow_dirs[5][3] =
+{
+	{ 0, -1, 0 },
+	{ 1, 0, 0 },
+	{ -1, 0, 0 },
+	{ 0, 0, 1 },
+	{ 0, 0, -1 }
+};
+
+static int LC_FluidCell_Index(int p_x, int p_y, int p_z)
+{
+	return (p_x * LC_CHUNK_HEIGHT + p_y) * LC_CHUNK_LENGTH + p_z;
+}
+
+static void LC_Fluids_GetChunkKey(LC_Chunk* const p_chunk, ivec3 dest)
+{
+	LC_getNormalizedChunkPosition(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2], dest);
+}
+
+static LC_FluidChunk* LC_Fluids_GetChunk(const ivec3 p_key, bool p_create)
+{
+	LC_FluidChunk** found = CHMap_Find(&lc_fluids.chunk_map, p_key);
+
+	if (found)
+	{
+		return *found;
+	}
+	if (!p_create)
+	{
+		return NULL;
+	}
+
+	LC_FluidChunk* fluid_chunk = calloc(1, sizeof(LC_FluidChunk));
+
+	if (!fluid_chunk)
+	{
+		return NULL;
+	}
+
+	fluid_chunk->active_cells = dA_INIT(uint16_t, 0);
+
+	if (!CHMap_Insert(&lc_fluids.chunk_map, p_key, &fluid_chunk))
+	{
+		dA_Destruct(fluid_chunk->active_cells);
+		free(fluid_chunk);
+		return NULL;
+	}
+
+	return fluid_chunk;
+}
+
+void LC_Fluids_RemoveChunk(const ivec3 p_key)
+{
+	LC_FluidChunk** found = CHMap_Find(&lc_fluids.chunk_map, p_key);
+
+	if (!found)
+	{
+		return;
+	}
+
+	//the key is dropped from the active and changed lists when they are walked next
+	dA_Destruct((*found)->active_cells);
+	free(*found);
+	*found = NULL; //pooled slots keep their data after the erase, so the exit walk must not see it again
+
+	CHMap_Erase(&lc_fluids.chunk_map, p_key);
+}
+
+//so water that stopped spreading stays stopped when its chunk is unloaded and comes back, NULL if all of it is still
+uint8_t* LC_Fluids_CopyLevels(const ivec3 p_key)
+{
+	LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(p_key, false);
+
+	if (!fluid_chunk)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < LC_CHUNK_CELLS; i++)
+	{
+		if (fluid_chunk->levels[i] == 0)
+		{
+			continue;
+		}
+
+		uint8_t* levels = malloc(LC_CHUNK_CELLS);
+
+		if (levels)
+		{
+			memcpy(levels, fluid_chunk->levels, LC_CHUNK_CELLS);
+		}
+		return levels;
+	}
+
+	return NULL;
+}
+
+void LC_Fluids_RestoreLevels(const ivec3 p_key, const uint8_t* p_levels)
+{
+	LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(p_key, true);
+
+	if (fluid_chunk)
+	{
+		memcpy(fluid_chunk->levels, p_levels, LC_CHUNK_CELLS);
+	}
+}
+
+//r_chunk is also the hint, blocks inside it don't need a map lookup
+static LC_Block* LC_Fluids_GetBlock(int p_gX, int p_gY, int p_gZ, LC_Chunk** r_chunk, ivec3 r_local)
+{
+	LC_Chunk* chunk = *r_chunk;
+
+	if (!chunk || p_gX < chunk->global_position[0] || p_gX >= chunk->global_position[0] + LC_CHUNK_WIDTH
+		|| p_gY < chunk->global_position[1] || p_gY >= chunk->global_position[1] + LC_CHUNK_HEIGHT
+		|| p_gZ < chunk->global_position[2] || p_gZ >= chunk->global_position[2] + LC_CHUNK_LENGTH)
+	{
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(p_gX, p_gY, p_gZ, chunk_key);
+
+		chunk = CHMap_Find(&lc_world.chunk_map, chunk_key);
+
+		if (!chunk)
+		{
+			return NULL;
+		}
+	}
+
+	*r_chunk = chunk;
+
+	r_local[0] = p_gX - chunk->global_position[0];
+	r_local[1] = p_gY - chunk->global_position[1];
+	r_local[2] = p_gZ - chunk->global_position[2];
+
+	return &chunk->blocks[r_local[0]][r_local[1]][r_local[2]];
+}
+
+static LC_FluidChunk* LC_Fluids_ActivateCell(LC_Chunk* const p_chunk, const ivec3 p_local)
+{
+	ivec3 chunk_key;
+	LC_Fluids_GetChunkKey(p_chunk, chunk_key);
+
+	LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(chunk_key, true);
+
+	if (!fluid_chunk)
+	{
+		return NULL;
+	}
+
+	int cell = LC_FluidCell_Index(p_local[0], p_local[1], p_local[2]);
+	uint32_t bit = 1u << (cell & 31);
+
+	if (fluid_chunk->active_bits[cell >> 5] & bit)
+	{
+		return fluid_chunk;
+	}
+
+	fluid_chunk->active_bits[cell >> 5] |= bit;
+
+	uint16_t cell_index = (uint16_t)cell;
+	dA_emplaceBackData(fluid_chunk->active_cells, &cell_index);
+
+	if (!fluid_chunk->queued)
+	{
+		fluid_chunk->queued = true;
+		dA_emplaceBackData(lc_fluids.active_chunks, chunk_key);
+	}
+
+	return fluid_chunk;
+}
+
+static void LC_Fluids_SetBlock(LC_Chunk* const p_chunk, const ivec3 p_local, uint8_t p_level)
+{
+	LC_FluidChunk* fluid_chunk = LC_Fluids_ActivateCell(p_chunk, p_local);
+
+	if (!fluid_chunk)
+	{
+		return;
+	}
+
+	int old_alive_blocks = p_chunk->alive_blocks;
+
+	LC_Chunk_SetBlock(p_chunk, p_local[0], p_local[1], p_local[2], LC_BT__WATER);
+
+	if (old_alive_blocks == 0 && p_chunk->alive_blocks > 0)
+	{
+		lc_world.num_alive_chunks++;
+	}
+
+	fluid_chunk->levels[LC_FluidCell_Index(p_local[0], p_local[1], p_local[2])] = p_level;
+
+	if (!fluid_chunk->changed)
+	{
+		ivec3 chunk_key;
+		LC_Fluids_GetChunkKey(p_chunk, chunk_key);
+
+		fluid_chunk->changed = true;
+		dA_emplaceBackData(lc_fluids.changed_chunks, chunk_key);
+	}
+}
+
+//wakes up the water that can flow into a block that changed, and the block itself if it's water now
+void LC_Fluids_WakeAround(LC_Chunk* const p_chunk, int p_gX, int p_gY, int p_gZ)
+{
+	ivec3 chunk_key;
+	LC_Fluids_GetChunkKey(p_chunk, chunk_key);
+
+	//placed water doesn't remember how far the water it replaced had spread
+	LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(chunk_key, false);
+
+	if (fluid_chunk)
+	{
+		fluid_chunk->levels[LC_FluidCell_Index(p_gX - p_chunk->global_position[0], p_gY - p_chunk->global_position[1], p_gZ - p_chunk->global_position[2])] = 0;
+	}
+
+	for (int i = -1; i < 5; i++)
+	{
+		LC_Chunk* chunk = p_chunk;
+		ivec3 local;
+		LC_Block* block = NULL;
+
+		if (i < 0)
+		{
+			block = LC_Fluids_GetBlock(p_gX, p_gY, p_gZ, &chunk, local);
+		}
+		else
+		{
+			block = LC_Fluids_GetBlock(p_gX - lc_fluid_flow_dirs[i][0], p_gY - lc_fluid_flow_dirs[i][1], p_gZ - lc_fluid_flow_dirs[i][2], &chunk, local);
+		}
+
+		if (block && LC_IsBlockWater(block->type))
+		{
+			LC_Fluids_ActivateCell(chunk, local);
+		}
+	}
+}
+
+//activates the water of a new chunk that has somewhere to go, and the water of its neighbours that can flow into it
+void LC_Fluids_SeedChunk(LC_Chunk* const p_chunk)
+{
+	if (p_chunk->water_blocks > 0)
+	{
+		for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+		{
+			for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
+			{
+				for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+				{
+					if (!LC_IsBlockWater(p_chunk->blocks[x][y][z].type))
+					{
+						continue;
+					}
+
+					for (int i = 0; i < 5; i++)
+					{
+						LC_Chunk* chunk = p_chunk;
+						ivec3 local;
+						LC_Block* block = LC_Fluids_GetBlock(x + p_chunk->global_position[0] + lc_fluid_flow_dirs[i][0], y + p_chunk->global_position[1] + lc_fluid_flow_dirs[i][1],
+							z + p_chunk->global_position[2] + lc_fluid_flow_dirs[i][2], &chunk, local);
+
+						if (block && block->type == LC_BT__NONE)
+						{
+							local[0] = x;
+							local[1] = y;
+							local[2] = z;
+							LC_Fluids_ActivateCell(p_chunk, local);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (p_chunk->alive_blocks >= LC_CHUNK_CELLS)
+	{
+		return;
+	}
+
+	ivec3 chunk_key;
+	LC_Fluids_GetChunkKey(p_chunk, chunk_key);
+
+	//only the faces of the neighbours that water can flow out of into this chunk
+	for (int i = 0; i < 5; i++)
+	{
+		ivec3 neighbour_key;
+		neighbour_key[0] = chunk_key[0] - lc_fluid_flow_dirs[i][0];
+		neighbour_key[1] = chunk_key[1] - lc_fluid_flow_dirs[i][1];
+		neighbour_key[2] = chunk_key[2] - lc_fluid_flow_dirs[i][2];
+
+		LC_Chunk* neighbour = CHMap_Find(&lc_world.chunk_map, neighbour_key);
+
+		if (!neighbour || neighbour->water_blocks <= 0)
+		{
+			continue;
+		}
+
+		//the face of this chunk that touches the neighbour
+		int min_x = (lc_fluid_flow_dirs[i][0] < 0) ? LC_CHUNK_WIDTH - 1 : 0;
+		int max_x = (lc_fluid_flow_dirs[i][0] > 0) ? 0 : LC_CHUNK_WIDTH - 1;
+		int min_y = (lc_fluid_flow_dirs[i][1] < 0) ? LC_CHUNK_HEIGHT - 1 : 0;
+		int max_y = (lc_fluid_flow_dirs[i][1] > 0) ? 0 : LC_CHUNK_HEIGHT - 1;
+		int min_z = (lc_fluid_flow_dirs[i][2] < 0) ? LC_CHUNK_LENGTH - 1 : 0;
+		int max_z = (lc_fluid_flow_dirs[i][2] > 0) ? 0 : LC_CHUNK_LENGTH - 1;
+
+		for (int x = min_x; x <= max_x; x++)
+		{
+			for (int y = min_y; y <= max_y; y++)
+			{
+				for (int z = min_z; z <= max_z; z++)
+				{
+					if (p_chunk->blocks[x][y][z].type != LC_BT__NONE)
+					{
+						continue;
+					}
+
+					ivec3 local;
+					local[0] = (x - lc_fluid_flow_dirs[i][0] + LC_CHUNK_WIDTH) % LC_CHUNK_WIDTH;
+					local[1] = (y - lc_fluid_flow_dirs[i][1] + LC_CHUNK_HEIGHT) % LC_CHUNK_HEIGHT;
+					local[2] = (z - lc_fluid_flow_dirs[i][2] + LC_CHUNK_LENGTH) % LC_CHUNK_LENGTH;
+
+					if (LC_IsBlockWater(neighbour->blocks[local[0]][local[1]][local[2]].type))
+					{
+						LC_Fluids_ActivateCell(neighbour, local);
+					}
+				}
+			}
+		}
+	}
+}
+
+static void LC_Fluids_FlowCell(LC_Chunk* const p_chunk, LC_FluidChunk* const p_fluidChunk, int p_cell)
+{
+	int x = p_cell / (LC_CHUNK_HEIGHT * LC_CHUNK_LENGTH);
+	int y = (p_cell / LC_CHUNK_LENGTH) % LC_CHUNK_HEIGHT;
+	int z = p_cell % LC_CHUNK_LENGTH;
+
+	//replaced since it was activated
+	if (!LC_IsBlockWater(p_chunk->blocks[x][y][z].type))
+	{
+		return;
+	}
+
+	int g_x = x + p_chunk->global_position[0];
+	int g_y = y + p_chunk->global_position[1];
+	int g_z = z + p_chunk->global_position[2];
+
+	uint8_t level = p_fluidChunk->levels[p_cell];
+
+	LC_Chunk* below_chunk = p_chunk;
+	ivec3 below_local;
+	LC_Block* below = LC_Fluids_GetBlock(g_x, g_y - 1, g_z, &below_chunk, below_local);
+
+	//falling water can spread again where it lands
+	if (below && below->type == LC_BT__NONE)
+	{
+		LC_Fluids_SetBlock(below_chunk, below_local, 1);
+	}
+
+	//still water spreads everywhere, flowing water only over solid ground and not too far
+	bool on_ground = below && below->type != LC_BT__NONE && !LC_IsBlockWater(below->type);
+
+	if ((level > 0 && !on_ground) || level >= LC_FLUID_MAX_SPREAD)
+	{
+		return;
+	}
+
+	uint8_t spread_level = level + 1;
+
+	for (int i = 1; i < 5; i++)
+	{
+		LC_Chunk* chunk = p_chunk;
+		ivec3 local;
+		LC_Block* block = LC_Fluids_GetBlock(g_x + lc_fluid_flow_dirs[i][0], g_y, g_z + lc_fluid_flow_dirs[i][2], &chunk, local);
+
+		if (!block)
+		{
+			continue;
+		}
+
+		if (block->type == LC_BT__NONE)
+		{
+			LC_Fluids_SetBlock(chunk, local, spread_level);
+		}
+		else if (LC_IsBlockWater(block->type))
+		{
+			//a shorter path, it can spread further from here now
+			ivec3 chunk_key;
+			LC_Fluids_GetChunkKey(chunk, chunk_key);
+
+			LC_FluidChunk* fluid_chunk = (chunk == p_chunk) ? p_fluidChunk : LC_Fluids_GetChunk(chunk_key, false);
+			int cell = LC_FluidCell_Index(local[0], local[1], local[2]);
+
+			if (fluid_chunk && fluid_chunk->levels[cell] > spread_level)
+			{
+				fluid_chunk->levels[cell] = spread_level;
+				LC_Fluids_ActivateCell(chunk, local);
+			}
+		}
+	}
+}
+
+void LC_Fluids_Tick()
+{
+	int budget = lc_fluid_budget->int_value;
+	int chunk_count = dA_size(lc_fluids.active_chunks);
+
+	int start = (chunk_count > 0) ? lc_fluids.next_chunk % chunk_count : 0;
+	int visited = 0;
+
+	//only the cells that were active when the tick started move, the ones they wake up are next. So water spreads a block per tick
+	for (; visited < chunk_count && budget > 0; visited++)
+	{
+		//can move when cells are activated, copy the key
+		ivec3 chunk_key;
+		glm_ivec3_copy(dA_at(lc_fluids.active_chunks, (start + visited) % chunk_count), chunk_key);
+
+		LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(chunk_key, false);
+		LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, chunk_key);
+
+		if (!fluid_chunk || !chunk)
+		{
+			continue;
+		}
+
+		int cell_count = min((int)dA_size(fluid_chunk->active_cells), budget);
+		budget -= cell_count;
+
+		for (int i = 0; i < cell_count; i++)
+		{
+			int cell = *(uint16_t*)dA_at(fluid_chunk->active_cells, i);
+
+			fluid_chunk->active_bits[cell >> 5] &= ~(1u << (cell & 31));
+
+			LC_Fluids_FlowCell(chunk, fluid_chunk, cell);
+		}
+
+		int cells_left = dA_size(fluid_chunk->active_cells) - cell_count;
+
+		if (cell_count > 0 && cells_left > 0)
+		{
+			memmove(fluid_chunk->active_cells->data, (uint16_t*)fluid_chunk->active_cells->data + cell_count, sizeof(uint16_t) * cells_left);
+		}
+		dA_resize(fluid_chunk->active_cells, cells_left);
+	}
+
+	lc_fluids.next_chunk = start + visited;
+
+	//drop the chunks that settled
+	int kept = 0;
+	int total_chunks = dA_size(lc_fluids.active_chunks);
+	ivec3* keys = lc_fluids.active_chunks->data;
+
+	for (int i = 0; i < total_chunks; i++)
+	{
+		LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(keys[i], false);
+
+		if (!fluid_chunk)
+		{
+			continue;
+		}
+		if (dA_size(fluid_chunk->active_cells) <= 0)
+		{
+			fluid_chunk->queued = false;
+			continue;
+		}
+
+		glm_ivec3_copy(keys[i], keys[kept++]);
+	}
+	dA_resize(lc_fluids.active_chunks, kept);
+
+	//only the chunks where water moved are remeshed
+	int changed_count = dA_size(lc_fluids.changed_chunks);
+	keys = lc_fluids.changed_chunks->data;
+
+	for (int i = 0; i < changed_count; i++)
+	{
+		LC_FluidChunk* fluid_chunk = LC_Fluids_GetChunk(keys[i], false);
+		LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, keys[i]);
+
+		if (!fluid_chunk || !chunk)
+		{
+			continue;
+		}
+
+		fluid_chunk->changed = false;
+
+		LC_World_QueueChunkRemesh(chunk);
+	}
+	dA_clear(lc_fluids.changed_chunks);
+
+	if (changed_count > 0)
+	{
+		LC_World_SubmitRemeshes();
+	}
+}
+
+void LC_Fluids_Init()
+{
+	memset(&lc_fluids, 0, sizeof(lc_fluids));
+	lc_fluids.chunk_map = CHMAP_INIT_POOLED((CHMap_HashFun)Hash_ivec3, NULL, ivec3, LC_FluidChunk*, 64);
+	lc_fluids.active_chunks = dA_INIT(ivec3, 0);
+	lc_fluids.changed_chunks = dA_INIT(ivec3, 0);
+
+	lc_fluid_budget = Cvar_Register("lc_fluid_budget", "2048", "Water blocks the fluid solver can move per physics step", CVAR__SAVE_TO_FILE, 64, 65536);
+}
+
+void LC_Fluids_Exit()
+{
+	for (size_t i = 0; i < CHMap_Size(&lc_fluids.chunk_map); i++)
+	{
+		LC_FluidChunk** fluid_chunk = CHMap_AtIndex(&lc_fluids.chunk_map, i);
+
+		if (fluid_chunk && *fluid_chunk)
+		{
+			dA_Destruct((*fluid_chunk)->active_cells);
+			free(*fluid_chunk);
+		}
+	}
+	CHMap_Destruct(&lc_fluids.chunk_map);
+	dA_Destruct(lc_fluids.active_chunks);
+	dA_Destruct(lc_fluids.changed_chunks);
+}
@@ -0,0 +1,24 @@
+#ifndef LC_FLUIDS_H
+#define LC_FLUIDS_H
+#pragma once
+
+#include "lc/lc_chunk.h"
+
+/*
+	Incremental water solver. Only the water that can still move is checked, at most lc_fluid_budget blocks per tick.
+	Flowing water remembers how far it spread, still water has level 0
+*/
+
+void LC_Fluids_Init();
+void LC_Fluids_Exit();
+void LC_Fluids_Tick(); //once per physics step
+
+void LC_Fluids_SeedChunk(LC_Chunk* const p_chunk); //a chunk was added to the world
+void LC_Fluids_RemoveChunk(const ivec3 p_key);
+void LC_Fluids_WakeAround(LC_Chunk* const p_chunk, int p_gX, int p_gY, int p_gZ); //a block was changed by hand
+
+//the levels of a chunk for the chunk cache, malloced or NULL if all of its water is still
+uint8_t* LC_Fluids_CopyLevels(const ivec3 p_key);
+void LC_Fluids_RestoreLevels(const ivec3 p_key, const uint8_t* p_levels);
+
+#endif // !LC_FLUIDS_H
@@ -7,6 +7,15 @@
 
 static unsigned s_seed;
 
+//chunks are generated on several threads, so every chunk seeds its own decoration rng from its position
+static __declspec(thread) unsigned long long s_chunk_rng_seed;
+
+static inline uint32_t LC_Generate_Rand()
+{
+	s_chunk_rng_seed = (214013 * s_chunk_rng_seed + 2531011);
+	return (s_chunk_rng_seed >> 32) & RAND_MAX;
+}
+
 float LC_CalculateContinentalness(float p_x, float p_z)
 {
 	float noise = stb_perlin_noise3(p_x / 2048.0, 0.0, p_z / 2048.0, 0, 0, 0);
@@ -128,141 +137,298 @@ static LC_BlockType LC_GenerateBlockBasedOnBiome(LC_BiomeType2 biome, float p_x,
 	return LC_BT__GRASS;
 }
 
-void LC_GenerateAdditionalBlocks(LC_Chunk* _chunk, int p_x, int p_y, int p_z, int p_gX, int p_gY, int p_gZ)
+/*
+~~~~~~~~~~~~~~~~~~
+DECORATION
+~~~~~~~~~~~~~~~~~~
+*/
+
+//how far a decoration can reach out of the chunk of the block it grows on, the biggest is a tree
+#define LC_DECORATION_MARGIN 2
+#define LC_DECORATION_HEIGHT 8
+
+#define LC_DECORATION_REGION_WIDTH (LC_CHUNK_WIDTH + LC_DECORATION_MARGIN * 2)
+#define LC_DECORATION_REGION_HEIGHT (LC_CHUNK_HEIGHT + LC_DECORATION_HEIGHT)
+#define LC_DECORATION_REGION_LENGTH (LC_CHUNK_LENGTH + LC_DECORATION_MARGIN * 2)
+
+//decorations of a chunk, including the blocks that land in the neighbours
+typedef struct
+{
+	uint8_t blocks[LC_DECORATION_REGION_WIDTH][LC_DECORATION_REGION_HEIGHT][LC_DECORATION_REGION_LENGTH];
+	int block_count;
+} LC_DecorationRegion;
+
+static int LC_Generate_DecorationPriority(uint8_t p_blockType)
+{
+	switch (p_blockType)
+	{
+	case LC_BT__NONE:
+		return 0;
+	case LC_BT__GRASS_PROP:
+	case LC_BT__FLOWER:
+	case LC_BT__DEAD_BUSH:
+		return 1;
+	case LC_BT__TREELEAVES:
+	case LC_BT__SNOWYLEAVES:
+		return 2;
+	case LC_BT__TRUNK:
+	case LC_BT__CACTUS:
+		return 4;
+	default:
+		break;
+	}
+
+	//terrain
+	return 3;
+}
+
+static bool LC_Generate_DecorationWins(uint8_t p_new, uint8_t p_old)
+{
+	int new_priority = LC_Generate_DecorationPriority(p_new);
+	int old_priority = LC_Generate_DecorationPriority(p_old);
+
+	//ties go to the higher type, so the merged result doesn't depend on which chunk was decorated first
+	return new_priority > old_priority || (new_priority == old_priority && p_new > p_old);
+}
+
+//the terrain, cells outside of the chunk are generated again. Decorations are never read, so neither are the neighbours
+static uint8_t LC_Generate_TerrainType(LC_Chunk* const p_chunk, int p_x, int p_y, int p_z)
 {
-	uint8_t block_type = _chunk->blocks[p_x][p_y][p_z].type;
+	if (p_x >= 0 && p_x < LC_CHUNK_WIDTH && p_y >= 0 && p_y < LC_CHUNK_HEIGHT && p_z >= 0 && p_z < LC_CHUNK_LENGTH)
+	{
+		return p_chunk->blocks[p_x][p_y][p_z].type;
+	}
 
-	uint8_t left_block = LC_Chunk_getType(_chunk, p_x - 1, p_y, p_z);
-	uint8_t right_block = LC_Chunk_getType(_chunk, p_x + 1, p_y, p_z);
-	uint8_t front_block = LC_Chunk_getType(_chunk, p_x, p_y, p_z + 1);
-	uint8_t back_block = LC_Chunk_getType(_chunk, p_x, p_y, p_z - 1);
-	uint8_t up_block = LC_Chunk_getType(_chunk, p_x, p_y + 1, p_z);
-	uint8_t down_block = LC_Chunk_getType(_chunk, p_x, p_y - 1, p_z);
+	return LC_Generate_Block(p_chunk->global_position[0] + p_x, p_chunk->global_position[1] + p_y, p_chunk->global_position[2] + p_z);
+}
 
+static void LC_Generate_PlaceDecoration(LC_DecorationRegion* const p_region, int p_x, int p_y, int p_z, uint8_t p_blockType)
+{
+	int x = p_x + LC_DECORATION_MARGIN;
+	int z = p_z + LC_DECORATION_MARGIN;
+
+	if (x < 0 || x >= LC_DECORATION_REGION_WIDTH || p_y < 0 || p_y >= LC_DECORATION_REGION_HEIGHT || z < 0 || z >= LC_DECORATION_REGION_LENGTH)
+	{
+		return;
+	}
+
+	uint8_t* block = &p_region->blocks[x][p_y][z];
+
+	if (*block == LC_BT__NONE)
+	{
+		p_region->block_count++;
+	}
+	if (LC_Generate_DecorationWins(p_blockType, *block))
+	{
+		*block = p_blockType;
+	}
+}
+
+static void LC_Generate_PlaceTree(LC_DecorationRegion* const p_region, int p_x, int p_y, int p_z, uint8_t p_leavesType)
+{
+	const int MIN_TREE_HEIGHT = 5;
+
+	//Generate trunk
+	int tree_height = max(LC_Generate_Rand() % 5, MIN_TREE_HEIGHT);
+
+	for (int i = 0; i < tree_height; i++)
+	{
+		LC_Generate_PlaceDecoration(p_region, p_x, p_y + i, p_z, LC_BT__TRUNK);
+	}
+
+	//Generate tree leaves
+	for (int iy = -2; iy <= 2; iy++)
+	{
+		int minH = (iy < -1 || iy > 1) ? 0 : -1;
+		int maxH = (iy < -1 || iy > 1) ? 0 : 1;
+		for (int ix = -1 + minH; ix <= 1 + maxH; ix++)
+		{
+			int x1 = abs(ix - p_x);
+			for (int iz = -1 + minH; iz <= 1 + maxH; iz++)
+			{
+				int z1 = abs(iz - p_z);
+				int total = ix * ix + iy * iy + iz * iz;
+
+				//leaves never replace the terrain, that is up to the merge
+				if (total + 2 < LC_Generate_Rand() % 24 && x1 != 2 - minH && x1 != 2 + maxH && z1 != 2 - minH && z1 != 2 + maxH)
+				{
+					LC_Generate_PlaceDecoration(p_region, p_x + ix, p_y + tree_height + iy, p_z + iz, p_leavesType);
+				}
+			}
+		}
+	}
+}
+
+static void LC_Generate_DecorateBlock(LC_Chunk* const p_chunk, LC_DecorationRegion* const p_region, int p_x, int p_y, int p_z, int p_gY)
+{
+	uint8_t block_type = p_chunk->blocks[p_x][p_y][p_z].type;
+	uint8_t up_block = LC_Generate_TerrainType(p_chunk, p_x, p_y + 1, p_z);
+
+	//only the surface is decorated
+	if (up_block != LC_BT__NONE && !LC_IsBlockWater(up_block))
+	{
+		return;
+	}
+
+	uint8_t left_block = LC_Generate_TerrainType(p_chunk, p_x - 1, p_y, p_z);
+	uint8_t back_block = LC_Generate_TerrainType(p_chunk, p_x, p_y, p_z - 1);
 
 	if (block_type == LC_BT__SAND)
 	{
 		//Cactus
-		if (p_gY > 0 && (Math_rand() % 512) == 0)
+		if (p_gY > 0 && (LC_Generate_Rand() % 512) == 0)
 		{
-			int cactus_height = Math_rand() % 5;
+			int cactus_height = LC_Generate_Rand() % 5;
 
 			for (int i = 0; i < cactus_height; i++)
 			{
-				LC_Chunk_SetBlock(_chunk, p_x, p_y + i, p_z, LC_BT__CACTUS);
+				LC_Generate_PlaceDecoration(p_region, p_x, p_y + i, p_z, LC_BT__CACTUS);
 			}
 		}
 		//Dead bush
-		else if ((Math_rand() % 128) == 0)
+		else if ((LC_Generate_Rand() % 128) == 0)
 		{
-			LC_Chunk_SetBlock(_chunk, p_x, p_y + 1, p_z, LC_BT__DEAD_BUSH);
+			LC_Generate_PlaceDecoration(p_region, p_x, p_y + 1, p_z, LC_BT__DEAD_BUSH);
 		}
 	}
 	else if (block_type == LC_BT__SNOW || block_type == LC_BT__GRASS_SNOW)
 	{
 		//Dead bush
-		if ((Math_rand() % 16) == 0 && p_gY > 12 && (up_block == LC_BT__NONE || LC_IsBlockWater(up_block)) && (left_block == LC_BT__NONE || back_block == LC_BT__NONE))
+		if ((LC_Generate_Rand() % 16) == 0 && p_gY > 12 && (left_block == LC_BT__NONE || back_block == LC_BT__NONE))
 		{
-			LC_Chunk_SetBlock(_chunk, p_x, p_y + 1, p_z, LC_BT__DEAD_BUSH);
+			LC_Generate_PlaceDecoration(p_region, p_x, p_y + 1, p_z, LC_BT__DEAD_BUSH);
 		}
-		else if ((Math_rand() % 16) == 0 && p_gY > 12 && p_gY < 300 && p_y < LC_CHUNK_HEIGHT - 5 && p_x > 2 && p_z > 2 && p_x < LC_CHUNK_WIDTH - 2
-			&& p_z < LC_CHUNK_LENGTH - 2 && up_block == LC_BT__NONE && right_block == LC_BT__NONE && front_block == LC_BT__NONE && back_block == LC_BT__NONE)
+		else if ((LC_Generate_Rand() % 16) == 0 && p_gY > 12 && p_gY < 300 && up_block == LC_BT__NONE && back_block == LC_BT__NONE)
 		{
-			const int MIN_TREE_HEIGHT = 5;
-
-			//Generate trunk
-			int tree_height = max(Math_rand() % 5, MIN_TREE_HEIGHT);
-
-			for (int i = 0; i < tree_height; i++)
+			LC_Generate_PlaceTree(p_region, p_x, p_y, p_z, LC_BT__SNOWYLEAVES);
+		}
+	}
+	else if (block_type == LC_BT__GRASS || block_type == LC_BT__DIRT)
+	{
+		//generate a tree
+		if ((LC_Generate_Rand() % 2) == 0 && p_gY > 12 && p_gY < 300 && up_block == LC_BT__NONE && back_block == LC_BT__NONE)
+		{
+			LC_Generate_PlaceTree(p_region, p_x, p_y, p_z, LC_BT__TREELEAVES);
+		}
+		else if (p_gY > 5 && (left_block == LC_BT__NONE || back_block == LC_BT__NONE))
+		{
+			//grass prop
+			if ((LC_Generate_Rand() % 8) == 0)
 			{
-				LC_Chunk_SetBlock(_chunk, p_x, p_y + i, p_z, LC_BT__TRUNK);
+				LC_Generate_PlaceDecoration(p_region, p_x, p_y + 1, p_z, LC_BT__GRASS_PROP);
 			}
+			//flower prop
+			else if ((LC_Generate_Rand() % 8) == 0)
+			{
+				LC_Generate_PlaceDecoration(p_region, p_x, p_y + 1, p_z, LC_BT__FLOWER);
+			}
+		}
+	}
+}
+
+bool LC_Generate_MergeDecoration(LC_Chunk* const p_chunk, int p_x, int p_y, int p_z, uint8_t p_blockType)
+{
+	uint8_t old_type = LC_Chunk_getType(p_chunk, p_x, p_y, p_z);
+
+	if (!LC_Generate_DecorationWins(p_blockType, old_type))
+	{
+		return false;
+	}
+
+	LC_Chunk_SetBlock(p_chunk, p_x, p_y, p_z, p_blockType);
+
+	return true;
+}
 
-			//Generate tree leaves
-			for (int iy = -2; iy <= 2; iy++)
+int LC_Generate_Decorate(LC_Chunk* const p_chunk, LC_DecorationSpill** r_spills)
+{
+	*r_spills = NULL;
+
+	LC_DecorationRegion* region = calloc(1, sizeof(LC_DecorationRegion));
+
+	if (!region)
+	{
+		return 0;
+	}
+
+	LC_Generate_SeedChunk(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2]);
+
+	//the decisions only read the terrain, the decorations go into the region and are merged after
+	for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+	{
+		for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+		{
+			for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
 			{
-				int minH = (iy < -1 || iy > 1) ? 0 : -1;
-				int maxH = (iy < -1 || iy > 1) ? 0 : 1;
-				for (int ix = -1 + minH; ix <= 1 + maxH; ix++)
+				if (p_chunk->blocks[x][y][z].type != LC_BT__NONE)
 				{
-					int x1 = abs(ix - p_x);
-					for (int iz = -1 + minH; iz <= 1 + maxH; iz++)
-					{
-						int z1 = abs(iz - p_z);
-						int total = ix * ix + iy * iy + iz * iz;
-
-						uint8_t sample_block_type = LC_Chunk_getType(_chunk, p_x + ix, p_y + tree_height + iy, p_z + iz);
-
-						if (total + 2 < Math_rand() % 24 && x1 != 2 - minH && x1 != 2 + maxH && z1 != 2 - minH && z1 != 2 + maxH &&
-							(sample_block_type == LC_BT__NONE || sample_block_type == LC_BT__SNOWYLEAVES))
-						{
-							LC_Chunk_SetBlock(_chunk, p_x + ix, p_y + tree_height + iy, p_z + iz, LC_BT__SNOWYLEAVES);
-						}
-					}
+					LC_Generate_DecorateBlock(p_chunk, region, x, y, z, y + p_chunk->global_position[1]);
 				}
 			}
-
 		}
+	}
 
+	LC_DecorationSpill* spills = NULL;
+	int spill_count = 0;
+
+	if (region->block_count > 0)
+	{
+		spills = malloc(sizeof(LC_DecorationSpill) * region->block_count);
 	}
-	else if (block_type == LC_BT__GRASS || block_type == LC_BT__DIRT)
+
+	for (int rx = 0; rx < LC_DECORATION_REGION_WIDTH && region->block_count > 0; rx++)
 	{
-		//generate a tree
-		if ((Math_rand() % 2) == 0 && p_gY > 12 && p_gY < 300 && p_y < LC_CHUNK_HEIGHT - 5 && p_x > 2 && p_z > 2 && p_x < LC_CHUNK_WIDTH - 2
-			&& p_z < LC_CHUNK_LENGTH - 2 && up_block == LC_BT__NONE && right_block == LC_BT__NONE && front_block == LC_BT__NONE && back_block == LC_BT__NONE)
+		for (int y = 0; y < LC_DECORATION_REGION_HEIGHT; y++)
 		{
-			const int MIN_TREE_HEIGHT = 5;
+			for (int rz = 0; rz < LC_DECORATION_REGION_LENGTH; rz++)
+			{
+				uint8_t block_type = region->blocks[rx][y][rz];
 
-			//Generate trunk
-			int tree_height = max(Math_rand() % 5, MIN_TREE_HEIGHT);
+				if (block_type == LC_BT__NONE)
+				{
+					continue;
+				}
 
-			for (int i = 0; i < tree_height; i++)
-			{
-				LC_Chunk_SetBlock(_chunk, p_x, p_y + i, p_z, LC_BT__TRUNK);
-			}
+				int x = rx - LC_DECORATION_MARGIN;
+				int z = rz - LC_DECORATION_MARGIN;
 
-			//Generate tree leaves
-			for (int iy = -2; iy <= 2; iy++)
-			{
-				int minH = (iy < -1 || iy > 1) ? 0 : -1;
-				int maxH = (iy < -1 || iy > 1) ? 0 : 1;
-				for (int ix = -1 + minH; ix <= 1 + maxH; ix++)
+				if (x >= 0 && x < LC_CHUNK_WIDTH && y < LC_CHUNK_HEIGHT && z >= 0 && z < LC_CHUNK_LENGTH)
 				{
-					int x1 = abs(ix - p_x);
-					for (int iz = -1 + minH; iz <= 1 + maxH; iz++)
-					{
-						int z1 = abs(iz - p_z);
-						int total = ix * ix + iy * iy + iz * iz;
-
-						uint8_t sample_block_type = LC_Chunk_getType(_chunk, p_x + ix, p_y + tree_height + iy, p_z + iz);
-
-						if (total + 2 < Math_rand() % 24 && x1 != 2 - minH && x1 != 2 + maxH && z1 != 2 - minH && z1 != 2 + maxH &&
-							(sample_block_type == LC_BT__NONE || sample_block_type == LC_BT__TREELEAVES))
-						{
-							LC_Chunk_SetBlock(_chunk, p_x + ix, p_y + tree_height + iy, p_z + iz, LC_BT__TREELEAVES);
-						}
-					}
+					LC_Generate_MergeDecoration(p_chunk, x, y, z, block_type);
+					continue;
+				}
+				if (!spills)
+				{
+					continue;
 				}
-			}
 
-		}
-		else if (p_gY > 5 && (up_block == LC_BT__NONE || LC_IsBlockWater(up_block)) && (left_block == LC_BT__NONE || back_block == LC_BT__NONE))
-		{
-			//grass prop
-			if ((Math_rand() % 8) == 0)
-			{
-				LC_Chunk_SetBlock(_chunk, p_x, p_y + 1, p_z, LC_BT__GRASS_PROP);
-			}
-			//flower prop
-			else if ((Math_rand() % 8) == 0)
-			{
-				LC_Chunk_SetBlock(_chunk, p_x, p_y + 1, p_z, LC_BT__FLOWER);
+				//lands in a neighbour, merged when that one is ready
+				int offset_x = (x < 0) ? -1 : (x >= LC_CHUNK_WIDTH) ? 1 : 0;
+				int offset_y = (y >= LC_CHUNK_HEIGHT) ? 1 : 0;
+				int offset_z = (z < 0) ? -1 : (z >= LC_CHUNK_LENGTH) ? 1 : 0;
+
+				LC_DecorationSpill* spill = &spills[spill_count++];
+				spill->chunk_offset[0] = offset_x;
+				spill->chunk_offset[1] = offset_y;
+				spill->chunk_offset[2] = offset_z;
+				spill->block_type = block_type;
+				spill->cell = LC_DECORATION_CELL(x - offset_x * LC_CHUNK_WIDTH, y - offset_y * LC_CHUNK_HEIGHT, z - offset_z * LC_CHUNK_LENGTH);
 			}
 		}
 	}
-}
 
+	free(region);
+
+	if (spill_count == 0)
+	{
+		free(spills);
+		return 0;
+	}
+
+	*r_spills = spills;
 
+	return spill_count;
+}
 
 LC_BlockType LC_Generate_Block(float p_x, float p_y, float p_z)
 {	
@@ -299,3 +465,107 @@ void LC_Generate_SetSeed(unsigned seed)
 {
 	s_seed = seed;
 }
+
+void LC_Generate_SeedChunk(int p_gX, int p_gY, int p_gZ)
+{
+	unsigned long long hash = s_seed;
+
+	hash = (hash ^ (unsigned)p_gX) * 0x9E3779B97F4A7C15ull;
+	hash = (hash ^ (unsigned)p_gY) * 0x9E3779B97F4A7C15ull;
+	hash = (hash ^ (unsigned)p_gZ) * 0x9E3779B97F4A7C15ull;
+
+	s_chunk_rng_seed = hash ^ (hash >> 29);
+}
+
+LC_BlockType LC_Generate_LodCell(int p_gX, int p_gY, int p_gZ, int p_cellSize)
+{
+	//majority vote of 2x2x2 samples spread over the cell, exact for 2x cells
+	int step = max(p_cellSize / 2, 1);
+	int offset = (p_cellSize > 2) ? p_cellSize / 4 : 0;
+
+	uint8_t types[8];
+	int counts[8];
+	int type_count = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		int x = p_gX + offset + (i & 1) * step;
+		int y = p_gY + offset + ((i >> 1) & 1) * step;
+		int z = p_gZ + offset + ((i >> 2) & 1) * step;
+
+		uint8_t type = LC_Generate_Block(x, y, z);
+
+		int j = 0;
+		while (j < type_count && types[j] != type)
+		{
+			j++;
+		}
+		if (j == type_count)
+		{
+			types[type_count] = type;
+			counts[type_count] = 0;
+			type_count++;
+		}
+		counts[j]++;
+	}
+
+	int best = 0;
+	for (int i = 1; i < type_count; i++)
+	{
+		//ties go to solid blocks, so thin ground doesn't turn into holes
+		bool best_solid = types[best] != LC_BT__NONE && types[best] != LC_BT__WATER;
+		bool solid = types[i] != LC_BT__NONE && types[i] != LC_BT__WATER;
+
+		if (counts[i] > counts[best] || (counts[i] == counts[best] && solid && !best_solid))
+		{
+			best = i;
+		}
+	}
+
+	return types[best];
+}
+
+void LC_Generate_SurfaceRange(int p_gX, int p_gZ, int p_size, int* r_min, int* r_max)
+{
+	//5x5 samples that reach a bit past the area, the surface between them is only roughly known
+	float start_x = p_gX - p_size * 0.25f;
+	float start_z = p_gZ - p_size * 0.25f;
+	float step = p_size * 1.5f / 4.0f;
+
+	float min_height = FLT_MAX;
+	float max_height = -FLT_MAX;
+
+	for (int x = 0; x < 5; x++)
+	{
+		for (int z = 0; z < 5; z++)
+		{
+			float height = LC_CalculateSurfaceHeight(start_x + x * step, LC_WORLD_WATER_HEIGHT, start_z + z * step);
+
+			min_height = min(min_height, height);
+			max_height = max(max_height, height);
+		}
+	}
+
+	*r_min = (int)floorf(min_height);
+	*r_max = (int)ceilf(max_height);
+}
+
+void LC_Generate_SurfaceSample(float p_x, float p_z, float* r_height, uint8_t* r_blockType)
+{
+	//only the 2d surface, the 3d part of the height noise is taken at the water height
+	float surface_height = LC_CalculateSurfaceHeight(p_x, LC_WORLD_WATER_HEIGHT, p_z);
+
+	//the top face of the highest block
+	float top = ceilf(surface_height) - 0.5f;
+
+	if (top < LC_WORLD_WATER_HEIGHT)
+	{
+		*r_height = LC_WORLD_WATER_HEIGHT;
+		*r_blockType = LC_BT__WATER;
+		return;
+	}
+
+	//same biome as LC_Generate_Block
+	*r_height = top;
+	*r_blockType = LC_GenerateBlockBasedOnBiome(LC_Biome_GrassyPlains, p_x, top - 0.5f, p_z);
+}
@@ -0,0 +1,250 @@
+#include "lc/lc_horizon.h"
+
+#include <string.h>
+#include <glad/glad.h>
+
+#include "lc/lc_world_internal.h"
+#include "lc/lc_lod.h"
+#include "core/cvar.h"
+
+#define LC_HORIZON_BASE_CELL_SIZE 32 //blocks between the vertices of the finest horizon level
+
+extern void LC_Player_getPosition(vec3 dest);
+
+typedef struct
+{
+	int rows_left; //rows of a full refill that haven't been sampled yet
+	bool valid;
+} LC_HorizonLevelState;
+
+typedef struct
+{
+	LC_HorizonLevelState levels[LC_HORIZON_LEVELS];
+	float samples[LC_HORIZON_GRID_SIZE * 2]; //one row or column, height and block type
+} LC_HorizonState;
+
+static LC_HorizonState lc_horizon;
+static Cvar* lc_horizon_enabled;
+static Cvar* lc_horizon_budget;
+
+static int LC_Horizon_Wrap(int p_cell)
+{
+	return p_cell & (LC_HORIZON_GRID_SIZE - 1);
+}
+
+//samples a row (or a column) of a level and uploads it to the texels the row wraps to
+static void LC_Horizon_WriteLine(int p_level, int p_cellX, int p_cellZ, bool p_alongX)
+{
+	LC_HorizonLevel* level = &lc_world.render_data.horizon.levels[p_level];
+
+	for (int i = 0; i < LC_HORIZON_GRID_SIZE; i++)
+	{
+		int cell_x = (p_alongX) ? p_cellX + i : p_cellX;
+		int cell_z = (p_alongX) ? p_cellZ : p_cellZ + i;
+		int index = LC_Horizon_Wrap((p_alongX) ? cell_x : cell_z);
+
+		float height = 0;
+		uint8_t block_type = 0;
+		LC_Generate_SurfaceSample(cell_x * level->cell_size, cell_z * level->cell_size, &height, &block_type);
+
+		lc_horizon.samples[index * 2] = height;
+		lc_horizon.samples[index * 2 + 1] = block_type;
+	}
+
+	if (p_alongX)
+	{
+		glTextureSubImage3D(lc_world.render_data.horizon.height_texture, 0, 0, LC_Horizon_Wrap(p_cellZ), p_level, LC_HORIZON_GRID_SIZE, 1, 1, GL_RG, GL_FLOAT, lc_horizon.samples);
+	}
+	else
+	{
+		glTextureSubImage3D(lc_world.render_data.horizon.height_texture, 0, LC_Horizon_Wrap(p_cellX), 0, p_level, 1, LC_HORIZON_GRID_SIZE, 1, GL_RG, GL_FLOAT, lc_horizon.samples);
+	}
+}
+
+//the finest level is cut where the chunks or the distant terrain end, every other level where the previous ready level ends
+static void LC_Horizon_UpdateHoles(const ivec3 p_playerKey)
+{
+	ivec4 key_box;
+	LC_Lod_GetDrawnBox(p_playerKey, key_box);
+
+	//block faces are at half positions
+	vec4 hole;
+	hole[0] = key_box[0] * LC_CHUNK_WIDTH - 0.5f;
+	hole[1] = key_box[1] * LC_CHUNK_LENGTH - 0.5f;
+	hole[2] = (key_box[2] + 1) * LC_CHUNK_WIDTH - 0.5f;
+	hole[3] = (key_box[3] + 1) * LC_CHUNK_LENGTH - 0.5f;
+
+	for (int i = 0; i < LC_HORIZON_LEVELS; i++)
+	{
+		LC_HorizonLevel* level = &lc_world.render_data.horizon.levels[i];
+
+		glm_vec4_copy(hole, level->hole_box);
+
+		if (!level->ready)
+		{
+			continue;
+		}
+
+		float extent = (LC_HORIZON_GRID_SIZE - 1) * level->cell_size;
+
+		hole[0] = min(hole[0], level->origin[0] * level->cell_size);
+		hole[1] = min(hole[1], level->origin[1] * level->cell_size);
+		hole[2] = max(hole[2], level->origin[0] * level->cell_size + extent);
+		hole[3] = max(hole[3], level->origin[1] * level->cell_size + extent);
+	}
+}
+
+void LC_Horizon_Update()
+{
+	LC_HorizonRenderData* horizon = &lc_world.render_data.horizon;
+
+	if (lc_horizon_enabled->int_value == 0)
+	{
+		for (int i = 0; i < LC_HORIZON_LEVELS; i++)
+		{
+			lc_horizon.levels[i].valid = false;
+			horizon->levels[i].ready = false;
+		}
+		horizon->enabled = false;
+		return;
+	}
+	horizon->enabled = true;
+
+	vec3 player_position;
+	LC_Player_getPosition(player_position);
+
+	//a fixed amount of surface samples per frame, shared by the levels from the finest out
+	int budget = lc_horizon_budget->int_value;
+
+	for (int i = 0; i < LC_HORIZON_LEVELS && budget >= LC_HORIZON_GRID_SIZE; i++)
+	{
+		LC_HorizonLevel* level = &horizon->levels[i];
+		LC_HorizonLevelState* state = &lc_horizon.levels[i];
+
+		ivec2 target;
+		target[0] = (int)floorf(player_position[0] / level->cell_size) - LC_HORIZON_GRID_SIZE / 2;
+		target[1] = (int)floorf(player_position[2] / level->cell_size) - LC_HORIZON_GRID_SIZE / 2;
+
+		//teleported, nothing in the level can be reused
+		if (!state->valid || abs(target[0] - level->origin[0]) >= LC_HORIZON_GRID_SIZE || abs(target[1] - level->origin[1]) >= LC_HORIZON_GRID_SIZE)
+		{
+			level->origin[0] = target[0];
+			level->origin[1] = target[1];
+			level->ready = false;
+			state->rows_left = LC_HORIZON_GRID_SIZE;
+			state->valid = true;
+		}
+
+		while (state->rows_left > 0 && budget >= LC_HORIZON_GRID_SIZE)
+		{
+			LC_Horizon_WriteLine(i, level->origin[0], level->origin[1] + LC_HORIZON_GRID_SIZE - state->rows_left, true);
+			state->rows_left--;
+			budget -= LC_HORIZON_GRID_SIZE;
+		}
+
+		if (state->rows_left > 0)
+		{
+			break;
+		}
+		level->ready = true;
+
+		//scroll a row at a time, the new row takes the texels of the one that left the grid
+		while (budget >= LC_HORIZON_GRID_SIZE && (level->origin[0] != target[0] || level->origin[1] != target[1]))
+		{
+			if (level->origin[0] < target[0])
+			{
+				LC_Horizon_WriteLine(i, level->origin[0] + LC_HORIZON_GRID_SIZE, level->origin[1], false);
+				level->origin[0]++;
+			}
+			else if (level->origin[0] > target[0])
+			{
+				LC_Horizon_WriteLine(i, level->origin[0] - 1, level->origin[1], false);
+				level->origin[0]--;
+			}
+			else if (level->origin[1] < target[1])
+			{
+				LC_Horizon_WriteLine(i, level->origin[0], level->origin[1] + LC_HORIZON_GRID_SIZE, true);
+				level->origin[1]++;
+			}
+			else
+			{
+				LC_Horizon_WriteLine(i, level->origin[0], level->origin[1] - 1, true);
+				level->origin[1]--;
+			}
+			budget -= LC_HORIZON_GRID_SIZE;
+		}
+	}
+
+	ivec3 player_key;
+	LC_getNormalizedChunkPosition(player_position[0], player_position[1], player_position[2], player_key);
+
+	LC_Horizon_UpdateHoles(player_key);
+}
+
+void LC_Horizon_Init()
+{
+	memset(&lc_horizon, 0, sizeof(lc_horizon));
+
+	//a layer per level. The grid is the same for every level, only the heights move
+	LC_HorizonRenderData* horizon = &lc_world.render_data.horizon;
+
+	glGenTextures(1, &horizon->height_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, horizon->height_texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RG32F, LC_HORIZON_GRID_SIZE, LC_HORIZON_GRID_SIZE, LC_HORIZON_LEVELS);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	for (int i = 0; i < LC_HORIZON_LEVELS; i++)
+	{
+		horizon->levels[i].cell_size = LC_HORIZON_BASE_CELL_SIZE << i;
+	}
+
+	horizon->index_count = (LC_HORIZON_GRID_SIZE - 1) * (LC_HORIZON_GRID_SIZE - 1) * 6;
+	unsigned* indices = malloc(sizeof(unsigned) * horizon->index_count);
+
+	if (indices)
+	{
+		int index = 0;
+		for (int z = 0; z < LC_HORIZON_GRID_SIZE - 1; z++)
+		{
+			for (int x = 0; x < LC_HORIZON_GRID_SIZE - 1; x++)
+			{
+				unsigned vertex = z * LC_HORIZON_GRID_SIZE + x;
+
+				indices[index++] = vertex;
+				indices[index++] = vertex + LC_HORIZON_GRID_SIZE;
+				indices[index++] = vertex + 1;
+				indices[index++] = vertex + 1;
+				indices[index++] = vertex + LC_HORIZON_GRID_SIZE;
+				indices[index++] = vertex + LC_HORIZON_GRID_SIZE + 1;
+			}
+		}
+	}
+	else
+	{
+		horizon->index_count = 0;
+	}
+
+	glGenVertexArrays(1, &horizon->vao);
+	glBindVertexArray(horizon->vao);
+
+	glGenBuffers(1, &horizon->index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, horizon->index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned) * horizon->index_count, indices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	free(indices);
+
+	lc_horizon_enabled = Cvar_Register("lc_horizon", "1", "Draw a heightmap of the terrain past the distant terrain", CVAR__SAVE_TO_FILE, 0, 1);
+	lc_horizon_budget = Cvar_Register("lc_horizon_budget", "256", "Surface height samples the horizon can take per frame", CVAR__SAVE_TO_FILE, 64, 16384);
+}
+
+void LC_Horizon_Exit()
+{
+	glDeleteTextures(1, &lc_world.render_data.horizon.height_texture);
+	glDeleteBuffers(1, &lc_world.render_data.horizon.index_buffer);
+	glDeleteVertexArrays(1, &lc_world.render_data.horizon.vao);
+}
@@ -0,0 +1,14 @@
+#ifndef LC_HORIZON_H
+#define LC_HORIZON_H
+#pragma once
+
+/*
+	Heightmap past the distant terrain, in lc_world.render_data.horizon. The levels are refilled and scrolled
+	a row at a time from the surface height, at most lc_horizon_budget samples per frame
+*/
+
+void LC_Horizon_Init(); //needs the gl context
+void LC_Horizon_Exit();
+void LC_Horizon_Update(); //once per frame, after the distant terrain
+
+#endif // !LC_HORIZON_H
@@ -9,6 +9,7 @@ INIT GAME RESOURCES, GAME WORLD, PHYSICS WORLD, ETC...
 #include "core/resource_manager.h"
 #include "lc/lc_core.h"
 #include "render/r_public.h"
+#include "render/r_texture_cache.h"
 
 #include <string.h>
 
@@ -24,65 +25,67 @@ static int Init_loadResources()
 {
 	memset(&lc_resources, 0, sizeof(lc_resources));
 
+	//everything is decoded in parallel on the resource workers, the first Resource_get of a file waits only for that file
+
 	//Textures
 
 
 
 	//Sounds
-	lc_resources.fall_sound = Resource_get("assets/sounds/player/fall/fallsmall.wav", RESOURCE__SOUND);
-	lc_resources.big_fall_sound = Resource_get("assets/sounds/player/fall/fallbig.wav", RESOURCE__SOUND);
-
-	lc_resources.grass_step_sounds[0] = Resource_get("assets/sounds/player/step/grass1.wav", RESOURCE__SOUND);
-	lc_resources.grass_step_sounds[1] = Resource_get("assets/sounds/player/step/grass2.wav", RESOURCE__SOUND);
-	lc_resources.grass_step_sounds[2] = Resource_get("assets/sounds/player/step/grass3.wav", RESOURCE__SOUND);
-	lc_resources.grass_step_sounds[3] = Resource_get("assets/sounds/player/step/grass4.wav", RESOURCE__SOUND);
-	lc_resources.grass_step_sounds[4] = Resource_get("assets/sounds/player/step/grass5.wav", RESOURCE__SOUND);
-	lc_resources.grass_step_sounds[5] = Resource_get("assets/sounds/player/step/grass6.wav", RESOURCE__SOUND);
-
-	lc_resources.sand_step_sounds[0] = Resource_get("assets/sounds/player/step/sand2.wav", RESOURCE__SOUND);
-	lc_resources.sand_step_sounds[1] = Resource_get("assets/sounds/player/step/sand3.wav", RESOURCE__SOUND);
-	lc_resources.sand_step_sounds[2] = Resource_get("assets/sounds/player/step/sand4.wav", RESOURCE__SOUND);
-	lc_resources.sand_step_sounds[3] = Resource_get("assets/sounds/player/step/sand5.wav", RESOURCE__SOUND);
-	lc_resources.sand_step_sounds[4] = Resource_get("assets/sounds/player/step/sand5.wav", RESOURCE__SOUND);
-
-	lc_resources.stone_step_sounds[0] = Resource_get("assets/sounds/player/step/stone1.wav", RESOURCE__SOUND);
-	lc_resources.stone_step_sounds[1] = Resource_get("assets/sounds/player/step/stone2.wav", RESOURCE__SOUND);
-	lc_resources.stone_step_sounds[2] = Resource_get("assets/sounds/player/step/stone3.wav", RESOURCE__SOUND);
-	lc_resources.stone_step_sounds[3] = Resource_get("assets/sounds/player/step/stone4.wav", RESOURCE__SOUND);
-	lc_resources.stone_step_sounds[4] = Resource_get("assets/sounds/player/step/stone5.wav", RESOURCE__SOUND);
-	lc_resources.stone_step_sounds[5] = Resource_get("assets/sounds/player/step/stone6.wav", RESOURCE__SOUND);
-
-	lc_resources.wood_step_sounds[0] = Resource_get("assets/sounds/player/step/wood1.wav", RESOURCE__SOUND);
-	lc_resources.wood_step_sounds[1] = Resource_get("assets/sounds/player/step/wood2.wav", RESOURCE__SOUND);
-	lc_resources.wood_step_sounds[2] = Resource_get("assets/sounds/player/step/wood3.wav", RESOURCE__SOUND);
-	lc_resources.wood_step_sounds[3] = Resource_get("assets/sounds/player/step/wood4.wav", RESOURCE__SOUND);
-	lc_resources.wood_step_sounds[4] = Resource_get("assets/sounds/player/step/wood5.wav", RESOURCE__SOUND);
-	lc_resources.wood_step_sounds[5] = Resource_get("assets/sounds/player/step/wood6.wav", RESOURCE__SOUND);
-
-	lc_resources.gravel_step_sounds[0] = Resource_get("assets/sounds/player/step/gravel1.wav", RESOURCE__SOUND);
-	lc_resources.gravel_step_sounds[1] = Resource_get("assets/sounds/player/step/gravel2.wav", RESOURCE__SOUND);
-	lc_resources.gravel_step_sounds[2] = Resource_get("assets/sounds/player/step/gravel3.wav", RESOURCE__SOUND);
-	lc_resources.gravel_step_sounds[3] = Resource_get("assets/sounds/player/step/gravel4.wav", RESOURCE__SOUND);
-
-	lc_resources.grass_dig_sounds[0] = Resource_get("assets/sounds/player/dig/grass1.wav", RESOURCE__SOUND);
-	lc_resources.grass_dig_sounds[1] = Resource_get("assets/sounds/player/dig/grass2.wav", RESOURCE__SOUND);
-	lc_resources.grass_dig_sounds[2] = Resource_get("assets/sounds/player/dig/grass3.wav", RESOURCE__SOUND);
-	lc_resources.grass_dig_sounds[3] = Resource_get("assets/sounds/player/dig/grass4.wav", RESOURCE__SOUND);
-
-	lc_resources.sand_dig_sounds[0] = Resource_get("assets/sounds/player/dig/sand1.wav", RESOURCE__SOUND);
-	lc_resources.sand_dig_sounds[1] = Resource_get("assets/sounds/player/dig/sand2.wav", RESOURCE__SOUND);
-	lc_resources.sand_dig_sounds[2] = Resource_get("assets/sounds/player/dig/sand3.wav", RESOURCE__SOUND);
-	lc_resources.sand_dig_sounds[3] = Resource_get("assets/sounds/player/dig/sand4.wav", RESOURCE__SOUND);
-
-	lc_resources.stone_dig_sounds[0] = Resource_get("assets/sounds/player/dig/stone1.wav", RESOURCE__SOUND);
-	lc_resources.stone_dig_sounds[1] = Resource_get("assets/sounds/player/dig/stone2.wav", RESOURCE__SOUND);
-	lc_resources.stone_dig_sounds[2] = Resource_get("assets/sounds/player/dig/stone3.wav", RESOURCE__SOUND);
-	lc_resources.stone_dig_sounds[3] = Resource_get("assets/sounds/player/dig/stone4.wav", RESOURCE__SOUND);
-
-	lc_resources.wood_dig_sounds[0] = Resource_get("assets/sounds/player/dig/wood1.wav", RESOURCE__SOUND);
-	lc_resources.wood_dig_sounds[1] = Resource_get("assets/sounds/player/dig/wood2.wav", RESOURCE__SOUND);
-	lc_resources.wood_dig_sounds[2] = Resource_get("assets/sounds/player/dig/wood3.wav", RESOURCE__SOUND);
-	lc_resources.wood_dig_sounds[3] = Resource_get("assets/sounds/player/dig/wood4.wav", RESOURCE__SOUND);
+	lc_resources.fall_sound = Resource_getAsync("assets/sounds/player/fall/fallsmall.wav", RESOURCE__SOUND);
+	lc_resources.big_fall_sound = Resource_getAsync("assets/sounds/player/fall/fallbig.wav", RESOURCE__SOUND);
+
+	lc_resources.grass_step_sounds[0] = Resource_getAsync("assets/sounds/player/step/grass1.wav", RESOURCE__SOUND);
+	lc_resources.grass_step_sounds[1] = Resource_getAsync("assets/sounds/player/step/grass2.wav", RESOURCE__SOUND);
+	lc_resources.grass_step_sounds[2] = Resource_getAsync("assets/sounds/player/step/grass3.wav", RESOURCE__SOUND);
+	lc_resources.grass_step_sounds[3] = Resource_getAsync("assets/sounds/player/step/grass4.wav", RESOURCE__SOUND);
+	lc_resources.grass_step_sounds[4] = Resource_getAsync("assets/sounds/player/step/grass5.wav", RESOURCE__SOUND);
+	lc_resources.grass_step_sounds[5] = Resource_getAsync("assets/sounds/player/step/grass6.wav", RESOURCE__SOUND);
+
+	lc_resources.sand_step_sounds[0] = Resource_getAsync("assets/sounds/player/step/sand2.wav", RESOURCE__SOUND);
+	lc_resources.sand_step_sounds[1] = Resource_getAsync("assets/sounds/player/step/sand3.wav", RESOURCE__SOUND);
+	lc_resources.sand_step_sounds[2] = Resource_getAsync("assets/sounds/player/step/sand4.wav", RESOURCE__SOUND);
+	lc_resources.sand_step_sounds[3] = Resource_getAsync("assets/sounds/player/step/sand5.wav", RESOURCE__SOUND);
+	lc_resources.sand_step_sounds[4] = Resource_getAsync("assets/sounds/player/step/sand5.wav", RESOURCE__SOUND);
+
+	lc_resources.stone_step_sounds[0] = Resource_getAsync("assets/sounds/player/step/stone1.wav", RESOURCE__SOUND);
+	lc_resources.stone_step_sounds[1] = Resource_getAsync("assets/sounds/player/step/stone2.wav", RESOURCE__SOUND);
+	lc_resources.stone_step_sounds[2] = Resource_getAsync("assets/sounds/player/step/stone3.wav", RESOURCE__SOUND);
+	lc_resources.stone_step_sounds[3] = Resource_getAsync("assets/sounds/player/step/stone4.wav", RESOURCE__SOUND);
+	lc_resources.stone_step_sounds[4] = Resource_getAsync("assets/sounds/player/step/stone5.wav", RESOURCE__SOUND);
+	lc_resources.stone_step_sounds[5] = Resource_getAsync("assets/sounds/player/step/stone6.wav", RESOURCE__SOUND);
+
+	lc_resources.wood_step_sounds[0] = Resource_getAsync("assets/sounds/player/step/wood1.wav", RESOURCE__SOUND);
+	lc_resources.wood_step_sounds[1] = Resource_getAsync("assets/sounds/player/step/wood2.wav", RESOURCE__SOUND);
+	lc_resources.wood_step_sounds[2] = Resource_getAsync("assets/sounds/player/step/wood3.wav", RESOURCE__SOUND);
+	lc_resources.wood_step_sounds[3] = Resource_getAsync("assets/sounds/player/step/wood4.wav", RESOURCE__SOUND);
+	lc_resources.wood_step_sounds[4] = Resource_getAsync("assets/sounds/player/step/wood5.wav", RESOURCE__SOUND);
+	lc_resources.wood_step_sounds[5] = Resource_getAsync("assets/sounds/player/step/wood6.wav", RESOURCE__SOUND);
+
+	lc_resources.gravel_step_sounds[0] = Resource_getAsync("assets/sounds/player/step/gravel1.wav", RESOURCE__SOUND);
+	lc_resources.gravel_step_sounds[1] = Resource_getAsync("assets/sounds/player/step/gravel2.wav", RESOURCE__SOUND);
+	lc_resources.gravel_step_sounds[2] = Resource_getAsync("assets/sounds/player/step/gravel3.wav", RESOURCE__SOUND);
+	lc_resources.gravel_step_sounds[3] = Resource_getAsync("assets/sounds/player/step/gravel4.wav", RESOURCE__SOUND);
+
+	lc_resources.grass_dig_sounds[0] = Resource_getAsync("assets/sounds/player/dig/grass1.wav", RESOURCE__SOUND);
+	lc_resources.grass_dig_sounds[1] = Resource_getAsync("assets/sounds/player/dig/grass2.wav", RESOURCE__SOUND);
+	lc_resources.grass_dig_sounds[2] = Resource_getAsync("assets/sounds/player/dig/grass3.wav", RESOURCE__SOUND);
+	lc_resources.grass_dig_sounds[3] = Resource_getAsync("assets/sounds/player/dig/grass4.wav", RESOURCE__SOUND);
+
+	lc_resources.sand_dig_sounds[0] = Resource_getAsync("assets/sounds/player/dig/sand1.wav", RESOURCE__SOUND);
+	lc_resources.sand_dig_sounds[1] = Resource_getAsync("assets/sounds/player/dig/sand2.wav", RESOURCE__SOUND);
+	lc_resources.sand_dig_sounds[2] = Resource_getAsync("assets/sounds/player/dig/sand3.wav", RESOURCE__SOUND);
+	lc_resources.sand_dig_sounds[3] = Resource_getAsync("assets/sounds/player/dig/sand4.wav", RESOURCE__SOUND);
+
+	lc_resources.stone_dig_sounds[0] = Resource_getAsync("assets/sounds/player/dig/stone1.wav", RESOURCE__SOUND);
+	lc_resources.stone_dig_sounds[1] = Resource_getAsync("assets/sounds/player/dig/stone2.wav", RESOURCE__SOUND);
+	lc_resources.stone_dig_sounds[2] = Resource_getAsync("assets/sounds/player/dig/stone3.wav", RESOURCE__SOUND);
+	lc_resources.stone_dig_sounds[3] = Resource_getAsync("assets/sounds/player/dig/stone4.wav", RESOURCE__SOUND);
+
+	lc_resources.wood_dig_sounds[0] = Resource_getAsync("assets/sounds/player/dig/wood1.wav", RESOURCE__SOUND);
+	lc_resources.wood_dig_sounds[1] = Resource_getAsync("assets/sounds/player/dig/wood2.wav", RESOURCE__SOUND);
+	lc_resources.wood_dig_sounds[2] = Resource_getAsync("assets/sounds/player/dig/wood3.wav", RESOURCE__SOUND);
+	lc_resources.wood_dig_sounds[3] = Resource_getAsync("assets/sounds/player/dig/wood4.wav", RESOURCE__SOUND);
 
 	if (!lc_resources.fall_sound || !lc_resources.big_fall_sound)
 	{
@@ -98,10 +101,10 @@ static int Init_loadResources()
 	for (int i = 0; i < 4; i++) if (!lc_resources.stone_dig_sounds[i]) return -1;
 	for (int i = 0; i < 4; i++) if (!lc_resources.wood_dig_sounds[i]) return -1;
 
-	if (!Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE) || !Resource_get("assets/cube_textures/simple_block_atlas_normal.png", RESOURCE__TEXTURE)
-		|| !Resource_get("assets/cube_textures/simple_block_atlas_mer.png", RESOURCE__TEXTURE) || !Resource_get("assets/cube_textures/simple_block_atlas_heightmap.png", RESOURCE__TEXTURE)
-		 || !Resource_get("assets/water/water_displacement.png", RESOURCE__TEXTURE) || !Resource_get("assets/water/gradient_map.png", RESOURCE__TEXTURE) || !Resource_get("assets/ui/hotbar.png", RESOURCE__TEXTURE)
-		|| !Resource_get("assets/ui/water_overlay.png", RESOURCE__TEXTURE) || !Resource_get("assets/ui/crosshair.png", RESOURCE__TEXTURE) || !Resource_get("assets/cubemaps/hdr/night_sky.hdr", RESOURCE__TEXTURE_HDR))
+	if (!Resource_getAsync("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7) || !Resource_getAsync("assets/cube_textures/simple_block_atlas_normal.png", RESOURCE__TEXTURE_BC5)
+		|| !Resource_getAsync("assets/cube_textures/simple_block_atlas_mer.png", RESOURCE__TEXTURE_BC7) || !Resource_getAsync("assets/cube_textures/simple_block_atlas_heightmap.png", RESOURCE__TEXTURE_BC4)
+		 || !Resource_getAsync("assets/water/water_displacement.png", RESOURCE__TEXTURE_BC5) || !Resource_getAsync("assets/water/gradient_map.png", RESOURCE__TEXTURE) || !Resource_getAsync("assets/ui/hotbar.png", RESOURCE__TEXTURE)
+		|| !Resource_getAsync("assets/ui/water_overlay.png", RESOURCE__TEXTURE) || !Resource_getAsync("assets/ui/crosshair.png", RESOURCE__TEXTURE) || !Resource_getAsync("assets/cubemaps/hdr/night_sky.hdr", RESOURCE__TEXTURE_HDR))
 	{
 		return -1;
 	}
@@ -116,64 +119,6 @@ void Init_SoundGroups()
 	//Sound_createGroup(0, &lc_sound_groups.step);
 }
 
-void Process_ParticleCollideWithWorld(ParticleCpu* const particle, ParticleEmitterSettings* const emitter, float local_delta)
-{
-	vec3 normal_vel;
-	glm_vec3_normalize_to(particle->velocity, normal_vel);
-
-	LC_Chunk* chunk;
-	ivec3 relative_block_pos;
-
-	LC_Block* block = LC_World_GetBlock(particle->xform[3][0] + (normal_vel[0] * emitter->scale), particle->xform[3][1] + (normal_vel[1] * emitter->scale),
-		particle->xform[3][2] + (normal_vel[2] * emitter->scale), relative_block_pos, &chunk);
-
-	if (block && LC_isBlockCollidable(block->type) && particle->time > 0.2)
-	{
-		ivec3 relative_particle_position;
-		relative_particle_position[0] = roundf(particle->xform[3][0]) - chunk->global_position[0];
-		relative_particle_position[1] = roundf(particle->xform[3][1]) - chunk->global_position[1];
-		relative_particle_position[2] = roundf(particle->xform[3][2]) - chunk->global_position[2];
-
-		vec3 normal;
-		glm_vec3_zero(normal);
-
-		if (relative_particle_position[0] > relative_block_pos[0])
-		{
-			normal[0] = 1;
-		}
-		else if (relative_particle_position[0] < relative_block_pos[0])
-		{
-			normal[0] = -1;
-		}
-		else if (relative_particle_position[1] > relative_block_pos[1])
-		{
-			normal[1] = 1;
-		}
-		else if (relative_particle_position[1] < relative_block_pos[1])
-		{
-			normal[1] = -1;
-		}
-		else if (relative_particle_position[2] > relative_block_pos[2])
-		{
-			normal[2] = 1;
-		}
-		else if (relative_particle_position[2] < relative_block_pos[2])
-		{
-			normal[2] = -1;
-		}
-
-		vec3 reflect;
-		float normal_dot = glm_dot(normal, particle->velocity);
-		reflect[0] = particle->velocity[0] - 2.0 * normal_dot * normal[0];
-		reflect[1] = particle->velocity[1] - 2.0 * normal_dot * normal[1];
-		reflect[2] = particle->velocity[2] - 2.0 * normal_dot * normal[2];
-
-		particle->velocity[0] = reflect[0] * 0.5;
-		particle->velocity[1] = reflect[1] * 0.5;
-		particle->velocity[2] = reflect[2] * 0.5;
-	}
-}
-
 void Init_Emitters()
 {
 	//hardcoded particle emitters, fine for now(not many different emitters), might make a serialization format later
@@ -182,7 +127,7 @@ void Init_Emitters()
 	{
 		lc_emitters.block_dig[i] = Particle_RegisterEmitter();
 
-		lc_emitters.block_dig[i]->texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE);
+		lc_emitters.block_dig[i]->texture = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7);
 
 		lc_emitters.block_dig[i]->particle_amount = (i == 4) ? 5 : 5;
 		glm_mat4_identity(lc_emitters.block_dig[i]->xform);
@@ -222,11 +167,51 @@ void Init_Emitters()
 
 		lc_emitters.block_dig[i]->one_shot = true;
 
-		lc_emitters.block_dig[i]->collision_function = Process_ParticleCollideWithWorld;
+		lc_emitters.block_dig[i]->collision_function = Particle_CollideWithWorld;
 	}
 	
 }
 
+/*
+	Encodes every compressed texture the game uses, without creating a window or a gl context.
+	Run with -build_texture_cache to ship the cache with a build, otherwise it is built on the first start
+*/
+int LC_BuildTextureCache()
+{
+	typedef struct
+	{
+		const char* path;
+		TextureCompression compression;
+	} CacheEntry;
+
+	const CacheEntry entries[] =
+	{
+		{ "assets/cube_textures/simple_block_atlas.png", TEXTURE_COMPRESSION__BC7 },
+		{ "assets/cube_textures/simple_block_atlas_mer.png", TEXTURE_COMPRESSION__BC7 },
+		{ "assets/cube_textures/simple_block_atlas_normal.png", TEXTURE_COMPRESSION__BC5 },
+		{ "assets/cube_textures/simple_block_atlas_heightmap.png", TEXTURE_COMPRESSION__BC4 },
+		{ "assets/water/water_displacement.png", TEXTURE_COMPRESSION__BC5 }
+	};
+
+	int failed = 0;
+
+	for (int i = 0; i < sizeof(entries) / sizeof(entries[0]); i++)
+	{
+		R_TextureData data;
+		if (!TextureCache_Build(entries[i].path, entries[i].compression, &data))
+		{
+			printf("Failed to build texture cache for %s \n", entries[i].path);
+			failed++;
+			continue;
+		}
+		printf("Built texture cache for %s, %i mips \n", entries[i].path, data.mip_count);
+
+		Texture_FreeData(&data);
+	}
+
+	return failed;
+}
+
 int LC_Init()
 {
 	if (!Init_loadResources())
@@ -245,12 +230,17 @@ int LC_Init()
 	const int Y_CHUNKS = 8;
 	const int Z_CHUNKS = 16;
 
-	LC_World_Create(X_CHUNKS, Y_CHUNKS, Z_CHUNKS);
-
 	vec3 player_pos;
 	player_pos[0] = X_CHUNKS / 2;
 	player_pos[1] = 0;
 	player_pos[2] = Z_CHUNKS / 2;
+
+	//only the chunks around the player are generated before the first frame
+	LC_World_Create(X_CHUNKS, Y_CHUNKS, Z_CHUNKS, player_pos);
+
+	//the player starts the sounds directly, so they have to be ready. The rest of the textures are uploaded by Resource_Update
+	Resource_waitAll(RESOURCE__SOUND);
+
 	PL_initPlayer(player_pos);
 
 	return 1;
@@ -0,0 +1,576 @@
+#include "lc/lc_lod.h"
+
+#include <string.h>
+
+#include "lc/lc_world_internal.h"
+#include "core/cvar.h"
+#include "utility/u_queue.h"
+
+#define LC_LOD_RING_RADIUS 4 //in columns of the level
+#define LC_LOD_MAX_COLUMN_CHUNKS 4
+
+extern void LC_Player_getPosition(vec3 dest);
+
+/*
+	A column of the distant terrain. Cells that the finer levels or the full detail chunks draw are left empty,
+	the clip boxes are in chunk keys as min x, min z, max x, max z
+*/
+typedef struct
+{
+	int level;
+	ivec2 key; //in columns of the level
+	ivec4 full_clip; //part of the column inside the full detail chunks
+	ivec4 inner_clip; //part of the column inside the previous level
+	LC_Chunk* chunks; //only the ones with render data
+	int chunk_count;
+	size_t vertex_count;
+	unsigned build_serial; //serial of the build in flight, 0 if none
+	bool build_requested; //waiting for a free lod task
+	bool visited;
+} LC_LodColumn;
+
+typedef struct
+{
+	int level;
+	ivec2 key;
+	ivec4 full_clip;
+	ivec4 inner_clip;
+	unsigned build_serial;
+
+	LC_Chunk chunks[LC_LOD_MAX_COLUMN_CHUNKS];
+	GeneratedChunkVerticesResult* vertices_results[LC_LOD_MAX_COLUMN_CHUNKS];
+	int chunk_count;
+} LC_LodTask;
+
+typedef struct
+{
+	LC_LodTask task_list[LC_MAX_LOD_TASKS];
+
+	//only touched by the main thread
+	int free_tasks[LC_MAX_LOD_TASKS];
+	int free_count;
+	unsigned serial_counter;
+
+	MPSC_Queue completed_queue; //lc workers -> main thread, task indexes
+
+	dynamic_array* columns; //LC_LodColumn*
+	int chunk_count; //lod chunks with render data, at most LC_LOD_MAX_CHUNKS
+	size_t vertex_count;
+
+	ivec3 player_key; //the rings were last updated around this chunk key
+	bool static_world; //lc_static_world of the last update
+	bool rings_valid;
+	ivec4 static_box; //chunk keys of the static world
+} LC_LodState;
+
+static LC_LodState lc_lod;
+static Cvar* lc_lod_enabled;
+static Cvar* lc_lod_report;
+
+static int LC_Lod_FloorDiv(int p_value, int p_divisor)
+{
+	return (int)floorf((float)p_value / (float)p_divisor);
+}
+
+static void LC_Lod_SetBox(ivec4 dest, int p_minX, int p_minZ, int p_maxX, int p_maxZ)
+{
+	dest[0] = p_minX;
+	dest[1] = p_minZ;
+	dest[2] = p_maxX;
+	dest[3] = p_maxZ;
+}
+
+static void LC_Lod_ClipBox(const ivec4 p_box, const ivec4 p_clip, ivec4 dest)
+{
+	LC_Lod_SetBox(dest, max(p_box[0], p_clip[0]), max(p_box[1], p_clip[1]), min(p_box[2], p_clip[2]), min(p_box[3], p_clip[3]));
+
+	//every empty box is the same, so the clips of a column can be compared
+	if (dest[0] > dest[2] || dest[1] > dest[3])
+	{
+		LC_Lod_SetBox(dest, 0, 0, -1, -1);
+	}
+}
+
+static bool LC_Lod_isKeyInBox(int p_x, int p_z, const ivec4 p_box)
+{
+	return p_x >= p_box[0] && p_x <= p_box[2] && p_z >= p_box[1] && p_z <= p_box[3];
+}
+
+//chunk keys covered by a level, the anchor only moves when the player crosses a column of the level
+static void LC_Lod_GetCoverage(int p_level, const ivec3 p_playerKey, ivec4 dest)
+{
+	int size = 1 << p_level;
+	int anchor_x = LC_Lod_FloorDiv(p_playerKey[0], size);
+	int anchor_z = LC_Lod_FloorDiv(p_playerKey[2], size);
+
+	LC_Lod_SetBox(dest, (anchor_x - LC_LOD_RING_RADIUS) * size, (anchor_z - LC_LOD_RING_RADIUS) * size,
+		(anchor_x + LC_LOD_RING_RADIUS + 1) * size - 1, (anchor_z + LC_LOD_RING_RADIUS + 1) * size - 1);
+}
+
+static void LC_Lod_GetFullDetailBox(const ivec3 p_playerKey, ivec4 dest)
+{
+	if (LC_World_IsStatic() != 0)
+	{
+		memcpy(dest, lc_lod.static_box, sizeof(ivec4));
+		return;
+	}
+
+	//same as LC_World_CreateNearbyChunks
+	LC_Lod_SetBox(dest, p_playerKey[0] - LC_RENDER_DISTANCE_CHUNKS, p_playerKey[2] - LC_RENDER_DISTANCE_CHUNKS,
+		p_playerKey[0] + LC_RENDER_DISTANCE_CHUNKS - 1, p_playerKey[2] + LC_RENDER_DISTANCE_CHUNKS - 1);
+}
+
+static void LC_Lod_BuildColumn(LC_LodTask* const p_task)
+{
+	int cell_size = 1 << p_task->level;
+	int column_size = LC_CHUNK_WIDTH * cell_size;
+	int min_x = p_task->key[0] * column_size;
+	int min_z = p_task->key[1] * column_size;
+
+	int surface_min = 0;
+	int surface_max = 0;
+	LC_Generate_SurfaceRange(min_x, min_z, column_size, &surface_min, &surface_max);
+
+	//the samples miss the peaks and valleys between them
+	surface_min -= cell_size * 2;
+	surface_max += cell_size * 2;
+
+	//water is drawn at its surface, so the column reaches at least up to it
+	int last_y = LC_Lod_FloorDiv(max(surface_max, LC_WORLD_WATER_HEIGHT), column_size);
+	int first_y = LC_Lod_FloorDiv(surface_min, column_size);
+	first_y = max(first_y, max(last_y - LC_LOD_MAX_COLUMN_CHUNKS + 1, 0));
+
+	p_task->chunk_count = 0;
+
+	for (int chunk_y = first_y; chunk_y <= last_y; chunk_y++)
+	{
+		int index = p_task->chunk_count++;
+
+		LC_Chunk* chunk = &p_task->chunks[index];
+		*chunk = LC_Chunk_Create(min_x, chunk_y * column_size, min_z);
+		chunk->lod_level = p_task->level;
+
+		p_task->vertices_results[index] = NULL;
+
+		for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+		{
+			int g_x = min_x + x * cell_size;
+			int key_x = LC_Lod_FloorDiv(g_x, LC_CHUNK_WIDTH);
+
+			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
+			{
+				int g_z = min_z + z * cell_size;
+				int key_z = LC_Lod_FloorDiv(g_z, LC_CHUNK_LENGTH);
+
+				//drawn by the finer levels
+				if (LC_Lod_isKeyInBox(key_x, key_z, p_task->full_clip) || LC_Lod_isKeyInBox(key_x, key_z, p_task->inner_clip))
+				{
+					continue;
+				}
+
+				for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
+				{
+					int g_y = chunk->global_position[1] + y * cell_size;
+
+					uint8_t type = LC_BT__NONE;
+
+					//the cell sizes divide the water height + 1, so the top of the water cells is the real water height
+					if (g_y > surface_max)
+					{
+						type = (g_y + cell_size - 1 <= LC_WORLD_WATER_HEIGHT) ? LC_BT__WATER : LC_BT__NONE;
+					}
+					//deep below the surface one sample is enough
+					else if (g_y + cell_size < surface_min)
+					{
+						type = LC_Generate_Block(g_x + cell_size / 2, g_y + cell_size / 2, g_z + cell_size / 2);
+					}
+					else
+					{
+						type = LC_Generate_LodCell(g_x, g_y, g_z, cell_size);
+					}
+
+					if (type != LC_BT__NONE)
+					{
+						LC_Chunk_SetBlock(chunk, x, y, z, type);
+					}
+				}
+			}
+		}
+
+		//the mesher always closes the faces on the chunk borders, they work as skirts over the cracks between the levels
+		if (chunk->alive_blocks > 0)
+		{
+			p_task->vertices_results[index] = LC_Chunk_GenerateVertices(chunk);
+		}
+	}
+}
+
+static LC_LodColumn* LC_Lod_FindColumn(int p_level, const ivec2 p_key)
+{
+	for (int i = 0; i < dA_size(lc_lod.columns); i++)
+	{
+		LC_LodColumn** column = dA_at(lc_lod.columns, i);
+
+		if ((*column)->level == p_level && (*column)->key[0] == p_key[0] && (*column)->key[1] == p_key[1])
+		{
+			return *column;
+		}
+	}
+
+	return NULL;
+}
+
+static void LC_Lod_ReleaseColumnChunks(LC_LodColumn* const p_column)
+{
+	for (int i = 0; i < p_column->chunk_count; i++)
+	{
+		LC_World_ReleaseChunkRenderData(&p_column->chunks[i]);
+		lc_lod.chunk_count--;
+	}
+
+	if (p_column->chunks)
+	{
+		free(p_column->chunks);
+	}
+
+	lc_lod.vertex_count -= p_column->vertex_count;
+
+	p_column->chunks = NULL;
+	p_column->chunk_count = 0;
+	p_column->vertex_count = 0;
+}
+
+static void LC_Lod_RemoveColumnAt(int p_index)
+{
+	LC_LodColumn** column = dA_at(lc_lod.columns, p_index);
+
+	LC_Lod_ReleaseColumnChunks(*column);
+	free(*column);
+
+	int last = dA_size(lc_lod.columns) - 1;
+
+	if (p_index != last)
+	{
+		*column = *(LC_LodColumn**)dA_at(lc_lod.columns, last);
+	}
+	dA_popBack(lc_lod.columns);
+}
+
+static void LC_Lod_UpdateRings()
+{
+	vec3 player_position;
+	LC_Player_getPosition(player_position);
+
+	ivec3 player_key;
+	LC_getNormalizedChunkPosition(player_position[0], player_position[1], player_position[2], player_key);
+
+	//the rings only change when the player crosses a chunk
+	if (lc_lod.rings_valid && player_key[0] == lc_lod.player_key[0] && player_key[2] == lc_lod.player_key[2]
+		&& lc_lod.static_world == LC_World_IsStatic())
+	{
+		return;
+	}
+
+	memcpy(lc_lod.player_key, player_key, sizeof(ivec3));
+	lc_lod.static_world = LC_World_IsStatic();
+	lc_lod.rings_valid = true;
+
+	for (int i = 0; i < dA_size(lc_lod.columns); i++)
+	{
+		LC_LodColumn** column = dA_at(lc_lod.columns, i);
+		(*column)->visited = false;
+	}
+
+	ivec4 full_box;
+	LC_Lod_GetFullDetailBox(player_key, full_box);
+
+	for (int level = 1; level <= LC_LOD_LEVELS; level++)
+	{
+		int size = 1 << level;
+
+		ivec4 coverage;
+		ivec4 inner_box;
+		LC_Lod_GetCoverage(level, player_key, coverage);
+
+		if (level == 1)
+		{
+			memcpy(inner_box, full_box, sizeof(ivec4));
+		}
+		else
+		{
+			LC_Lod_GetCoverage(level - 1, player_key, inner_box);
+		}
+
+		for (int x = coverage[0] / size; x <= coverage[2] / size; x++)
+		{
+			for (int z = coverage[1] / size; z <= coverage[3] / size; z++)
+			{
+				ivec2 key;
+				key[0] = x;
+				key[1] = z;
+
+				ivec4 column_box;
+				LC_Lod_SetBox(column_box, x * size, z * size, x * size + size - 1, z * size + size - 1);
+
+				ivec4 full_clip;
+				ivec4 inner_clip;
+				LC_Lod_ClipBox(full_box, column_box, full_clip);
+				LC_Lod_ClipBox(inner_box, column_box, inner_clip);
+
+				//the whole column is drawn by the finer levels
+				if (memcmp(full_clip, column_box, sizeof(ivec4)) == 0 || memcmp(inner_clip, column_box, sizeof(ivec4)) == 0)
+				{
+					continue;
+				}
+
+				LC_LodColumn* column = LC_Lod_FindColumn(level, key);
+
+				if (!column)
+				{
+					column = calloc(1, sizeof(LC_LodColumn));
+
+					if (!column)
+					{
+						continue;
+					}
+
+					column->level = level;
+					memcpy(column->key, key, sizeof(ivec2));
+					column->build_requested = true;
+
+					dA_emplaceBackData(lc_lod.columns, &column);
+				}
+				//the hole for the finer levels moved
+				else if (memcmp(column->full_clip, full_clip, sizeof(ivec4)) != 0 || memcmp(column->inner_clip, inner_clip, sizeof(ivec4)) != 0)
+				{
+					column->build_requested = true;
+				}
+
+				memcpy(column->full_clip, full_clip, sizeof(ivec4));
+				memcpy(column->inner_clip, inner_clip, sizeof(ivec4));
+				column->visited = true;
+			}
+		}
+	}
+
+	for (int i = dA_size(lc_lod.columns) - 1; i >= 0; i--)
+	{
+		LC_LodColumn** column = dA_at(lc_lod.columns, i);
+
+		if (!(*column)->visited)
+		{
+			LC_Lod_RemoveColumnAt(i);
+		}
+	}
+}
+
+static void LC_Lod_SubmitBuilds()
+{
+	for (int i = 0; i < dA_size(lc_lod.columns) && lc_lod.free_count > 0; i++)
+	{
+		LC_LodColumn* column = *(LC_LodColumn**)dA_at(lc_lod.columns, i);
+
+		if (!column->build_requested)
+		{
+			continue;
+		}
+
+		int index = lc_lod.free_tasks[--lc_lod.free_count];
+
+		//0 is kept for no build
+		if (++lc_lod.serial_counter == 0)
+		{
+			lc_lod.serial_counter = 1;
+		}
+
+		column->build_requested = false;
+		column->build_serial = lc_lod.serial_counter;
+
+		LC_LodTask* task = &lc_lod.task_list[index];
+		task->level = column->level;
+		task->build_serial = column->build_serial;
+		memcpy(task->key, column->key, sizeof(ivec2));
+		memcpy(task->full_clip, column->full_clip, sizeof(ivec4));
+		memcpy(task->inner_clip, column->inner_clip, sizeof(ivec4));
+
+		LC_World_RequestLodTask(index);
+	}
+}
+
+static void LC_Lod_ProcessFinishedBuilds(size_t p_budgetBytes)
+{
+	int index = 0;
+
+	while (lc_world.frame_upload_bytes < p_budgetBytes && MPSC_Queue_Pop(&lc_lod.completed_queue, &index))
+	{
+		LC_LodTask* task = &lc_lod.task_list[index];
+
+		lc_lod.free_tasks[lc_lod.free_count++] = index;
+
+		LC_LodColumn* column = LC_Lod_FindColumn(task->level, task->key);
+
+		//removed while it was building, or a newer build is on the way
+		if (!column || column->build_serial != task->build_serial)
+		{
+			for (int i = 0; i < task->chunk_count; i++)
+			{
+				LC_World_FreeVerticesResult(task->vertices_results[i]);
+				task->vertices_results[i] = NULL;
+			}
+			continue;
+		}
+
+		LC_Lod_ReleaseColumnChunks(column);
+
+		column->build_serial = 0;
+		column->chunks = malloc(sizeof(LC_Chunk) * max(task->chunk_count, 1));
+
+		for (int i = 0; i < task->chunk_count; i++)
+		{
+			GeneratedChunkVerticesResult* vertices_result = task->vertices_results[i];
+			task->vertices_results[i] = NULL;
+
+			if (!vertices_result || !column->chunks || lc_lod.chunk_count >= LC_LOD_MAX_CHUNKS)
+			{
+				LC_World_FreeVerticesResult(vertices_result);
+				continue;
+			}
+
+			LC_Chunk* chunk = &column->chunks[column->chunk_count++];
+			*chunk = task->chunks[i];
+
+			chunk->opaque_index = -1;
+			chunk->transparent_index = -1;
+			chunk->water_index = -1;
+			chunk->chunk_data_index = -1;
+			chunk->draw_cmd_index = -1;
+			chunk->aabb_tree_index = -1;
+
+			column->vertex_count += vertices_result->opaque_vertex_count + vertices_result->transparent_vertex_count + vertices_result->water_vertex_count;
+
+			LC_World_UpdateChunkIndexes(chunk);
+			LC_World_UpdateChunkVertices(chunk, vertices_result);
+
+			lc_lod.chunk_count++;
+		}
+
+		lc_lod.vertex_count += column->vertex_count;
+	}
+}
+
+static void LC_Lod_ReleaseAll()
+{
+	for (int i = dA_size(lc_lod.columns) - 1; i >= 0; i--)
+	{
+		LC_Lod_RemoveColumnAt(i);
+	}
+
+	lc_lod.rings_valid = false;
+}
+
+static void LC_Lod_PrintReport()
+{
+	size_t full_vertices = (lc_world.render_data.opaque_buffer.used_bytes + lc_world.render_data.semi_transparent_buffer.used_bytes) / sizeof(ChunkVertex)
+		+ lc_world.render_data.water_buffer.used_bytes / sizeof(ChunkWaterVertex);
+
+	full_vertices = (full_vertices > lc_lod.vertex_count) ? full_vertices - lc_lod.vertex_count : 0;
+
+	int full_detail_distance = LC_RENDER_DISTANCE_CHUNKS * LC_CHUNK_WIDTH;
+	int lod_distance = (LC_LOD_RING_RADIUS << LC_LOD_LEVELS) * LC_CHUNK_WIDTH;
+
+	printf("Distant terrain: %zu columns, %i chunks, %zu vertices, %i blocks view distance\n", dA_size(lc_lod.columns), lc_lod.chunk_count, lc_lod.vertex_count, lod_distance);
+	printf("Full detail: %zu chunks, %zu vertices, %i blocks view distance\n", lc_world.num_alive_chunks, full_vertices, full_detail_distance);
+}
+
+void LC_Lod_Update(size_t p_budgetBytes)
+{
+	if (lc_lod_report->modified)
+	{
+		if (lc_lod_report->int_value == 1)
+		{
+			LC_Lod_PrintReport();
+			Cvar_setValueDirectInt(lc_lod_report, 0);
+		}
+		lc_lod_report->modified = false;
+	}
+
+	if (lc_lod_enabled->int_value == 0)
+	{
+		if (dA_size(lc_lod.columns) > 0)
+		{
+			LC_Lod_ReleaseAll();
+		}
+		//builds that are still in flight are dropped when they finish, since their columns are gone
+		LC_Lod_ProcessFinishedBuilds(SIZE_MAX);
+		return;
+	}
+
+	LC_Lod_UpdateRings();
+	LC_Lod_ProcessFinishedBuilds(p_budgetBytes);
+	LC_Lod_SubmitBuilds();
+}
+
+void LC_Lod_RunTask(int p_index)
+{
+	LC_Lod_BuildColumn(&lc_lod.task_list[p_index]);
+
+	MPSC_Queue_Push(&lc_lod.completed_queue, &p_index);
+}
+
+void LC_Lod_GetDrawnBox(const ivec3 p_playerKey, ivec4 dest)
+{
+	LC_Lod_GetFullDetailBox(p_playerKey, dest);
+
+	if (lc_lod_enabled->int_value != 0)
+	{
+		ivec4 lod_box;
+		LC_Lod_GetCoverage(LC_LOD_LEVELS - 1, p_playerKey, lod_box);
+
+		LC_Lod_SetBox(dest, min(dest[0], lod_box[0]), min(dest[1], lod_box[1]), max(dest[2], lod_box[2]), max(dest[3], lod_box[3]));
+	}
+}
+
+void LC_Lod_Init(int p_xChunks, int p_zChunks)
+{
+	memset(&lc_lod, 0, sizeof(lc_lod));
+
+	for (int i = 0; i < LC_MAX_LOD_TASKS; i++)
+	{
+		lc_lod.free_tasks[i] = i;
+	}
+	lc_lod.free_count = LC_MAX_LOD_TASKS;
+	lc_lod.columns = dA_INIT(LC_LodColumn*, 0);
+	LC_Lod_SetBox(lc_lod.static_box, 0, 0, p_xChunks - 1, p_zChunks - 1);
+
+	MPSC_Queue_Init(&lc_lod.completed_queue, sizeof(int), LC_MAX_LOD_TASKS);
+
+	lc_lod_enabled = Cvar_Register("lc_lod", "1", "Draw downsampled terrain past the render distance", CVAR__SAVE_TO_FILE, 0, 1);
+	lc_lod_report = Cvar_Register("lc_lod_report", "0", "Set to 1 to print the chunks and vertices of the distant terrain and the full detail chunks", 0, 0, 1);
+}
+
+void LC_Lod_Exit()
+{
+	//builds that finished after the last frame
+	int index = 0;
+	while (MPSC_Queue_Pop(&lc_lod.completed_queue, &index))
+	{
+		for (int i = 0; i < lc_lod.task_list[index].chunk_count; i++)
+		{
+			LC_World_FreeVerticesResult(lc_lod.task_list[index].vertices_results[i]);
+		}
+	}
+	MPSC_Queue_Destruct(&lc_lod.completed_queue);
+
+	//the render data goes with the world buffers
+	for (int i = 0; i < dA_size(lc_lod.columns); i++)
+	{
+		LC_LodColumn** column = dA_at(lc_lod.columns, i);
+
+		if ((*column)->chunks)
+		{
+			free((*column)->chunks);
+		}
+		free(*column);
+	}
+	dA_Destruct(lc_lod.columns);
+}
@@ -0,0 +1,23 @@
+#ifndef LC_LOD_H
+#define LC_LOD_H
+#pragma once
+
+#include <cglm/cglm.h>
+
+/*
+	Distant terrain. Rings of columns around the player, built from downsampled chunks on the lc workers.
+	Level k is made of cells of 1 << k blocks and covers twice the distance of level k - 1
+*/
+
+#define LC_LOD_LEVELS 3
+#define LC_MAX_LOD_TASKS 8
+
+void LC_Lod_Init(int p_xChunks, int p_zChunks);
+void LC_Lod_Exit(); //after the workers are gone
+void LC_Lod_Update(size_t p_budgetBytes); //once per frame, uploads at most p_budgetBytes
+void LC_Lod_RunTask(int p_index); //on a worker, see LC_World_RequestLodTask
+
+//chunk keys drawn by the full detail chunks and the distant terrain, min x, min z, max x, max z
+void LC_Lod_GetDrawnBox(const ivec3 p_playerKey, ivec4 dest);
+
+#endif // !LC_LOD_H
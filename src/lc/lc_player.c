@@ -531,19 +531,13 @@ static void PL_fallCheck()
 			}
 			if (fall_sound)
 			{
-				float sound_x = player.k_body->box.position[0];
-				float sound_y = player.k_body->box.position[1];
-				float sound_z = player.k_body->box.position[2];
-
-				ma_sound_set_position(fall_sound, sound_x, sound_y, sound_z);
-				ma_sound_start(fall_sound);
+				Sound_playAt(fall_sound, player.k_body->box.position, SOUND_PRIORITY__NORMAL);
 
 				ma_sound* step_sound = PL_getStepSound();
 
 				if (step_sound)
 				{
-					ma_sound_set_position(step_sound, sound_x, sound_y, sound_z);
-					ma_sound_start(step_sound);
+					Sound_playAt(step_sound, player.k_body->box.position, SOUND_PRIORITY__LOW);
 				}
 			}
 		}
@@ -666,12 +660,12 @@ static void PL_placeBlock()
 
 	if (place_sound)
 	{
-		float sound_x = selected_block.position[0];
-		float sound_y = selected_block.position[1];
-		float sound_z = selected_block.position[2];
+		vec3 sound_pos;
+		sound_pos[0] = selected_block.position[0];
+		sound_pos[1] = selected_block.position[1];
+		sound_pos[2] = selected_block.position[2];
 
-		ma_sound_set_position(place_sound, sound_x, sound_y, sound_z);
-		ma_sound_start(place_sound);
+		Sound_playAt(place_sound, sound_pos, SOUND_PRIORITY__NORMAL);
 	}
 
 	//Reset the timer
@@ -712,12 +706,12 @@ static void PL_mineBlock()
 
 	if (dig_sound)
 	{
-		float sound_x = selected_block.position[0];
-		float sound_y = selected_block.position[1];
-		float sound_z = selected_block.position[2];
+		vec3 sound_pos;
+		sound_pos[0] = selected_block.position[0];
+		sound_pos[1] = selected_block.position[1];
+		sound_pos[2] = selected_block.position[2];
 
-		ma_sound_set_position(dig_sound, sound_x, sound_y, sound_z);
-		ma_sound_start(dig_sound);
+		Sound_playAt(dig_sound, sound_pos, SOUND_PRIORITY__NORMAL);
 	}
 
 	//Emit particles
@@ -817,12 +811,7 @@ static void PL_move(int p_dirX, int p_dirY, int p_dirZ)
 			
 			if (step_sound)
 			{
-				float sound_x = player.k_body->box.position[0];
-				float sound_y = player.k_body->box.position[1];
-				float sound_z = player.k_body->box.position[2];
-
-				ma_sound_set_position(step_sound, sound_x, sound_y, sound_z);
-				ma_sound_start(step_sound);
+				Sound_playAt(step_sound, player.k_body->box.position, SOUND_PRIORITY__LOW);
 			}
 			
 		}
@@ -1150,7 +1139,7 @@ void PL_IssueDrawCmds()
 			tex_Region.x = 24;
 			tex_Region.y = (7 - LC_World_getPrevMinedBlockHP());
 
-			Draw_TexturedCubeColored(box, Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE), &tex_Region, 1.0, 1.0, 1.0, 0.5);
+			Draw_TexturedCubeColored(box, Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7), &tex_Region, 1.0, 1.0, 1.0, 0.5);
 		}
 
 	}
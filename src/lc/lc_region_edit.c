@@ -0,0 +1,348 @@
+#include "lc/lc_region_edit.h"
+
+#include <string.h>
+
+#include "lc/lc_world_internal.h"
+#include "lc/lc_fluids.h"
+
+//returns the new type of the block
+typedef uint8_t (*LC_RegionEditFunc)(int p_gX, int p_gY, int p_gZ, uint8_t p_oldType, void* p_ctx);
+
+typedef struct
+{
+	uint8_t from;
+	uint8_t to;
+	bool replace_all;
+} LC_FillEditData;
+
+typedef struct
+{
+	vec3 center;
+	float radius_squared;
+	bool keep_water;
+} LC_SphereEditData;
+
+typedef struct
+{
+	LC_Clipboard* clipboard;
+	const LC_Clipboard* const_clipboard;
+	ivec3 origin;
+	bool skip_air;
+} LC_ClipboardEditData;
+
+static uint8_t LC_Region_FillEdit(int p_gX, int p_gY, int p_gZ, uint8_t p_oldType, void* p_ctx)
+{
+	LC_FillEditData* data = p_ctx;
+
+	if (data->replace_all || p_oldType == data->from)
+	{
+		return data->to;
+	}
+
+	return p_oldType;
+}
+
+static uint8_t LC_Region_SphereEdit(int p_gX, int p_gY, int p_gZ, uint8_t p_oldType, void* p_ctx)
+{
+	LC_SphereEditData* data = p_ctx;
+
+	if (data->keep_water && LC_IsBlockWater(p_oldType))
+	{
+		return p_oldType;
+	}
+
+	vec3 pos;
+	pos[0] = p_gX;
+	pos[1] = p_gY;
+	pos[2] = p_gZ;
+
+	if (glm_vec3_distance2(pos, data->center) > data->radius_squared)
+	{
+		return p_oldType;
+	}
+
+	return LC_BT__NONE;
+}
+
+static int LC_Clipboard_Index(const LC_Clipboard* const p_clipboard, int p_x, int p_y, int p_z)
+{
+	return (p_x * p_clipboard->size[1] + p_y) * p_clipboard->size[2] + p_z;
+}
+
+static uint8_t LC_Region_CopyEdit(int p_gX, int p_gY, int p_gZ, uint8_t p_oldType, void* p_ctx)
+{
+	LC_ClipboardEditData* data = p_ctx;
+
+	int index = LC_Clipboard_Index(data->clipboard, p_gX - data->origin[0], p_gY - data->origin[1], p_gZ - data->origin[2]);
+	data->clipboard->types[index] = p_oldType;
+
+	return p_oldType;
+}
+
+static uint8_t LC_Region_PasteEdit(int p_gX, int p_gY, int p_gZ, uint8_t p_oldType, void* p_ctx)
+{
+	LC_ClipboardEditData* data = p_ctx;
+
+	int index = LC_Clipboard_Index(data->const_clipboard, p_gX - data->origin[0], p_gY - data->origin[1], p_gZ - data->origin[2]);
+	uint8_t type = data->const_clipboard->types[index];
+
+	if (data->skip_air && type == LC_BT__NONE)
+	{
+		return p_oldType;
+	}
+
+	return type;
+}
+
+static int LC_Region_EditChunkBlocks(LC_Chunk* const p_chunk, ivec3 p_min, ivec3 p_max, LC_RegionEditFunc p_func, void* p_ctx, bool p_inWorld)
+{
+	int changed = 0;
+
+	//the part of the region inside this chunk
+	int min_x = max(p_min[0] - p_chunk->global_position[0], 0);
+	int min_y = max(p_min[1] - p_chunk->global_position[1], 0);
+	int min_z = max(p_min[2] - p_chunk->global_position[2], 0);
+	int max_x = min(p_max[0] - p_chunk->global_position[0], LC_CHUNK_WIDTH - 1);
+	int max_y = min(p_max[1] - p_chunk->global_position[1], LC_CHUNK_HEIGHT - 1);
+	int max_z = min(p_max[2] - p_chunk->global_position[2], LC_CHUNK_LENGTH - 1);
+
+	for (int x = min_x; x <= max_x; x++)
+	{
+		for (int y = min_y; y <= max_y; y++)
+		{
+			for (int z = min_z; z <= max_z; z++)
+			{
+				int g_x = x + p_chunk->global_position[0];
+				int g_y = y + p_chunk->global_position[1];
+				int g_z = z + p_chunk->global_position[2];
+
+				LC_Block* block = &p_chunk->blocks[x][y][z];
+				uint8_t new_type = p_func(g_x, g_y, g_z, block->type, p_ctx);
+
+				if (new_type == block->type)
+				{
+					continue;
+				}
+
+				//chunks that aren't inserted yet get their lights and fluids when they are
+				if (p_inWorld)
+				{
+					if (LC_isblockEmittingLight(block->type))
+					{
+						LC_World_DestroyLightBlock(g_x, g_y, g_z);
+					}
+					if (LC_isblockEmittingLight(new_type))
+					{
+						LC_World_CreateLightBlock(g_x, g_y, g_z, LC_getBlockLightingData(new_type));
+					}
+				}
+
+				block->type = new_type;
+				changed++;
+
+				if (p_inWorld && (new_type == LC_BT__NONE || LC_IsBlockWater(new_type)))
+				{
+					LC_Fluids_WakeAround(p_chunk, g_x, g_y, g_z);
+				}
+			}
+		}
+	}
+
+	return changed;
+}
+
+static int LC_Region_Edit(ivec3 p_min, ivec3 p_max, LC_RegionEditFunc p_func, void* p_ctx)
+{
+	ivec3 min_key, max_key;
+	LC_getNormalizedChunkPosition(p_min[0], p_min[1], p_min[2], min_key);
+	LC_getNormalizedChunkPosition(p_max[0], p_max[1], p_max[2], max_key);
+
+	int total_changed = 0;
+
+	for (int cx = min_key[0]; cx <= max_key[0]; cx++)
+	{
+		for (int cy = min_key[1]; cy <= max_key[1]; cy++)
+		{
+			for (int cz = min_key[2]; cz <= max_key[2]; cz++)
+			{
+				ivec3 key;
+				key[0] = cx;
+				key[1] = cy;
+				key[2] = cz;
+
+				LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, key);
+
+				//not loaded, only inserted if something was placed in it
+				if (!chunk)
+				{
+					if (lc_world.num_alive_chunks >= LC_WORLD_MAX_FULL_CHUNKS - 2)
+					{
+						continue;
+					}
+
+					LC_Chunk stack_chunk = LC_Chunk_Create(cx * LC_CHUNK_WIDTH, cy * LC_CHUNK_HEIGHT, cz * LC_CHUNK_LENGTH);
+
+					int changed = LC_Region_EditChunkBlocks(&stack_chunk, p_min, p_max, p_func, p_ctx, false);
+
+					if (changed <= 0)
+					{
+						continue;
+					}
+
+					//creates the light blocks too
+					LC_Chunk_RecountBlocks(&stack_chunk);
+					chunk = LC_World_InsertChunk(&stack_chunk);
+
+					if (chunk)
+					{
+						LC_World_QueueChunkEdit(chunk);
+						total_changed += changed;
+					}
+					continue;
+				}
+
+				int old_alive_blocks = chunk->alive_blocks;
+				int changed = LC_Region_EditChunkBlocks(chunk, p_min, p_max, p_func, p_ctx, true);
+
+				if (changed <= 0)
+				{
+					continue;
+				}
+
+				LC_Chunk_RecountBlocks(chunk);
+
+				if (old_alive_blocks == 0 && chunk->alive_blocks > 0)
+				{
+					lc_world.num_alive_chunks++;
+				}
+				else if (old_alive_blocks > 0 && chunk->alive_blocks == 0)
+				{
+					lc_world.num_alive_chunks--;
+				}
+
+				LC_World_QueueChunkEdit(chunk);
+				total_changed += changed;
+			}
+		}
+	}
+
+	return total_changed;
+}
+
+static void LC_Region_Sort(ivec3 p_min, ivec3 p_max, ivec3 r_min, ivec3 r_max)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		r_min[i] = min(p_min[i], p_max[i]);
+		r_max[i] = max(p_min[i], p_max[i]);
+	}
+}
+
+int LC_Region_Fill(ivec3 p_min, ivec3 p_max, LC_BlockType p_blockType)
+{
+	ivec3 region_min, region_max;
+	LC_Region_Sort(p_min, p_max, region_min, region_max);
+
+	LC_FillEditData data;
+	data.from = LC_BT__NONE;
+	data.to = p_blockType;
+	data.replace_all = true;
+
+	return LC_Region_Edit(region_min, region_max, LC_Region_FillEdit, &data);
+}
+
+int LC_Region_Replace(ivec3 p_min, ivec3 p_max, LC_BlockType p_from, LC_BlockType p_to)
+{
+	ivec3 region_min, region_max;
+	LC_Region_Sort(p_min, p_max, region_min, region_max);
+
+	LC_FillEditData data;
+	data.from = p_from;
+	data.to = p_to;
+	data.replace_all = false;
+
+	return LC_Region_Edit(region_min, region_max, LC_Region_FillEdit, &data);
+}
+
+int LC_Region_CarveSphere(vec3 p_center, float p_radius, bool p_keepWater)
+{
+	if (p_radius <= 0)
+	{
+		return 0;
+	}
+
+	ivec3 region_min, region_max;
+	for (int i = 0; i < 3; i++)
+	{
+		region_min[i] = floorf(p_center[i] - p_radius);
+		region_max[i] = ceilf(p_center[i] + p_radius);
+	}
+
+	LC_SphereEditData data;
+	glm_vec3_copy(p_center, data.center);
+	data.radius_squared = p_radius * p_radius;
+	data.keep_water = p_keepWater;
+
+	return LC_Region_Edit(region_min, region_max, LC_Region_SphereEdit, &data);
+}
+
+bool LC_Region_Copy(ivec3 p_min, ivec3 p_max, LC_Clipboard* r_clipboard)
+{
+	ivec3 region_min, region_max;
+	LC_Region_Sort(p_min, p_max, region_min, region_max);
+
+	memset(r_clipboard, 0, sizeof(LC_Clipboard));
+
+	for (int i = 0; i < 3; i++)
+	{
+		r_clipboard->size[i] = region_max[i] - region_min[i] + 1;
+	}
+
+	//blocks of chunks that aren't loaded stay as air
+	r_clipboard->types = calloc((size_t)r_clipboard->size[0] * r_clipboard->size[1] * r_clipboard->size[2], sizeof(uint8_t));
+
+	if (!r_clipboard->types)
+	{
+		return false;
+	}
+
+	LC_ClipboardEditData data;
+	memset(&data, 0, sizeof(data));
+	data.clipboard = r_clipboard;
+	glm_ivec3_copy(region_min, data.origin);
+
+	LC_Region_Edit(region_min, region_max, LC_Region_CopyEdit, &data);
+
+	return true;
+}
+
+int LC_Region_Paste(const LC_Clipboard* p_clipboard, ivec3 p_dest, bool p_skipAir)
+{
+	if (!p_clipboard->types)
+	{
+		return 0;
+	}
+
+	ivec3 region_max;
+	for (int i = 0; i < 3; i++)
+	{
+		region_max[i] = p_dest[i] + p_clipboard->size[i] - 1;
+	}
+
+	LC_ClipboardEditData data;
+	memset(&data, 0, sizeof(data));
+	data.const_clipboard = p_clipboard;
+	data.skip_air = p_skipAir;
+	glm_ivec3_copy(p_dest, data.origin);
+
+	return LC_Region_Edit(p_dest, region_max, LC_Region_PasteEdit, &data);
+}
+
+void LC_Clipboard_Destruct(LC_Clipboard* const p_clipboard)
+{
+	if (p_clipboard->types)
+	{
+		free(p_clipboard->types);
+	}
+	memset(p_clipboard, 0, sizeof(LC_Clipboard));
+}
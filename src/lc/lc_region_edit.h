@@ -0,0 +1,25 @@
+#ifndef LC_REGION_EDIT_H
+#define LC_REGION_EDIT_H
+#pragma once
+
+#include "lc/lc_common.h"
+
+typedef struct
+{
+	ivec3 size;
+	uint8_t* types; //block types, index is (x * size[1] + y) * size[2] + z
+} LC_Clipboard;
+
+/*
+	Region edits. Boxes are inclusive block coordinates. The blocks are written straight into the chunks,
+	every touched chunk is recounted and remeshed once, no matter how many of its blocks changed.
+	They return the amount of changed blocks
+*/
+int LC_Region_Fill(ivec3 p_min, ivec3 p_max, LC_BlockType p_blockType);
+int LC_Region_Replace(ivec3 p_min, ivec3 p_max, LC_BlockType p_from, LC_BlockType p_to);
+int LC_Region_CarveSphere(vec3 p_center, float p_radius, bool p_keepWater);
+bool LC_Region_Copy(ivec3 p_min, ivec3 p_max, LC_Clipboard* r_clipboard);
+int LC_Region_Paste(const LC_Clipboard* p_clipboard, ivec3 p_dest, bool p_skipAir);
+void LC_Clipboard_Destruct(LC_Clipboard* const p_clipboard);
+
+#endif // !LC_REGION_EDIT_H
@@ -9,8 +9,41 @@
 #include "core/core_common.h"
 #include "core/resource_manager.h"
 #include "core/cvar.h"
+#include "utility/u_queue.h"
+#include "lc/lc_world_internal.h"
+#include "lc/lc_chunk_cache.h"
+#include "lc/lc_fluids.h"
+#include "lc/lc_lod.h"
+#include "lc/lc_horizon.h"
+#include "lc/lc_region_edit.h"
+#include "lc/lc_decorations.h"
 
-#define LC_MAX_ACTIVE_TASKS 32
+#define LC_MAX_ACTIVE_TASKS 64
+#define LC_MAX_WORKER_THREADS 8
+#define LC_MAX_EDIT_TASKS 64
+#define LC_TASK_EXIT_REQUEST -1
+#define LC_TASK_EDIT_WAKE -2
+
+#define LC_EDIT_LATENCY_SAMPLES 512
+
+//the first frame waits for the chunks this close to the spawn point, the rest of the initial world streams in
+#define LC_SPAWN_RADIUS_CHUNKS 2
+
+//chunks are only unloaded this far past the render distance, so walking back and forth over the edge doesn't reload them
+#define LC_UNLOAD_HYSTERESIS_CHUNKS 2
+
+#define LC_CHUNK_RING_WIDTH ((LC_RENDER_DISTANCE_CHUNKS + LC_UNLOAD_HYSTERESIS_CHUNKS) * 2 + 1)
+#define LC_CHUNK_RING_HEIGHT ((LC_RENDER_DISTANCE_VERTICAL_CHUNKS + LC_UNLOAD_HYSTERESIS_CHUNKS) * 2 + 1)
+#define LC_CHUNK_RING_LENGTH ((LC_RENDER_DISTANCE_CHUNKS + LC_UNLOAD_HYSTERESIS_CHUNKS) * 2 + 1)
+
+//dirty draw cmds this close to each other are uploaded with one call
+#define LC_DRAW_CMD_UPLOAD_MERGE_GAP 8
+
+//every gpu upload of the world goes through this, it has to fit a few frames worth of uploads
+#define LC_UPLOAD_RING_SIZE (16 * 1024 * 1024)
+
+
+#define LC_TASK_LOD_FIRST 0x10000 //task request tokens from here on are lod tasks
 
 extern void LC_Player_getPosition(vec3 dest);
 
@@ -19,33 +52,89 @@ typedef struct
 	Cvar* lc_static_world;
 	Cvar* lc_dynamic_weather;
 	Cvar* lc_creative;
+	Cvar* lc_upload_budget_kb;
+	Cvar* lc_edit_latency_report;
+	Cvar* lc_edit_benchmark;
+	Cvar* lc_block_benchmark;
 } LC_WorldCvars;
 
-typedef enum
-{
-	LC_TASK_STATUS__INACTIVE,
-	LC_TASK_STATUS__READY,
-	LC_TASK_STATUS__WORKING,
-	LC_TASK_STATUS__COMPLETED,
-} LC_TaskStatus;
 typedef struct
 {
 	LC_Chunk chunk;
 	GeneratedChunkVerticesResult* vertices_result;
-	LC_TaskStatus status;
+	bool startup; //part of the initial world
+	bool cached; //the blocks came from the chunk cache, only the mesh is missing
+	LC_DecorationBlock* decorations; //what the neighbours grew into it, merged by the worker
+	int decorations_seen; //decoration blocks the chunk has, the ones added later are merged when it's finished
+	LC_DecorationSpill* spills; //what the worker grew into the neighbours
+	int spill_count;
+	uint8_t* fluid_levels; //from the chunk cache, NULL if all of its water was still
 } LC_Task;
 
 typedef struct
 {
 	LC_Task task_list[LC_MAX_ACTIVE_TASKS];
-	int lookup_index;
+
+	//indexes of tasks that are not in flight, only touched by the main thread
+	int free_tasks[LC_MAX_ACTIVE_TASKS];
+	int free_count;
+
+	MPMC_Queue request_queue; //main thread -> lc workers, task indexes
+	MPSC_Queue completed_queue; //lc workers -> main thread, task indexes
 } LC_TaskQueue;
 
+typedef enum
+{
+	LC_REMESH__NONE,
+	LC_REMESH__REQUESTED, //waiting for a free edit task
+	LC_REMESH__IN_FLIGHT
+} LC_RemeshState;
+
+typedef struct
+{
+	LC_Chunk chunk; //snapshot of the edited chunk, meshed by a worker
+	ivec3 chunk_key;
+	unsigned edit_serial;
+	GeneratedChunkVerticesResult* vertices_result;
+} LC_EditTask;
+
+typedef struct
+{
+	LC_EditTask task_list[LC_MAX_EDIT_TASKS];
+
+	//only touched by the main thread
+	int free_tasks[LC_MAX_EDIT_TASKS];
+	int free_count;
+	unsigned serial_counter;
+	dynamic_array* requested_keys; //keys of LC_REMESH__REQUESTED chunks, oldest first
+
+	MPMC_Queue request_queue; //high priority lane, the workers empty it before every streaming task
+	MPSC_Queue completed_queue;
+	volatile LONG pending_wakes; //LC_TASK_EDIT_WAKE requests in the task request queue
+
+	//edit to visible latency
+	dynamic_array* visible_edit_times; //edit times of the meshes that are uploaded this frame
+	float latency_samples[LC_EDIT_LATENCY_SAMPLES]; //ms
+	int latency_sample_count;
+	int next_latency_sample;
+} LC_EditQueue;
+
+typedef struct
+{
+	dynamic_array* keys; //chunk keys of the initial world that are not requested yet, the nearest to the spawn point is last
+	ivec3 spawn_key;
+	int total;
+	int finished;
+	int spawn_chunks_left;
+
+	LARGE_INTEGER create_time;
+} LC_StartupState;
+
 typedef struct
 {
 	bool force_exit;
-	HANDLE win_handle;
-	HANDLE mutex_handle;
+	HANDLE win_handles[LC_MAX_WORKER_THREADS];
+	int worker_count;
 } LC_Thread;
 
 typedef struct
@@ -55,26 +144,309 @@ typedef struct
 	float cooldown_timer;
 } LC_PrevMinedBlock;
 
+typedef enum
+{
+	LC_DRB__OPAQUE,
+	LC_DRB__TRANSPARENT,
+	LC_DRB__WATER,
+	LC_DRB__MAX
+} LC_DrbType;
+
+typedef struct
+{
+	unsigned index;
+	unsigned order; //a freed index can be requested again in the same frame, the newest entry wins
+	LC_ChunkData data;
+} LC_PendingChunkData;
+
+typedef struct
+{
+	ivec3 key;
+	bool occupied;
+} LC_ChunkRingSlot;
+
+/*
+	Toroidal grid with the size of the unload distance. Every chunk inside the unload distance has its own slot,
+	so when the player moves, only the slots of the rows that left the unload distance need to be checked
+*/
+typedef struct
+{
+	LC_ChunkRingSlot slots[LC_CHUNK_RING_WIDTH * LC_CHUNK_RING_HEIGHT * LC_CHUNK_RING_LENGTH];
+	ivec3 bounds[2]; //render distance bounds of the last update
+	bool bounds_valid;
+	int hidden_chunks;
+} LC_ChunkRing;
+
 static LC_WorldCvars lc_cvars;
-static LC_World lc_world;
+LC_World lc_world;
 static LC_TaskQueue lc_task_queue;
 static LC_Thread lc_thread;
 static LC_PrevMinedBlock lc_prev_mined_block;
+static LC_ChunkRing lc_chunk_ring;
+static LC_StartupState lc_startup;
+static LC_EditQueue lc_edit_queue;
+
+static void LC_World_GetRenderDistanceBounds(ivec3 min_max[2]);
+static void LC_World_ProcessEditTasks();
+static void LC_World_GetUnloadBounds(ivec3 min_max[2]);
+static void LC_World_EvictChunk(LC_Chunk* const p_chunk);
+
+static void LC_World_MarkDrawCmdDirty(int p_drawCmdIndex)
+{
+	if (p_drawCmdIndex < 0)
+	{
+		return;
+	}
+
+	assert(p_drawCmdIndex < dA_size(lc_world.draw_cmd_dirty_flags));
+
+	uint8_t* dirty_flag = dA_at(lc_world.draw_cmd_dirty_flags, p_drawCmdIndex);
+
+	if (*dirty_flag)
+	{
+		return;
+	}
+	*dirty_flag = 1;
+
+	dA_emplaceBackData(lc_world.dirty_draw_cmds, &p_drawCmdIndex);
+}
+
+static void LC_World_SetDrbOwner(LC_DrbType p_type, int p_drbIndex, int p_drawCmdIndex)
+{
+	if (p_drbIndex < 0)
+	{
+		return;
+	}
+
+	dynamic_array* owners = lc_world.drb_owners[p_type];
+	size_t old_size = dA_size(owners);
+
+	if ((size_t)p_drbIndex >= old_size)
+	{
+		dA_resize(owners, p_drbIndex + 1);
+
+		int* owner_array = owners->data;
+		for (size_t i = old_size; i <= (size_t)p_drbIndex; i++)
+		{
+			owner_array[i] = -1;
+		}
+	}
+
+	int* owner = dA_at(owners, p_drbIndex);
+	*owner = p_drawCmdIndex;
+}
+
+static void LC_World_SetDrawCmdSource(LC_Chunk* const p_chunk)
+{
+	if (p_chunk->draw_cmd_index < 0)
+	{
+		return;
+	}
+
+	LC_DrawCmdSource* source = dA_at(lc_world.draw_cmd_sources, p_chunk->draw_cmd_index);
+	source->opaque_index = p_chunk->opaque_index;
+	source->transparent_index = p_chunk->transparent_index;
+	source->water_index = p_chunk->water_index;
+	source->hidden = p_chunk->is_hidden;
+
+	LC_World_SetDrbOwner(LC_DRB__OPAQUE, p_chunk->opaque_index, p_chunk->draw_cmd_index);
+	LC_World_SetDrbOwner(LC_DRB__TRANSPARENT, p_chunk->transparent_index, p_chunk->draw_cmd_index);
+	LC_World_SetDrbOwner(LC_DRB__WATER, p_chunk->water_index, p_chunk->draw_cmd_index);
+
+	LC_World_MarkDrawCmdDirty(p_chunk->draw_cmd_index);
+}
+
+static void LC_World_CollectMovedItems(DynamicRenderBuffer* const p_drb, LC_DrbType p_type)
+{
+	//growing or shrinking a chunk's vertices shifts every item after it, those chunks need new offsets
+	dynamic_array* owners = lc_world.drb_owners[p_type];
+	unsigned* moved_items = p_drb->moved_items->data;
+
+	for (size_t i = 0; i < dA_size(p_drb->moved_items); i++)
+	{
+		if (moved_items[i] < dA_size(owners))
+		{
+			int* owner = dA_at(owners, moved_items[i]);
+			LC_World_MarkDrawCmdDirty(*owner);
+		}
+	}
+
+	DRB_ClearMovedItems(p_drb);
+}
+
+static void LC_World_BuildDrawCmd(int p_drawCmdIndex)
+{
+	LC_DrawCmdSource* source = dA_at(lc_world.draw_cmd_sources, p_drawCmdIndex);
+	LC_CombinedChunkDrawCmdData* cmd = dA_at(lc_world.draw_cmd_backbuffer, p_drawCmdIndex);
+
+	memset(cmd, 0, sizeof(LC_CombinedChunkDrawCmdData));
+
+	//still on the gpu, just not drawn
+	if (source->hidden)
+	{
+		return;
+	}
+
+	if (source->opaque_index >= 0)
+	{
+		DRB_Item item = DRB_GetItem(&lc_world.render_data.opaque_buffer, source->opaque_index);
+
+		cmd->o_count = item.count / sizeof(ChunkVertex);
+		cmd->o_first = item.offset / sizeof(ChunkVertex);
+	}
+	if (source->transparent_index >= 0)
+	{
+		DRB_Item item = DRB_GetItem(&lc_world.render_data.semi_transparent_buffer, source->transparent_index);
+
+		cmd->t_count = item.count / sizeof(ChunkVertex);
+		cmd->t_first = item.offset / sizeof(ChunkVertex);
+	}
+	if (source->water_index >= 0)
+	{
+		DRB_Item item = DRB_GetItem(&lc_world.render_data.water_buffer, source->water_index);
+
+		cmd->w_count = item.count / sizeof(ChunkWaterVertex);
+		cmd->w_first = item.offset / sizeof(ChunkWaterVertex);
+	}
+}
+
+static int LC_World_CompareDrawCmdIndexes(const void* p_a, const void* p_b)
+{
+	int a = *(const int*)p_a;
+	int b = *(const int*)p_b;
+
+	return (a > b) - (a < b);
+}
 
 static void LC_World_UpdateDrawCmds()
 {
-	static int counter = 0;
-	if (lc_world.require_draw_cmd_update)
+	LC_World_CollectMovedItems(&lc_world.render_data.opaque_buffer, LC_DRB__OPAQUE);
+	LC_World_CollectMovedItems(&lc_world.render_data.semi_transparent_buffer, LC_DRB__TRANSPARENT);
+	LC_World_CollectMovedItems(&lc_world.render_data.water_buffer, LC_DRB__WATER);
+
+	int dirty_count = dA_size(lc_world.dirty_draw_cmds);
+
+	if (dirty_count <= 0)
+	{
+		return;
+	}
+
+	int* dirty = lc_world.dirty_draw_cmds->data;
+	uint8_t* dirty_flags = lc_world.draw_cmd_dirty_flags->data;
+
+	qsort(dirty, dirty_count, sizeof(int), LC_World_CompareDrawCmdIndexes);
+
+	for (int i = 0; i < dirty_count; i++)
+	{
+		LC_World_BuildDrawCmd(dirty[i]);
+		dirty_flags[dirty[i]] = 0;
+	}
+
+	//the backbuffer is always up to date, so small gaps between dirty cmds can be uploaded with them
+	int run_start = dirty[0];
+	int run_end = dirty[0];
+
+	for (int i = 1; i <= dirty_count; i++)
+	{
+		if (i < dirty_count && dirty[i] - run_end <= LC_DRAW_CMD_UPLOAD_MERGE_GAP)
+		{
+			run_end = dirty[i];
+			continue;
+		}
+
+		StagingRing_Upload(&lc_world.upload_ring, lc_world.render_data.draw_cmds_buffer.buffer, sizeof(LC_CombinedChunkDrawCmdData) * run_start,
+			sizeof(LC_CombinedChunkDrawCmdData) * (run_end - run_start + 1), dA_at(lc_world.draw_cmd_backbuffer, run_start));
+
+		if (i < dirty_count)
+		{
+			run_start = dirty[i];
+			run_end = dirty[i];
+		}
+	}
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	dA_clear(lc_world.dirty_draw_cmds);
+}
+
+static int LC_World_ComparePendingChunkData(const void* p_a, const void* p_b)
+{
+	const LC_PendingChunkData* a = p_a;
+	const LC_PendingChunkData* b = p_b;
+
+	if (a->index != b->index)
+	{
+		return (a->index > b->index) - (a->index < b->index);
+	}
+
+	return (a->order > b->order) - (a->order < b->order);
+}
+
+static void LC_World_UploadChunkData()
+{
+	int count = dA_size(lc_world.pending_chunk_data);
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	LC_PendingChunkData* pending = lc_world.pending_chunk_data->data;
+
+	qsort(pending, count, sizeof(LC_PendingChunkData), LC_World_ComparePendingChunkData);
+
+	//only keep the newest entry of every index
+	int unique_count = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (i + 1 < count && pending[i + 1].index == pending[i].index)
+		{
+			continue;
+		}
+		pending[unique_count++] = pending[i];
+	}
+
+	//vis flags are written by the gpu, so only runs of new entries are uploaded, never the gaps between them
+	int run_start = 0;
+
+	while (run_start < unique_count)
 	{
-		glNamedBufferSubData(lc_world.render_data.draw_cmds_buffer.buffer, 0,
-			dA_size(lc_world.draw_cmd_backbuffer) * sizeof(LC_CombinedChunkDrawCmdData), dA_getFront(lc_world.draw_cmd_backbuffer));
+		int run_end = run_start;
+
+		while (run_end + 1 < unique_count && pending[run_end + 1].index == pending[run_end].index + 1)
+		{
+			run_end++;
+		}
+
+		int run_count = run_end - run_start + 1;
+		size_t ring_offset = 0;
+		LC_ChunkData* dst = StagingRing_Alloc(&lc_world.upload_ring, sizeof(LC_ChunkData) * run_count, &ring_offset);
 
-		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		if (dst)
+		{
+			for (int i = 0; i < run_count; i++)
+			{
+				dst[i] = pending[run_start + i].data;
+			}
+			glCopyNamedBufferSubData(lc_world.upload_ring.buffer, lc_world.render_data.chunk_data_buffer.buffer, ring_offset,
+				sizeof(LC_ChunkData) * pending[run_start].index, sizeof(LC_ChunkData) * run_count);
+
+			lc_world.upload_ring.frame_copies++;
+			lc_world.upload_ring.frame_upload_bytes += sizeof(LC_ChunkData) * run_count;
+		}
+		else
+		{
+			for (int i = run_start; i <= run_end; i++)
+			{
+				glNamedBufferSubData(lc_world.render_data.chunk_data_buffer.buffer, sizeof(LC_ChunkData) * pending[i].index, sizeof(LC_ChunkData), &pending[i].data);
+			}
+			lc_world.upload_ring.fallback_count++;
+		}
 
-		lc_world.require_draw_cmd_update = false;
-		counter++;
-		printf("draw cmd update %i \n", counter);
+		run_start = run_end + 1;
 	}
+
+	dA_clear(lc_world.pending_chunk_data);
 }
 
 static LC_Chunk* LC_World_getNeighbourChunk(LC_Chunk* const p_chunk, int p_side)
@@ -123,7 +495,7 @@ static LC_Chunk* LC_World_getNeighbourChunk(LC_Chunk* const p_chunk, int p_side)
 	return CHMap_Find(&lc_world.chunk_map, chunk_pos);
 }
 
-static void LC_World_CreateLightBlock(int p_x, int p_y, int p_z, LC_Block_LightData light_data)
+void LC_World_CreateLightBlock(int p_x, int p_y, int p_z, LC_Block_LightData light_data)
 {
 	PointLight point_light;
 	memset(&point_light, 0, sizeof(PointLight));
@@ -150,7 +522,7 @@ static void LC_World_CreateLightBlock(int p_x, int p_y, int p_z, LC_Block_LightD
 	CHMap_Insert(&lc_world.light_block_map, block_pos, &index);
 }
 
-static void LC_World_DestroyLightBlock(int p_x, int p_y, int p_z)
+void LC_World_DestroyLightBlock(int p_x, int p_y, int p_z)
 {
 	ivec3 block_pos;
 	block_pos[0] = p_x;
@@ -166,11 +538,73 @@ static void LC_World_DestroyLightBlock(int p_x, int p_y, int p_z)
 	}
 }
 
-static LC_Chunk* LC_World_InsertChunk(LC_Chunk* p_chunk)
+bool LC_World_isChunkKeyInBounds(const ivec3 p_key, ivec3 p_bounds[2])
+{
+	return p_key[0] >= p_bounds[0][0] && p_key[0] <= p_bounds[1][0] && p_key[1] >= p_bounds[0][1] && p_key[1] <= p_bounds[1][1]
+		&& p_key[2] >= p_bounds[0][2] && p_key[2] <= p_bounds[1][2];
+}
+
+static int LC_ChunkRing_Wrap(int p_value, int p_size)
+{
+	int result = p_value % p_size;
+
+	return (result < 0) ? result + p_size : result;
+}
+
+static LC_ChunkRingSlot* LC_ChunkRing_getSlot(const ivec3 p_key)
+{
+	int x = LC_ChunkRing_Wrap(p_key[0], LC_CHUNK_RING_WIDTH);
+	int y = LC_ChunkRing_Wrap(p_key[1], LC_CHUNK_RING_HEIGHT);
+	int z = LC_ChunkRing_Wrap(p_key[2], LC_CHUNK_RING_LENGTH);
+
+	return &lc_chunk_ring.slots[x + (y * LC_CHUNK_RING_WIDTH) + (z * LC_CHUNK_RING_WIDTH * LC_CHUNK_RING_HEIGHT)];
+}
+
+static void LC_ChunkRing_Insert(const ivec3 p_key)
+{
+	LC_ChunkRingSlot* slot = LC_ChunkRing_getSlot(p_key);
+
+	if (slot->occupied && memcmp(slot->key, p_key, sizeof(ivec3)) != 0 && lc_cvars.lc_static_world->int_value == 0)
+	{
+		ivec3 bounds[2];
+		LC_World_GetUnloadBounds(bounds);
+
+		//two chunks inside the unload distance never share a slot, so the old one is a leftover
+		if (!LC_World_isChunkKeyInBounds(slot->key, bounds))
+		{
+			LC_Chunk* old_chunk = CHMap_Find(&lc_world.chunk_map, slot->key);
+
+			if (old_chunk)
+			{
+				LC_World_EvictChunk(old_chunk);
+			}
+		}
+		//the new one is outside the unload distance, keep tracking the loaded one
+		else
+		{
+			return;
+		}
+	}
+
+	memcpy(slot->key, p_key, sizeof(ivec3));
+	slot->occupied = true;
+}
+
+static void LC_ChunkRing_Remove(const ivec3 p_key)
+{
+	LC_ChunkRingSlot* slot = LC_ChunkRing_getSlot(p_key);
+
+	if (slot->occupied && memcmp(slot->key, p_key, sizeof(ivec3)) == 0)
+	{
+		slot->occupied = false;
+	}
+}
+
+LC_Chunk* LC_World_InsertChunk(LC_Chunk* p_chunk)
 {	
 	if (p_chunk->alive_blocks > 0)
 	{
-		if (lc_world.num_alive_chunks >= LC_WORLD_MAX_CHUNK_LIMIT - 2)
+		if (lc_world.num_alive_chunks >= LC_WORLD_MAX_FULL_CHUNKS - 2)
 		{
 			return NULL;
 		}
@@ -181,6 +615,8 @@ static LC_Chunk* LC_World_InsertChunk(LC_Chunk* p_chunk)
 	ivec3 chunk_key;
 	LC_getNormalizedChunkPosition(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2], chunk_key);
 
+	LC_ChunkRing_Insert(chunk_key);
+
 	LC_Chunk* chunk = CHMap_Insert(&lc_world.chunk_map, chunk_key, p_chunk);
 
 	chunk->opaque_index = -1;
@@ -191,6 +627,14 @@ static LC_Chunk* LC_World_InsertChunk(LC_Chunk* p_chunk)
 	chunk->aabb_tree_index = -1;
 
 	chunk->is_deleted = false;
+	chunk->is_hidden = false;
+
+	chunk->remesh_state = LC_REMESH__NONE;
+	chunk->edit_serial = 0;
+	chunk->remesh_serial = 0;
+	chunk->pending_edit_time = 0;
+
+	LC_Fluids_SeedChunk(chunk);
 
 	if (chunk->light_blocks > 0)
 	{
@@ -230,15 +674,24 @@ static void LC_World_GetRenderDistanceBounds(ivec3 min_max[2])
 	ivec3 normalized_player_position;
 	LC_getNormalizedChunkPosition(player_position[0], player_position[1], player_position[2], normalized_player_position);
 
-	const int render_distance_chunks = 8;
+	min_max[0][0] = normalized_player_position[0] - LC_RENDER_DISTANCE_CHUNKS;
+	min_max[0][1] = normalized_player_position[1] - LC_RENDER_DISTANCE_VERTICAL_CHUNKS;
+	min_max[0][2] = normalized_player_position[2] - LC_RENDER_DISTANCE_CHUNKS;
+
+	min_max[1][0] = normalized_player_position[0] + LC_RENDER_DISTANCE_CHUNKS;
+	min_max[1][1] = normalized_player_position[1] + LC_RENDER_DISTANCE_VERTICAL_CHUNKS;
+	min_max[1][2] = normalized_player_position[2] + LC_RENDER_DISTANCE_CHUNKS;
+}
 
-	min_max[0][0] = normalized_player_position[0] - render_distance_chunks;
-	min_max[0][1] = normalized_player_position[1] - 4;
-	min_max[0][2] = normalized_player_position[2] - render_distance_chunks;
+static void LC_World_GetUnloadBounds(ivec3 min_max[2])
+{
+	LC_World_GetRenderDistanceBounds(min_max);
 
-	min_max[1][0] = normalized_player_position[0] + render_distance_chunks;
-	min_max[1][1] = normalized_player_position[1] + 4;
-	min_max[1][2] = normalized_player_position[2] + render_distance_chunks;
+	for (int i = 0; i < 3; i++)
+	{
+		min_max[0][i] -= LC_UNLOAD_HYSTERESIS_CHUNKS;
+		min_max[1][i] += LC_UNLOAD_HYSTERESIS_CHUNKS;
+	}
 }
 
 static float LC_World_CalculateSunAngle(long time)
@@ -368,132 +821,746 @@ static void LC_World_UpdateWorldEnviroment()
 }
 
 
-static void LC_World_ThreadProcess()
+void LC_World_FreeVerticesResult(GeneratedChunkVerticesResult* p_vertices_result)
 {
-	int index = 0;
-
-	while (lc_thread.force_exit == false)
+	if (!p_vertices_result)
 	{
-		LC_Task* task = &lc_task_queue.task_list[index];
-
-		if (task->status == LC_TASK_STATUS__READY)
-		{
-			//WaitForSingleObject(lc_thread.mutex_handle, INFINITY);
-
-			//lc_thread.mutex_handle = CreateMutex(NULL, true, "LC_MUTEX");
-
-			//set status
-			task->status = LC_TASK_STATUS__WORKING;
-
-			//generate blocks
-			LC_Chunk_GenerateBlocks(&task->chunk, 2);
-
-			//generate vertices
-			if (task->chunk.alive_blocks > 0)
-			{
-				//task->vertices_result = LC_Chunk_GenerateVertices(&task->chunk);
-			}
-		
-			//set as completed
-			task->status = LC_TASK_STATUS__COMPLETED;
-
-			if (lc_thread.mutex_handle)
-			{
-				//ReleaseMutex(lc_thread.mutex_handle);
-			}
-		}
+		return;
+	}
 
-		index = (index + 1) % LC_MAX_ACTIVE_TASKS;
+	//free the vertices buffers
+	if (p_vertices_result->opaque_vertices)
+	{
+		free(p_vertices_result->opaque_vertices);
+	}
+	if (p_vertices_result->transparent_vertices)
+	{
+		free(p_vertices_result->transparent_vertices);
+	}
+	if (p_vertices_result->water_vertices)
+	{
+		free(p_vertices_result->water_vertices);
 	}
-}
 
-static bool LC_World_CreateChunkAsync(int p_x, int p_y, int p_z)
-{	
-	bool result = false;
+	//free the result
+	free(p_vertices_result);
+}
 
-	LC_Task* task = &lc_task_queue.task_list[lc_task_queue.lookup_index];
+static void LC_World_ProcessEditTasks()
+{
+	int index = 0;
 
-	if (task->status == LC_TASK_STATUS__INACTIVE)
+	while (MPMC_Queue_Pop(&lc_edit_queue.request_queue, &index))
 	{
-		task->vertices_result = NULL;
-		task->chunk = LC_Chunk_Create(p_x * LC_CHUNK_WIDTH, p_y * LC_CHUNK_HEIGHT, p_z * LC_CHUNK_LENGTH);
+		LC_EditTask* task = &lc_edit_queue.task_list[index];
 
-		task->status = LC_TASK_STATUS__READY;
+		if (task->chunk.alive_blocks > 0)
+		{
+			task->vertices_result = LC_Chunk_GenerateVertices(&task->chunk);
+		}
 
-		result = true;
+		MPSC_Queue_Push(&lc_edit_queue.completed_queue, &index);
 	}
-
-	lc_task_queue.lookup_index = (lc_task_queue.lookup_index + 1) % LC_MAX_ACTIVE_TASKS;
-
-	return result;
 }
 
-static void LC_World_ProcessTaskQueue()
+static DWORD WINAPI LC_World_ThreadProcess(LPVOID p_param)
 {
-	if (lc_world.num_alive_chunks >= LC_WORLD_MAX_CHUNK_LIMIT - 2)
-	{
-		return;
-	}
-	//if (WaitForSingleObject(lc_thread.mutex_handle, 0.01) == WAIT_TIMEOUT)
-	//{
-	//	return;
-	//}
-
-	//lc_thread.mutex_handle = CreateMutex(NULL, true, "LC_MUTEX");
-
-	for (int i = 0; i < LC_MAX_ACTIVE_TASKS; i++)
+	while (lc_thread.force_exit == false)
 	{
-		LC_Task* task = &lc_task_queue.task_list[i];
+		int index = 0;
 
-		if (task->status == LC_TASK_STATUS__COMPLETED)
+		//sleep until the main thread hands us a task
+		if (!MPMC_Queue_PopWait(&lc_task_queue.request_queue, &index, INFINITE))
 		{
-			//insert to hash map
-			LC_Chunk* chunk = LC_World_InsertChunk(&task->chunk);
+			continue;
+		}
+		if (index == LC_TASK_EXIT_REQUEST)
+		{
+			break;
+		}
+
+		//edits go first, whoever is awake takes every waiting edit
+		LC_World_ProcessEditTasks();
+
+		if (index == LC_TASK_EDIT_WAKE)
+		{
+			InterlockedDecrement(&lc_edit_queue.pending_wakes);
+			continue;
+		}
+		if (index >= LC_TASK_LOD_FIRST)
+		{
+			LC_Lod_RunTask(index - LC_TASK_LOD_FIRST);
+			continue;
+		}
+
+		LC_Task* task = &lc_task_queue.task_list[index];
+
+		//generate blocks, unless they came from the chunk cache
+		if (!task->cached)
+		{
+			LC_Chunk_GenerateBlocks(&task->chunk, 2);
+
+			//its own trees first, they are only decided by the terrain
+			task->spill_count = LC_Generate_Decorate(&task->chunk, &task->spills);
+			LC_Decorations_Merge(&task->chunk, task->decorations, task->decorations_seen);
+		}
+
+		//the chunk isn't in the world yet, so everything that only touches the chunk itself is done here
+		if (task->chunk.alive_blocks > 0)
+		{
+			task->vertices_result = LC_Chunk_GenerateVertices(&task->chunk);
+		}
+		
+		//hand it back, can't fail since there are never more tasks than the queue can hold
+		MPSC_Queue_Push(&lc_task_queue.completed_queue, &index);
+	}
+
+	return 0;
+}
+
+void LC_World_RequestLodTask(int p_index)
+{
+	int token = LC_TASK_LOD_FIRST + p_index;
+	MPMC_Queue_Push(&lc_task_queue.request_queue, &token);
+}
+
+static bool LC_World_CreateChunkAsync(int p_x, int p_y, int p_z, bool p_startup)
+{	
+	if (lc_task_queue.free_count <= 0)
+	{
+		return false;
+	}
+
+	int index = lc_task_queue.free_tasks[--lc_task_queue.free_count];
+
+	LC_Task* task = &lc_task_queue.task_list[index];
+	task->vertices_result = NULL;
+	task->startup = p_startup;
+	task->cached = false;
+	task->decorations = NULL;
+	task->spills = NULL;
+	task->spill_count = 0;
+	task->fluid_levels = NULL;
+	task->chunk = LC_Chunk_Create(p_x * LC_CHUNK_WIDTH, p_y * LC_CHUNK_HEIGHT, p_z * LC_CHUNK_LENGTH);
+
+	ivec3 key;
+	key[0] = p_x;
+	key[1] = p_y;
+	key[2] = p_z;
+
+	//a cached chunk already has all of them
+	task->decorations_seen = LC_Decorations_Count(key);
+
+	//the initial world was never unloaded
+	if (!p_startup && LC_ChunkCache_Restore(key, &task->chunk, &task->vertices_result, &task->fluid_levels))
+	{
+		task->cached = true;
+
+		//nothing left for a worker, goes through the finished tasks so it's still uploaded within the budget
+		if (task->vertices_result || task->chunk.alive_blocks <= 0)
+		{
+			MPSC_Queue_Push(&lc_task_queue.completed_queue, &index);
+			return true;
+		}
+	}
+	else if (task->decorations_seen > 0)
+	{
+		task->decorations = LC_Decorations_Copy(key, task->decorations_seen);
+
+		if (!task->decorations)
+		{
+			task->decorations_seen = 0;
+		}
+	}
+
+	MPMC_Queue_Push(&lc_task_queue.request_queue, &index);
+
+	return true;
+}
+
+static int LC_World_StartupDistance(const ivec3 p_key)
+{
+	int dx = abs(p_key[0] - lc_startup.spawn_key[0]);
+	int dy = abs(p_key[1] - lc_startup.spawn_key[1]);
+	int dz = abs(p_key[2] - lc_startup.spawn_key[2]);
+
+	return max(dx, dz) * 64 + dy;
+}
+
+static bool LC_World_isSpawnChunkKey(const ivec3 p_key)
+{
+	return abs(p_key[0] - lc_startup.spawn_key[0]) <= LC_SPAWN_RADIUS_CHUNKS && abs(p_key[2] - lc_startup.spawn_key[2]) <= LC_SPAWN_RADIUS_CHUNKS;
+}
+
+static int LC_World_CompareStartupKeys(const void* p_a, const void* p_b)
+{
+	int a = LC_World_StartupDistance(p_a);
+	int b = LC_World_StartupDistance(p_b);
+
+	//furthest first, so the nearest can be popped from the back
+	return (a < b) - (a > b);
+}
+
+static void LC_World_QueueStartupChunks()
+{
+	int key_count = dA_size(lc_startup.keys);
+
+	while (key_count > 0 && lc_task_queue.free_count > 0)
+	{
+		ivec3* key = dA_at(lc_startup.keys, key_count - 1);
+
+		LC_World_CreateChunkAsync((*key)[0], (*key)[1], (*key)[2], true);
+
+		key_count--;
+	}
+
+	dA_resize(lc_startup.keys, key_count);
+}
+
+static void LC_World_FinishStartupChunk(LC_Task* const p_task)
+{
+	if (!p_task->startup)
+	{
+		return;
+	}
+
+	ivec3 chunk_key;
+	LC_getNormalizedChunkPosition(p_task->chunk.global_position[0], p_task->chunk.global_position[1], p_task->chunk.global_position[2], chunk_key);
+
+	if (LC_World_isSpawnChunkKey(chunk_key))
+	{
+		lc_startup.spawn_chunks_left--;
+	}
+	lc_startup.finished++;
+
+	if (lc_startup.finished == lc_startup.total)
+	{
+		LARGE_INTEGER freq, now;
+		QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&now);
+
+		printf("Initial world of %i chunks finished in %.2f ms\n", lc_startup.total, (double)(now.QuadPart - lc_startup.create_time.QuadPart) * 1000.0 / (double)freq.QuadPart);
+	}
+}
+
+static void LC_World_ProcessTaskQueue(size_t p_budgetBytes, bool p_wait)
+{
+	while (true)
+	{
+		int index = -1;
+
+		if (p_wait)
+		{
+			//only the first one is waited for, the rest is whatever is done by then
+			if (!MPSC_Queue_PopWait(&lc_task_queue.completed_queue, &index, INFINITE))
+			{
+				return;
+			}
+			p_wait = false;
+		}
+		else if (!MPSC_Queue_Pop(&lc_task_queue.completed_queue, &index))
+		{
+			return;
+		}
+
+		LC_Task* task = &lc_task_queue.task_list[index];
+
+		lc_task_queue.free_tasks[lc_task_queue.free_count++] = index;
+
+		LC_World_FinishStartupChunk(task);
+
+		GeneratedChunkVerticesResult* vertices_result = task->vertices_result;
+		task->vertices_result = NULL;
+
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(task->chunk.global_position[0], task->chunk.global_position[1], task->chunk.global_position[2], chunk_key);
+
+		//neighbours that finished while it was generating
+		bool late_decorations = LC_Decorations_MergeLate(&task->chunk, chunk_key, task->decorations_seen);
+
+		LC_Decorations_AddSpills(chunk_key, task->spills, task->spill_count);
+
+		free(task->decorations);
+		free(task->spills);
+		task->decorations = NULL;
+		task->spills = NULL;
+		task->spill_count = 0;
+
+		uint8_t* fluid_levels = task->fluid_levels;
+		task->fluid_levels = NULL;
+
+		//the player moved away while it was generating, it would only be unloaded again
+		if (lc_cvars.lc_static_world->int_value == 0)
+		{
+			ivec3 bounds[2];
+			LC_World_GetRenderDistanceBounds(bounds);
+
+			if (!LC_World_isChunkKeyInBounds(chunk_key, bounds))
+			{
+				//it might come back, meshed again if the mesh is out of date
+				if (late_decorations)
+				{
+					LC_World_FreeVerticesResult(vertices_result);
+					vertices_result = NULL;
+				}
+				LC_ChunkCache_Store(chunk_key, &task->chunk, vertices_result, fluid_levels);
+				continue;
+			}
+		}
+
+		//how far the water had spread, before the chunk's water is seeded in the insert
+		if (fluid_levels)
+		{
+			LC_Fluids_RestoreLevels(chunk_key, fluid_levels);
+			free(fluid_levels);
+		}
+
+		//insert to hash map
+		LC_Chunk* chunk = LC_World_InsertChunk(&task->chunk);
+
+		if (!chunk)
+		{
+			LC_Fluids_RemoveChunk(chunk_key);
+		}
+		if (!chunk || chunk->alive_blocks <= 0)
+		{
+			LC_World_FreeVerticesResult(vertices_result);
+			continue;
+		}
+
+		//already meshed by the worker
+		if (vertices_result)
+		{
+			LC_World_UpdateChunkIndexes(chunk);
+			LC_World_UpdateChunkVertices(chunk, vertices_result);
+		}
+		else
+		{
+			LC_World_UpdateChunk(chunk, NULL);
+		}
+
+		//the worker meshed it without them
+		if (late_decorations && vertices_result)
+		{
+			LC_World_QueueChunkRemesh(chunk);
+			LC_World_SubmitRemeshes();
+		}
+
+		//keep applying meshes until the vertex data of this frame is over the budget
+		if (lc_world.frame_upload_bytes >= p_budgetBytes)
+		{
+			break;
+		}
+	}
+}
+
+static void LC_World_RequestRemesh(LC_Chunk* const p_chunk)
+{
+	//one in flight per chunk, it's requested again if it comes back out of date
+	if (p_chunk->remesh_state != LC_REMESH__NONE)
+	{
+		return;
+	}
+
+	ivec3 chunk_key;
+	LC_getNormalizedChunkPosition(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2], chunk_key);
+
+	p_chunk->remesh_state = LC_REMESH__REQUESTED;
+	dA_emplaceBackData(lc_edit_queue.requested_keys, chunk_key);
+}
+
+void LC_World_SubmitRemeshes()
+{
+	int key_count = dA_size(lc_edit_queue.requested_keys);
+	int submitted = 0;
+
+	ivec3* keys = lc_edit_queue.requested_keys->data;
+
+	while (submitted < key_count && lc_edit_queue.free_count > 0)
+	{
+		LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, keys[submitted]);
+
+		if (!chunk || chunk->remesh_state != LC_REMESH__REQUESTED)
+		{
+			submitted++;
+			continue;
+		}
+
+		int index = lc_edit_queue.free_tasks[--lc_edit_queue.free_count];
+		LC_EditTask* task = &lc_edit_queue.task_list[index];
+
+		task->chunk = *chunk;
+		task->edit_serial = chunk->edit_serial;
+		task->vertices_result = NULL;
+		glm_ivec3_copy(keys[submitted], task->chunk_key);
+
+		chunk->remesh_state = LC_REMESH__IN_FLIGHT;
+		chunk->remesh_serial = chunk->edit_serial;
+
+		MPMC_Queue_Push(&lc_edit_queue.request_queue, &index);
+
+		//wake up a sleeping worker, busy ones check the edit lane before their next chunk anyway
+		if (InterlockedIncrement(&lc_edit_queue.pending_wakes) <= LC_MAX_EDIT_TASKS)
+		{
+			int wake_request = LC_TASK_EDIT_WAKE;
+			MPMC_Queue_Push(&lc_task_queue.request_queue, &wake_request);
+		}
+		else
+		{
+			InterlockedDecrement(&lc_edit_queue.pending_wakes);
+		}
+
+		submitted++;
+	}
+
+	if (submitted > 0)
+	{
+		memmove(keys, keys + submitted, sizeof(ivec3) * (key_count - submitted));
+		dA_resize(lc_edit_queue.requested_keys, key_count - submitted);
+	}
+}
+
+//call LC_World_SubmitRemeshes after queueing
+void LC_World_QueueChunkRemesh(LC_Chunk* const p_chunk)
+{
+	//nothing to hand it to
+	if (lc_thread.worker_count <= 0)
+	{
+		LC_World_UpdateChunk(p_chunk, NULL);
+		return;
+	}
+
+	p_chunk->edit_serial = ++lc_edit_queue.serial_counter;
+
+	LC_World_RequestRemesh(p_chunk);
+}
+
+void LC_World_QueueChunkEdit(LC_Chunk* const p_chunk)
+{
+	if (lc_thread.worker_count > 0 && p_chunk->pending_edit_time == 0)
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		p_chunk->pending_edit_time = now.QuadPart;
+	}
+
+	LC_World_QueueChunkRemesh(p_chunk);
+	LC_World_SubmitRemeshes();
+}
+
+static void LC_World_ProcessFinishedEdits()
+{
+	int index = 0;
+
+	while (MPSC_Queue_Pop(&lc_edit_queue.completed_queue, &index))
+	{
+		LC_EditTask* task = &lc_edit_queue.task_list[index];
+
+		GeneratedChunkVerticesResult* vertices_result = task->vertices_result;
+		task->vertices_result = NULL;
+
+		lc_edit_queue.free_tasks[lc_edit_queue.free_count++] = index;
+
+		LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, task->chunk_key);
+
+		//unloaded, or a different chunk was loaded in its place
+		if (!chunk || chunk->remesh_state != LC_REMESH__IN_FLIGHT || chunk->remesh_serial != task->edit_serial)
+		{
+			LC_World_FreeVerticesResult(vertices_result);
+			continue;
+		}
+
+		chunk->remesh_state = LC_REMESH__NONE;
+
+		bool up_to_date = chunk->edit_serial == task->edit_serial;
+
+		//an older mesh is still shown, so a chunk that keeps changing (flowing water) isn't stuck on its first mesh
+		if (vertices_result)
+		{
+			LC_World_UpdateChunkIndexes(chunk);
+			LC_World_UpdateChunkVertices(chunk, vertices_result);
+		}
+		else if (chunk->alive_blocks <= 0)
+		{
+			LC_World_UpdateChunkVertices(chunk, NULL);
+		}
+		else if (up_to_date)
+		{
+			LC_World_UpdateChunk(chunk, NULL);
+		}
+
+		//edited again while it was meshing
+		if (!up_to_date)
+		{
+			LC_World_RequestRemesh(chunk);
+			continue;
+		}
+
+		if (chunk->pending_edit_time != 0)
+		{
+			dA_emplaceBackData(lc_edit_queue.visible_edit_times, &chunk->pending_edit_time);
+			chunk->pending_edit_time = 0;
+		}
+	}
+
+	LC_World_SubmitRemeshes();
+}
+
+static int LC_World_CompareFloats(const void* p_a, const void* p_b)
+{
+	float a = *(const float*)p_a;
+	float b = *(const float*)p_b;
+
+	return (a > b) - (a < b);
+}
+
+static void LC_World_PrintEditLatency()
+{
+	int count = lc_edit_queue.latency_sample_count;
+
+	if (count <= 0)
+	{
+		printf("No block edits recorded\n");
+		return;
+	}
+
+	float sorted[LC_EDIT_LATENCY_SAMPLES];
+	memcpy(sorted, lc_edit_queue.latency_samples, sizeof(float) * count);
+
+	qsort(sorted, count, sizeof(float), LC_World_CompareFloats);
+
+	printf("Edit to visible latency of the last %i edits: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", count,
+		sorted[(count * 50) / 100], sorted[(count * 90) / 100], sorted[(count * 99) / 100], sorted[count - 1]);
+}
+
+static void LC_World_RecordEditLatency()
+{
+	int count = dA_size(lc_edit_queue.visible_edit_times);
+
+	if (count > 0)
+	{
+		LARGE_INTEGER freq, now;
+		QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&now);
+
+		int64_t* edit_times = lc_edit_queue.visible_edit_times->data;
+
+		for (int i = 0; i < count; i++)
+		{
+			lc_edit_queue.latency_samples[lc_edit_queue.next_latency_sample] = (double)(now.QuadPart - edit_times[i]) * 1000.0 / (double)freq.QuadPart;
+			lc_edit_queue.next_latency_sample = (lc_edit_queue.next_latency_sample + 1) % LC_EDIT_LATENCY_SAMPLES;
+			lc_edit_queue.latency_sample_count = min(lc_edit_queue.latency_sample_count + 1, LC_EDIT_LATENCY_SAMPLES);
+		}
+
+		dA_clear(lc_edit_queue.visible_edit_times);
+	}
+
+	if (lc_cvars.lc_edit_latency_report->modified)
+	{
+		if (lc_cvars.lc_edit_latency_report->int_value == 1)
+		{
+			LC_World_PrintEditLatency();
+			Cvar_setValueDirectInt(lc_cvars.lc_edit_latency_report, 0);
+		}
+		lc_cvars.lc_edit_latency_report->modified = false;
+	}
+}
+
+/*
+~~~~~~~~~~~~~~~~~~
+UNLOADING
+~~~~~~~~~~~~~~~~~~
+*/
+static bool LC_World_CopyDrbItem(DynamicRenderBuffer* const p_drb, int p_drbIndex, size_t p_vertexSize, void** r_vertices, size_t* r_vertexCount)
+{
+	if (p_drbIndex < 0)
+	{
+		return true;
+	}
+
+	DRB_Item item = DRB_GetItem(p_drb, p_drbIndex);
+
+	if (item.count == 0)
+	{
+		return true;
+	}
+
+	const void* data = DRB_GetItemData(p_drb, p_drbIndex);
+	void* vertices = (data) ? malloc(item.count) : NULL;
+
+	if (!vertices)
+	{
+		return false;
+	}
+
+	memcpy(vertices, data, item.count);
+
+	*r_vertices = vertices;
+	*r_vertexCount = item.count / p_vertexSize;
+
+	return true;
+}
+
+//the uploaded mesh from the cpu copies of the DRBs, NULL if it doesn't match the blocks anymore
+static GeneratedChunkVerticesResult* LC_World_CopyChunkMesh(LC_Chunk* const p_chunk)
+{
+	if (p_chunk->alive_blocks <= 0 || p_chunk->remesh_state != LC_REMESH__NONE)
+	{
+		return NULL;
+	}
+
+	GeneratedChunkVerticesResult* result = calloc(1, sizeof(GeneratedChunkVerticesResult));
+
+	if (!result)
+	{
+		return NULL;
+	}
+
+	memcpy(result->water_surface, p_chunk->water_surface, sizeof(result->water_surface));
+
+	if (!LC_World_CopyDrbItem(&lc_world.render_data.opaque_buffer, p_chunk->opaque_index, sizeof(ChunkVertex), (void**)&result->opaque_vertices, &result->opaque_vertex_count)
+		|| !LC_World_CopyDrbItem(&lc_world.render_data.semi_transparent_buffer, p_chunk->transparent_index, sizeof(ChunkVertex), (void**)&result->transparent_vertices, &result->transparent_vertex_count)
+		|| !LC_World_CopyDrbItem(&lc_world.render_data.water_buffer, p_chunk->water_index, sizeof(ChunkWaterVertex), (void**)&result->water_vertices, &result->water_vertex_count))
+	{
+		LC_World_FreeVerticesResult(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+//unload a chunk that might come back
+static void LC_World_EvictChunk(LC_Chunk* const p_chunk)
+{
+	if (LC_ChunkCache_IsEnabled())
+	{
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2], chunk_key);
+
+		LC_ChunkCache_Store(chunk_key, p_chunk, LC_World_CopyChunkMesh(p_chunk), LC_Fluids_CopyLevels(chunk_key));
+	}
+
+	LC_World_DeleteChunk(p_chunk);
+}
+
+static void LC_World_SetChunkHidden(LC_Chunk* const p_chunk, bool p_hidden)
+{
+	if (p_chunk->is_hidden == p_hidden)
+	{
+		return;
+	}
+
+	p_chunk->is_hidden = p_hidden;
+	lc_chunk_ring.hidden_chunks += (p_hidden) ? 1 : -1;
+
+	LC_World_SetDrawCmdSource(p_chunk);
+}
+
+static void LC_World_ShowAllChunks()
+{
+	for (int i = 0; i < dA_size(lc_world.chunk_map.item_data) && lc_chunk_ring.hidden_chunks > 0; i++)
+	{
+		LC_Chunk* chunk = dA_at(lc_world.chunk_map.item_data, i);
+
+		if (!chunk->is_deleted)
+		{
+			LC_World_SetChunkHidden(chunk, false);
+		}
+	}
+}
 
-			if (!chunk)
-			{
-				task->status = LC_TASK_STATUS__INACTIVE;
-				continue;
-			}
-			if (task->chunk.alive_blocks <= 0)
-			{
-				task->status = LC_TASK_STATUS__INACTIVE;
-				continue;
-			}
+static void LC_World_UnloadChunkAt(int p_x, int p_y, int p_z)
+{
+	ivec3 key;
+	key[0] = p_x;
+	key[1] = p_y;
+	key[2] = p_z;
 
-			if (!task->vertices_result)
-			{
-				//continue;
-			}
+	LC_ChunkRingSlot* slot = LC_ChunkRing_getSlot(key);
 
-			if (task->chunk.alive_blocks > 0 && !lc_world.player_action_this_frame)
-			{
-				//GeneratedChunkVerticesResult* result = LC_Chunk_GenerateVerticesTest(chunk);
-				LC_World_UpdateChunk(chunk, NULL);
+	if (!slot->occupied || memcmp(slot->key, key, sizeof(ivec3)) != 0)
+	{
+		return;
+	}
 
-				task->status = LC_TASK_STATUS__INACTIVE;
+	LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, key);
 
-				break;
-			}
-		}
+	if (chunk)
+	{
+		LC_World_EvictChunk(chunk);
 	}
-	if (lc_thread.mutex_handle)
+	else
 	{
-		//ReleaseMutex(lc_thread.mutex_handle);
+		slot->occupied = false;
 	}
 }
 
-static void LC_World_IterateChunks()
+static void LC_World_HideChunkAt(int p_x, int p_y, int p_z)
 {
-	if (dA_capacity(lc_world.draw_cmd_backbuffer) <= lc_world.render_data.draw_cmds_buffer.used_size)
+	ivec3 key;
+	key[0] = p_x;
+	key[1] = p_y;
+	key[2] = p_z;
+
+	LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, key);
+
+	if (chunk)
 	{
-		dA_resize(lc_world.draw_cmd_backbuffer, lc_world.render_data.draw_cmds_buffer.used_size);
+		LC_World_SetChunkHidden(chunk, true);
 	}
+}
 
-	memset(lc_world.draw_cmd_backbuffer->data, 0, sizeof(LC_CombinedChunkDrawCmdData) * lc_world.draw_cmd_backbuffer->elements_size);
+static void LC_World_ShowChunkAt(int p_x, int p_y, int p_z)
+{
+	ivec3 key;
+	key[0] = p_x;
+	key[1] = p_y;
+	key[2] = p_z;
 
-	ivec3 min_max_bounds[2];
-	LC_World_GetRenderDistanceBounds(min_max_bounds);
+	LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, key);
+
+	if (chunk)
+	{
+		LC_World_SetChunkHidden(chunk, false);
+	}
+}
+
+//only visits the cells that are inside the old bounds, but outside the new ones
+static void LC_World_VisitLeavingCells(ivec3 p_oldBounds[2], ivec3 p_newBounds[2], void (*p_visit)(int, int, int))
+{
+	for (int x = p_oldBounds[0][0]; x <= p_oldBounds[1][0]; x++)
+	{
+		bool x_outside = x < p_newBounds[0][0] || x > p_newBounds[1][0];
+
+		for (int y = p_oldBounds[0][1]; y <= p_oldBounds[1][1]; y++)
+		{
+			bool y_outside = y < p_newBounds[0][1] || y > p_newBounds[1][1];
+
+			if (x_outside || y_outside)
+			{
+				for (int z = p_oldBounds[0][2]; z <= p_oldBounds[1][2]; z++)
+				{
+					p_visit(x, y, z);
+				}
+				continue;
+			}
+
+			for (int z = p_oldBounds[0][2]; z <= p_oldBounds[1][2] && z < p_newBounds[0][2]; z++)
+			{
+				p_visit(x, y, z);
+			}
+			for (int z = max(p_oldBounds[0][2], p_newBounds[1][2] + 1); z <= p_oldBounds[1][2]; z++)
+			{
+				p_visit(x, y, z);
+			}
+		}
+	}
+}
+
+static void LC_World_RebuildChunkRing(ivec3 p_bounds[2], ivec3 p_unloadBounds[2])
+{
+	memset(lc_chunk_ring.slots, 0, sizeof(lc_chunk_ring.slots));
 
 	for (int i = 0; i < dA_size(lc_world.chunk_map.item_data); i++)
 	{
@@ -504,52 +1571,73 @@ static void LC_World_IterateChunks()
 			continue;
 		}
 
-		ivec3 normalized_chunk_pos;
-		LC_getNormalizedChunkPosition(chunk->global_position[0], chunk->global_position[1], chunk->global_position[2], normalized_chunk_pos);
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(chunk->global_position[0], chunk->global_position[1], chunk->global_position[2], chunk_key);
 
-		if (lc_cvars.lc_static_world->int_value == 0)
+		if (!LC_World_isChunkKeyInBounds(chunk_key, p_unloadBounds))
 		{
-			//Delete chunk if it falls outside the min and max
-			if (normalized_chunk_pos[0] < min_max_bounds[0][0] || normalized_chunk_pos[0] > min_max_bounds[1][0] || normalized_chunk_pos[1] < min_max_bounds[0][1] || normalized_chunk_pos[1] > min_max_bounds[1][1]
-				|| normalized_chunk_pos[2] < min_max_bounds[0][2] || normalized_chunk_pos[2] > min_max_bounds[1][2])
-			{
-				LC_World_DeleteChunk(chunk);
-				continue;
-			}
+			LC_World_EvictChunk(chunk);
+			continue;
 		}
-		if (lc_world.require_draw_cmd_update && chunk->draw_cmd_index >= 0)
+
+		LC_World_SetChunkHidden(chunk, !LC_World_isChunkKeyInBounds(chunk_key, p_bounds));
+
+		LC_ChunkRingSlot* slot = LC_ChunkRing_getSlot(chunk_key);
+		memcpy(slot->key, chunk_key, sizeof(ivec3));
+		slot->occupied = true;
+	}
+}
+
+static void LC_World_UnloadFarChunks()
+{
+	if (lc_cvars.lc_static_world->int_value != 0)
+	{
+		//the whole static world is drawn
+		if (lc_chunk_ring.bounds_valid)
 		{
-			LC_CombinedChunkDrawCmdData* cmd = dA_at(lc_world.draw_cmd_backbuffer, chunk->draw_cmd_index);
+			LC_World_ShowAllChunks();
+		}
 
-			if (chunk->opaque_index >= 0 && chunk->opaque_blocks > 0)
-			{
-				DRB_Item item = DRB_GetItem(&lc_world.render_data.opaque_buffer, chunk->opaque_index);
+		//nothing is unloaded, rebuild the ring once the world is dynamic again
+		lc_chunk_ring.bounds_valid = false;
+		return;
+	}
 
-				cmd->o_count = item.count / sizeof(ChunkVertex);
-				cmd->o_first = item.offset / sizeof(ChunkVertex);
-			}
-			if (chunk->transparent_index >= 0 && chunk->transparent_blocks > 0)
-			{
-				DRB_Item item = DRB_GetItem(&lc_world.render_data.semi_transparent_buffer, chunk->transparent_index);
+	ivec3 bounds[2];
+	ivec3 unload_bounds[2];
+	LC_World_GetRenderDistanceBounds(bounds);
+	LC_World_GetUnloadBounds(unload_bounds);
 
-				cmd->t_count = item.count / sizeof(ChunkVertex);
-				cmd->t_first = item.offset / sizeof(ChunkVertex);
-			}
-			if (chunk->water_index >= 0 && chunk->water_blocks > 0)
-			{
-				DRB_Item item = DRB_GetItem(&lc_world.render_data.water_buffer, chunk->water_index);
+	//full pass only on the first frame or after the world was static
+	if (!lc_chunk_ring.bounds_valid)
+	{
+		LC_World_RebuildChunkRing(bounds, unload_bounds);
+	}
+	else if (memcmp(bounds, lc_chunk_ring.bounds, sizeof(bounds)) != 0)
+	{
+		ivec3* old_bounds = lc_chunk_ring.bounds;
 
-				cmd->w_count = item.count / sizeof(ChunkWaterVertex);
-				cmd->w_first = item.offset / sizeof(ChunkWaterVertex);
-			}
+		ivec3 old_unload_bounds[2];
+		memcpy(old_unload_bounds, old_bounds, sizeof(old_unload_bounds));
+
+		for (int i = 0; i < 3; i++)
+		{
+			old_unload_bounds[0][i] -= LC_UNLOAD_HYSTERESIS_CHUNKS;
+			old_unload_bounds[1][i] += LC_UNLOAD_HYSTERESIS_CHUNKS;
 		}
-		
+
+		LC_World_VisitLeavingCells(old_unload_bounds, unload_bounds, LC_World_UnloadChunkAt);
+		LC_World_VisitLeavingCells(old_bounds, bounds, LC_World_HideChunkAt);
+		LC_World_VisitLeavingCells(bounds, old_bounds, LC_World_ShowChunkAt);
 	}
+
+	memcpy(lc_chunk_ring.bounds, bounds, sizeof(bounds));
+	lc_chunk_ring.bounds_valid = true;
 }
 
 static void LC_World_CreateNearbyChunks()
 {
-	if (lc_world.num_alive_chunks >= LC_WORLD_MAX_CHUNK_LIMIT - 2)
+	if (lc_world.num_alive_chunks >= LC_WORLD_MAX_FULL_CHUNKS - 2)
 	{
 		return;
 	}
@@ -565,7 +1653,7 @@ static void LC_World_CreateNearbyChunks()
 			{
 				if (!LC_World_ChunkExists(x * LC_CHUNK_WIDTH, y * LC_CHUNK_HEIGHT, z * LC_CHUNK_LENGTH))
 				{
-					LC_World_CreateChunkAsync(x, y, z);
+					LC_World_CreateChunkAsync(x, y, z, false);
 					break;
 				}
 			}
@@ -573,166 +1661,38 @@ static void LC_World_CreateNearbyChunks()
 	}
 }
 
-static void LC_World_FloodWater(LC_Chunk* const p_chunk)
+static void LC_World_PruneDecorations()
 {
-	if (p_chunk->water_blocks <= 0)
-	{
-		return;
-	}
-	//return;
-	int num_none_blocks = (LC_CHUNK_WIDTH * LC_CHUNK_HEIGHT * LC_CHUNK_LENGTH) - p_chunk->alive_blocks;
+	ivec3 bounds[2];
+	LC_World_GetUnloadBounds(bounds);
 
-	if (num_none_blocks <= 0)
-	{
-		return;
-	}
-
-	int minWaterX = 16;
-	int minWaterY = 16;
-	int minWaterZ = 16;
+	//chunks that are still generating can be anywhere in the unload bounds
+	bool free_tasks[LC_MAX_ACTIVE_TASKS];
+	memset(free_tasks, 0, sizeof(free_tasks));
 
-	int maxWaterX = 0;
-	int maxWaterY = 0;
-	int maxWaterZ = 0;
-
-	for (int x = 0; x < LC_CHUNK_WIDTH; x++)
+	for (int i = 0; i < lc_task_queue.free_count; i++)
 	{
-		for (int y = 0; y < LC_CHUNK_HEIGHT; y++)
-		{
-			for (int z = 0; z < LC_CHUNK_LENGTH; z++)
-			{
-				num_none_blocks = (LC_CHUNK_WIDTH * LC_CHUNK_HEIGHT * LC_CHUNK_LENGTH) - p_chunk->alive_blocks;
-				if (num_none_blocks <= 0)
-				{
-					break;
-				}
-				if (LC_IsBlockWater(p_chunk->blocks[x][y][z].type))
-				{
-					minWaterX = min(minWaterX, x);
-					minWaterY = min(minWaterY, y);
-					minWaterZ = min(minWaterZ, z);
-
-					maxWaterX = max(maxWaterX, x);
-					maxWaterY = max(maxWaterY, y);
-					maxWaterZ = max(maxWaterZ, z);
-
-					for (int x2 = x; x2 >= 0; x2--)
-					{
-						for (int y2 = y; y2 >= 0; y2--)
-						{
-							for (int z2 = z; z2 >= 0; z2--)
-							{
-								if (LC_Chunk_getType(p_chunk, x2, y2, z2) == LC_BT__NONE)
-								{
-									minWaterX = min(minWaterX, x2);
-									minWaterY = min(minWaterY, y2);
-									minWaterZ = min(minWaterZ, z2);
-
-									maxWaterX = max(maxWaterX, x2);
-									maxWaterY = max(maxWaterY, y2);
-									maxWaterZ = max(maxWaterZ, z2);
-
-									LC_Chunk_SetBlock(p_chunk, x2, y2, z2, LC_BT__WATER);
-								}
-							}
-						}
-					}
-					for (int x2 = x; x2 < LC_CHUNK_WIDTH; x2++)
-					{
-						for (int z2 = z; z2 < LC_CHUNK_LENGTH; z2++)
-						{
-							if (LC_Chunk_getType(p_chunk, x2, y, z2) == LC_BT__NONE)
-							{
-								minWaterX = min(minWaterX, x2);
-								minWaterY = min(minWaterY, y);
-								minWaterZ = min(minWaterZ, z2);
-
-								maxWaterX = max(maxWaterX, x2);
-								maxWaterY = max(maxWaterY, y);
-								maxWaterZ = max(maxWaterZ, z2);
-
-
-								LC_Chunk_SetBlock(p_chunk, x2, y, z2, LC_BT__WATER);
-							}
-						}
-					}
-				}
-			}
-		}
+		free_tasks[lc_task_queue.free_tasks[i]] = true;
 	}
-	/*
-	if (minWaterZ == 0)
+	for (int i = 0; i < LC_MAX_ACTIVE_TASKS; i++)
 	{
-		LC_Chunk* neigbour = LC_World_getNeighbourChunk(p_chunk, 0);
-		
-		if (neigbour)
+		if (free_tasks[i])
 		{
-			for (int x = minWaterX; x < maxWaterX; x++)
-			{
-				if (LC_Chunk_getType(neigbour, x, LC_WORLD_WATER_HEIGHT, LC_CHUNK_LENGTH - 1) == LC_BT__NONE)
-				{
-					LC_Chunk_SetBlock(neigbour, x, LC_WORLD_WATER_HEIGHT, LC_CHUNK_LENGTH - 1, LC_BT__WATER);
-					LC_World_UpdateChunk(neigbour, NULL);
-					break;
-				}
-			}
-
+			continue;
 		}
-	}
-	if (maxWaterZ == LC_CHUNK_LENGTH - 1)
-	{
-		LC_Chunk* neigbour = LC_World_getNeighbourChunk(p_chunk, 1);
 
-		if (neigbour)
-		{
-			for (int x = minWaterX; x < maxWaterX; x++)
-			{
-				if (LC_Chunk_getType(neigbour, x, LC_WORLD_WATER_HEIGHT, 0) == LC_BT__NONE)
-				{
-					LC_Chunk_SetBlock(neigbour, x, LC_WORLD_WATER_HEIGHT, 0, LC_BT__WATER);
-					LC_World_UpdateChunk(neigbour, NULL);
-					break;
-				}
-			}
+		LC_Chunk* chunk = &lc_task_queue.task_list[i].chunk;
 
-		}
-	}
-	if (minWaterX == 0)
-	{
-		LC_Chunk* neigbour = LC_World_getNeighbourChunk(p_chunk, 2);
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(chunk->global_position[0], chunk->global_position[1], chunk->global_position[2], chunk_key);
 
-		if (neigbour)
+		if (!LC_World_isChunkKeyInBounds(chunk_key, bounds))
 		{
-			for (int z = minWaterZ; z < maxWaterZ; z++)
-			{
-				if (LC_Chunk_getType(neigbour, LC_CHUNK_WIDTH - 1, LC_WORLD_WATER_HEIGHT, z) == LC_BT__NONE)
-				{
-					LC_Chunk_SetBlock(neigbour, LC_CHUNK_WIDTH - 1, LC_WORLD_WATER_HEIGHT, z, LC_BT__WATER);
-					LC_World_UpdateChunk(neigbour, NULL);
-					break;
-				}
-			}
-
+			return;
 		}
 	}
-	if (maxWaterX == LC_CHUNK_WIDTH - 1)
-	{
-		LC_Chunk* neigbour = LC_World_getNeighbourChunk(p_chunk, 3);
 
-		if (neigbour)
-		{
-			for (int z = minWaterZ; z < maxWaterZ; z++)
-			{
-				if (LC_Chunk_getType(neigbour, 0, LC_WORLD_WATER_HEIGHT, z) == LC_BT__NONE)
-				{
-					LC_Chunk_SetBlock(neigbour, 0, LC_WORLD_WATER_HEIGHT, z, LC_BT__WATER);
-					LC_World_UpdateChunk(neigbour, NULL);
-					break;
-				}
-			}
-		}
-	}
-	*/
+	LC_Decorations_Prune(bounds);
 }
 
 LC_Chunk* LC_World_GetChunk(float p_x, float p_y, float p_z)
@@ -771,6 +1731,41 @@ LC_Block* LC_World_GetBlock(float p_x, float p_y, float p_z, ivec3 r_relativePos
 
 	return LC_Chunk_GetBlock(chunk_ptr, x_block_pos, y_block_pos, z_block_pos);
 }
+void LC_World_GetBlockTypes(const float* p_x, const float* p_y, const float* p_z, int p_count, uint8_t* r_types)
+{
+	//nearby positions usually fall into the same chunk, so keep the last found chunk around
+	//and only go through the hash map when the chunk changes
+	LC_Chunk* cached_chunk = NULL;
+	ivec3 cached_key = { INT_MAX, INT_MAX, INT_MAX };
+
+	for (int i = 0; i < p_count; i++)
+	{
+		int block_x = roundf(p_x[i]);
+		int block_y = roundf(p_y[i]);
+		int block_z = roundf(p_z[i]);
+
+		ivec3 chunk_key;
+		LC_getNormalizedChunkPosition(block_x, block_y, block_z, chunk_key);
+
+		if (!glm_ivec3_eqv(chunk_key, cached_key))
+		{
+			cached_chunk = CHMap_Find(&lc_world.chunk_map, chunk_key);
+			glm_ivec3_copy(chunk_key, cached_key);
+		}
+
+		if (!cached_chunk)
+		{
+			r_types[i] = LC_BT__NONE;
+			continue;
+		}
+
+		int x = block_x - cached_chunk->global_position[0];
+		int y = block_y - cached_chunk->global_position[1];
+		int z = block_z - cached_chunk->global_position[2];
+
+		r_types[i] = cached_chunk->blocks[x][y][z].type;
+	}
+}
 LC_Block* LC_World_getBlockByRay(vec3 from, vec3 dir, int max_steps, ivec3 r_pos, ivec3 r_face, LC_Chunk** r_chunk)
 {
 	// "A Fast Voxel Traversal Algorithm for Ray Tracing" by John Amanatides, Andrew Woo */
@@ -892,85 +1887,247 @@ bool LC_World_addBlock(int p_gX, int p_gY, int p_gZ, ivec3 p_addFace, LC_BlockTy
 	assert(new_block_relative_pos_x >= 0 && new_block_relative_pos_x < LC_CHUNK_WIDTH && new_block_relative_pos_y >= 0 && new_block_relative_pos_y < LC_CHUNK_HEIGHT &&
 		new_block_relative_pos_z >= 0 && new_block_relative_pos_x < LC_CHUNK_LENGTH);
 
-	int old_alive_blocks = new_chunk->alive_blocks;
+	int old_alive_blocks = new_chunk->alive_blocks;
+
+	LC_Chunk_SetBlock(new_chunk, new_block_relative_pos_x, new_block_relative_pos_y, new_block_relative_pos_z, block_type);
+
+	if (LC_isblockEmittingLight(block_type))
+	{
+		LC_Block_LightData light_data = LC_getBlockLightingData(block_type);
+
+		LC_World_CreateLightBlock(new_block_pos_x, new_block_pos_y, new_block_pos_z, light_data);
+	}
+	if (LC_IsBlockWater(block_type))
+	{
+		LC_Fluids_WakeAround(new_chunk, new_block_pos_x, new_block_pos_y, new_block_pos_z);
+	}
+
+	LC_World_QueueChunkEdit(new_chunk);
+
+	if (old_alive_blocks == 0 && new_chunk->alive_blocks == 1)
+	{
+		lc_world.num_alive_chunks++;
+	}
+
+	return true;
+}
+
+bool LC_World_mineBlock(int p_gX, int p_gY, int p_gZ)
+{
+	ivec3 relative_block_position;
+	LC_Chunk* chunk = NULL;
+	LC_Block* block = LC_World_GetBlock(p_gX, p_gY, p_gZ, relative_block_position, &chunk);
+
+	//block not found?
+	if (!block || !chunk)
+	{
+		return false;
+	}
+
+	//is water block?
+	if (LC_IsBlockWater(block->type))
+	{
+		return false;
+	}
+
+	lc_prev_mined_block.hp--;
+
+	//destroy instantly if creative mode is on or block is a prop
+	if (lc_world.creative_mode_on || LC_isBlockProp(block->type))
+	{
+		lc_prev_mined_block.hp = 0;
+	}
+
+	if (lc_prev_mined_block.block)
+	{
+		if (lc_prev_mined_block.block != block)
+		{
+			lc_prev_mined_block.hp = LC_BLOCK_STARTING_HP;
+		}
+	}
+	lc_prev_mined_block.cooldown_timer = 0;
+	
+
+	//destroy block
+	if (lc_prev_mined_block.hp <= 0)
+	{	
+		if (LC_isblockEmittingLight(block->type))
+		{
+			LC_World_DestroyLightBlock(p_gX, p_gY, p_gZ);
+		}
+
+		LC_Chunk_SetBlock(chunk, relative_block_position[0], relative_block_position[1], relative_block_position[2], LC_BT__NONE);
+
+		//nearby water flows in on the next fluid ticks
+		LC_Fluids_WakeAround(chunk, p_gX, p_gY, p_gZ);
+
+		//remeshed on the lc workers
+		LC_World_QueueChunkEdit(chunk);
+
+		lc_prev_mined_block.block = NULL;
+		lc_prev_mined_block.hp = LC_BLOCK_STARTING_HP;
+	}
+
+	return true;
+}
+
+static void LC_World_WaitForEdits()
+{
+	while (dA_size(lc_edit_queue.requested_keys) > 0 || lc_edit_queue.free_count < LC_MAX_EDIT_TASKS)
+	{
+		LC_World_ProcessFinishedEdits();
+		SwitchToThread();
+	}
+}
+
+static double LC_World_ElapsedMs(LARGE_INTEGER p_start)
+{
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+
+	return (double)(now.QuadPart - p_start.QuadPart) * 1000.0 / (double)freq.QuadPart;
+}
+
+void LC_World_EditBenchmark(int p_size)
+{
+	if (p_size <= 0)
+	{
+		return;
+	}
+
+	//somewhere above the player, the old blocks are pasted back at the end
+	vec3 player_pos;
+	LC_Player_getPosition(player_pos);
+
+	ivec3 region_min, region_max;
+	region_min[0] = (int)player_pos[0] - p_size / 2;
+	region_min[1] = (int)player_pos[1] + 4;
+	region_min[2] = (int)player_pos[2] - p_size / 2;
+	glm_ivec3_copy(region_min, region_max);
+	glm_ivec3_adds(region_max, p_size - 1, region_max);
+
+	LC_Clipboard backup;
+	if (!LC_Region_Copy(region_min, region_max, &backup))
+	{
+		return;
+	}
+
+	LC_World_WaitForEdits();
+
+	//the old path, a chunk update for every block. Only a slice of it, the whole region would take minutes
+	int single_blocks = min(p_size * p_size * 4, p_size * p_size * p_size);
+
+	int placed_blocks = 0;
+
+	LARGE_INTEGER start_time;
+	QueryPerformanceCounter(&start_time);
+
+	for (int i = 0; i < single_blocks; i++)
+	{
+		int x = region_min[0] + (i / (p_size * p_size));
+		int y = region_min[1] + (i / p_size) % p_size;
+		int z = region_min[2] + i % p_size;
+
+		ivec3 relative_pos;
+		LC_Chunk* chunk = NULL;
+		LC_World_GetBlock(x, y, z, relative_pos, &chunk);
+
+		if (chunk)
+		{
+			LC_Chunk_SetBlock(chunk, relative_pos[0], relative_pos[1], relative_pos[2], LC_BT__STONE);
+			LC_World_UpdateChunk(chunk, NULL);
+			placed_blocks++;
+		}
+	}
+	double single_ms = LC_World_ElapsedMs(start_time);
+
+	LC_Region_Paste(&backup, region_min, false);
+	LC_World_WaitForEdits();
 
-	LC_Chunk_SetBlock(new_chunk, new_block_relative_pos_x, new_block_relative_pos_y, new_block_relative_pos_z, block_type);
+	//region fill, then until every touched chunk is remeshed
+	QueryPerformanceCounter(&start_time);
 
-	if (LC_isblockEmittingLight(block_type))
-	{
-		LC_Block_LightData light_data = LC_getBlockLightingData(block_type);
+	int changed = LC_Region_Fill(region_min, region_max, LC_BT__STONE);
+	double write_ms = LC_World_ElapsedMs(start_time);
 
-		LC_World_CreateLightBlock(new_block_pos_x, new_block_pos_y, new_block_pos_z, light_data);
-	}
+	LC_World_WaitForEdits();
+	double fill_ms = LC_World_ElapsedMs(start_time);
 
-	LC_World_UpdateChunk(new_chunk, NULL);
+	LC_Region_Paste(&backup, region_min, false);
+	LC_World_WaitForEdits();
 
-	if (old_alive_blocks == 0 && new_chunk->alive_blocks == 1)
-	{
-		lc_world.num_alive_chunks++;
-	}
+	LC_Clipboard_Destruct(&backup);
 
-	lc_world.player_action_this_frame = true;
+	double single_total_ms = (single_ms / max(placed_blocks, 1)) * p_size * p_size * p_size;
 
-	return true;
+	printf("Edit benchmark, %i^3 fill: one by one %.2f ms for %i blocks (~%.0f ms for all), region fill %.2f ms to write %i blocks, %.2f ms until remeshed (%.1fx)\n",
+		p_size, single_ms, placed_blocks, single_total_ms, write_ms, changed, fill_ms, (fill_ms > 0) ? single_total_ms / fill_ms : 0);
 }
 
-bool LC_World_mineBlock(int p_gX, int p_gY, int p_gZ)
+void LC_World_BlockBenchmark(int p_probeSize)
 {
-	ivec3 relative_block_position;
-	LC_Chunk* chunk = NULL;
-	LC_Block* block = LC_World_GetBlock(p_gX, p_gY, p_gZ, relative_block_position, &chunk);
-
-	//block not found?
-	if (!block || !chunk)
+	if (p_probeSize <= 0)
 	{
-		return false;
+		return;
 	}
 
-	//is water block?
-	if (LC_IsBlockWater(block->type))
-	{
-		return false;
-	}
+	//remesh every loaded full detail chunk, the results are thrown away
+	int meshed_chunks = 0;
+	size_t mesh_vertices = 0;
 
-	lc_prev_mined_block.hp--;
+	LARGE_INTEGER start_time;
+	QueryPerformanceCounter(&start_time);
 
-	//destroy instantly if creative mode is on or block is a prop
-	if (lc_world.creative_mode_on || LC_isBlockProp(block->type))
+	for (int i = 0; i < dA_size(lc_world.chunk_map.item_data); i++)
 	{
-		lc_prev_mined_block.hp = 0;
-	}
+		LC_Chunk* chunk = dA_at(lc_world.chunk_map.item_data, i);
 
-	if (lc_prev_mined_block.block)
-	{
-		if (lc_prev_mined_block.block != block)
+		if (chunk->is_deleted || chunk->lod_level > 0 || chunk->alive_blocks <= 0)
 		{
-			lc_prev_mined_block.hp = LC_BLOCK_STARTING_HP;
+			continue;
 		}
-	}
-	lc_prev_mined_block.cooldown_timer = 0;
-	
 
-	//destroy block
-	if (lc_prev_mined_block.hp <= 0)
-	{	
-		if (LC_isblockEmittingLight(block->type))
+		GeneratedChunkVerticesResult* vertices = LC_Chunk_GenerateVertices(chunk);
+
+		if (vertices)
 		{
-			LC_World_DestroyLightBlock(p_gX, p_gY, p_gZ);
+			mesh_vertices += vertices->opaque_vertex_count + vertices->transparent_vertex_count + vertices->water_vertex_count;
+			LC_World_FreeVerticesResult(vertices);
 		}
+		meshed_chunks++;
+	}
+	double mesh_ms = LC_World_ElapsedMs(start_time);
 
-		LC_Chunk_SetBlock(chunk, relative_block_position[0], relative_block_position[1], relative_block_position[2], LC_BT__NONE);
+	//the same lookups the physics does for a body, a block and if it's collidable, over a cube around the player
+	vec3 player_pos;
+	LC_Player_getPosition(player_pos);
 
-		//update chunk
-		LC_World_UpdateChunk(chunk, NULL);
+	int collidable_blocks = 0;
+	int probed_blocks = 0;
 
-		lc_prev_mined_block.block = NULL;
-		lc_prev_mined_block.hp = LC_BLOCK_STARTING_HP;
+	QueryPerformanceCounter(&start_time);
+
+	for (int x = 0; x < p_probeSize; x++)
+	{
+		for (int y = 0; y < p_probeSize; y++)
+		{
+			for (int z = 0; z < p_probeSize; z++)
+			{
+				LC_Block* block = LC_World_GetBlock(player_pos[0] + x - p_probeSize / 2, player_pos[1] + y - p_probeSize / 2, player_pos[2] + z - p_probeSize / 2, NULL, NULL);
 
-		lc_world.player_action_this_frame = true;
+				if (block && LC_isBlockCollidable(block->type))
+				{
+					collidable_blocks++;
+				}
+				probed_blocks++;
+			}
+		}
 	}
+	double probe_ms = LC_World_ElapsedMs(start_time);
 
-	return true;
+	printf("Block benchmark: meshed %i chunks in %.2f ms (%.3f ms per chunk, %zu vertices), %i collision probes in %.2f ms (%i collidable)\n",
+		meshed_chunks, mesh_ms, (meshed_chunks > 0) ? mesh_ms / meshed_chunks : 0, mesh_vertices, probed_blocks, probe_ms, collidable_blocks);
 }
 
 bool LC_World_ChunkExists(float p_x, float p_y, float p_z)
@@ -983,14 +2140,19 @@ bool LC_World_ChunkExists(float p_x, float p_y, float p_z)
 	return false;
 }
 
-void LC_World_UpdateChunk(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* vertices_result)
+static void LC_World_PushChangedChunk(LC_Chunk* const p_chunk)
 {
-	//flood water to nearby blocks and chunks
-	if (p_chunk->water_blocks > 0)
-	{
-		LC_World_FloodWater(p_chunk);
-	}
+	ivec4 changed;
+	changed[0] = p_chunk->global_position[0];
+	changed[1] = p_chunk->global_position[1];
+	changed[2] = p_chunk->global_position[2];
+	changed[3] = LC_CHUNK_WIDTH << p_chunk->lod_level;
+
+	dA_emplaceBackData(lc_world.render_data.changed_chunks, changed);
+}
 
+void LC_World_UpdateChunk(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* vertices_result)
+{
 	LC_World_UpdateChunkIndexes(p_chunk);
 
 	GeneratedChunkVerticesResult* vertices = NULL;
@@ -1006,10 +2168,7 @@ void LC_World_UpdateChunk(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult*
 			vertices = LC_Chunk_GenerateVertices(p_chunk);
 		}
 	}
-	if (LC_World_UpdateChunkVertices(p_chunk, vertices))
-	{
-		lc_world.require_draw_cmd_update = true;
-	}
+	LC_World_UpdateChunkVertices(p_chunk, vertices);
 }
 
 void LC_World_UpdateChunkIndexes(LC_Chunk* const p_chunk)
@@ -1040,15 +2199,19 @@ void LC_World_UpdateChunkIndexes(LC_Chunk* const p_chunk)
 	{
 		unsigned chunk_data_index = RSB_Request(&lc_world.render_data.chunk_data_buffer);
 
-		LC_ChunkData chunk_data;
-		memset(&chunk_data, 0, sizeof(LC_ChunkData));
+		LC_PendingChunkData pending;
+		memset(&pending, 0, sizeof(LC_PendingChunkData));
 
-		chunk_data.min_point[0] = p_chunk->global_position[0];
-		chunk_data.min_point[1] = p_chunk->global_position[1];
-		chunk_data.min_point[2] = p_chunk->global_position[2];
-		chunk_data.min_point[3] = chunk_data_index;
+		pending.index = chunk_data_index;
+		pending.order = dA_size(lc_world.pending_chunk_data);
+		pending.data.min_point[0] = p_chunk->global_position[0];
+		pending.data.min_point[1] = p_chunk->global_position[1];
+		pending.data.min_point[2] = p_chunk->global_position[2];
+		pending.data.min_point[3] = chunk_data_index;
+		pending.data.scale = 1 << p_chunk->lod_level;
 
-		glNamedBufferSubData(lc_world.render_data.chunk_data_buffer.buffer, chunk_data_index * sizeof(LC_ChunkData), sizeof(LC_ChunkData), &chunk_data);
+		//uploaded with the draw cmds at the end of the frame
+		dA_emplaceBackData(lc_world.pending_chunk_data, &pending);
 
 		p_chunk->chunk_data_index = chunk_data_index;
 
@@ -1069,14 +2232,16 @@ void LC_World_UpdateChunkIndexes(LC_Chunk* const p_chunk)
 			tree_data->transparent_index = p_chunk->transparent_index;
 			tree_data->water_index = p_chunk->water_index;
 
+			int scale = 1 << p_chunk->lod_level;
+
 			vec3 box[2];
 			box[0][0] = (float)p_chunk->global_position[0] - 0.5;
 			box[0][1] = (float)p_chunk->global_position[1] - 0.5;
 			box[0][2] = (float)p_chunk->global_position[2] - 0.5;
 
-			box[1][0] = (float)p_chunk->global_position[0] + LC_CHUNK_WIDTH;
-			box[1][1] = (float)p_chunk->global_position[1] + LC_CHUNK_HEIGHT;
-			box[1][2] = (float)p_chunk->global_position[2] + LC_CHUNK_LENGTH;
+			box[1][0] = (float)p_chunk->global_position[0] + LC_CHUNK_WIDTH * scale;
+			box[1][1] = (float)p_chunk->global_position[1] + LC_CHUNK_HEIGHT * scale;
+			box[1][2] = (float)p_chunk->global_position[2] + LC_CHUNK_LENGTH * scale;
 
 			p_chunk->aabb_tree_index = BVH_Tree_Insert(&lc_world.render_data.bvh_tree, box, tree_data);
 		}
@@ -1093,17 +2258,27 @@ void LC_World_UpdateChunkIndexes(LC_Chunk* const p_chunk)
 		tree_data->water_index = p_chunk->water_index;
 	}
 
+	LC_World_SetDrawCmdSource(p_chunk);
+
 	//sanity check. These should always match
 	assert(p_chunk->chunk_data_index == p_chunk->draw_cmd_index);
 }
 
 bool LC_World_UpdateChunkVertices(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* p_vertices_result)
 {
-	bool need_draw_cmd_update = false;
-	bool update_draw_cmd_cpu = false;
+	bool data_changed = false;
 
-	LC_CombinedChunkDrawCmdData cmd;
-	memset(&cmd, 0, sizeof(cmd));
+	LC_World_PushChangedChunk(p_chunk);
+
+	//the water surface is generated with the mesh
+	if (p_vertices_result)
+	{
+		memcpy(p_chunk->water_surface, p_vertices_result->water_surface, sizeof(p_chunk->water_surface));
+	}
+	else if (p_chunk->water_blocks <= 0)
+	{
+		memset(p_chunk->water_surface, LC_CHUNK_NO_WATER_SURFACE, sizeof(p_chunk->water_surface));
+	}
 
 	if (p_chunk->opaque_index >= 0)
 	{
@@ -1113,25 +2288,14 @@ bool LC_World_UpdateChunkVertices(LC_Chunk* const p_chunk, GeneratedChunkVertice
 		if (p_chunk->opaque_blocks > 0 && p_vertices_result->opaque_vertices)
 		{
 			DRB_ChangeData(&lc_world.render_data.opaque_buffer, sizeof(ChunkVertex) * p_vertices_result->opaque_vertex_count, p_vertices_result->opaque_vertices, p_chunk->opaque_index);
-
-			DRB_Item current_item = DRB_GetItem(&lc_world.render_data.opaque_buffer, p_chunk->opaque_index);
-
-			if (prev_item.count > 0)
-			{
-				need_draw_cmd_update = true;
-			}
-			else
-			{
-				update_draw_cmd_cpu = true;
-				cmd.o_count = current_item.count / sizeof(ChunkVertex);
-				cmd.o_first = current_item.offset / sizeof(ChunkVertex);
-			}
+			lc_world.frame_upload_bytes += sizeof(ChunkVertex) * p_vertices_result->opaque_vertex_count;
+			data_changed = true;
 		}
 		//clean up the vertex data if we dont have any blocks left
 		else if (prev_item.count > 0 && p_chunk->opaque_blocks <= 0)
 		{
 			DRB_ChangeData(&lc_world.render_data.opaque_buffer, 0, NULL, p_chunk->opaque_index);
-			need_draw_cmd_update = true;
+			data_changed = true;
 		}
 		
 	}
@@ -1143,25 +2307,14 @@ bool LC_World_UpdateChunkVertices(LC_Chunk* const p_chunk, GeneratedChunkVertice
 		{
 			//upload to the vertex buffer
 			DRB_ChangeData(&lc_world.render_data.semi_transparent_buffer, sizeof(ChunkVertex) * p_vertices_result->transparent_vertex_count, p_vertices_result->transparent_vertices, p_chunk->transparent_index);
-
-			DRB_Item current_item = DRB_GetItem(&lc_world.render_data.semi_transparent_buffer, p_chunk->transparent_index);
-
-			if (prev_item.count > 0)
-			{
-				need_draw_cmd_update = true;
-			}
-			else
-			{
-				update_draw_cmd_cpu = true;
-				cmd.t_count = current_item.count / sizeof(ChunkVertex);
-				cmd.t_first = current_item.offset / sizeof(ChunkVertex);
-			}
+			lc_world.frame_upload_bytes += sizeof(ChunkVertex) * p_vertices_result->transparent_vertex_count;
+			data_changed = true;
 		}
 		//clean up the vertex data if we dont have any blocks left
 		else if (prev_item.count > 0 && p_chunk->transparent_blocks <= 0)
 		{
 			DRB_ChangeData(&lc_world.render_data.semi_transparent_buffer, 0, NULL, p_chunk->transparent_index);
-			need_draw_cmd_update = true;
+			data_changed = true;
 		}
 
 	}
@@ -1173,82 +2326,53 @@ bool LC_World_UpdateChunkVertices(LC_Chunk* const p_chunk, GeneratedChunkVertice
 		{
 			//upload to the vertex buffer
 			DRB_ChangeData(&lc_world.render_data.water_buffer, sizeof(ChunkWaterVertex) * p_vertices_result->water_vertex_count, p_vertices_result->water_vertices, p_chunk->water_index);
-
-			DRB_Item current_item = DRB_GetItem(&lc_world.render_data.water_buffer, p_chunk->water_index);
-
-			if (prev_item.count > 0)
-			{
-				need_draw_cmd_update = true;
-			}
-			else
-			{
-				update_draw_cmd_cpu = true;
-				cmd.w_count = current_item.count / sizeof(ChunkWaterVertex);
-				cmd.w_first = current_item.offset / sizeof(ChunkWaterVertex);
-			}
+			lc_world.frame_upload_bytes += sizeof(ChunkWaterVertex) * p_vertices_result->water_vertex_count;
+			data_changed = true;
 		}
 		//clean up the vertex data if we dont have any blocks left
 		else if (prev_item.count > 0 && p_chunk->water_blocks <= 0)
 		{
 			DRB_ChangeData(&lc_world.render_data.water_buffer, 0, NULL, p_chunk->water_index);
-			need_draw_cmd_update = true;
+			data_changed = true;
 		}
 	}
 
-	if (!need_draw_cmd_update && update_draw_cmd_cpu)
+	//the chunks that were moved by this are picked up from the DRBs at the end of the frame
+	if (data_changed)
 	{
-		if (p_chunk->draw_cmd_index >= 0)
-		{
-			glNamedBufferSubData(lc_world.render_data.draw_cmds_buffer.buffer, sizeof(LC_CombinedChunkDrawCmdData) * p_chunk->draw_cmd_index, sizeof(LC_CombinedChunkDrawCmdData), &cmd);
-		}
+		LC_World_MarkDrawCmdDirty(p_chunk->draw_cmd_index);
 	}
 
-	if (p_vertices_result)
-	{
-		//free the vertices buffers
-		if (p_vertices_result->opaque_vertices)
-		{
-			free(p_vertices_result->opaque_vertices);
-		}
-		if (p_vertices_result->transparent_vertices)
-		{
-			free(p_vertices_result->transparent_vertices);
-		}
-		if (p_vertices_result->water_vertices)
-		{
-			free(p_vertices_result->water_vertices);
-		}
+	LC_World_FreeVerticesResult(p_vertices_result);
 
-		//free the result
-		if (p_vertices_result)
-		{
-			free(p_vertices_result);
-		}
-	}
-	
 
-	return need_draw_cmd_update;
+	return data_changed;
 }
 
-void LC_World_DeleteChunk(LC_Chunk* const p_chunk)
+void LC_World_ReleaseChunkRenderData(LC_Chunk* const p_chunk)
 {
 	assert(p_chunk->draw_cmd_index == p_chunk->chunk_data_index);
 
+	LC_World_PushChangedChunk(p_chunk);
+
 	//remove the item from vertex buffers
 	if (p_chunk->opaque_index != -1)
 	{
+		LC_World_SetDrbOwner(LC_DRB__OPAQUE, p_chunk->opaque_index, -1);
 		DRB_RemoveItem(&lc_world.render_data.opaque_buffer, p_chunk->opaque_index);
 
 		p_chunk->opaque_index = -1;
 	}
 	if (p_chunk->transparent_index != -1)
 	{
+		LC_World_SetDrbOwner(LC_DRB__TRANSPARENT, p_chunk->transparent_index, -1);
 		DRB_RemoveItem(&lc_world.render_data.semi_transparent_buffer, p_chunk->transparent_index);
 
 		p_chunk->transparent_index = -1;
 	}
 	if (p_chunk->water_index != -1)
 	{
+		LC_World_SetDrbOwner(LC_DRB__WATER, p_chunk->water_index, -1);
 		DRB_RemoveItem(&lc_world.render_data.water_buffer, p_chunk->water_index);
 
 		p_chunk->water_index = -1;
@@ -1261,10 +2385,14 @@ void LC_World_DeleteChunk(LC_Chunk* const p_chunk)
 	}
 	if (p_chunk->draw_cmd_index != -1)
 	{
-		LC_CombinedChunkDrawCmdData draw_data;
-		memset(&draw_data, 0, sizeof(LC_CombinedChunkDrawCmdData));
-		
-		glNamedBufferSubData(lc_world.render_data.draw_cmds_buffer.buffer, sizeof(LC_CombinedChunkDrawCmdData) * p_chunk->draw_cmd_index, sizeof(LC_CombinedChunkDrawCmdData), &draw_data);
+		//zeroed at the end of the frame with the rest of the dirty draw cmds
+		LC_DrawCmdSource* source = dA_at(lc_world.draw_cmd_sources, p_chunk->draw_cmd_index);
+		source->opaque_index = -1;
+		source->transparent_index = -1;
+		source->water_index = -1;
+		source->hidden = false;
+
+		LC_World_MarkDrawCmdDirty(p_chunk->draw_cmd_index);
 
 		RSB_FreeItem(&lc_world.render_data.draw_cmds_buffer, p_chunk->draw_cmd_index, false);
 
@@ -1283,6 +2411,12 @@ void LC_World_DeleteChunk(LC_Chunk* const p_chunk)
 
 		p_chunk->aabb_tree_index = -1;
 	}
+}
+
+void LC_World_DeleteChunk(LC_Chunk* const p_chunk)
+{
+	LC_World_ReleaseChunkRenderData(p_chunk);
+
 	//remove any light blcoks
 	if (p_chunk->light_blocks > 0)
 	{
@@ -1319,9 +2453,19 @@ void LC_World_DeleteChunk(LC_Chunk* const p_chunk)
 
 	p_chunk->is_deleted = true;
 
+	if (p_chunk->is_hidden)
+	{
+		p_chunk->is_hidden = false;
+		lc_chunk_ring.hidden_chunks--;
+	}
+
 	ivec3 hash_key;
 	LC_getNormalizedChunkPosition(p_chunk->global_position[0], p_chunk->global_position[1], p_chunk->global_position[2], hash_key);
 
+	LC_ChunkRing_Remove(hash_key);
+
+	LC_Fluids_RemoveChunk(hash_key);
+
 	//remove from hashmap
 	CHMap_Erase(&lc_world.chunk_map, hash_key);
 }
@@ -1332,10 +2476,47 @@ static void LC_World_SetupGLBindingPoints()
 	glBindBufferBase(GL_UNIFORM_BUFFER, 5, lc_world.render_data.block_data_buffer);
 }
 
-void LC_World_Create(int x_chunks, int y_chunks, int z_chunks)
+void LC_World_Create(int x_chunks, int y_chunks, int z_chunks, vec3 p_spawnPos)
 {
 	memset(&lc_world, 0, sizeof(LC_World));
 	memset(&lc_task_queue, 0, sizeof(lc_task_queue));
+	memset(&lc_startup, 0, sizeof(lc_startup));
+
+	QueryPerformanceCounter(&lc_startup.create_time);
+
+	for (int i = 0; i < LC_MAX_ACTIVE_TASKS; i++)
+	{
+		lc_task_queue.free_tasks[i] = i;
+	}
+	lc_task_queue.free_count = LC_MAX_ACTIVE_TASKS;
+
+	//+ an exit request for every worker, the edit wake ups and the lod tasks
+	MPMC_Queue_Init(&lc_task_queue.request_queue, sizeof(int), LC_MAX_ACTIVE_TASKS + LC_MAX_WORKER_THREADS + LC_MAX_EDIT_TASKS + LC_MAX_LOD_TASKS);
+	MPSC_Queue_Init(&lc_task_queue.completed_queue, sizeof(int), LC_MAX_ACTIVE_TASKS);
+
+	memset(&lc_edit_queue, 0, sizeof(lc_edit_queue));
+
+	for (int i = 0; i < LC_MAX_EDIT_TASKS; i++)
+	{
+		lc_edit_queue.free_tasks[i] = i;
+	}
+	lc_edit_queue.free_count = LC_MAX_EDIT_TASKS;
+	lc_edit_queue.requested_keys = dA_INIT(ivec3, 0);
+	lc_edit_queue.visible_edit_times = dA_INIT(int64_t, 0);
+
+	MPMC_Queue_Init(&lc_edit_queue.request_queue, sizeof(int), LC_MAX_EDIT_TASKS);
+	MPSC_Queue_Init(&lc_edit_queue.completed_queue, sizeof(int), LC_MAX_EDIT_TASKS);
+
+	LC_Fluids_Init();
+
+	LC_Lod_Init(x_chunks, z_chunks);
+
+	memset(&lc_chunk_ring, 0, sizeof(lc_chunk_ring));
+
+	LC_ChunkCache_Init();
+
+	LC_Decorations_Init();
+
 	memset(&lc_thread, 0, sizeof(lc_thread));
 	memset(&lc_prev_mined_block, 0, sizeof(lc_prev_mined_block));
 	memset(&lc_cvars, 0, sizeof(lc_cvars));
@@ -1343,6 +2524,10 @@ void LC_World_Create(int x_chunks, int y_chunks, int z_chunks)
 	lc_cvars.lc_static_world = Cvar_Register("lc_static_world", "1", NULL, CVAR__SAVE_TO_FILE, 0, 1);
 	lc_cvars.lc_dynamic_weather = Cvar_Register("lc_dynamic_weather", "0", NULL, CVAR__SAVE_TO_FILE, 0, 1);
 	lc_cvars.lc_creative = Cvar_Register("lc_creative", "1", NULL, CVAR__SAVE_TO_FILE, 0, 1);
+	lc_cvars.lc_upload_budget_kb = Cvar_Register("lc_upload_budget_kb", "1024", "Vertex data in KB that finished chunks can upload per frame", CVAR__SAVE_TO_FILE, 64, 65536);
+	lc_cvars.lc_edit_latency_report = Cvar_Register("lc_edit_latency_report", "0", "Set to 1 to print the edit to visible latency percentiles", 0, 0, 1);
+	lc_cvars.lc_edit_benchmark = Cvar_Register("lc_edit_benchmark", "0", "Set to 1 to compare a 64^3 region fill against placing the blocks one by one", 0, 0, 1);
+	lc_cvars.lc_block_benchmark = Cvar_Register("lc_block_benchmark", "0", "Set to 1 to time meshing every loaded chunk and the physics collision lookups around the player", 0, 0, 1);
 
 	lc_world.seed = 2;
 	Math_srand(lc_world.seed);
@@ -1362,16 +2547,39 @@ void LC_World_Create(int x_chunks, int y_chunks, int z_chunks)
 
 	lc_world.light_block_map = CHMAP_INIT(Hash_ivec3, NULL, ivec3, unsigned, 1);
 
-	lc_world.draw_cmd_backbuffer = dA_INIT(LC_CombinedChunkDrawCmdData, 0);
+	lc_world.draw_cmd_backbuffer = dA_INIT(LC_CombinedChunkDrawCmdData, LC_WORLD_MAX_CHUNK_LIMIT);
+	lc_world.draw_cmd_sources = dA_INIT(LC_DrawCmdSource, LC_WORLD_MAX_CHUNK_LIMIT);
+	lc_world.draw_cmd_dirty_flags = dA_INIT(uint8_t, LC_WORLD_MAX_CHUNK_LIMIT);
+	lc_world.dirty_draw_cmds = dA_INIT(int, 0);
+	lc_world.pending_chunk_data = dA_INIT(LC_PendingChunkData, 0);
+
+	dA_resize(lc_world.draw_cmd_backbuffer, LC_WORLD_MAX_CHUNK_LIMIT);
+	dA_resize(lc_world.draw_cmd_sources, LC_WORLD_MAX_CHUNK_LIMIT);
+	dA_resize(lc_world.draw_cmd_dirty_flags, LC_WORLD_MAX_CHUNK_LIMIT);
 
-	lc_world.render_data.opaque_buffer = DRB_Create(sizeof(ChunkVertex) * LC_WORLD_MAX_CHUNK_LIMIT, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA);
+	memset(lc_world.draw_cmd_backbuffer->data, 0, sizeof(LC_CombinedChunkDrawCmdData) * LC_WORLD_MAX_CHUNK_LIMIT);
+	memset(lc_world.draw_cmd_sources->data, -1, sizeof(LC_DrawCmdSource) * LC_WORLD_MAX_CHUNK_LIMIT);
+	memset(lc_world.draw_cmd_dirty_flags->data, 0, sizeof(uint8_t) * LC_WORLD_MAX_CHUNK_LIMIT);
 
-	lc_world.render_data.semi_transparent_buffer = DRB_Create(sizeof(ChunkVertex) * LC_WORLD_MAX_CHUNK_LIMIT, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA);
+	for (int i = 0; i < LC_DRB__MAX; i++)
+	{
+		lc_world.drb_owners[i] = dA_INIT(int, LC_WORLD_MAX_CHUNK_LIMIT);
+	}
+
+	memset(&lc_chunk_ring, 0, sizeof(lc_chunk_ring));
+
+	lc_world.render_data.changed_chunks = dA_INIT(ivec4, 0);
 
-	lc_world.render_data.water_buffer = DRB_Create(sizeof(ChunkWaterVertex) * 1000000, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA);
+	lc_world.render_data.opaque_buffer = DRB_Create(sizeof(ChunkVertex) * LC_WORLD_MAX_CHUNK_LIMIT, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA | DRB_FLAG__TRACK_MOVED_ITEMS);
+
+	lc_world.render_data.semi_transparent_buffer = DRB_Create(sizeof(ChunkVertex) * LC_WORLD_MAX_CHUNK_LIMIT, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA | DRB_FLAG__TRACK_MOVED_ITEMS);
+
+	lc_world.render_data.water_buffer = DRB_Create(sizeof(ChunkWaterVertex) * 1000000, LC_WORLD_MAX_CHUNK_LIMIT, DRB_FLAG__WRITABLE | DRB_FLAG__RESIZABLE | DRB_FLAG__USE_CPU_BACK_BUFFER | DRB_FLAG__POOLABLE | DRB_FLAG__POOLABLE_KEEP_DATA | DRB_FLAG__TRACK_MOVED_ITEMS);
 
 	lc_world.render_data.chunk_data_buffer = RSB_Create(LC_WORLD_MAX_CHUNK_LIMIT, sizeof(LC_ChunkData), RSB_FLAG__POOLABLE | RSB_FLAG__WRITABLE);
 
+	lc_world.upload_ring = StagingRing_Create(LC_UPLOAD_RING_SIZE);
+
 	lc_world.render_data.draw_cmds_buffer = RSB_Create(LC_WORLD_MAX_CHUNK_LIMIT, sizeof(LC_CombinedChunkDrawCmdData), RSB_FLAG__POOLABLE | RSB_FLAG__WRITABLE);
 	
 	glGenVertexArrays(1, &lc_world.render_data.vao);
@@ -1396,7 +2604,7 @@ void LC_World_Create(int x_chunks, int y_chunks, int z_chunks)
 	glBindVertexArray(lc_world.render_data.water_vao);
 	glBindBuffer(GL_ARRAY_BUFFER, lc_world.render_data.water_buffer.buffer);
 
-	glVertexAttribIPointer(0, 2, GL_BYTE, sizeof(ChunkWaterVertex), (void*)0);
+	glVertexAttribIPointer(0, 3, GL_BYTE, sizeof(ChunkWaterVertex), (void*)0);
 	glEnableVertexAttribArray(0);
 	glVertexAttribBinding(0, 0);
 
@@ -1415,96 +2623,110 @@ void LC_World_Create(int x_chunks, int y_chunks, int z_chunks)
 		glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(unsigned), NULL, GL_STATIC_DRAW);
 	}
 
+	glGenBuffers(1, &lc_world.render_data.occlusion_counters_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lc_world.render_data.occlusion_counters_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LC_OcclusionCounters), NULL, GL_DYNAMIC_DRAW);
+
 	glGenBuffers(1, &lc_world.render_data.draw_cmds_sorted_buffer);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lc_world.render_data.draw_cmds_sorted_buffer);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LC_CombinedChunkDrawCmdData) * (LC_WORLD_MAX_CHUNK_LIMIT * 10), NULL, GL_STATIC_DRAW);
 
+	LC_Horizon_Init();
+
 	lc_world.render_data.block_data_buffer = LC_generateBlockInfoGLBuffer();
 
 	LC_World_SetupGLBindingPoints();
 
-	printf("Generating chunks...\n");
-	//Generate the chunks
+	//leave a core for the main thread
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+
+	int worker_count = (int)sys_info.dwNumberOfProcessors - 1;
+	worker_count = max(worker_count, 1);
+	worker_count = min(worker_count, LC_MAX_WORKER_THREADS);
+
+	printf("Starting %i lc threads...\n", worker_count);
+
+	for (int i = 0; i < worker_count; i++)
+	{
+		HANDLE handle = CreateThread(NULL, 0, LC_World_ThreadProcess, NULL, 0, NULL);
+
+		if (!handle)
+		{
+			break;
+		}
+
+		lc_thread.win_handles[lc_thread.worker_count++] = handle;
+	}
+
+	//queue the initial world, nearest to the spawn point first
+	LC_getNormalizedChunkPosition(p_spawnPos[0], p_spawnPos[1], p_spawnPos[2], lc_startup.spawn_key);
+
+	lc_startup.keys = dA_INIT(ivec3, x_chunks * y_chunks * z_chunks);
+
 	for (int x = 0; x < x_chunks; x++)
 	{
 		for (int z = 0; z < z_chunks; z++)
 		{
 			for (int y = 0; y < y_chunks; y++)
 			{
-				LC_Chunk stack_chunk = LC_Chunk_Create(x * LC_CHUNK_WIDTH, y * LC_CHUNK_HEIGHT, z * LC_CHUNK_LENGTH);
-				//Generate the chunk
-				LC_Chunk_GenerateBlocks(&stack_chunk, 2);
+				ivec3 key;
+				key[0] = x;
+				key[1] = y;
+				key[2] = z;
 
-				//add to the hash map
-				if (stack_chunk.alive_blocks > 0)
-				{	
-					//printf("Generated chunk: %i :opaque blocks, %i :transparent blocks %i water blocks\n", stack_chunk.opaque_blocks, stack_chunk.transparent_blocks, stack_chunk.water_blocks);
+				dA_emplaceBackData(lc_startup.keys, key);
 
-					LC_Chunk* chunk = LC_World_InsertChunk(&stack_chunk, x * LC_CHUNK_WIDTH, y * LC_CHUNK_HEIGHT, z * LC_CHUNK_LENGTH);
-					if (chunk)
-					{
-						LC_World_UpdateChunk(chunk, NULL);
-					}
-					
+				if (LC_World_isSpawnChunkKey(key))
+				{
+					lc_startup.spawn_chunks_left++;
 				}
-
 			}
 		}
 	}
+	lc_startup.total = dA_size(lc_startup.keys);
 
+	qsort(lc_startup.keys->data, lc_startup.total, sizeof(ivec3), LC_World_CompareStartupKeys);
 
+	printf("Generating chunks...\n");
 
-	DRB_WriteDataToGpu(&lc_world.render_data.opaque_buffer);
-	DRB_WriteDataToGpu(&lc_world.render_data.semi_transparent_buffer);
-	DRB_WriteDataToGpu(&lc_world.render_data.water_buffer);
+	//only wait for the spawn area, LC_World_StartFrame streams in the rest
+	if (lc_thread.worker_count > 0)
+	{
+		while (lc_startup.spawn_chunks_left > 0)
+		{
+			LC_World_QueueStartupChunks();
+			LC_World_ProcessTaskQueue(SIZE_MAX, true);
+		}
+	}
+	else
+	{
+		printf("Failed to start lc threads\n");
+	}
 
 	//Load the textures
-	lc_world.render_data.texture_atlas = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE);
-	lc_world.render_data.texture_atlas_normals = Resource_get("assets/cube_textures/simple_block_atlas_normal.png", RESOURCE__TEXTURE);
-	lc_world.render_data.texture_atlas_mer = Resource_get("assets/cube_textures/simple_block_atlas_mer.png", RESOURCE__TEXTURE);
-	lc_world.render_data.texture_atlas_height = Resource_get("assets/cube_textures/simple_block_atlas_heightmap.png", RESOURCE__TEXTURE);
+	lc_world.render_data.texture_atlas = Resource_get("assets/cube_textures/simple_block_atlas.png", RESOURCE__TEXTURE_BC7);
+	lc_world.render_data.texture_atlas_normals = Resource_get("assets/cube_textures/simple_block_atlas_normal.png", RESOURCE__TEXTURE_BC5);
+	lc_world.render_data.texture_atlas_mer = Resource_get("assets/cube_textures/simple_block_atlas_mer.png", RESOURCE__TEXTURE_BC7);
+	lc_world.render_data.texture_atlas_height = Resource_get("assets/cube_textures/simple_block_atlas_heightmap.png", RESOURCE__TEXTURE_BC4);
 
-	lc_world.render_data.water_displacement_texture = Resource_get("assets/water/water_displacement.png", RESOURCE__TEXTURE);
+	lc_world.render_data.water_displacement_texture = Resource_get("assets/water/water_displacement.png", RESOURCE__TEXTURE_BC5);
 	lc_world.render_data.gradient_map = Resource_get("assets/water/gradient_map.png", RESOURCE__TEXTURE);
 
-	//setup mipmaps for the textures
-	glBindTexture(GL_TEXTURE_2D, lc_world.render_data.texture_atlas->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LOD, 2);
-	glGenerateTextureMipmap(lc_world.render_data.texture_atlas->id);
+	//the compressed atlases come with their mip chains from the texture cache
+	glTextureParameteri(lc_world.render_data.texture_atlas->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(lc_world.render_data.texture_atlas->id, GL_TEXTURE_MAX_LOD, 2);
 
-	glBindTexture(GL_TEXTURE_2D, lc_world.render_data.texture_atlas_normals->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glGenerateTextureMipmap(lc_world.render_data.texture_atlas_normals->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LOD, 2);
+	glTextureParameteri(lc_world.render_data.texture_atlas_normals->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(lc_world.render_data.texture_atlas_normals->id, GL_TEXTURE_MAX_LOD, 2);
 
-	glBindTexture(GL_TEXTURE_2D, lc_world.render_data.texture_atlas_mer->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glGenerateTextureMipmap(lc_world.render_data.texture_atlas_mer->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LOD, 2);
+	glTextureParameteri(lc_world.render_data.texture_atlas_mer->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(lc_world.render_data.texture_atlas_mer->id, GL_TEXTURE_MAX_LOD, 2);
 
 	glBindTexture(GL_TEXTURE_2D, lc_world.render_data.water_displacement_texture->id);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	printf("Starting lc thread...\n");
-
-	LPDWORD id = 0;
-	lc_thread.win_handle = CreateThread
-	(
-		NULL,
-		0,
-		(LPTHREAD_START_ROUTINE)LC_World_ThreadProcess,
-		0,
-		0,
-		&id
-	);
-
-	if (!lc_thread.win_handle)
-	{
-		return false;
-	}
-
 	lc_world.creative_mode_on = true;
 
 }
@@ -1513,12 +2735,48 @@ void LC_World_Exit()
 {
 	lc_thread.force_exit = true;
 
-	WaitForSingleObject(lc_thread.win_handle, INFINITY);
-	
-	if (lc_thread.win_handle)
+	//wake up the workers if they are sleeping on the queue, one exit request each
+	int exit_request = LC_TASK_EXIT_REQUEST;
+	for (int i = 0; i < lc_thread.worker_count; i++)
+	{
+		MPMC_Queue_Push(&lc_task_queue.request_queue, &exit_request);
+	}
+	for (int i = 0; i < lc_thread.worker_count; i++)
+	{
+		WaitForSingleObject(lc_thread.win_handles[i], INFINITE);
+		CloseHandle(lc_thread.win_handles[i]);
+	}
+
+	//meshes of tasks that finished after the last frame
+	int index = 0;
+	while (MPSC_Queue_Pop(&lc_task_queue.completed_queue, &index))
 	{
-		CloseHandle(lc_thread.win_handle);
+		LC_World_FreeVerticesResult(lc_task_queue.task_list[index].vertices_result);
+		free(lc_task_queue.task_list[index].decorations);
+		free(lc_task_queue.task_list[index].spills);
 	}
+	while (MPSC_Queue_Pop(&lc_edit_queue.completed_queue, &index))
+	{
+		LC_World_FreeVerticesResult(lc_edit_queue.task_list[index].vertices_result);
+	}
+
+	MPMC_Queue_Destruct(&lc_task_queue.request_queue);
+	MPSC_Queue_Destruct(&lc_task_queue.completed_queue);
+	MPMC_Queue_Destruct(&lc_edit_queue.request_queue);
+	MPSC_Queue_Destruct(&lc_edit_queue.completed_queue);
+
+	LC_Lod_Exit();
+
+	LC_ChunkCache_Exit();
+
+	LC_Decorations_Exit();
+
+	dA_Destruct(lc_edit_queue.requested_keys);
+	dA_Destruct(lc_edit_queue.visible_edit_times);
+
+	dA_Destruct(lc_startup.keys);
+
+	LC_Fluids_Exit();
 
 	PhysicsWorld_Destruct(lc_world.phys_world);
 
@@ -1529,6 +2787,16 @@ void LC_World_Exit()
 	CHMap_Destruct(&lc_world.light_block_map);
 
 	dA_Destruct(lc_world.draw_cmd_backbuffer);
+	dA_Destruct(lc_world.draw_cmd_sources);
+	dA_Destruct(lc_world.draw_cmd_dirty_flags);
+	dA_Destruct(lc_world.dirty_draw_cmds);
+	dA_Destruct(lc_world.pending_chunk_data);
+
+	for (int i = 0; i < LC_DRB__MAX; i++)
+	{
+		dA_Destruct(lc_world.drb_owners[i]);
+	}
+	dA_Destruct(lc_world.render_data.changed_chunks);
 
 	//destruct the GL Buffers
 	DRB_Destruct(&lc_world.render_data.opaque_buffer);
@@ -1536,6 +2804,9 @@ void LC_World_Exit()
 	DRB_Destruct(&lc_world.render_data.water_buffer);
 	RSB_Destruct(&lc_world.render_data.draw_cmds_buffer);
 	RSB_Destruct(&lc_world.render_data.chunk_data_buffer);
+	StagingRing_Destruct(&lc_world.upload_ring);
+
+	LC_Horizon_Exit();
 
 	BVH_Tree_Destruct(&lc_world.render_data.bvh_tree);
 }
@@ -1549,17 +2820,48 @@ void LC_World_StartFrame()
 	//update scene enviroment, sun, sky color, etc..
 	LC_World_UpdateWorldEnviroment();
 	
+	if (lc_cvars.lc_edit_benchmark->modified)
+	{
+		if (lc_cvars.lc_edit_benchmark->int_value == 1)
+		{
+			LC_World_EditBenchmark(64);
+			Cvar_setValueDirectInt(lc_cvars.lc_edit_benchmark, 0);
+		}
+		lc_cvars.lc_edit_benchmark->modified = false;
+	}
+	if (lc_cvars.lc_block_benchmark->modified)
+	{
+		if (lc_cvars.lc_block_benchmark->int_value == 1)
+		{
+			LC_World_BlockBenchmark(64);
+			Cvar_setValueDirectInt(lc_cvars.lc_block_benchmark, 0);
+		}
+		lc_cvars.lc_block_benchmark->modified = false;
+	}
+
+	//the rest of the initial world
+	LC_World_QueueStartupChunks();
+
 	//create chunks nearby player
 	if (lc_cvars.lc_static_world->int_value == 0)
 	{
 		LC_World_CreateNearbyChunks();
-
-		//process finished tasks
-		LC_World_ProcessTaskQueue();
 	}
 
-	//remove far away chunks and update the draw cmd backbuffer
-	LC_World_IterateChunks();
+	//process finished tasks
+	LC_World_ProcessTaskQueue((size_t)lc_cvars.lc_upload_budget_kb->int_value * 1024, false);
+
+	//remove chunks that left the render distance
+	LC_World_UnloadFarChunks();
+
+	//decorations of chunks that are far away for good
+	LC_World_PruneDecorations();
+
+	//distant terrain, gets what is left of the upload budget
+	LC_Lod_Update((size_t)lc_cvars.lc_upload_budget_kb->int_value * 1024);
+
+	//terrain past the distant terrain
+	LC_Horizon_Update();
 
 	
 	lc_world.time += Core_getDeltaTime();
@@ -1573,13 +2875,22 @@ void LC_World_StartFrame()
 }
 void LC_World_EndFrame()
 {
-	DRB_WriteDataToGpu(&lc_world.render_data.opaque_buffer);
-	DRB_WriteDataToGpu(&lc_world.render_data.semi_transparent_buffer);
-	DRB_WriteDataToGpu(&lc_world.render_data.water_buffer);
+	//edits that finished meshing this frame go up with the rest
+	LC_World_ProcessFinishedEdits();
 
+	//all of the frame's uploads are copied from the staging ring, then fenced together
+	DRB_WriteDataToGpuStaged(&lc_world.render_data.opaque_buffer, &lc_world.upload_ring);
+	DRB_WriteDataToGpuStaged(&lc_world.render_data.semi_transparent_buffer, &lc_world.upload_ring);
+	DRB_WriteDataToGpuStaged(&lc_world.render_data.water_buffer, &lc_world.upload_ring);
+
+	LC_World_UploadChunkData();
 	LC_World_UpdateDrawCmds();
 
-	lc_world.player_action_this_frame = false;
+	StagingRing_EndFrame(&lc_world.upload_ring);
+
+	LC_World_RecordEditLatency();
+
+	lc_world.frame_upload_bytes = 0;
 }
 
 LC_WorldRenderData* LC_World_getRenderData()
@@ -1591,82 +2902,73 @@ PhysicsWorld* LC_World_GetPhysWorld()
 	return lc_world.phys_world;
 }
 
-static int LC_World_calcWaterLevelInsideChunk(LC_Chunk* const p_chunk, float p_y)
+int LC_World_calcWaterLevelFromPoint(float p_x, float p_y, float p_z)
 {
-	if (p_chunk->water_blocks <= 0)
-	{
-		return 0;
-	}
-
-	int water_level = 0;
-
-	if (p_y <= p_chunk->global_position[1] + (LC_CHUNK_HEIGHT * 0.8))
-	{
-		water_level++;
-	}
-	if (p_y <= p_chunk->global_position[1] + (LC_CHUNK_HEIGHT * 0.7))
-	{
-		water_level++;
-	}
-	if (p_y <= p_chunk->global_position[1] + (LC_CHUNK_HEIGHT * 0.6))
-	{
-		water_level++;
-	}
-	if (p_y <= p_chunk->global_position[1] + (LC_CHUNK_HEIGHT * 0.5))
-	{
-		water_level++;
-	}
-
-	return water_level;
-}
+	int g_x = roundf(p_x);
+	int g_y = roundf(p_y);
+	int g_z = roundf(p_z);
 
+	ivec3 chunk_key;
+	LC_getNormalizedChunkPosition(g_x, g_y, g_z, chunk_key);
 
-int LC_World_calcWaterLevelFromPoint(float p_x, float p_y, float p_z)
-{
-	LC_Chunk* point_chunk = LC_World_GetChunk(p_x, p_y, p_z);
+	LC_Chunk* chunk = CHMap_Find(&lc_world.chunk_map, chunk_key);
 
-	if (!point_chunk)
+	if (!chunk || chunk->water_blocks <= 0)
 	{
 		return 0;
 	}
-	if (point_chunk->water_blocks <= 0)
+
+	int x = g_x - chunk->global_position[0];
+	int y = g_y - chunk->global_position[1];
+	int z = g_z - chunk->global_position[2];
+
+	//above the surface, or in a dry pocket under it
+	if (chunk->water_surface[x][z] < y || !LC_IsBlockWater(chunk->blocks[x][y][z].type))
 	{
 		return 0;
 	}
-	int water_level = LC_World_calcWaterLevelInsideChunk(point_chunk, p_y);
 
-	LC_Chunk* above_chunk = NULL;
+	int surface_y = chunk->water_surface[x][z] + chunk->global_position[1];
 
-	for (int i = 0; i < 4; i++)
+	//water up to the top of the chunk goes on in the chunk above
+	while (chunk->water_surface[x][z] == LC_CHUNK_HEIGHT - 1)
 	{
-		above_chunk = LC_World_GetChunk(p_x, p_y + (i * LC_CHUNK_HEIGHT), p_z);
+		chunk_key[1]++;
+		chunk = CHMap_Find(&lc_world.chunk_map, chunk_key);
 
-		if (!above_chunk)
+		if (!chunk || !LC_IsBlockWater(chunk->blocks[x][0][z].type))
 		{
 			break;
 		}
-		ivec3 norm_position;
-		LC_getNormalizedChunkPosition(p_x, p_y, p_z, norm_position);
-		int x = norm_position[0] - above_chunk->global_position[0];
-		int z = norm_position[2] - above_chunk->global_position[2];
 
-		if (above_chunk->water_blocks > 0 && LC_IsBlockWater(LC_Chunk_getType(above_chunk, x, 0, z)))
-		{
-			water_level += LC_World_calcWaterLevelInsideChunk(above_chunk, p_y);
-		}
-		else
-		{
-			break;
-		}
+		surface_y = chunk->water_surface[x][z] + chunk->global_position[1];
 	}
 
-	return water_level;
+	//same steps as the old chunk height fractions with the surface at the top of the chunk,
+	//the first level is 0.2 of a chunk under the top of the surface block and then one every 0.1 of a chunk
+	float depth = (surface_y + 0.5f) - p_y;
+	int water_level = (int)((depth + 0.5f) / (LC_CHUNK_HEIGHT * 0.1f)) - 1;
+
+	return max(water_level, 0);
 }
 
 size_t LC_World_GetDrawCmdAmount()
 {
 	return lc_world.render_data.draw_cmds_buffer.used_size;
 }
+LC_ChunkCacheStats LC_World_GetChunkCacheStats()
+{
+	LC_ChunkCacheStats stats;
+	stats.resident_chunks = (int)lc_world.num_alive_chunks;
+	stats.hidden_chunks = lc_chunk_ring.hidden_chunks;
+	LC_ChunkCache_GetStats(&stats);
+
+	return stats;
+}
+bool LC_World_IsStatic()
+{
+	return lc_cvars.lc_static_world->int_value != 0;
+}
 int LC_World_getPrevMinedBlockHP()
 {
 	return lc_prev_mined_block.hp;
@@ -12,6 +12,41 @@
 #include "physics/physics_world.h"
 #include "render/r_texture.h"
 
+//Must match process_chunks.comp
+typedef struct
+{
+	unsigned disoccluded_opaque; //draw count of the second phase opaque list
+	unsigned disoccluded_transparent; //draw count of the second phase transparent list
+	unsigned culled_chunks;
+	unsigned saved_draw_cmds;
+	unsigned disoccluded_chunks;
+} LC_OcclusionCounters;
+
+#define LC_HORIZON_LEVELS 3
+#define LC_HORIZON_GRID_SIZE 64 //vertices per side of a clipmap level, a power of two
+
+typedef struct
+{
+	ivec2 origin; //grid position of the first vertex, in cells of the level
+	float cell_size; //blocks
+	vec4 hole_box; //min x, min z, max x, max z in blocks, drawn by the finer levels or the chunks
+	bool ready;
+} LC_HorizonLevel;
+
+/*
+	Low poly terrain past the chunks, made from the 2d surface height only. Every level is a grid around the player
+	with twice the cell size of the previous one
+*/
+typedef struct
+{
+	LC_HorizonLevel levels[LC_HORIZON_LEVELS];
+	unsigned height_texture; //RG32F array, surface height and block type, a layer per level
+	unsigned vao;
+	unsigned index_buffer;
+	unsigned index_count;
+	bool enabled;
+} LC_HorizonRenderData;
+
 typedef struct
 {
 	DynamicRenderBuffer opaque_buffer;
@@ -28,9 +63,12 @@ typedef struct
 	unsigned prev_in_frustrum_bitset_buffer;
 	unsigned visibles_sorted_buffer;
 	unsigned atomic_counters[3];
+	unsigned occlusion_counters_buffer; //LC_OcclusionCounters
 	unsigned block_data_buffer;
 	unsigned draw_cmds_sorted_buffer;
 
+	dynamic_array* changed_chunks; //ivec4 global positions and sizes of chunks remeshed or deleted since the renderer last consumed them
+
 	R_Texture* texture_atlas;
 	R_Texture* texture_atlas_normals;
 	R_Texture* texture_atlas_mer;
@@ -38,6 +76,8 @@ typedef struct
 
 	R_Texture* water_displacement_texture;
 	R_Texture* gradient_map;
+
+	LC_HorizonRenderData horizon;
 } LC_WorldRenderData;
 
 typedef struct
@@ -50,10 +90,16 @@ typedef struct
 
 	LC_WorldRenderData render_data;
 
-	dynamic_array* draw_cmd_backbuffer;
+	dynamic_array* draw_cmd_backbuffer; //cpu copy of the draw cmds buffer, indexed by draw_cmd_index
+	dynamic_array* draw_cmd_sources; //LC_DrawCmdSource per draw_cmd_index
+	dynamic_array* draw_cmd_dirty_flags; //uint8_t per draw_cmd_index
+	dynamic_array* dirty_draw_cmds; //draw_cmd_indexes to rebuild and upload at the end of the frame
+	dynamic_array* drb_owners[3]; //draw_cmd_index of every opaque, transparent and water DRB item, -1 if unused
+	dynamic_array* pending_chunk_data; //chunk data entries to upload at the end of the frame
+
+	StagingRing upload_ring;
+	size_t frame_upload_bytes; //vertex bytes changed this frame, checked against lc_upload_budget_kb
 
-	bool require_draw_cmd_update;
-	bool player_action_this_frame;
 	float time;
 
 	PhysicsWorld* phys_world;
@@ -69,10 +115,31 @@ typedef struct
 	int water_index;
 } LC_TreeData;
 
+//The DRB items a draw cmd is built from
+typedef struct
+{
+	int opaque_index;
+	int transparent_index;
+	int water_index;
+	bool hidden; //the chunk is past the render distance, the draw cmd is left empty
+} LC_DrawCmdSource;
+
+typedef struct
+{
+	int resident_chunks; //chunks with blocks in the world
+	int hidden_chunks; //resident, but past the render distance
+	int cached_chunks;
+	size_t cached_bytes;
+	size_t budget_bytes;
+	unsigned hits;
+	unsigned misses;
+} LC_ChunkCacheStats;
+
 typedef struct
 {
 	vec4 min_point;
 	unsigned vis_flags;
+	float scale; //size of a block, 1 << lod_level
 }  LC_ChunkData;
 
 typedef struct
@@ -92,17 +159,21 @@ typedef struct
 
 LC_Chunk* LC_World_GetChunk(float p_x, float p_y, float p_z);
 LC_Block* LC_World_GetBlock(float p_x, float p_y, float p_z, ivec3 r_relativePos, LC_Chunk** r_chunk);
+void LC_World_GetBlockTypes(const float* p_x, const float* p_y, const float* p_z, int p_count, uint8_t* r_types);
 LC_Block* LC_World_getBlockByRay(vec3 from, vec3 dir, int max_steps, ivec3 r_pos, ivec3 r_face, LC_Chunk** r_chunk);
 bool LC_World_addBlock(int p_gX, int p_gY, int p_gZ, ivec3 p_addFace, LC_BlockType block_type);
 bool LC_World_mineBlock(int p_gX, int p_gY, int p_gZ);
 
+void LC_World_EditBenchmark(int p_size);
+void LC_World_BlockBenchmark(int p_probeSize);
+
 bool LC_World_ChunkExists(float p_x, float p_y, float p_z);
 void LC_World_UpdateChunk(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* vertices_result);
 void LC_World_UpdateChunkIndexes(LC_Chunk* const p_chunk);
 bool LC_World_UpdateChunkVertices(LC_Chunk* const p_chunk, GeneratedChunkVerticesResult* p_vertices_result);
 void LC_World_DeleteChunk(LC_Chunk* const p_chunk);
 
-void LC_World_Create(int x_chunks, int y_chunks, int z_chunks);
+void LC_World_Create(int x_chunks, int y_chunks, int z_chunks, vec3 p_spawnPos);
 void LC_World_Exit();
 
 void LC_World_StartFrame();
@@ -114,6 +185,7 @@ PhysicsWorld* LC_World_GetPhysWorld();
 int LC_World_calcWaterLevelFromPoint(float p_x, float p_y, float p_z);
 
 size_t LC_World_GetDrawCmdAmount();
+LC_ChunkCacheStats LC_World_GetChunkCacheStats();
 int LC_World_getPrevMinedBlockHP();
 bool LC_World_IsCreativeModeOn();
 
@@ -0,0 +1,33 @@
+#ifndef LC_WORLD_INTERNAL_H
+#define LC_WORLD_INTERNAL_H
+#pragma once
+
+#include "lc/lc_world.h"
+
+/*
+	Shared by lc_world.c and the parts of the world that live in their own files.
+	The rest of the game only uses lc_world.h
+*/
+
+#define LC_RENDER_DISTANCE_CHUNKS 8
+#define LC_RENDER_DISTANCE_VERTICAL_CHUNKS 4
+
+extern LC_World lc_world;
+
+bool LC_World_IsStatic(); //lc_static_world, the whole world is loaded and drawn
+bool LC_World_isChunkKeyInBounds(const ivec3 p_key, ivec3 p_bounds[2]); //bounds are min and max chunk keys
+
+LC_Chunk* LC_World_InsertChunk(LC_Chunk* p_chunk); //copies the chunk into the chunk map, NULL if it's full
+void LC_World_FreeVerticesResult(GeneratedChunkVerticesResult* p_vertices_result);
+void LC_World_CreateLightBlock(int p_x, int p_y, int p_z, LC_Block_LightData light_data);
+void LC_World_DestroyLightBlock(int p_x, int p_y, int p_z);
+
+//blocks of a chunk were changed in place, it's remeshed on the edit lane once the remeshes are submitted
+void LC_World_QueueChunkRemesh(LC_Chunk* const p_chunk);
+void LC_World_SubmitRemeshes();
+void LC_World_QueueChunkEdit(LC_Chunk* const p_chunk); //a hand edit, queues and submits the remesh
+
+void LC_World_ReleaseChunkRenderData(LC_Chunk* const p_chunk);
+void LC_World_RequestLodTask(int p_index); //LC_Lod_RunTask is called on a worker
+
+#endif // !LC_WORLD_INTERNAL_H
@@ -1,12 +1,22 @@
 
 #include <Windows.h>
+#include <string.h>
 
 extern int Core_entry();
+extern int LC_BuildTextureCache();
 
 
 #ifdef DEBUG
-int main()
+int main(int argc, char** argv)
 {
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-build_texture_cache"))
+		{
+			return LC_BuildTextureCache();
+		}
+	}
+
 	int error = Core_entry();
 
 	return error;
@@ -14,10 +24,13 @@ int main()
 #else
 int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hInstPrev, PSTR cmdline, int cmdshow)
 {
+	if (cmdline && strstr(cmdline, "-build_texture_cache"))
+	{
+		return LC_BuildTextureCache();
+	}
+
 	int error = Core_entry();
 
 	return error;
 }
 #endif
-
-
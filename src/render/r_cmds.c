@@ -14,11 +14,16 @@
 
 extern R_Scene scene;
 extern R_StorageBuffers storage;
-extern R_CMD_Buffer* cmdBuffer;
 extern RDraw_DrawData* drawData;
 extern RPass_PassData* pass;
 extern R_BackendData* backend_data;
 extern R_Cvars r_cvars;
+extern R_Metrics metrics;
+
+extern void RParticles_BeginJobs();
+extern void RParticles_AddEmitterJobs(ParticleEmitterSettings* const p_emitter, double p_eDelta, double p_prevTime, double p_systemTime, bool p_draw, int p_textureIndex, M_Rect2Df p_textureRegion);
+extern void RParticles_RunJobs(int p_maxWorkerThreads);
+extern void RParticles_GatherInstances();
 
 static void DecimalColorTo8Bit(vec4 src, uint8_t dest[4])
 {
@@ -390,97 +395,108 @@ static void Process_Cube(vec3 box[2], vec4 color, R_Texture* p_tex, M_Rect2Df p_
     drawData->cube.instance_count++;
 }
 
-static void Process_AddParticleToQuadInstances(ParticleCpu* const particle, mat4 matrix, M_Rect2Df textureRegion, int textureIndex)
+static void Process_ParticleEmitterToGL(ParticleEmitterSettings* const p_emitter, ParticleEmitterGL* const p_dest, double p_eDelta, double p_prevTime, double p_systemTime, bool p_draw, int p_textureIndex, M_Rect2Df p_textureRegion)
 {
-    mat4 transposed_matrix;
-    glm_mat4_transpose_to(matrix, transposed_matrix);
-
-    float instance_uv[4];
-    instance_uv[0] = textureRegion.x;
-    instance_uv[1] = textureRegion.y;
-    instance_uv[2] = textureRegion.width;
-    instance_uv[3] = textureRegion.height;
-
-    float custom[4];
-    custom[0] = textureIndex;
-    custom[1] = 1;
-    custom[2] = 2;
-    custom[3] = 3;
+    p_dest->state_flags = EMITTER_STATE_FLAG__EMITTING;
+    if (!p_draw)
+    {
+        p_dest->state_flags |= EMITTER_STATE_FLAG__SKIP_DRAW;
+    }
 
-    dA_emplaceBackMultipleData(drawData->particles.instance_buffer, 4 * 3, transposed_matrix);
-    dA_emplaceBackMultipleData(drawData->particles.instance_buffer, 4, instance_uv);
-    dA_emplaceBackMultipleData(drawData->particles.instance_buffer, 4, particle->color);
-    dA_emplaceBackMultipleData(drawData->particles.instance_buffer, 4, custom);
+    p_dest->settings_flags = EMITTER_SETTINGS_FLAG__NONE;
+    if (p_emitter->one_shot)
+    {
+        p_dest->settings_flags |= EMITTER_SETTINGS_FLAG__ONE_SHOT;
+    }
+    //the gpu path collides against the depth buffer instead of calling the collision function
+    if (p_emitter->collision_function)
+    {
+        p_dest->settings_flags |= EMITTER_SETTINGS_FLAG__COLLISION;
+    }
 
-    drawData->particles.instance_count++;
+    glm_mat4_copy(p_emitter->xform, p_dest->xform);
+    glm_vec3_copy(p_emitter->aabb[0], p_dest->aabb[0]);
+    glm_vec3_copy(p_emitter->aabb[1], p_dest->aabb[1]);
+    glm_vec3_copy(p_emitter->direction, p_dest->direction);
+    glm_vec4_copy(p_emitter->color, p_dest->color);
+    glm_vec4_copy(p_emitter->end_color, p_dest->end_color);
+    glm_vec4_copy(p_emitter->emission_size, p_dest->emission_size);
+
+    p_dest->delta = p_eDelta;
+    p_dest->time = p_emitter->_time;
+    p_dest->prev_time = p_prevTime;
+    p_dest->system_time = p_systemTime;
+    p_dest->cycle = p_emitter->_cycle;
+
+    p_dest->explosiveness = p_emitter->explosiveness;
+    p_dest->randomness = p_emitter->randomness;
+    p_dest->life_time = p_emitter->life_time;
+    p_dest->speed_scale = p_emitter->speed_scale;
+    p_dest->initial_velocity = p_emitter->initial_velocity;
+    p_dest->spread = p_emitter->spread;
+    p_dest->flatness = p_emitter->flatness;
+    p_dest->gravity = p_emitter->gravity;
+    p_dest->friction = p_emitter->friction;
+    p_dest->linear_accel = p_emitter->linear_accel;
+    p_dest->scale = p_emitter->scale;
+
+    p_dest->emission_shape = p_emitter->emission_shape;
+    p_dest->texture_index = p_textureIndex;
+
+    p_dest->texture_region[0] = p_textureRegion.x;
+    p_dest->texture_region[1] = p_textureRegion.y;
+    p_dest->texture_region[2] = p_textureRegion.width;
+    p_dest->texture_region[3] = p_textureRegion.height;
 }
 
-static void Process_ParticleCollideWithWorld(ParticleCpu* const particle, ParticleEmitterSettings* emitter)
+static void Process_ParticleGpuRebuild()
 {
-    vec3 normal_vel;
-    glm_vec3_normalize_to(particle->velocity, normal_vel);
+    //Every particle keeps a fixed slot in the gpu particle buffer, so when the layout changes
+    //the slots are reassigned and all particles restart
+    RDraw_ParticleData* data = &drawData->particles;
+
+    dA_clear(data->gpu_rebuild_particles);
 
-    LC_Chunk* chunk;
-    ivec3 relative_block_pos;
+    if (data->gpu_particle_amount <= 0)
+    {
+        return;
+    }
 
-    LC_Block* block = LC_World_GetBlock(particle->xform[3][0] + (normal_vel[0] * emitter->scale), particle->xform[3][1] + (normal_vel[1] * emitter->scale),
-        particle->xform[3][2] + (normal_vel[2] * emitter->scale), relative_block_pos, &chunk);
+    Particle* particles = dA_emplaceBackMultiple(data->gpu_rebuild_particles, data->gpu_particle_amount);
 
-    if (block && LC_isBlockCollidable(block->type) && particle->time > 0.2)
+    if (!particles)
     {
-        ivec3 relative_particle_position;
-        relative_particle_position[0] = roundf(particle->xform[3][0]) - chunk->global_position[0];
-        relative_particle_position[1] = roundf(particle->xform[3][1]) - chunk->global_position[1];
-        relative_particle_position[2] = roundf(particle->xform[3][2]) - chunk->global_position[2];
+        return;
+    }
 
-        vec3 normal;
-        glm_vec3_zero(normal);
+    for (int i = 0; i < data->gpu_emitter_amount; i++)
+    {
+        ParticleEmitterGL* gpu_emitter = dA_at(data->gpu_emitters, i);
 
-        if (relative_particle_position[0] > relative_block_pos[0])
+        for (unsigned k = 0; k < gpu_emitter->particle_amount; k++)
         {
-            normal[0] = 1;
-        }
-        else if (relative_particle_position[0] < relative_block_pos[0])
-        {
-            normal[0] = -1;
-        }
-        else if (relative_particle_position[1] > relative_block_pos[1])
-        {
-            normal[1] = 1;
-        }
-        else if (relative_particle_position[1] < relative_block_pos[1])
-        {
-            normal[1] = -1;
-        }
-        else if (relative_particle_position[2] > relative_block_pos[2])
-        {
-            normal[2] = 1;
-        }
-        else if (relative_particle_position[2] < relative_block_pos[2])
-        {
-            normal[2] = -1;
-        }
+            Particle* particle = &particles[gpu_emitter->particle_offset + k];
 
-        vec3 reflect;
-        float normal_dot = glm_dot(normal, particle->velocity);
-        reflect[0] = particle->velocity[0] - 2.0 * normal_dot * normal[0];
-        reflect[1] = particle->velocity[1] - 2.0 * normal_dot * normal[1];
-        reflect[2] = particle->velocity[2] - 2.0 * normal_dot * normal[2];
-
-        particle->velocity[0] = reflect[0] * 0.5;
-        particle->velocity[1] = reflect[1] * 0.5;
-        particle->velocity[2] = reflect[2] * 0.5;
+            particle->emitter_index = i;
+            particle->local_index = k;
+        }
     }
 }
 
 static void Process_ParticleSystemUpdate()
 {
     //mainly inspired by godot's particle system https://github.com/godotengine/godot/blob/4.3/scene/3d/cpu_particles_3d.cpp#L657
+    //Emitter state is updated here, the particles themselves are simulated in batched jobs (r_particles.c)
+    //or in a compute shader when r_particleGpu is set
     dA_clear(drawData->particles.instance_buffer);
-
-    const vec3 up = { 0.0, 1.0, 0.0 };
+    dA_clear(drawData->particles.gpu_emitters);
 
     const double delta = Core_getDeltaTime();
+    const bool use_gpu = (r_cvars.r_particleGpu->int_value == 1);
+
+    int gpu_particle_offset = 0;
+
+    RParticles_BeginJobs();
 
     FL_Node* emitter_node = storage.particle_emitter_clients->next;
 
@@ -492,6 +508,31 @@ static void Process_ParticleSystemUpdate()
         M_Rect2Df texture_region;
         memset(&texture_region, 0, sizeof(M_Rect2Df));
 
+        ParticleEmitterGL* gpu_emitter = NULL;
+
+        //every emitter gets a gpu slot, even if it's not emitting, so that the particle slots stay stable
+        if (use_gpu)
+        {
+            gpu_emitter = dA_emplaceBack(drawData->particles.gpu_emitters);
+
+            if (!gpu_emitter)
+            {
+                emitter_node = emitter_node->next;
+                continue;
+            }
+
+            if (emitter->_gpu_offset != gpu_particle_offset || emitter->_gpu_amount != emitter->particle_amount)
+            {
+                emitter->_gpu_offset = gpu_particle_offset;
+                emitter->_gpu_amount = emitter->particle_amount;
+                drawData->particles.gpu_rebuild = true;
+            }
+            gpu_emitter->particle_offset = gpu_particle_offset;
+            gpu_emitter->particle_amount = emitter->particle_amount;
+
+            gpu_particle_offset += emitter->particle_amount;
+        }
+
         if (!emitter->emitting)
         {
             emitter_node = emitter_node->next;
@@ -505,17 +546,6 @@ static void Process_ParticleSystemUpdate()
             emitter->force_restart = false;
         }
 
-        int NUM_PARTICLES = dA_size(emitter->particles);
-
-        //increase particle amount if needed
-        if (NUM_PARTICLES < emitter->particle_amount)
-        {
-            dA_clear(emitter->particles);
-            dA_emplaceBackMultiple(emitter->particles, emitter->particle_amount);
-
-            NUM_PARTICLES = dA_size(emitter->particles);
-        }
-
         double e_delta = delta * emitter->speed_scale;
         double prev_time = emitter->_time;
 
@@ -564,274 +594,43 @@ static void Process_ParticleSystemUpdate()
             texture_region.x = frameOffset[0];
             texture_region.y = frameOffset[1];
         }
-        //draw = true;
         double system_time = emitter->_time / max(emitter->life_time, 0.0001);
 
-        //process particles
-        for (int i = 0; i < NUM_PARTICLES; i++)
+        if (use_gpu)
         {
-            ParticleCpu* particle = dA_at(emitter->particles, i);
-
-            double local_delta = e_delta;
-
-            double restart_phase = (double)i / (double)NUM_PARTICLES;
-
-            if (emitter->randomness > 0)
-            {
-                uint32_t seed = emitter->_cycle;
-                if (restart_phase >= system_time)
-                {
-                    seed -= 1;
-                }
-                seed *= NUM_PARTICLES;
-                seed += i;
-
-                uint32_t hash = Hash_id(seed);
-                double random = (hash % 65536) / 65536.0;
-                restart_phase += emitter->randomness * random * 1.0 / (double)NUM_PARTICLES;
-            }
-
-            restart_phase *= (1.0 - emitter->explosiveness);
-
-            bool restart = false;
-
-            if (emitter->_time > prev_time)
-            {
-                if (restart_phase >= prev_time && restart_phase < emitter->_time)
-                {
-                    restart = true;
-                    local_delta = (emitter->_time - restart_phase) * emitter->life_time;
-                }
-            }
-            else if (e_delta > 0.0)
-            {
-                if (restart_phase >= prev_time)
-                {
-                    restart = true;
-                    local_delta = (1.0 - restart_phase + emitter->_time) * emitter->life_time;
-                }
-                else if (restart_phase < emitter->_time)
-                {
-                    restart = true;
-                    local_delta = (emitter->_time - restart_phase) * emitter->life_time;
-                }
-            }
-            
-            if (particle->time * (1.0 - emitter->explosiveness) > emitter->life_time)
-            {
-                restart = true;
-            }
-
-            if (restart)
-            {
-                vec3 v;
-                glm_vec3_copy(emitter->direction, v);
-
-                particle->active = true;
-
-                if (emitter->spread > 0)
-                {
-                    vec3   v1, v2;
-                    float  c, s;
-
-                    float angle1 = glm_rad((Math_randf() * 2.0 - 1.0) * emitter->spread);
-                    float angle2 = glm_rad((Math_randf() * 2.0 - 1.0) * ((1.0 - emitter->flatness) * emitter->spread));
-
-                    c = cos(angle1) * cos(angle2);
-                    s = sin(angle1) * sin(angle2);
-
-                    vec3 k = { 0, 1, 0 };
-
-                    glm_vec3_normalize(k);
-                    /* Right Hand, Rodrigues' rotation formula:
-                        v = v*cos(t) + (kxv)sin(t) + k*(k.v)(1 - cos(t))
-                    */
-                    glm_vec3_scale(v, c, v1);
-
-                    glm_vec3_cross(k, v, v2);
-                    glm_vec3_scale(v2, s, v2);
-
-                    glm_vec3_add(v1, v2, v1);
-
-                    glm_vec3_scale(k, glm_vec3_dot(k, v) * (1.0f - c), v2);
-                    glm_vec3_add(v1, v2, v);
-                }
-               
-                float initial_velocity = emitter->initial_velocity;
-
-                glm_mat4_copy(emitter->xform, particle->xform);
-                glm_vec3_scale(v, initial_velocity, particle->velocity);
-                glm_vec4_copy(emitter->color, particle->color);
-                particle->time = 0;
-
-                if (emitter->scale != 1.0)
-                {
-                   glm_vec3_scale(particle->xform[0], emitter->scale, particle->xform[0]);
-                   glm_vec3_scale(particle->xform[1], emitter->scale, particle->xform[1]);
-                   glm_vec3_scale(particle->xform[2], emitter->scale, particle->xform[2]);
-                }
-
-                switch (emitter->emission_shape)
-                {
-                case EES__POINT:
-                {
-                    break;
-                }
-                case EES__BOX:
-                {
-                    float random = Math_randf();
-                    vec3 e = { Math_randf() * 2.0 - 1.0, Math_randf() * 2.0 - 1.0, Math_randf() * 2.0 - 1.0 };
-                    glm_vec3_mul(e, emitter->emission_size, e);
-                    glm_vec3_add(particle->xform[3], e, emitter->xform[3]);
-                    break;
-                }
-                default:
-                    break;
-                }
-            }
-            else if (!particle->active)
-            {
-                continue;
-            }
-            else if (particle->time > emitter->life_time)
-            {
-                particle->active = false;
-            }
-
-            if (particle->active)
-            {
-                particle->time += local_delta;
-
-                vec3 force = {0, emitter->gravity, 0};
-
-                //linear accel
-                if (glm_vec3_norm(particle->velocity) > 0)
-                {
-                    vec3 normalized_vel;
-                    glm_vec3_normalize_to(particle->velocity, normalized_vel);
-                    
-                    float linear_accel = emitter->linear_accel;
-                    glm_vec3_scale(normalized_vel, linear_accel, normalized_vel);
-
-                    glm_vec3_add(normalized_vel, force, force);
-                }
-                glm_vec3_scale(force, local_delta, force);
-                glm_vec3_add(force, particle->velocity, particle->velocity);
+            Process_ParticleEmitterToGL(emitter, gpu_emitter, e_delta, prev_time, system_time, draw, texture_index, texture_region);
+        }
+        else
+        {
+            RParticles_AddEmitterJobs(emitter, e_delta, prev_time, system_time, draw, texture_index, texture_region);
+        }
 
-                //call collision function if provided
-                if (emitter->collision_function)
-                {
-                    (*emitter->collision_function)(particle, emitter, local_delta);
-                }
-    
-                //friction
-                if (emitter->friction > 0.0)
-                {
-                    float friction = emitter->friction;
-                    float l = glm_vec3_norm(particle->velocity);
-                    l -= friction * local_delta;
-
-                    if (l < 0)
-                    {
-                        glm_vec3_zero(particle->velocity);
-                    }
-                    else
-                    {
-                        vec3 normalized_vel;
-                        glm_vec3_normalize_to(particle->velocity, normalized_vel);
-
-                        glm_vec3_scale(normalized_vel, l, particle->velocity);
-                    }
-                }
+        emitter->force_restart = false;
 
-                vec3 delta_vel;
-                glm_vec3_scale(particle->velocity, local_delta, delta_vel);
-                glm_vec3_add(particle->xform[3], delta_vel, particle->xform[3]);
+        emitter_node = emitter_node->next;
+    }
 
-                glm_vec4_lerp(particle->color, emitter->end_color, local_delta, particle->color);
+    drawData->particles.gpu_enabled = use_gpu && gpu_particle_offset > 0;
 
-           
-                if (draw)
-                {
-                    mat4 local_matrix;
-                    glm_mat4_copy(particle->xform, local_matrix);
-
-                    //billboard to cam 
-                    vec3 to_camera;
-                    to_camera[0] = scene.camera.position[0] - local_matrix[3][0];
-                    to_camera[1] = scene.camera.position[1] - local_matrix[3][1];
-                    to_camera[2] = scene.camera.position[2] - local_matrix[3][2];
-                    glm_vec3_normalize(to_camera);
-
-                    int mode = 1;
-                    switch (mode)
-                    {
-                    case 0:
-                    {
-                        break;
-                    }
-                    case 1:
-                    {
-                        vec3 crossed;
-                        glm_vec3_crossn(up, to_camera, crossed);
-
-                        mat3 local;
-                        glm_vec3_copy(crossed, local[0]);
-                        glm_vec3_copy(up, local[1]);
-                        glm_vec3_copy(to_camera, local[2]);
-                        //do this way since cglm copies incorrecly
-                        mat3 matrix_3;
-                        matrix_3[0][0] = local_matrix[0][0];
-                        matrix_3[0][1] = local_matrix[0][1];
-                        matrix_3[0][2] = local_matrix[0][2];
-
-                        matrix_3[1][0] = local_matrix[1][0];
-                        matrix_3[1][1] = local_matrix[1][1];
-                        matrix_3[1][2] = local_matrix[1][2];
-
-                        matrix_3[2][0] = local_matrix[2][0];
-                        matrix_3[2][1] = local_matrix[2][1];
-                        matrix_3[2][2] = local_matrix[2][2];
-
-                        glm_mat3_mul(local, matrix_3, local);
-                        glm_vec3_copy(local[0], local_matrix[0]);
-                        glm_vec3_copy(local[1], local_matrix[1]);
-                        glm_vec3_copy(local[2], local_matrix[2]);
-                        break;
-                    }
-                    case 2:
-                    {
-                        vec3 screen_velocity;
-                        glm_vec3_sub(particle->velocity, to_camera, screen_velocity);
-                        glm_vec3_scale(screen_velocity, glm_vec3_dot(to_camera, particle->velocity), screen_velocity);
-
-                        if (glm_vec3_norm(screen_velocity) == 0)
-                        {
-                            glm_vec3_copy(up, screen_velocity);
-                        }
-
-                        glm_vec3_normalize(screen_velocity);
-
-                        glm_vec3_crossn(screen_velocity, to_camera, local_matrix[0]);
-                        glm_vec3_scale(local_matrix[0], glm_vec3_norm(particle->xform[0]), local_matrix[0]);
-
-                        glm_vec3_scale(screen_velocity, glm_vec3_norm(particle->xform[1]), local_matrix[1]);
-
-                        glm_vec3_scale(to_camera, glm_vec3_norm(particle->xform[2]), local_matrix[2]);
-                        break;
-                    }
-                    default:
-                        break;
-                    }
-
-                    Process_AddParticleToQuadInstances(particle, local_matrix, texture_region, texture_index);
-                }
-            }
+    if (use_gpu)
+    {
+        if (drawData->particles.gpu_emitter_amount != dA_size(drawData->particles.gpu_emitters))
+        {
+            drawData->particles.gpu_rebuild = true;
         }
-        emitter->force_restart = false;
+        drawData->particles.gpu_emitter_amount = dA_size(drawData->particles.gpu_emitters);
+        drawData->particles.gpu_particle_amount = gpu_particle_offset;
 
-        emitter_node = emitter_node->next;
+        if (drawData->particles.gpu_rebuild)
+        {
+            Process_ParticleGpuRebuild();
+            drawData->particles.gpu_rebuild = false;
+        }
     }
+
+    //process cpu particles
+    RParticles_RunJobs(r_cvars.r_particleWorkerThreads->int_value);
+    RParticles_GatherInstances();
 }
 
 static void Process_LCWorld(RDraw_LCWorldData* const p_lcWorldData)
@@ -946,15 +745,84 @@ static double snapped(double p_value, float p_step)
     return p_value;
 }
 
+static void Process_CalcShadowSplitBox(mat4 p_shadowMatrix, int p_split, vec3 dest[2])
+{
+    const float SHADOW_MARGIN_MULTIPLIER = 2.0;
+
+    mat4 ident;
+    glm_mat4_identity(ident);
+
+    mat4 invMat;
+    glm_mat4_inv(p_shadowMatrix, invMat);
+
+    vec4 frustrum_corners[8];
+    glm_frustum_corners(invMat, frustrum_corners);
+
+    glm_frustum_box(frustrum_corners, ident, dest);
+
+    if (p_split == 0)
+    {
+        //Fatten the box a little, since shadows get cut off incorrectly in high peaks and valleys
+        dest[0][0] -= LC_CHUNK_WIDTH * SHADOW_MARGIN_MULTIPLIER;
+        dest[0][1] -= LC_CHUNK_HEIGHT * SHADOW_MARGIN_MULTIPLIER;
+        dest[0][2] -= LC_CHUNK_LENGTH * SHADOW_MARGIN_MULTIPLIER;
+
+        dest[1][0] += LC_CHUNK_WIDTH * SHADOW_MARGIN_MULTIPLIER;
+        dest[1][1] += LC_CHUNK_HEIGHT * SHADOW_MARGIN_MULTIPLIER;
+        dest[1][2] += LC_CHUNK_LENGTH * SHADOW_MARGIN_MULTIPLIER;
+    }
+}
+
+static void Process_ShadowCacheCheckChangedChunks(int p_splits)
+{
+    LC_WorldRenderData* world_data = drawData->lc_world.world_render_data;
+
+    if (!world_data)
+    {
+        return;
+    }
+
+    //Mark the far splits that contain a remeshed or deleted chunk as dirty
+    for (int i = 0; i < dA_size(world_data->changed_chunks); i++)
+    {
+        ivec4* chunk_position = dA_at(world_data->changed_chunks, i);
+
+        //w is the size of the chunk, bigger for the distant terrain
+        vec3 chunk_box[2];
+        chunk_box[0][0] = (*chunk_position)[0];
+        chunk_box[0][1] = (*chunk_position)[1];
+        chunk_box[0][2] = (*chunk_position)[2];
+
+        chunk_box[1][0] = chunk_box[0][0] + (*chunk_position)[3];
+        chunk_box[1][1] = chunk_box[0][1] + (*chunk_position)[3];
+        chunk_box[1][2] = chunk_box[0][2] + (*chunk_position)[3];
+
+        for (int j = 1; j < p_splits; j++)
+        {
+            if (!pass->shadow.split_dirty[j] && glm_aabb_aabb(chunk_box, pass->shadow.split_boxes[j]))
+            {
+                pass->shadow.split_dirty[j] = true;
+            }
+        }
+    }
+
+    dA_clear(world_data->changed_chunks);
+}
+
 static void Process_CalcShadowMatrixes()
 {
     R_Camera* cam = Camera_getCurrent();
 
+    int splits = r_cvars.r_shadowSplits->int_value;
+
+    Process_ShadowCacheCheckChangedChunks(splits);
+
+    metrics.shadow_splits_rendered = 0;
+
     if (!cam || !r_cvars.r_useDirShadowMapping->int_value)
     {
         return;
     }
-    int splits = r_cvars.r_shadowSplits->int_value;
 
     vec4 splits2;
     Process_CalcShadowSplits(splits2, scene.camera.z_near, scene.camera.z_far, 0.80, splits);
@@ -1009,6 +877,8 @@ static void Process_CalcShadowMatrixes()
 
     float first_radius = 0.0;
 
+    mat4 split_matrixes[SHADOW_CASCADE_LEVELS];
+
     for (int i = 0; i < splits; i++)
     {
         vec4 frustrum_center;
@@ -1121,16 +991,61 @@ static void Process_CalcShadowMatrixes()
         glm_ortho(-radius, radius, -radius, radius, 0.0, maxZ - minZ, orthoProj);
 
         //multiply light view matrix with proj
-        glm_mat4_mul(orthoProj, lightView, scene.scene_data.shadow_matrixes[i]);
+        glm_mat4_mul(orthoProj, lightView, split_matrixes[i]);
 
         scene.scene_data.shadow_bias[i] = r_cvars.r_shadowBias->float_value / 100.0 * bias_scale;
         scene.scene_data.shadow_normal_bias[i] = r_cvars.r_shadowNormalBias->float_value * (radius * 2.0 / shadow_texture_size);
     }
 
+    //The first split is always rendered, since it is the closest and also holds the particle shadows.
+    //Far splits are only rerendered when their snapped light matrix changed or a chunk inside them was remeshed,
+    //and only one of them per frame, so the cost is spread over multiple frames
+    bool use_cache = (r_cvars.r_shadowCache->int_value == 1) && !pass->shadow.invalidate_cache;
+
+    int stagger_count = max(splits - 1, 1);
+    int staggered_split = -1;
+
+    if (use_cache)
+    {
+        for (int j = 0; j < splits - 1; j++)
+        {
+            int i = 1 + (pass->shadow.next_stagger_split + j) % stagger_count;
+
+            if (pass->shadow.split_dirty[i] || memcmp(split_matrixes[i], pass->shadow.cached_matrixes[i], sizeof(mat4)) != 0)
+            {
+                staggered_split = i;
+                pass->shadow.next_stagger_split = i % stagger_count;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < SHADOW_CASCADE_LEVELS; i++)
+    {
+        bool render = (i < splits) && (!use_cache || i == 0 || i == staggered_split);
+
+        pass->shadow.split_render[i] = render;
+
+        if (render)
+        {
+            glm_mat4_copy(split_matrixes[i], pass->shadow.cached_matrixes[i]);
+            Process_CalcShadowSplitBox(split_matrixes[i], i, pass->shadow.split_boxes[i]);
+
+            pass->shadow.split_dirty[i] = false;
+            metrics.shadow_splits_rendered++;
+        }
+
+        //skipped splits keep the matrix they were rendered with
+        if (i < splits)
+        {
+            glm_mat4_copy(pass->shadow.cached_matrixes[i], scene.scene_data.shadow_matrixes[i]);
+        }
+    }
+
+    pass->shadow.invalidate_cache = false;
 }
 
 static int HIT_COUNT = 0;
-static int ACTIVE_SPLIT = 0;
 
 void Process_CullRegisterHit(const void* _data, BVH_ID _index)
 {
@@ -1171,77 +1086,6 @@ void Process_CullRegisterHitLCWorld(const void* _data, BVH_ID _index)
     }
 }
 
-void Process_CullRegisterHitLCWorldShadow(const void* _data, BVH_ID _index)
-{
-    LC_TreeData* tree_data = _data;
-
-    if (tree_data->opaque_index >= 0)
-    {
-        DRB_Item opaque_item = DRB_GetItem(&drawData->lc_world.world_render_data->opaque_buffer, tree_data->opaque_index);
-
-        int* first = dA_emplaceBack(drawData->lc_world.shadow_firsts[ACTIVE_SPLIT]);
-        int* count = dA_emplaceBack(drawData->lc_world.shadow_counts[ACTIVE_SPLIT]);
-
-        *first = opaque_item.offset / sizeof(ChunkVertex);
-        *count = opaque_item.count / sizeof(ChunkVertex);
-
-        int* chunk_index = dA_emplaceBack(drawData->lc_world.shadow_sorted_chunk_indexes);
-
-        *chunk_index = tree_data->chunk_data_index;
-        scene.cull_data.lc_world.shadow_cull_count[ACTIVE_SPLIT]++;
-    }
-    if (tree_data->transparent_index >= 0)
-    {
-        DRB_Item transparent_item = DRB_GetItem(&drawData->lc_world.world_render_data->semi_transparent_buffer, tree_data->transparent_index);
-
-        int* first = dA_emplaceBack(drawData->lc_world.shadow_firsts_transparent[ACTIVE_SPLIT]);
-        int* count = dA_emplaceBack(drawData->lc_world.shadow_counts_transparent[ACTIVE_SPLIT]);
-
-        *first = transparent_item.offset / sizeof(ChunkVertex);
-        *count = transparent_item.count / sizeof(ChunkVertex);
-
-        int* chunk_index = dA_emplaceBack(drawData->lc_world.shadow_sorted_chunk_transparent_indexes);
-
-        *chunk_index = tree_data->chunk_data_index;
-        scene.cull_data.lc_world.shadow_cull_transparent_count[ACTIVE_SPLIT]++;
-    }
-}
-void Process_CullRegisterHitLCWorldReflection(const void* _data, BVH_ID _index)
-{
-    LC_TreeData* tree_data = _data;
-
-    if (tree_data->opaque_index >= 0)
-    {
-        DRB_Item opaque_item = DRB_GetItem(&drawData->lc_world.world_render_data->opaque_buffer, tree_data->opaque_index);
-
-        int* first = dA_emplaceBack(drawData->lc_world.reflection_pass_opaque_firsts);
-        int* count = dA_emplaceBack(drawData->lc_world.reflection_pass_opaque_counts);
-
-        *first = opaque_item.offset / sizeof(ChunkVertex);
-        *count = opaque_item.count / sizeof(ChunkVertex);
-
-        int* chunk_index = dA_emplaceBack(drawData->lc_world.reflection_pass_chunk_indexes);
-        *chunk_index = tree_data->chunk_data_index;
-
-        scene.cull_data.lc_world.reflection_opaque_count++;
-    }
-    if (tree_data->transparent_index >= 0)
-    {
-        DRB_Item transparent_item = DRB_GetItem(&drawData->lc_world.world_render_data->semi_transparent_buffer, tree_data->transparent_index);
-
-        int* first = dA_emplaceBack(drawData->lc_world.reflection_pass_transparent_firsts);
-        int* count = dA_emplaceBack(drawData->lc_world.reflection_pass_transparent_counts);
-
-        *first = transparent_item.offset / sizeof(ChunkVertex);
-        *count = transparent_item.count / sizeof(ChunkVertex);
-
-        int* chunk_index = dA_emplaceBack(drawData->lc_world.reflection_pass_transparent_chunk_indexes);
-        *chunk_index = tree_data->chunk_data_index;
-
-        scene.cull_data.lc_world.reflection_transparent_count++;
-    }
-}
-
 //#define CULL_SHADOWS_PLANES
 static void Process_CullScene()
 {
@@ -1251,33 +1095,30 @@ static void Process_CullScene()
 
     HIT_COUNT = 0;
 
-    dA_clear(storage.point_lights_backbuffer);
-    dA_clear(storage.spot_lights_backbuffer);
-
     //Cull scene
     int static_cull_count = BVH_Tree_Cull_Planes(&scene.cull_data.static_partition_tree, scene.camera.frustrum_planes, 6, 1000, Process_CullRegisterHit);
 
+    //every hit could be a light
+    storage.point_lights_backbuffer = Arena_ALLOC(&backend_data->frame_arena, PointLight, static_cull_count);
+    storage.spot_lights_backbuffer = Arena_ALLOC(&backend_data->frame_arena, SpotLight, static_cull_count);
+
     for (int i = 0; i < static_cull_count; i++)
     {
         int instance_index = scene.cull_data.static_cull_instance_result[i];
 
         RenderInstance* instance = dA_at(scene.render_instances_pool->pool, instance_index);
 
-        if (instance->type == INST__POINT_LIGHT)
+        if (instance->type == INST__POINT_LIGHT && storage.point_lights_backbuffer)
         {
             PointLight* point_light = dA_at(storage.point_lights_pool->pool, instance->data_index);
 
-            scene.scene_data.numPointLights++;
-
-            dA_emplaceBackData(storage.point_lights_backbuffer, point_light);
+            storage.point_lights_backbuffer[scene.scene_data.numPointLights++] = *point_light;
         }
-        else if (instance->type == INST__SPOT_LIGHT)
+        else if (instance->type == INST__SPOT_LIGHT && storage.spot_lights_backbuffer)
         {
             SpotLight* spot_light = dA_at(storage.spot_lights_pool->pool, instance->data_index);
 
-            scene.scene_data.numSpotLights++;
-
-            dA_emplaceBackData(storage.spot_lights_backbuffer, spot_light);
+            storage.spot_lights_backbuffer[scene.scene_data.numSpotLights++] = *spot_light;
         }
     }
 
@@ -1291,101 +1132,18 @@ static void Process_CullScene()
         scene.cull_data.lc_world.water_in_frustrum = 0;
 
         scene.cull_data.lc_world.total_in_frustrum_count = BVH_Tree_Cull_Planes(&drawData->lc_world.world_render_data->bvh_tree, scene.camera.frustrum_planes, 6, MAX_CULL_QUERY_BUFFER_ITEMS, Process_CullRegisterHitLCWorld);
-        
-        //cull chunks for reflection pass (only if there is a visible water chunk)
-        if (scene.cull_data.lc_world.water_in_frustrum > 0)
-        {
-            dA_clear(drawData->lc_world.reflection_pass_opaque_firsts);
-            dA_clear(drawData->lc_world.reflection_pass_opaque_counts);
-
-            dA_clear(drawData->lc_world.reflection_pass_transparent_firsts);
-            dA_clear(drawData->lc_world.reflection_pass_transparent_counts);
-
-            dA_clear(drawData->lc_world.reflection_pass_chunk_indexes);
-            dA_clear(drawData->lc_world.reflection_pass_transparent_chunk_indexes);
-
-            scene.cull_data.lc_world.reflection_opaque_count = 0;
-            scene.cull_data.lc_world.reflection_transparent_count = 0;
-
-            vec4 frustrum_planes[6];
-            glm_frustum_planes(pass->water.reflection_projView_matrix, frustrum_planes);
 
-            BVH_Tree_Cull_Planes(&drawData->lc_world.world_render_data->bvh_tree, frustrum_planes, 6, MAX_CULL_QUERY_BUFFER_ITEMS, Process_CullRegisterHitLCWorldReflection);
-        }
-
-        //cull chunks in shadow
-        if (r_cvars.r_useDirShadowMapping->int_value)
-        {        
-            int splits = r_cvars.r_shadowSplits->int_value;
-
-            const float SHADOW_MARGIN_MULTIPLIER = 2.0;
-
-            bool allow_transparent_shadows = (r_cvars.r_allowTransparentShadows->int_value == 1);
-
-            dA_clear(drawData->lc_world.shadow_sorted_chunk_indexes);
-
-            if (allow_transparent_shadows)
-            {
-                dA_clear(drawData->lc_world.shadow_sorted_chunk_transparent_indexes);
-            }
-
-            mat4 ident;
-            glm_mat4_identity(ident);
-
-            for (int i = 0; i < splits; i++)
-            {
-                int shadow_count = 0;
-
-                mat4 invMat;
-                glm_mat4_inv(scene.scene_data.shadow_matrixes[i], invMat);
-
-                vec4 frustrum_corners[8];
-                glm_frustum_corners(invMat, frustrum_corners);
-
-                vec3 box[2];
-                glm_frustum_box(frustrum_corners, ident, box);
-                
-                if (i == 0)
-                {
-                    //Fatten the box a little, since shadows get cut off incorrectly in high peaks and valleys
-                    box[0][0] -= LC_CHUNK_WIDTH * SHADOW_MARGIN_MULTIPLIER;
-                    box[0][1] -= LC_CHUNK_HEIGHT * SHADOW_MARGIN_MULTIPLIER;
-                    box[0][2] -= LC_CHUNK_LENGTH * SHADOW_MARGIN_MULTIPLIER;
-
-                    box[1][0] += LC_CHUNK_WIDTH * SHADOW_MARGIN_MULTIPLIER;
-                    box[1][1] += LC_CHUNK_HEIGHT * SHADOW_MARGIN_MULTIPLIER;
-                    box[1][2] += LC_CHUNK_LENGTH * SHADOW_MARGIN_MULTIPLIER;
-                }
-
-                dA_clear(drawData->lc_world.shadow_firsts[i]);
-                dA_clear(drawData->lc_world.shadow_counts[i]);
-                drawData->lc_world.shadow_sorted_chunk_offsets[i] = dA_size(drawData->lc_world.shadow_sorted_chunk_indexes);
-
-                if (allow_transparent_shadows)
-                {
-                    dA_clear(drawData->lc_world.shadow_firsts_transparent[i]);
-                    dA_clear(drawData->lc_world.shadow_counts_transparent[i]);
-
-                    drawData->lc_world.shadow_sorted_chunk_transparent_offsets[i] = dA_size(drawData->lc_world.shadow_sorted_chunk_transparent_indexes);
-                }
-                scene.cull_data.lc_world.shadow_cull_count[i] = 0;
-                scene.cull_data.lc_world.shadow_cull_transparent_count[i] = 0;
-                ACTIVE_SPLIT = i;
-
-                //processed in the provided function
-                shadow_count = BVH_Tree_Cull_Box(&drawData->lc_world.world_render_data->bvh_tree, box, MAX_CULL_LC_SHADOW_QUERY_BUFFER_ITEMS, Process_CullRegisterHitLCWorldShadow);
-            }
-        }
+        //chunks for the shadow and reflection passes are culled on the gpu, see Compute_CullWorldChunkPasses()
     }
   
 }
 
-static void Process_CmdBuffer()
+static void Process_CmdBuffer(R_CMD_Buffer* const p_cmdBuffer)
 {
-    void* itr_ptr = cmdBuffer->cmds_data;
-    for (int i = 0; i < cmdBuffer->cmds_counter; i++)
+    void* itr_ptr = p_cmdBuffer->cmds_data;
+    for (int i = 0; i < p_cmdBuffer->cmds_counter; i++)
     {
-        switch (cmdBuffer->cmd_enums[i])
+        switch (p_cmdBuffer->cmd_enums[i])
         {
         case R_CMD__TEXTURE:
         {
@@ -1461,24 +1219,24 @@ static void Process_CmdBuffer()
         }
     }
 
-    cmdBuffer->cmds_ptr = cmdBuffer->cmds_data;
-    cmdBuffer->cmds_counter = 0;
-    cmdBuffer->byte_count = 0;
+    p_cmdBuffer->cmds_ptr = p_cmdBuffer->cmds_data;
+    p_cmdBuffer->cmds_counter = 0;
+    p_cmdBuffer->byte_count = 0;
 }
 
 /*
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
    Main function
-   Called in r_core.c
+   Called in r_core.c, by the render thread or the main thread
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 */
 
-void RCmds_processCommands()
+void RCmds_processCommands(R_CMD_Buffer* const p_cmdBuffer)
 {
     drawData->lc_world.draw = false;
 
     
-    Process_CmdBuffer();
+    Process_CmdBuffer(p_cmdBuffer);
     Process_ParticleSystemUpdate();
     Process_CalcShadowMatrixes();
     Process_CameraUpdate();
@@ -22,24 +22,24 @@ R_Metrics metrics;
 R_StorageBuffers storage;
 R_Scene scene;
 R_RendererResources resources;
+R_FrameSnapshot snapshot;
 
-extern void RCmds_processCommands();
+extern void RCmds_processCommands(R_CMD_Buffer* const p_cmdBuffer);
 extern void Pass_Main();
 extern void Compute_DispatchAll();
 extern void Compute_Sync();
+extern void Compute_Particles();
 extern void	RPanel_Main();
 extern void RPanel_Metrics();
+extern void RParticles_Benchmark(int p_particleAmount);
 
 /*
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-Updates metrics and sets if we should skip this frame (if fps limit is on)
+Updates metrics
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 */
-/*
 static void RCore_updateMetrics()
 {
-	backend_data->skip_frame = false;
-
 	metrics.frame_ticks_per_second++;
 	float new_time = glfwGetTime();
 	
@@ -53,24 +53,15 @@ static void RCore_updateMetrics()
 		metrics.frame_ticks_per_second = 0;;
 		metrics.previous_fps_timed_time = new_time;
 	}
-	
-	if (r_cvars.r_limitFPS->int_value == 1)
-	{
-		float max_fps = (r_cvars.r_maxFPS->int_value > 0) ? r_cvars.r_maxFPS->int_value : 144; //make sure we are not diving by zero
-		float max_fps_norm = 1.0 / max_fps;
 
-		if (new_time - metrics.previous_render_time >= max_fps_norm)
-		{
-			backend_data->skip_frame = false;
-			metrics.previous_render_time = new_time;
-		}
-		else
-		{
-			backend_data->skip_frame = true;
-		}
-	}
+	//memory
+	dA_AllocStats alloc_stats = dA_getAllocStats();
+
+	metrics.frame_alloc_count = alloc_stats.alloc_count - metrics.prev_alloc_count;
+	metrics.prev_alloc_count = alloc_stats.alloc_count;
+	metrics.allocated_bytes = alloc_stats.allocated_bytes;
+	metrics.peak_allocated_bytes = alloc_stats.peak_allocated_bytes;
 }
-*/
 /*
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 Called on any window resize event. Updates textures sizes, etc...
@@ -205,6 +196,8 @@ void RCore_onWindowResize(int width, int height)
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass->general.normal_halfsize_texture, 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, pass->general.depth_halfsize_texture, 0);
 
+	RInternal_ResizeHiZTexture(width, height);
+
 	scene.camera.screen_size[0] = width;
 	scene.camera.screen_size[1] = height;
 
@@ -285,10 +278,26 @@ static void RCore_checkForModifiedCvars()
 		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pass->shadow.depth_maps, 0);
 
 		pass->shadow.shadow_map_size = shadow_size;
+		pass->shadow.invalidate_cache = true;
 		r_cvars.r_shadowQualityLevel->modified = false;
 	}
+	if (r_cvars.r_shadowSplits->modified || r_cvars.r_shadowCache->modified || r_cvars.r_allowTransparentShadows->modified)
+	{
+		//the cached splits are stale
+		pass->shadow.invalidate_cache = true;
+
+		r_cvars.r_shadowSplits->modified = false;
+		r_cvars.r_shadowCache->modified = false;
+		r_cvars.r_allowTransparentShadows->modified = false;
+	}
 	if (r_cvars.r_shadowBlurLevel->modified || r_cvars.r_useSsao->modified || r_cvars.r_useDirShadowMapping->modified)
 	{
+		//shadow maps are not updated while disabled
+		if (r_cvars.r_useDirShadowMapping->modified)
+		{
+			pass->shadow.invalidate_cache = true;
+		}
+
 		RInternal_GetShadowQualityData(r_cvars.r_shadowQualityLevel->int_value, r_cvars.r_shadowBlurLevel->int_value, NULL, pass->shadow.shadow_sample_kernels,
 			&pass->shadow.num_shadow_sample_kernels, &pass->shadow.quality_radius_scale);
 
@@ -308,12 +317,28 @@ static void RCore_checkForModifiedCvars()
 		Shader_SetInt(&pass->deferred.shading_shader, DEFERRED_SCENE_UNIFORM_SHADOWSAMPLEAMOUNT, pass->shadow.num_shadow_sample_kernels);
 
 		r_cvars.r_shadowBlurLevel->modified = false;
+		r_cvars.r_useDirShadowMapping->modified = false;
 	}
 	if (r_cvars.r_waterReflectionQuality->modified)
 	{
 		RCore_onWindowResize(backend_data->screenSize[0], backend_data->screenSize[1]);
 		r_cvars.r_waterReflectionQuality->modified = false;
 	}
+	if (r_cvars.r_particleBenchmark->modified)
+	{
+		if (r_cvars.r_particleBenchmark->int_value == 1)
+		{
+			RParticles_Benchmark(100000);
+			Cvar_setValueDirectInt(r_cvars.r_particleBenchmark, 0);
+		}
+		r_cvars.r_particleBenchmark->modified = false;
+	}
+	if (r_cvars.r_particleGpu->modified)
+	{
+		//the particles might have been simulated on the cpu in the meantime, so reset the gpu particles
+		drawData->particles.gpu_rebuild = true;
+		r_cvars.r_particleGpu->modified = false;
+	}
 }
 /*
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -372,6 +397,28 @@ static void RCore_UploadGpuData()
 			glBufferSubData(GL_ARRAY_BUFFER, 0, size, dA_getFront(drawData->particles.instance_buffer));
 		}
 	}
+	if (drawData->particles.gpu_enabled)
+	{
+		//particle slots were reassigned, upload the reset particles and resize the instance buffer to fit all of them
+		if (dA_size(drawData->particles.gpu_rebuild_particles) > 0)
+		{
+			glNamedBufferData(drawData->particles.gpu_particle_buffer, sizeof(Particle) * dA_size(drawData->particles.gpu_rebuild_particles), dA_getFront(drawData->particles.gpu_rebuild_particles), GL_DYNAMIC_DRAW);
+			glNamedBufferData(drawData->particles.gpu_instance_buffer, sizeof(float) * PARTICLE_INSTANCE_FLOAT_COUNT * drawData->particles.gpu_particle_amount, NULL, GL_DYNAMIC_DRAW);
+
+			dA_clear(drawData->particles.gpu_rebuild_particles);
+		}
+
+		size_t size = sizeof(ParticleEmitterGL) * dA_size(drawData->particles.gpu_emitters);
+		if (size > drawData->particles.gpu_emitter_allocated_size)
+		{
+			glNamedBufferData(drawData->particles.gpu_emitter_buffer, size, dA_getFront(drawData->particles.gpu_emitters), GL_STREAM_DRAW);
+			drawData->particles.gpu_emitter_allocated_size = size;
+		}
+		else
+		{
+			glNamedBufferSubData(drawData->particles.gpu_emitter_buffer, 0, size, dA_getFront(drawData->particles.gpu_emitters));
+		}
+	}
 
 	//Scene data
 	if (drawData->lc_world.draw)
@@ -380,12 +427,6 @@ static void RCore_UploadGpuData()
 		{
 			//glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_ssbo, 0, sizeof(int) * scene.cull_data.lc_world.total_in_frustrum_count, scene.cull_data.lc_world.frustrum_sorted_query_buffer);
 		}
-		//glNamedBufferSubData(drawData->lc_world.world_render_data->shadow_chunk_indexes_ssbo, 0, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_indexes->elements_size,
-		//	drawData->lc_world.shadow_sorted_chunk_indexes->data);
-
-		//glNamedBufferSubData(drawData->lc_world.world_render_data->shadow_chunk_indexes_ssbo, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_indexes->elements_size, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_transparent_indexes->elements_size,
-			//drawData->lc_world.shadow_sorted_chunk_transparent_indexes->data);
-
 
 		//glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_buffer, 0, sizeof(int) * 500, scene.cull_data.lc_world.frustrum_query_buffer);
 	}
@@ -403,12 +444,12 @@ static void RCore_UploadGpuData()
 	if (scene.scene_data.numPointLights > 0)
 	{
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, storage.point_lights.buffer);
-		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(PointLight) * scene.scene_data.numPointLights, storage.point_lights_backbuffer->data);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(PointLight) * scene.scene_data.numPointLights, storage.point_lights_backbuffer);
 	}
 	if (scene.scene_data.numSpotLights > 0)
 	{
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, storage.spot_lights.buffer);
-		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(SpotLight) * scene.scene_data.numSpotLights, storage.spot_lights_backbuffer->data);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(SpotLight) * scene.scene_data.numSpotLights, storage.spot_lights_backbuffer);
 	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -424,6 +465,7 @@ static void RCore_EndFrameCleanup()
 	drawData->triangle.vertices_count = 0;
 	drawData->screen_quad.vertices_count = 0;
 	drawData->screen_quad.indices_count = 0;
+	drawData->screen_quad.tex_index = 0;
 	drawData->text.vertices_count = 0;
 	drawData->text.indices_count = 0;
 
@@ -432,6 +474,127 @@ static void RCore_EndFrameCleanup()
 	dA_clear(drawData->cube.vertices_buffer);
 	drawData->cube.instance_count = 0;
 	drawData->particles.instance_count = 0;
+
+	//Everything in the frame arena is uploaded by now
+	metrics.frame_arena_used = backend_data->frame_arena.used;
+	metrics.frame_arena_peak = backend_data->frame_arena.peak_used;
+	metrics.frame_arena_overflows = backend_data->frame_arena.overflow_count;
+
+	Arena_Reset(&backend_data->frame_arena);
+	storage.point_lights_backbuffer = NULL;
+	storage.spot_lights_backbuffer = NULL;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+Uploads the processed frame and takes the snapshot the passes read.
+After this the render thread is free to process the next frame
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+static void RCore_PublishFrame()
+{
+	if (drawData->lc_world.world_render_data)
+	{
+		//process_chunks.comp needs the last frame's frustrum bits and this frame's visibles
+		glNamedBufferSubData(drawData->lc_world.world_render_data->prev_in_frustrum_bitset_buffer, 0, sizeof(snapshot.lc_frustrum_bitset), snapshot.lc_frustrum_bitset);
+		glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, 0, sizeof(int) * scene.cull_data.lc_world.total_in_frustrum_count, scene.cull_data.lc_world.frustrum_sorted_query_buffer);
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	}
+	memcpy(snapshot.lc_frustrum_bitset, scene.cull_data.lc_world.frustrum_query_buffer, sizeof(snapshot.lc_frustrum_bitset));
+
+	//Upload data to gpu
+	RCore_UploadGpuData();
+
+	//CAMERA
+	glm_mat4_copy(scene.camera.view, snapshot.view);
+	glm_mat4_copy(scene.camera.proj, snapshot.proj);
+	glm_mat4_copy(scene.camera.viewProjectionMatrix, snapshot.viewProjection);
+
+	//SHADOWS
+	for (int i = 0; i < SHADOW_CASCADE_LEVELS; i++)
+	{
+		glm_mat4_copy(scene.scene_data.shadow_matrixes[i], snapshot.shadow_matrixes[i]);
+		glm_vec3_copy(pass->shadow.split_boxes[i][0], snapshot.shadow_split_boxes[i][0]);
+		glm_vec3_copy(pass->shadow.split_boxes[i][1], snapshot.shadow_split_boxes[i][1]);
+		snapshot.shadow_split_render[i] = pass->shadow.split_render[i];
+	}
+
+	//WATER
+	glm_mat4_copy(pass->water.reflection_view_matrix, snapshot.reflection_view_matrix);
+	glm_mat4_copy(pass->water.reflection_projView_matrix, snapshot.reflection_projView_matrix);
+
+	//ENVIRONMENT
+	memcpy(&snapshot.environment, &scene.environment, sizeof(snapshot.environment));
+
+	//LC WORLD
+	snapshot.draw_lc_world = drawData->lc_world.draw;
+	snapshot.lc_total_in_frustrum = scene.cull_data.lc_world.total_in_frustrum_count;
+	snapshot.lc_opaque_in_frustrum = scene.cull_data.lc_world.opaque_in_frustrum;
+	snapshot.lc_transparent_in_frustrum = scene.cull_data.lc_world.transparent_in_frustrum;
+	snapshot.lc_water_in_frustrum = scene.cull_data.lc_world.water_in_frustrum;
+
+	//BATCHES
+	snapshot.screen_quad_indices_count = drawData->screen_quad.indices_count;
+	memcpy(snapshot.screen_quad_textures, drawData->screen_quad.tex_array, sizeof(snapshot.screen_quad_textures));
+
+	snapshot.line_vertices_count = drawData->lines.vertices_count;
+
+	snapshot.triangle_vertices_count = drawData->triangle.vertices_count;
+	memcpy(snapshot.triangle_textures, drawData->triangle.texture_ids, sizeof(snapshot.triangle_textures));
+
+	snapshot.cube_instance_count = drawData->cube.instance_count;
+	snapshot.cube_texture_count = drawData->cube.texture_index;
+	memcpy(snapshot.cube_textures, drawData->cube.texture_ids, sizeof(snapshot.cube_textures));
+
+	snapshot.particle_instance_count = drawData->particles.instance_count;
+	snapshot.particle_texture_count = drawData->particles.texture_index;
+	snapshot.gpu_particles_enabled = drawData->particles.gpu_enabled;
+	memcpy(snapshot.particle_textures, drawData->particles.texture_ids, sizeof(snapshot.particle_textures));
+
+	//The batches are free to be filled again
+	RCore_EndFrameCleanup();
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+Render thread loop. Processes the commands of the next frame while the
+main thread submits the current one. Never calls gl
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+DWORD WINAPI RCore_RenderThreadLoop(LPVOID p_arg)
+{
+	for (;;)
+	{
+		WaitForSingleObject(backend_data->thread.event_work_permssion, INFINITE);
+
+		if (backend_data->thread.exit_request)
+		{
+			break;
+		}
+
+		double start_time = glfwGetTime();
+
+		RCmds_processCommands(backend_data->thread.cmd_buffer);
+
+		metrics.frontend_time = (glfwGetTime() - start_time) * 1000.0;
+
+		SetEvent(backend_data->thread.event_completed);
+	}
+
+	return 0;
+}
+
+static void RCore_StartRenderThreadFrame()
+{
+	//keep recording into the other buffer while this one is processed
+	backend_data->thread.cmd_buffer = cmdBuffer;
+
+	backend_data->cmd_buffer_index = (backend_data->cmd_buffer_index + 1) % 2;
+	cmdBuffer = backend_data->cmd_buffers[backend_data->cmd_buffer_index];
+
+	backend_data->thread.boolean_active = true;
+
+	SetEvent(backend_data->thread.event_work_permssion);
 }
 
 static void RCore_DrawUI()
@@ -446,7 +609,7 @@ static void RCore_DrawUI()
 /*
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 Called in c_main.c. Called by the main thread
-Dispatches various computes, adds jobs to render thread, updates metrics
+Dispatches various computes, processes the frame if the render thread hasn't, updates metrics
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 */
 void RCore_Start()
@@ -456,29 +619,36 @@ void RCore_Start()
 	//Render panel, metrics ui
 	RCore_DrawUI();
 
-	if (drawData->lc_world.world_render_data)
+	//The console can change r_multithread during the frame, so the end of the frame uses the same choice
+	backend_data->threaded_frame = r_cvars.r_multithread->int_value == 1 && backend_data->thread.handle;
+
+	//Process various renderer tasks, unless the render thread already did it during the last frame.
+	//If the render thread takes this frame, the commands are left for it, even if nothing was published,
+	//so they are never processed twice and the thread's buffer keeps the LC_Draw recorded before this
+	if (!backend_data->frame_published && !backend_data->threaded_frame)
 	{
-		glNamedBufferSubData(drawData->lc_world.world_render_data->prev_in_frustrum_bitset_buffer, 0, sizeof(int) * 500, scene.cull_data.lc_world.frustrum_query_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, drawData->lc_world.world_render_data->chunk_data_buffer.buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, drawData->lc_world.world_render_data->visibles_sorted_buffer);
-	}
-	
+		double start_time = glfwGetTime();
+
+		RCmds_processCommands(cmdBuffer);
+
+		metrics.frontend_time = (glfwGetTime() - start_time) * 1000.0;
+		metrics.sync_wait_time = 0;
 
-	//Process various renderer tasks
-	RCmds_processCommands();
+		RCore_PublishFrame();
+	}
+	backend_data->frame_published = false;
 
 	if (drawData->lc_world.world_render_data)
 	{
-		glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, 0, sizeof(int) * scene.cull_data.lc_world.total_in_frustrum_count, scene.cull_data.lc_world.frustrum_sorted_query_buffer);
-		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, drawData->lc_world.world_render_data->chunk_data_buffer.buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, drawData->lc_world.world_render_data->visibles_sorted_buffer);
 	}
-	
 
 	////Dispatch computes
 	Compute_DispatchAll();
 
 	//Update backend stuff
-	//RCore_updateMetrics();
+	RCore_updateMetrics();
 	RCore_checkForModifiedCvars();
 }
 /*
@@ -492,19 +662,49 @@ void RCore_End()
 	{
 		Cvar_setValueDirectInt(r_cvars.r_drawPanel, !r_cvars.r_drawPanel->int_value);
 	}
-	//Sync the render process thread and dispatched gl computes
-	//and upload data to gpu
+	//Sync the dispatched gl computes
 	Compute_Sync();
-	//CPU SYNC
 
-	//Upload data to gpu
-	RCore_UploadGpuData();
+	//Simulate gpu particles, needs the uploaded camera and emitter data
+	Compute_Particles();
+
+	//From here on the passes only read the snapshot, so the render thread can process the next frame
+	if (backend_data->threaded_frame)
+	{
+		RCore_StartRenderThreadFrame();
+	}
 
 	//Perform main rendering pass
+	double start_time = glfwGetTime();
+
 	metrics.total_render_frame_count++;
 	Pass_Main();
 
-	//Perform cleanup at the end of the main rendering passes
-	RCore_EndFrameCleanup();
-	
+	metrics.backend_time = (glfwGetTime() - start_time) * 1000.0;
+}
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+Called in c_main.c. Called by the main thread after the buffers are swapped.
+Waits for the render thread and publishes the frame it processed,
+the game can't modify the world or the scene while it's working
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void RCore_Sync()
+{
+	if (!backend_data->thread.boolean_active)
+	{
+		return;
+	}
+
+	double start_time = glfwGetTime();
+
+	WaitForSingleObject(backend_data->thread.event_completed, INFINITE);
+
+	metrics.sync_wait_time = (glfwGetTime() - start_time) * 1000.0;
+
+	backend_data->thread.boolean_active = false;
+
+	RCore_PublishFrame();
+
+	backend_data->frame_published = true;
 }
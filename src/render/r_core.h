@@ -11,7 +11,9 @@
 #include "core/cvar.h"
 #include "lc/lc_world.h"
 #include "utility/u_object_pool.h"
+#include "utility/u_arena.h"
 #include "utility/BVH_Tree.h"
+#include "render/r_public.h"
 #include "render/r_shader.h"
 #include "render/shaders/shader_info.h"
 
@@ -255,34 +257,28 @@ typedef struct
 	size_t allocated_size;
 } RDraw_CubeData;
 
+//Must match cull_chunks.comp
+typedef enum
+{
+	LC_PASS_CULL_LIST__SHADOW_OPAQUE = 0, //one list per shadow split
+	LC_PASS_CULL_LIST__SHADOW_TRANSPARENT = 4, //one list per shadow split
+	LC_PASS_CULL_LIST__REFLECTION_OPAQUE = 8,
+	LC_PASS_CULL_LIST__REFLECTION_TRANSPARENT = 9,
+	LC_PASS_CULL_LIST__MAX = 10
+} LC_PassCullList;
+
 typedef struct
 {
 	bool draw;
 	LC_WorldRenderData* world_render_data;
 
-	dynamic_array* shadow_firsts[4];
-	dynamic_array* shadow_counts[4];
-
-	dynamic_array* shadow_firsts_transparent[4];
-	dynamic_array* shadow_counts_transparent[4];
-
-	dynamic_array* shadow_sorted_chunk_indexes;
-	dynamic_array* shadow_sorted_chunk_transparent_indexes;
-
-	int shadow_sorted_chunk_offsets[4];
-	int shadow_sorted_chunk_transparent_offsets[4];
-
-	dynamic_array* reflection_pass_opaque_firsts;
-	dynamic_array* reflection_pass_opaque_counts;
-
-	dynamic_array* reflection_pass_transparent_firsts;
-	dynamic_array* reflection_pass_transparent_counts;
-
-	dynamic_array* reflection_pass_chunk_indexes;
-	dynamic_array* reflection_pass_transparent_chunk_indexes;
+	unsigned pass_draw_cmds_buffer; //compacted shadow and reflection draw cmds, LC_WORLD_MAX_CHUNK_LIMIT per LC_PassCullList
+	unsigned pass_draw_counts_buffer; //draw count per LC_PassCullList, used as the GL_PARAMETER_BUFFER
 } RDraw_LCWorldData;
 
 
+#define PARTICLE_INSTANCE_FLOAT_COUNT 24 //mat3x4 + uv + color + custom
+
 typedef struct
 {	
 	int total_particle_amount;
@@ -299,6 +295,25 @@ typedef struct
 	size_t allocated_size;
 
 	dynamic_array* instance_buffer;
+
+	//GPU PATH
+	unsigned gpu_vao;
+	unsigned gpu_particle_buffer;
+	unsigned gpu_emitter_buffer;
+	unsigned gpu_instance_buffer;
+	unsigned gpu_draw_cmd_buffer;
+
+	int gpu_particle_amount;
+	int gpu_emitter_amount;
+	size_t gpu_emitter_allocated_size;
+
+	bool gpu_enabled;
+	bool gpu_rebuild;
+
+	mat4 gpu_prev_view_proj;
+
+	dynamic_array* gpu_emitters; //ParticleEmitterGL
+	dynamic_array* gpu_rebuild_particles; //Particle, only filled when the particle buffer is rebuilt
 } RDraw_ParticleData;
 
 typedef struct
@@ -321,9 +336,13 @@ typedef struct
 typedef struct
 {
 	RShader process_chunks_shader;
+	RShader cull_chunks_shader;
 	RShader water_shader;
-	RShader occlusion_box_shader;
 	RShader world_shader;
+	RShader horizon_shader;
+
+	unsigned occlusion_readback_buffers[3]; //LC_OcclusionCounters, read 2 frames later so we don't stall
+	int occlusion_readback_index;
 } RPass_LCSpecificData;
 
 typedef struct
@@ -436,6 +455,10 @@ typedef struct
 	unsigned depth_halfsize_texture;
 	unsigned normal_halfsize_texture;
 	unsigned perlin_noise_texture;
+
+	RShader hiz_shader;
+	unsigned hiz_texture; //farthest depth pyramid, level 0 is half the screen size
+	int hiz_levels;
 }RPass_General;
 
 typedef struct
@@ -444,6 +467,11 @@ typedef struct
 	RShader post_process_shader;
 } RPass_ProcessData;
 
+typedef struct
+{
+	RShader simulate_shader;
+} RPass_Particles;
+
 #define SHADOW_CASCADE_LEVELS 4
 #define LIGHT_MATRICES_COUNT 5
 #define SHADOW_MAP_SIZE 2048
@@ -459,6 +487,14 @@ typedef struct
 	vec2 shadow_sample_kernels[32];
 	int num_shadow_sample_kernels;
 	float quality_radius_scale;
+
+	//CACHING
+	mat4 cached_matrixes[4]; //the light matrixes the splits were last rendered with
+	vec3 split_boxes[4][2]; //world space bounds of each split
+	bool split_dirty[4];
+	bool split_render[4]; //is the split rendered this frame
+	int next_stagger_split;
+	bool invalidate_cache; //rerender all splits on the next frame
 } RPass_ShadowMappingData;
 
 typedef struct
@@ -475,6 +511,7 @@ typedef struct
 	RPass_ShadowMappingData shadow;
 	RPass_Water water;
 	RPass_Godray godray;
+	RPass_Particles particles;
 } RPass_PassData;
 
 /*
@@ -487,18 +524,31 @@ typedef struct
 	DWORD id;
 	HANDLE handle;
 
-	HANDLE event_active;
 	HANDLE event_completed;
 	HANDLE event_work_permssion;
 
-	bool boolean_active;
+	R_CMD_Buffer* cmd_buffer; //the buffer being processed
+
+	bool boolean_active; //is a frame being processed
+	bool exit_request;
 
 } R_Thread;
 
+#define RENDER_FRAME_ARENA_SIZE 1024 * 1024
 typedef struct
 {
 	R_Thread thread;
 
+	//the main thread records into one while the render thread processes the other
+	R_CMD_Buffer* cmd_buffers[2];
+	int cmd_buffer_index;
+
+	bool frame_published; //the render thread already processed the frame that is drawn next
+	bool threaded_frame; //the render thread takes this frame's commands, decided once in RCore_Start
+
+	//transient allocations of the frontend, reset after the frame is published
+	Arena frame_arena;
+
 	bool skip_frame;
 
 	vec2 screenSize;
@@ -563,6 +613,7 @@ typedef struct
 	Cvar* r_shadowQualityLevel; //256 + (level * 256)
 	Cvar* r_shadowBlurLevel; 
 	Cvar* r_shadowSplits;
+	Cvar* r_shadowCache; //0 = render all splits every frame, 1 = only rerender far splits when they change
 
 	//DOF
 	Cvar* r_DepthOfFieldMode; //0 == box, 1 == circular
@@ -571,6 +622,11 @@ typedef struct
 	//WATER
 	Cvar* r_waterReflectionQuality;
 
+	//PARTICLES
+	Cvar* r_particleWorkerThreads;
+	Cvar* r_particleBenchmark;
+	Cvar* r_particleGpu; //0 = cpu fallback, 1 = compute shaders
+
 	//DEBUG
 	Cvar* r_drawDebugTexture; //-1 disabled, 0 = Normal, 1 = Albedo, 2 = Depth, 3 = Metal, 4 = Rough, 5 = AO
 	Cvar* r_wireframe;
@@ -592,6 +648,25 @@ typedef struct
 	float prev_frame_time;
 	int fps;
 
+	float frontend_time; //command processing, culling, particles and shadow matrixes
+	float backend_time; //gl submission of the main pass
+	float sync_wait_time; //main thread waiting for the render thread
+
+	int shadow_splits_rendered;
+
+	int occlusion_culled_chunks;
+	int occlusion_saved_draw_cmds;
+	int occlusion_disoccluded_chunks;
+
+	//MEMORY
+	long long prev_alloc_count;
+	int frame_alloc_count; //dynamic array allocations during the last frame
+	long long allocated_bytes;
+	long long peak_allocated_bytes;
+	size_t frame_arena_used;
+	size_t frame_arena_peak;
+	unsigned frame_arena_overflows;
+
 	size_t total_render_frame_count;
 } R_Metrics;
 
@@ -709,15 +784,10 @@ typedef struct
 
 typedef struct
 {
-	int shadow_cull_count[4];
-	int shadow_cull_transparent_count[4];
-
 	int total_in_frustrum_count;
 	int opaque_in_frustrum;
 	int transparent_in_frustrum;
 	int water_in_frustrum;
-	int reflection_opaque_count;
-	int reflection_transparent_count;
 
 	int frustrum_query_buffer[MAX_CULL_QUERY_BUFFER_ITEMS];
 	int frustrum_sorted_query_buffer[MAX_CULL_QUERY_BUFFER_ITEMS];
@@ -750,6 +820,61 @@ typedef struct
 	bool dirty_cam;
 }R_Scene;
 
+/*
+* ~~~~~~~~~~~~~~~~~~~~
+	FRAME SNAPSHOT
+* ~~~~~~~~~~~~~~~~~~~
+*/
+#define LC_FRUSTRUM_BITSET_ITEMS 500
+
+//Results of the command processing that the passes read while the render thread processes the next frame.
+//Taken on the main thread when the frame is published, after the batches and ubos are uploaded
+typedef struct
+{
+	//CAMERA
+	mat4 view;
+	mat4 proj;
+	mat4 viewProjection;
+
+	//SHADOWS
+	mat4 shadow_matrixes[4];
+	vec3 shadow_split_boxes[4][2];
+	bool shadow_split_render[4];
+
+	//WATER
+	mat4 reflection_view_matrix;
+	mat4 reflection_projView_matrix;
+
+	//ENVIRONMENT
+	RScene_Environment environment; //the panel and the public setters change the scene's copy between frames
+
+	//LC WORLD
+	bool draw_lc_world;
+	int lc_total_in_frustrum;
+	int lc_opaque_in_frustrum;
+	int lc_transparent_in_frustrum;
+	int lc_water_in_frustrum;
+	int lc_frustrum_bitset[LC_FRUSTRUM_BITSET_ITEMS]; //uploaded as the previous frame's bits on the next publish
+
+	//BATCHES
+	size_t screen_quad_indices_count;
+	unsigned screen_quad_textures[SCREEN_QUAD_MAX_TEXTURES_IN_ARRAY];
+
+	size_t line_vertices_count;
+
+	size_t triangle_vertices_count;
+	unsigned triangle_textures[32];
+
+	int cube_instance_count;
+	unsigned cube_textures[32];
+	int cube_texture_count;
+
+	int particle_instance_count;
+	unsigned particle_textures[32];
+	int particle_texture_count;
+	bool gpu_particles_enabled;
+} R_FrameSnapshot;
+
 /*
 * ~~~~~~~~~~~~~~~~~~~~
 	GENERIC RESOURCES
@@ -796,8 +921,9 @@ typedef struct
 	Object_Pool* point_lights_pool;
 	Object_Pool* spot_lights_pool;
 
-	dynamic_array* point_lights_backbuffer;
-	dynamic_array* spot_lights_backbuffer;
+	//culled lights of the frame, allocated from the frame arena
+	PointLight* point_lights_backbuffer;
+	SpotLight* spot_lights_backbuffer;
 
 	RenderStorageBuffer point_lights;
 	RenderStorageBuffer spot_lights;
@@ -818,6 +944,7 @@ typedef struct
 */
 void RInternal_GetShadowQualityData(int p_qualityLevel, int p_blurLevel, float* r_shadowMapSize, float* r_kernels, int* r_numKernels, float* r_qualityRadius);
 void RInternal_ProcessIBLCubemap(bool p_fast, bool p_irradiance, bool p_prefilter, bool p_brdf);
+void RInternal_ResizeHiZTexture(int p_width, int p_height);
 
 /*
 * ~~~~~~~~~~~~~~~~~~~~
@@ -828,6 +955,7 @@ typedef enum
 {
 	RPass__STANDART,
 	RPass__DEPTH_PREPASS,
+	RPass__DEPTH_PREPASS_DISOCCLUDED,
 	RPass__GBUFFER,
 	RPass__SHADOW_MAPPING_SPLIT1,
 	RPass__SHADOW_MAPPING_SPLIT2,
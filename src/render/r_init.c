@@ -25,6 +25,12 @@ extern R_Cvars r_cvars;
 extern R_StorageBuffers storage;
 extern R_Scene scene;
 extern R_RendererResources resources;
+extern R_FrameSnapshot snapshot;
+
+extern DWORD WINAPI RCore_RenderThreadLoop(LPVOID p_arg);
+extern bool RParticles_Init();
+extern void RParticles_Exit();
+extern void RParticles_FreeStorage(ParticleSoA* const p_particles);
 
 static float INIT_WIDTH = 1280;
 static float INIT_HEIGHT = 720;
@@ -40,7 +46,7 @@ static void CheckBoundFrameBufferStatus(const char* p_fboName)
 
 static void Init_registerCvars()
 {
-   // r_cvars.r_multithread = Cvar_Register("r_multithread", "1", "Use multiple threads for rendering", CVAR__SAVE_TO_FILE, 0, 1);
+    r_cvars.r_multithread = Cvar_Register("r_multithread", "1", "Process the next frame on the render thread while the current one is submitted", CVAR__SAVE_TO_FILE, 0, 1);
    // r_cvars.r_limitFPS = Cvar_Register("r_limitFPS", "1", "Limit FPS with r_maxFPS", CVAR__SAVE_TO_FILE, 0, 1);
    // r_cvars.r_maxFPS = Cvar_Register("r_maxFPS", "144", NULL, CVAR__SAVE_TO_FILE, 30, 1000);
     r_cvars.r_useDirShadowMapping = Cvar_Register("r_useDirShadowMapping", "1", NULL, CVAR__SAVE_TO_FILE, 0, 1);
@@ -85,6 +91,7 @@ static void Init_registerCvars()
     r_cvars.r_shadowQualityLevel = Cvar_Register("r_shadowQualityLevel", "7", NULL, CVAR__SAVE_TO_FILE, 0, 24);
     r_cvars.r_shadowBlurLevel = Cvar_Register("r_shadowBlurLevel", "1", NULL, CVAR__SAVE_TO_FILE, 0, 4);
     r_cvars.r_shadowSplits = Cvar_Register("r_shadowSplits", "4", NULL, CVAR__SAVE_TO_FILE, 1, 4);
+    r_cvars.r_shadowCache = Cvar_Register("r_shadowCache", "1", NULL, CVAR__SAVE_TO_FILE, 0, 1);
     
     //DOF SPECIFIC
     r_cvars.r_DepthOfFieldMode = Cvar_Register("r_DepthOfFieldMode", "0", NULL, CVAR__SAVE_TO_FILE, 0, 1);
@@ -93,6 +100,11 @@ static void Init_registerCvars()
     //WATER 
     r_cvars.r_waterReflectionQuality = Cvar_Register("r_waterReflectionQuality", "1", NULL, CVAR__SAVE_TO_FILE, 0, 2);
 
+    //PARTICLES
+    r_cvars.r_particleWorkerThreads = Cvar_Register("r_particleWorkerThreads", "4", "Max worker threads used for simulating cpu particles. 0 = main thread only", CVAR__SAVE_TO_FILE, 0, 4);
+    r_cvars.r_particleBenchmark = Cvar_Register("r_particleBenchmark", "0", "Set to 1 to run the 100k particle benchmark", 0, 0, 1);
+    r_cvars.r_particleGpu = Cvar_Register("r_particleGpu", "1", "Simulate particles with compute shaders. 0 = cpu fallback", CVAR__SAVE_TO_FILE, 0, 1);
+
     //DEBUG
     r_cvars.r_drawDebugTexture = Cvar_Register("r_drawDebugTexture", "-1", NULL, 0, -1, 5);
     r_cvars.r_wireframe = Cvar_Register("r_wireframe", "0", NULL, 0, 0, 2);
@@ -369,27 +381,8 @@ static void Init_CubeDrawData()
     
 }
 
-static void Init_ParticleDrawData()
+static void Init_ParticleQuadAttributes()
 {
-    drawData->particles.instance_buffer = dA_INIT(float, 0);
-    
-    const float quad_vertices[] =
-    {       -1, 1, 0,   0, 0,    0, 0, 1,  
-            -1, -1, 0,   0, 1,    0, 0, 1,
-             1, -1, 0,   1, 1,    0, 0, 1,
-             1, 1, 0,   1, 0,    0, 0, 1,
-    };
-
-    //setup vao and vbo
-    glGenVertexArrays(1, &drawData->particles.vao);
-    glGenBuffers(1, &drawData->particles.vbo);
-    glGenBuffers(1, &drawData->particles.instance_vbo);
-
-    //BASE QUAD SETUP
-    glBindVertexArray(drawData->particles.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
-
     //POSITION
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)0);
     glEnableVertexAttribArray(0);
@@ -399,14 +392,10 @@ static void Init_ParticleDrawData()
     //NORMAL
     glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float) * 5));
     glEnableVertexAttribArray(3);
+}
 
-   
-    //INSTANCE BUFFER
-    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.instance_vbo);
-    glBufferData(GL_ARRAY_BUFFER, 32, NULL, GL_STREAM_DRAW);
-
-    drawData->particles.allocated_size = 32;
-
+static void Init_ParticleInstanceAttributes()
+{
     const int STRIDE = sizeof(float) * (4 + 4 + 4 + 4 + 4 + 4);
     glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, STRIDE, (void*)0);
     glEnableVertexAttribArray(7);
@@ -431,7 +420,79 @@ static void Init_ParticleDrawData()
     glVertexAttribPointer(12, 4, GL_FLOAT, GL_FALSE, STRIDE, (void*)(sizeof(float) * 20));
     glEnableVertexAttribArray(12);
     glVertexAttribDivisor(12, 1);
+}
 
+static void Init_ParticleDrawData()
+{
+    drawData->particles.instance_buffer = dA_INIT(float, 0);
+    drawData->particles.gpu_emitters = dA_INIT(ParticleEmitterGL, 0);
+    drawData->particles.gpu_rebuild_particles = dA_INIT(Particle, 0);
+    
+    const float quad_vertices[] =
+    {       -1, 1, 0,   0, 0,    0, 0, 1,  
+            -1, -1, 0,   0, 1,    0, 0, 1,
+             1, -1, 0,   1, 1,    0, 0, 1,
+             1, 1, 0,   1, 0,    0, 0, 1,
+    };
+
+    //setup vao and vbo
+    glGenVertexArrays(1, &drawData->particles.vao);
+    glGenBuffers(1, &drawData->particles.vbo);
+    glGenBuffers(1, &drawData->particles.instance_vbo);
+
+    //BASE QUAD SETUP
+    glBindVertexArray(drawData->particles.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
+
+    Init_ParticleQuadAttributes();
+   
+    //INSTANCE BUFFER
+    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, 32, NULL, GL_STREAM_DRAW);
+
+    drawData->particles.allocated_size = 32;
+
+    Init_ParticleInstanceAttributes();
+
+    //GPU PATH
+    //The particle state stays on the gpu, the compute shader writes the visible particles 
+    //into the instance buffer and the instance count into the draw cmd
+    glGenVertexArrays(1, &drawData->particles.gpu_vao);
+    glGenBuffers(1, &drawData->particles.gpu_particle_buffer);
+    glGenBuffers(1, &drawData->particles.gpu_emitter_buffer);
+    glGenBuffers(1, &drawData->particles.gpu_instance_buffer);
+    glGenBuffers(1, &drawData->particles.gpu_draw_cmd_buffer);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawData->particles.gpu_particle_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Particle), NULL, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawData->particles.gpu_emitter_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ParticleEmitterGL), NULL, GL_STREAM_DRAW);
+    drawData->particles.gpu_emitter_allocated_size = sizeof(ParticleEmitterGL);
+
+    DrawArraysIndirectCommand draw_cmd;
+    memset(&draw_cmd, 0, sizeof(DrawArraysIndirectCommand));
+    draw_cmd.count = 4;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawData->particles.gpu_draw_cmd_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawArraysIndirectCommand), &draw_cmd, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindVertexArray(drawData->particles.gpu_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.vbo);
+
+    Init_ParticleQuadAttributes();
+
+    glBindBuffer(GL_ARRAY_BUFFER, drawData->particles.gpu_instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, 32, NULL, GL_DYNAMIC_DRAW);
+
+    Init_ParticleInstanceAttributes();
+
+    glBindVertexArray(0);
+
+    drawData->particles.gpu_rebuild = true;
 }
 
 static void Init_DrawData()
@@ -475,11 +536,17 @@ static bool Init_GeneralPassData()
 
     CheckBoundFrameBufferStatus("General");
 
+    //HI-Z
+    bool result2;
+    pass->general.hiz_shader = Shader_ComputeCreate("shaders/screen/hiz_downsample.comp", 0, HIZ_DOWNSAMPLE_UNIFORM_MAX, 1, NULL, HIZ_DOWNSAMPLE_UNIFORMS_STR, HIZ_DOWNSAMPLE_TEXTURES_STR, &result2);
+
+    RInternal_ResizeHiZTexture(INIT_WIDTH, INIT_HEIGHT);
+
     R_Texture noise = Texture_Load("assets/perlin_noise.png", NULL);
 
     pass->general.perlin_noise_texture = noise.id;
     
-    return result;
+    return result && result2;
 }
 
 static bool Init_PostProcessData()
@@ -496,40 +563,43 @@ static bool Init_PostProcessData()
 
 static bool Init_LCSpecificData()
 {
-    for (int i = 0; i < 4; i++)
-    {
-        drawData->lc_world.shadow_counts[i] = dA_INIT(int, 0);
-        drawData->lc_world.shadow_firsts[i] = dA_INIT(int, 0);
-
-        drawData->lc_world.shadow_counts_transparent[i] = dA_INIT(int, 0);
-        drawData->lc_world.shadow_firsts_transparent[i] = dA_INIT(int, 0);
-    }
-    drawData->lc_world.shadow_sorted_chunk_indexes = dA_INIT(int, 0);
-    drawData->lc_world.shadow_sorted_chunk_transparent_indexes = dA_INIT(int, 0);
-
-    drawData->lc_world.reflection_pass_opaque_counts = dA_INIT(int, 0);
-    drawData->lc_world.reflection_pass_opaque_firsts = dA_INIT(int, 0);
-
-    drawData->lc_world.reflection_pass_transparent_counts = dA_INIT(int, 0);
-    drawData->lc_world.reflection_pass_transparent_firsts = dA_INIT(int, 0);
+    //written by cull_chunks.comp
+    glGenBuffers(1, &drawData->lc_world.pass_draw_cmds_buffer);
+    glGenBuffers(1, &drawData->lc_world.pass_draw_counts_buffer);
 
-    drawData->lc_world.reflection_pass_chunk_indexes = dA_INIT(int, 0);
-    drawData->lc_world.reflection_pass_transparent_chunk_indexes = dA_INIT(int, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawData->lc_world.pass_draw_cmds_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * LC_PASS_CULL_LIST__MAX, NULL, GL_DYNAMIC_DRAW);
 
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawData->lc_world.pass_draw_counts_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned) * LC_PASS_CULL_LIST__MAX, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     bool result = false;
     pass->lc.world_shader = Shader_PixelCreate("shaders/lc_world/lc_world.vert", "shaders/lc_world/lc_world.frag", LC_WORLD_DEFINE_MAX, LC_WORLD_UNIFORM_MAX, 6, LC_WORLD_DEFINES_STR, LC_WORLD_UNIFORMS_STR, LC_WORLD_TEXTURES_STR, &result);
     
-    bool result2 = false;
-    pass->lc.occlusion_box_shader = Shader_PixelCreate("shaders/lc_world/lc_occlusion_boxes.vert", "shaders/lc_world/lc_occlusion_boxes.frag", 0, 0, 0, NULL, NULL, NULL, &result2);
+    //stats of the hi-z occlusion culling
+    glGenBuffers(3, pass->lc.occlusion_readback_buffers);
+
+    for (int i = 0; i < 3; i++)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pass->lc.occlusion_readback_buffers[i]);
+        glBufferData(GL_COPY_WRITE_BUFFER, sizeof(LC_OcclusionCounters), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
     bool result3 = false;
     pass->lc.water_shader = Shader_PixelCreate("shaders/lc_world/lc_water.vert", "shaders/lc_world/lc_water.frag", 0, 0, 6, NULL, NULL, LC_WATER_TEXTURES_STR, &result3);
 
     bool result4 = false;
-    pass->lc.process_chunks_shader = Shader_ComputeCreate("shaders/lc_world/process_chunks.comp", 0, PROCESS_CHUNKS_UNIFORM_MAX, 0, NULL, PROCESS_CHUNKS_UNIFORMS_STR, NULL, &result4);
+    pass->lc.process_chunks_shader = Shader_ComputeCreate("shaders/lc_world/process_chunks.comp", 0, PROCESS_CHUNKS_UNIFORM_MAX, 1, NULL, PROCESS_CHUNKS_UNIFORMS_STR, PROCESS_CHUNKS_TEXTURES_STR, &result4);
+
+    bool result5 = false;
+    pass->lc.cull_chunks_shader = Shader_ComputeCreate("shaders/lc_world/cull_chunks.comp", 0, CULL_CHUNKS_UNIFORM_MAX, 0, NULL, CULL_CHUNKS_UNIFORMS_STR, NULL, &result5);
+
+    bool result6 = false;
+    pass->lc.horizon_shader = Shader_PixelCreate("shaders/lc_world/lc_horizon.vert", "shaders/lc_world/lc_horizon.frag", LC_HORIZON_DEFINE_MAX, LC_HORIZON_UNIFORM_MAX, 3, LC_HORIZON_DEFINES_STR, LC_HORIZON_UNIFORMS_STR, LC_HORIZON_TEXTURES_STR, &result6);
 
-    return result && result2 && result3 && result4;
+    return result && result3 && result4 && result5 && result6;
 }
 
 static bool Init_DeferredData()
@@ -938,6 +1008,7 @@ static void Init_ShadowMappingData()
     pass->shadow.cascade_levels[3] = z_far / 10.0f;
 
     pass->shadow.shadow_map_size = SHADOW_MAP_SIZE;
+    pass->shadow.invalidate_cache = true;
 }
 
 static void Init_WaterData()
@@ -1011,6 +1082,14 @@ static bool Init_GodrayData()
 }
 
 
+static bool Init_ParticlesData()
+{
+    bool result;
+    pass->particles.simulate_shader = Shader_ComputeCreate("shaders/particles/particles.comp", 0, PARTICLES_UNIFORM_MAX, 2, NULL, PARTICLES_UNIFORMS_STR, PARTICLES_TEXTURES_STR, &result);
+
+    return result;
+}
+
 static bool Init_PassData()
 {
     if(!Init_PostProcessData()) return false;
@@ -1025,6 +1104,7 @@ static bool Init_PassData()
     Init_ShadowMappingData();
     Init_WaterData();
     if(!Init_GodrayData()) return false;
+    if(!Init_ParticlesData()) return false;
 
     return true;
 }
@@ -1088,12 +1168,18 @@ static void Init_SceneData()
 
 static bool _initRenderThread()
 {
-    /*
+    //create events
+    backend_data->thread.event_completed = CreateEvent(NULL, FALSE, FALSE, NULL);
+    backend_data->thread.event_work_permssion = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    if (!backend_data->thread.event_completed || !backend_data->thread.event_work_permssion)
+        return false;
+
     backend_data->thread.handle = CreateThread
     (
         NULL,
         0,
-        (LPTHREAD_START_ROUTINE)r_threadLoop,
+        RCore_RenderThreadLoop,
         0,
         0,
         &backend_data->thread.id
@@ -1103,20 +1189,6 @@ static bool _initRenderThread()
     {
         return false;
     }
-    
-    //create events
-    backend_data->thread.event_active = CreateEvent(NULL, TRUE, FALSE, NULL);
-    backend_data->thread.event_completed = CreateEvent(NULL, TRUE, FALSE, NULL);
-    backend_data->thread.event_work_permssion = CreateEvent(NULL, TRUE, FALSE, NULL);
-
-    if (!backend_data->thread.event_active || !backend_data->thread.event_completed || !backend_data->thread.event_work_permssion)
-        return false;
-
-
-    ResetEvent(backend_data->thread.event_active);
-    ResetEvent(backend_data->thread.event_completed);
-    ResetEvent(backend_data->thread.event_work_permssion);
-    */
 
     return true;
 }
@@ -1128,9 +1200,7 @@ static void Init_StorageBuffers()
     storage.particle_emitter_clients = FL_INIT(ParticleEmitterSettings);
 
     storage.point_lights_pool = Object_Pool_INIT(PointLight, 0);
-    storage.point_lights_backbuffer = dA_INIT(PointLight, 0);
     storage.spot_lights_pool = Object_Pool_INIT(SpotLight, 0);
-    storage.spot_lights_backbuffer = dA_INIT(SpotLight, 0);
    
     storage.spot_lights = RSB_Create(10000, sizeof(SpotLight), RSB_FLAG__RESIZABLE | RSB_FLAG__WRITABLE);
     storage.point_lights = RSB_Create(10000, sizeof(PointLight), RSB_FLAG__RESIZABLE | RSB_FLAG__WRITABLE);
@@ -1224,30 +1294,68 @@ static void Init_Inputs()
     Input_setActionBinding("Open-panel", IT__KEYBOARD, GLFW_KEY_P, 0);
 }
 
+static R_CMD_Buffer* Init_CreateCmdBuffer()
+{
+    R_CMD_Buffer* cmd_buffer = malloc(sizeof(R_CMD_Buffer));
+
+    if (!cmd_buffer)
+    {
+        return NULL;
+    }
+    memset(cmd_buffer, 0, sizeof(R_CMD_Buffer));
+
+    cmd_buffer->cmds_data = malloc(RENDER_BUFFER_COMMAND_ALLOC_SIZE);
+    if (!cmd_buffer->cmds_data)
+    {
+        free(cmd_buffer);
+        return NULL;
+    }
+    memset(cmd_buffer->cmds_data, 0, RENDER_BUFFER_COMMAND_ALLOC_SIZE);
+    cmd_buffer->cmds_ptr = cmd_buffer->cmds_data;
+
+    return cmd_buffer;
+}
+
+static void Init_DestroyCmdBuffer(R_CMD_Buffer* p_cmdBuffer)
+{
+    if (!p_cmdBuffer)
+    {
+        return;
+    }
+    free(p_cmdBuffer->cmds_data);
+    free(p_cmdBuffer);
+}
+
 static int Init_Mem()
 {
-    cmdBuffer = malloc(sizeof(R_CMD_Buffer));
+    backend_data = malloc(sizeof(R_BackendData));
 
-    if (!cmdBuffer)
+    if (!backend_data)
     {
         return false;
     }
-    memset(cmdBuffer, 0, sizeof(R_CMD_Buffer));
+    memset(backend_data, 0, sizeof(R_BackendData));
 
-    cmdBuffer->cmds_data = malloc(RENDER_BUFFER_COMMAND_ALLOC_SIZE);
-    if (!cmdBuffer->cmds_data)
+    //double buffered, see RCore_StartRenderThreadFrame()
+    for (int i = 0; i < 2; i++)
     {
-        free(cmdBuffer);
-        return false;
+        backend_data->cmd_buffers[i] = Init_CreateCmdBuffer();
+
+        if (!backend_data->cmd_buffers[i])
+        {
+            Init_DestroyCmdBuffer(backend_data->cmd_buffers[0]);
+            free(backend_data);
+            return false;
+        }
     }
-    memset(cmdBuffer->cmds_data, 0, RENDER_BUFFER_COMMAND_ALLOC_SIZE);
-    cmdBuffer->cmds_ptr = cmdBuffer->cmds_data;
+    cmdBuffer = backend_data->cmd_buffers[0];
 
     drawData = malloc(sizeof(RDraw_DrawData));
     if (!drawData)
     {
-        free(cmdBuffer->cmds_data);
-        free(cmdBuffer);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[0]);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[1]);
+        free(backend_data);
         return false;
     }
     memset(drawData, 0, sizeof(RDraw_DrawData));
@@ -1256,29 +1364,29 @@ static int Init_Mem()
 
     if (!pass)
     {
-        free(cmdBuffer->cmds_data);
-        free(cmdBuffer);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[0]);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[1]);
+        free(backend_data);
         free(drawData);
         return false;
     }
     memset(pass, 0, sizeof(RPass_PassData));
 
-    backend_data = malloc(sizeof(R_BackendData));
-
-    if (!backend_data)
+    if (!Arena_Init(&backend_data->frame_arena, RENDER_FRAME_ARENA_SIZE))
     {
-        free(cmdBuffer->cmds_data);
-        free(cmdBuffer);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[0]);
+        Init_DestroyCmdBuffer(backend_data->cmd_buffers[1]);
+        free(backend_data);
         free(drawData);
         free(pass);
         return false;
     }
-    memset(backend_data, 0, sizeof(R_BackendData));
 
     //STATIC MEM
     memset(&storage, 0, sizeof(storage));
     memset(&scene, 0, sizeof(scene));
     memset(&resources, 0, sizeof(resources));
+    memset(&snapshot, 0, sizeof(snapshot));
 
     return true;
 }
@@ -1307,6 +1415,14 @@ int Renderer_Init(int p_initWidth, int p_initHeight)
 
     Init_Inputs();
 
+    if (!RParticles_Init()) return false;
+
+    if (!_initRenderThread()) return false;
+
+    ShaderStats shader_stats = Shader_GetStats();
+    printf("Shaders loaded in %.2f ms. %i cached binaries, %i compiled from source, %i variants warming up \n", shader_stats.startup_time, 
+        shader_stats.binary_hits, shader_stats.binary_misses, shader_stats.warmed_up_variants);
+
     backend_data->screenSize[0] = INIT_WIDTH;
     backend_data->screenSize[1] = INIT_HEIGHT;
 
@@ -1322,38 +1438,44 @@ int Renderer_Init(int p_initWidth, int p_initHeight)
 
 void Renderer_Exit()
 {
+    //the render thread is idle after RCore_Sync()
+    backend_data->thread.exit_request = true;
+
+    if (backend_data->thread.handle)
+    {
+        SetEvent(backend_data->thread.event_work_permssion);
+        WaitForSingleObject(backend_data->thread.handle, INFINITE);
+
+        CloseHandle(backend_data->thread.handle);
+    }
+    CloseHandle(backend_data->thread.event_work_permssion);
+    CloseHandle(backend_data->thread.event_completed);
+
+    RParticles_Exit();
+
+    FL_Node* emitter_node = storage.particle_emitter_clients->next;
+    while (emitter_node)
+    {
+        ParticleEmitterSettings* emitter = emitter_node->value;
+        RParticles_FreeStorage(&emitter->particles);
+
+        emitter_node = emitter_node->next;
+    }
     FL_Destruct(storage.particle_emitter_clients);
 
     RSB_Destruct(&storage.spot_lights);
     RSB_Destruct(&storage.point_lights);
     RSB_Destruct(&storage.texture_handles);
     
-    dA_Destruct(storage.point_lights_backbuffer);
-    dA_Destruct(storage.spot_lights_backbuffer);
     dA_Destruct(drawData->cube.vertices_buffer);
     dA_Destruct(drawData->particles.instance_buffer);
+    dA_Destruct(drawData->particles.gpu_emitters);
+    dA_Destruct(drawData->particles.gpu_rebuild_particles);
 
     Object_Pool_Destruct(scene.render_instances_pool);
     Object_Pool_Destruct(storage.point_lights_pool);
     Object_Pool_Destruct(storage.spot_lights_pool);
 
-    for (int i = 0; i < 4; i++)
-    {
-        dA_Destruct(drawData->lc_world.shadow_counts[i]);
-        dA_Destruct(drawData->lc_world.shadow_firsts[i]);
-
-        dA_Destruct(drawData->lc_world.shadow_counts_transparent[i]);
-        dA_Destruct(drawData->lc_world.shadow_firsts_transparent[i]);
-    }
-    dA_Destruct(drawData->lc_world.shadow_sorted_chunk_indexes);
-    dA_Destruct(drawData->lc_world.shadow_sorted_chunk_transparent_indexes);
-    dA_Destruct(drawData->lc_world.reflection_pass_opaque_firsts);
-    dA_Destruct(drawData->lc_world.reflection_pass_opaque_counts);
-    dA_Destruct(drawData->lc_world.reflection_pass_transparent_firsts);
-    dA_Destruct(drawData->lc_world.reflection_pass_transparent_counts);
-    dA_Destruct(drawData->lc_world.reflection_pass_chunk_indexes);
-    dA_Destruct(drawData->lc_world.reflection_pass_transparent_chunk_indexes);
-
     BVH_Tree_Destruct(&scene.cull_data.static_partition_tree);
 
     //destroy shaders
@@ -1362,6 +1484,7 @@ void Renderer_Exit()
     Shader_Destruct(&pass->post.debug_shader);
     Shader_Destruct(&pass->godray.shader);
     Shader_Destruct(&pass->general.blur_shader);
+    Shader_Destruct(&pass->general.hiz_shader);
     Shader_Destruct(&pass->ao.shader);
     Shader_Destruct(&pass->scene.shader_3d_forward);
     Shader_Destruct(&pass->scene.shader_3d_deferred);
@@ -1369,14 +1492,18 @@ void Renderer_Exit()
     Shader_Destruct(&pass->bloom.shader);
     Shader_Destruct(&pass->lc.world_shader);
     Shader_Destruct(&pass->lc.water_shader);
-    Shader_Destruct(&pass->lc.occlusion_box_shader);
     Shader_Destruct(&pass->lc.process_chunks_shader);
+    Shader_Destruct(&pass->lc.cull_chunks_shader);
+    Shader_Destruct(&pass->lc.horizon_shader);
     Shader_Destruct(&pass->ibl.cubemap_shader);
     Shader_Destruct(&pass->deferred.shading_shader);
+    Shader_Destruct(&pass->particles.simulate_shader);
+    Shader_CacheCleanup();
 
     //Mem clean up
-    free(cmdBuffer->cmds_data);
-    free(cmdBuffer);
+    Init_DestroyCmdBuffer(backend_data->cmd_buffers[0]);
+    Init_DestroyCmdBuffer(backend_data->cmd_buffers[1]);
+    Arena_Destruct(&backend_data->frame_arena);
     free(drawData);
     free(pass);
     free(backend_data);
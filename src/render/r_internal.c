@@ -164,4 +164,33 @@ void RInternal_ProcessIBLCubemap(bool p_fast, bool p_irradiance, bool p_prefilte
         glDisable(GL_BLEND);
         Render_Quad();
     }
-}
\ No newline at end of file
+}
+void RInternal_ResizeHiZTexture(int p_width, int p_height)
+{
+    //level 0 is half the screen size, the rest follow the standard mip sizes
+    int base_width = max(p_width / 2, 1);
+    int base_height = max(p_height / 2, 1);
+
+    int levels = 1;
+
+    while ((base_width >> levels) > 0 || (base_height >> levels) > 0)
+    {
+        levels++;
+    }
+
+    //the storage is immutable, so a new texture is made on every resize
+    if (pass->general.hiz_texture)
+    {
+        glDeleteTextures(1, &pass->general.hiz_texture);
+    }
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &pass->general.hiz_texture);
+    glTextureStorage2D(pass->general.hiz_texture, levels, GL_R32F, base_width, base_height);
+
+    glTextureParameteri(pass->general.hiz_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(pass->general.hiz_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(pass->general.hiz_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(pass->general.hiz_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+
+    pass->general.hiz_levels = levels;
+}
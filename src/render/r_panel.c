@@ -4,6 +4,7 @@
 
 #include "render/r_core.h"
 #include "core/core_common.h"
+#include "core/sound.h"
 
 extern NK_Data nk;
 extern GLFWwindow* glfw_window;
@@ -127,6 +128,8 @@ void RPanel_Main()
 		}
 
 		RPanel_CvarCheckbox(r_cvars.r_drawSky, "Draw sky");	
+		RPanel_CvarCheckbox(r_cvars.r_particleGpu, "Gpu particles");
+		RPanel_CvarCheckbox(r_cvars.r_multithread, "Pipelined render thread");
 		nk_tree_pop(nk.ctx);
 	}
 	if (nk_tree_push(nk.ctx, NK_TREE_NODE, "Camera", NK_MAXIMIZED))
@@ -192,6 +195,7 @@ void RPanel_Main()
 
 			RPanel_CvarSlideri(r_cvars.r_shadowQualityLevel, "Quality", 0, r_cvars.r_shadowQualityLevel->max_value, 1, 1);
 			RPanel_CvarSlideri(r_cvars.r_shadowBlurLevel, "Blurring", 0, r_cvars.r_shadowBlurLevel->max_value, 1, 1);
+			RPanel_CvarCheckbox(r_cvars.r_shadowCache, "Cache far splits");
 
 			nk_tree_pop(nk.ctx);
 		}
@@ -373,7 +377,7 @@ void RPanel_Main()
 void RPanel_Metrics()
 {
 	nk_style_push_color(nk.ctx, &nk.ctx->style.window.fixed_background.data.color, nk_rgba(1, 1, 1, 1));
-	if (!nk_begin(nk.ctx, "Renderer metrics", nk_rect(200, 200, 240, 95), NK_WINDOW_NO_SCROLLBAR))
+	if (!nk_begin(nk.ctx, "Renderer metrics", nk_rect(200, 200, 280, 460), NK_WINDOW_NO_SCROLLBAR))
 	{
 		nk_end(nk.ctx);
 		return;
@@ -383,6 +387,32 @@ void RPanel_Metrics()
 	nk_layout_row_dynamic(nk.ctx, 15, 1);
 	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Frame time: %f", metrics.frame_time);
 	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "FPS: %i", metrics.fps);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Frontend ms: %.3f", metrics.frontend_time);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Submit ms: %.3f", metrics.backend_time);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Render thread wait ms: %.3f", metrics.sync_wait_time);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Shadow splits drawn: %i/%i", metrics.shadow_splits_rendered, r_cvars.r_shadowSplits->int_value);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Occlusion culled chunks: %i", metrics.occlusion_culled_chunks);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Draw cmds saved: %i", metrics.occlusion_saved_draw_cmds);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Disoccluded chunks: %i", metrics.occlusion_disoccluded_chunks);
+
+	LC_ChunkCacheStats cache_stats = LC_World_GetChunkCacheStats();
+	unsigned cache_lookups = cache_stats.hits + cache_stats.misses;
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Chunks: %i resident, %i past render distance", cache_stats.resident_chunks, cache_stats.hidden_chunks);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Chunk cache: %i chunks, %.1f/%.0f MB", cache_stats.cached_chunks, cache_stats.cached_bytes / (1024.0 * 1024.0), cache_stats.budget_bytes / (1024.0 * 1024.0));
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Chunk cache hit rate: %.1f%% (%u/%u)", (cache_lookups > 0) ? cache_stats.hits * 100.0 / cache_lookups : 0.0, cache_stats.hits, cache_lookups);
+
+	SoundStats sound_stats = Sound_GetStats();
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Sound voices: %i/%i (%u culled, %u stolen)", sound_stats.active_voices, sound_stats.max_voices, sound_stats.culled, sound_stats.stolen);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Audio mixing: %.2f ms per second", sound_stats.mix_ms_per_second);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Allocs per frame: %i", metrics.frame_alloc_count);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Array memory: %.1f KB (peak %.1f KB)", metrics.allocated_bytes / 1024.0, metrics.peak_allocated_bytes / 1024.0);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Frame arena: %.1f KB (peak %.1f KB)", metrics.frame_arena_used / 1024.0, metrics.frame_arena_peak / 1024.0);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Frame arena overflows: %u", metrics.frame_arena_overflows);
+
+	ShaderStats shader_stats = Shader_GetStats();
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Shader startup ms: %.2f", shader_stats.startup_time);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Shader binaries: %i cached, %i compiled", shader_stats.binary_hits, shader_stats.binary_misses);
+	nk_labelf(nk.ctx, NK_TEXT_ALIGN_LEFT, "Shader hitch ms: %.2f (max %.2f)", shader_stats.last_hitch_time, shader_stats.max_hitch_time);
 	nk_style_pop_color(nk.ctx);
 	nk_style_pop_color(nk.ctx);
 	nk_end(nk.ctx);
@@ -0,0 +1,883 @@
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Cpu particle simulation.
+    Particles are stored per emitter as structure of arrays
+    and simulated in sse batches. Emitters are split into jobs
+    that are shared between the main thread and a small pool
+    of worker threads
+    No gl calls here
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+#include "render/r_core.h"
+
+#include <xmmintrin.h>
+#include <malloc.h>
+
+#include "render/r_public.h"
+#include "utility/u_math.h"
+#include "core/core_common.h"
+
+#define PARTICLE_MAX_WORKER_THREADS 4
+#define PARTICLE_JOB_BATCH_SIZE 4096
+#define PARTICLE_SOA_STREAMS 13 //position 3, velocity 3, color 4, time, local delta, active
+#define PARTICLE_COLLISION_BATCH_SIZE 64
+#define PARTICLE_BENCHMARK_FRAMES 120
+
+extern R_Scene scene;
+extern RDraw_DrawData* drawData;
+extern R_Cvars r_cvars;
+
+typedef struct
+{
+    ParticleEmitterSettings* emitter;
+
+    int start;
+    int end; //padded to the simd width, only the sse passes go this far
+    int particle_end; //end of the real particles, the padding lanes are never restarted, drawn or collided
+
+    double e_delta;
+    double prev_time;
+    double system_time;
+
+    bool draw;
+    int texture_index;
+    M_Rect2Df texture_region;
+
+    uint32_t rng_state;
+
+    dynamic_array* instances;
+} ParticleJob;
+
+typedef struct
+{
+    HANDLE handle;
+    HANDLE event_start;
+    HANDLE event_completed;
+} ParticleWorker;
+
+typedef struct
+{
+    ParticleWorker workers[PARTICLE_MAX_WORKER_THREADS];
+    int worker_count;
+
+    dynamic_array* jobs;
+    int job_count;
+
+    volatile LONG next_job;
+    volatile LONG exit_request;
+} ParticleCore;
+
+static ParticleCore particle_core;
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Helpers
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+static inline uint32_t Particle_Rand(uint32_t* p_state)
+{
+    //xorshift32. Every job has its own state, so no locking is needed
+    uint32_t x = *p_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *p_state = x;
+
+    return x;
+}
+
+static inline float Particle_Randf(uint32_t* p_state)
+{
+    return (Particle_Rand(p_state) >> 8) * (1.0f / 16777216.0f);
+}
+
+static void RParticles_UpdateSpreadTable(ParticleEmitterSettings* const p_emitter)
+{
+    if (p_emitter->_spread_table_valid && p_emitter->_spread_table_spread == p_emitter->spread && p_emitter->_spread_table_flatness == p_emitter->flatness)
+    {
+        return;
+    }
+
+    //the rotation only depends on the spread and flatness, so we precompute cos and sin pairs
+    //once and let the restarted particles pick a random entry instead of calling trig functions
+    uint32_t state = Hash_id((uint32_t)(p_emitter->spread * 1000.0f) + (uint32_t)(p_emitter->flatness * 1000.0f)) | 1;
+
+    for (int i = 0; i < PARTICLE_SPREAD_TABLE_SIZE; i++)
+    {
+        float angle1 = glm_rad((Particle_Randf(&state) * 2.0 - 1.0) * p_emitter->spread);
+        float angle2 = glm_rad((Particle_Randf(&state) * 2.0 - 1.0) * ((1.0 - p_emitter->flatness) * p_emitter->spread));
+
+        p_emitter->_spread_table[i][0] = cosf(angle1) * cosf(angle2);
+        p_emitter->_spread_table[i][1] = sinf(angle1) * sinf(angle2);
+    }
+
+    p_emitter->_spread_table_spread = p_emitter->spread;
+    p_emitter->_spread_table_flatness = p_emitter->flatness;
+    p_emitter->_spread_table_valid = true;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Storage
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void RParticles_FreeStorage(ParticleSoA* const p_particles)
+{
+    if (p_particles->_block)
+    {
+        _aligned_free(p_particles->_block);
+    }
+
+    memset(p_particles, 0, sizeof(ParticleSoA));
+}
+
+bool RParticles_ResizeStorage(ParticleSoA* const p_particles, int p_amount)
+{
+    //pad to the simd width, so that the batches never need a scalar tail
+    int capacity = (max(p_amount, 0) + 3) & ~3;
+
+    if (capacity > p_particles->capacity)
+    {
+        RParticles_FreeStorage(p_particles);
+
+        float* block = _aligned_malloc(sizeof(float) * PARTICLE_SOA_STREAMS * capacity, 16);
+
+        if (!block)
+        {
+            return false;
+        }
+
+        p_particles->_block = block;
+        p_particles->capacity = capacity;
+
+        for (int i = 0; i < 3; i++)
+        {
+            p_particles->position[i] = block + (capacity * i);
+            p_particles->velocity[i] = block + (capacity * (3 + i));
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            p_particles->color[i] = block + (capacity * (6 + i));
+        }
+        p_particles->time = block + (capacity * 10);
+        p_particles->local_delta = block + (capacity * 11);
+        p_particles->active = (uint32_t*)(block + (capacity * 12));
+    }
+
+    //zero everything, since all particles start inactive
+    if (p_particles->_block)
+    {
+        memset(p_particles->_block, 0, sizeof(float) * PARTICLE_SOA_STREAMS * p_particles->capacity);
+    }
+
+    p_particles->count = p_amount;
+
+    return true;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Simulation
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+static void RParticles_RestartPass(ParticleJob* const p_job)
+{
+    //mainly inspired by godot's particle system https://github.com/godotengine/godot/blob/4.3/scene/3d/cpu_particles_3d.cpp#L657
+    ParticleEmitterSettings* emitter = p_job->emitter;
+    ParticleSoA* p = &emitter->particles;
+
+    const int NUM_PARTICLES = p->count;
+    const double e_delta = p_job->e_delta;
+    const double prev_time = p_job->prev_time;
+    const double system_time = p_job->system_time;
+    const double time = emitter->_time;
+    const float life_time = emitter->life_time;
+
+    for (int i = p_job->start; i < p_job->particle_end; i++)
+    {
+        double local_delta = e_delta;
+
+        double restart_phase = (double)i / (double)NUM_PARTICLES;
+
+        if (emitter->randomness > 0)
+        {
+            uint32_t seed = emitter->_cycle;
+            if (restart_phase >= system_time)
+            {
+                seed -= 1;
+            }
+            seed *= NUM_PARTICLES;
+            seed += i;
+
+            uint32_t hash = Hash_id(seed);
+            double random = (hash % 65536) / 65536.0;
+            restart_phase += emitter->randomness * random * 1.0 / (double)NUM_PARTICLES;
+        }
+
+        restart_phase *= (1.0 - emitter->explosiveness);
+
+        bool restart = false;
+
+        if (time > prev_time)
+        {
+            if (restart_phase >= prev_time && restart_phase < time)
+            {
+                restart = true;
+                local_delta = (time - restart_phase) * life_time;
+            }
+        }
+        else if (e_delta > 0.0)
+        {
+            if (restart_phase >= prev_time)
+            {
+                restart = true;
+                local_delta = (1.0 - restart_phase + time) * life_time;
+            }
+            else if (restart_phase < time)
+            {
+                restart = true;
+                local_delta = (time - restart_phase) * life_time;
+            }
+        }
+
+        if (p->time[i] * (1.0 - emitter->explosiveness) > emitter->life_time)
+        {
+            restart = true;
+        }
+
+        if (restart)
+        {
+            float vx = emitter->direction[0];
+            float vy = emitter->direction[1];
+            float vz = emitter->direction[2];
+
+            if (emitter->spread > 0)
+            {
+                const float* cs = emitter->_spread_table[Particle_Rand(&p_job->rng_state) % PARTICLE_SPREAD_TABLE_SIZE];
+                const float c = cs[0];
+                const float s = cs[1];
+
+                /* Right Hand, Rodrigues' rotation formula with k = (0, 1, 0):
+                    v = v*cos(t) + (kxv)sin(t) + k*(k.v)(1 - cos(t))
+                */
+                float rx = vx * c + vz * s;
+                float rz = vz * c - vx * s;
+
+                vx = rx;
+                vz = rz;
+            }
+
+            const float initial_velocity = emitter->initial_velocity;
+
+            p->active[i] = 1;
+            p->time[i] = 0;
+
+            p->velocity[0][i] = vx * initial_velocity;
+            p->velocity[1][i] = vy * initial_velocity;
+            p->velocity[2][i] = vz * initial_velocity;
+
+            p->color[0][i] = emitter->color[0];
+            p->color[1][i] = emitter->color[1];
+            p->color[2][i] = emitter->color[2];
+            p->color[3][i] = emitter->color[3];
+
+            p->position[0][i] = emitter->xform[3][0];
+            p->position[1][i] = emitter->xform[3][1];
+            p->position[2][i] = emitter->xform[3][2];
+
+            switch (emitter->emission_shape)
+            {
+            case EES__POINT:
+            {
+                break;
+            }
+            case EES__BOX:
+            {
+                p->position[0][i] += (Particle_Randf(&p_job->rng_state) * 2.0 - 1.0) * emitter->emission_size[0];
+                p->position[1][i] += (Particle_Randf(&p_job->rng_state) * 2.0 - 1.0) * emitter->emission_size[1];
+                p->position[2][i] += (Particle_Randf(&p_job->rng_state) * 2.0 - 1.0) * emitter->emission_size[2];
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        else if (p->active[i] && p->time[i] > emitter->life_time)
+        {
+            p->active[i] = 0;
+        }
+
+        //inactive particles get a zero delta, which turns the integration into a no-op for them
+        p->local_delta[i] = (p->active[i]) ? (float)local_delta : 0.0f;
+    }
+}
+
+static void RParticles_IntegrateVelocity(ParticleJob* const p_job)
+{
+    ParticleEmitterSettings* emitter = p_job->emitter;
+    ParticleSoA* p = &emitter->particles;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 gravity = _mm_set1_ps(emitter->gravity);
+    const __m128 linear_accel = _mm_set1_ps(emitter->linear_accel);
+
+    for (int i = p_job->start; i < p_job->end; i += 4)
+    {
+        __m128 dt = _mm_load_ps(p->local_delta + i);
+        __m128 vx = _mm_load_ps(p->velocity[0] + i);
+        __m128 vy = _mm_load_ps(p->velocity[1] + i);
+        __m128 vz = _mm_load_ps(p->velocity[2] + i);
+
+        _mm_store_ps(p->time + i, _mm_add_ps(_mm_load_ps(p->time + i), dt));
+
+        //linear accel along the normalized velocity
+        __m128 len_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        __m128 has_len = _mm_cmpgt_ps(len_sq, zero);
+        __m128 accel_scale = _mm_and_ps(has_len, _mm_div_ps(linear_accel, _mm_sqrt_ps(_mm_max_ps(len_sq, _mm_set1_ps(FLT_MIN)))));
+
+        __m128 fx = _mm_mul_ps(vx, accel_scale);
+        __m128 fy = _mm_add_ps(_mm_mul_ps(vy, accel_scale), gravity);
+        __m128 fz = _mm_mul_ps(vz, accel_scale);
+
+        _mm_store_ps(p->velocity[0] + i, _mm_add_ps(vx, _mm_mul_ps(fx, dt)));
+        _mm_store_ps(p->velocity[1] + i, _mm_add_ps(vy, _mm_mul_ps(fy, dt)));
+        _mm_store_ps(p->velocity[2] + i, _mm_add_ps(vz, _mm_mul_ps(fz, dt)));
+    }
+}
+
+static void RParticles_IntegratePosition(ParticleJob* const p_job)
+{
+    ParticleEmitterSettings* emitter = p_job->emitter;
+    ParticleSoA* p = &emitter->particles;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 friction = _mm_set1_ps(emitter->friction);
+    const bool use_friction = emitter->friction > 0.0;
+
+    __m128 end_color[4];
+    for (int k = 0; k < 4; k++)
+    {
+        end_color[k] = _mm_set1_ps(emitter->end_color[k]);
+    }
+
+    for (int i = p_job->start; i < p_job->end; i += 4)
+    {
+        __m128 dt = _mm_load_ps(p->local_delta + i);
+        __m128 vx = _mm_load_ps(p->velocity[0] + i);
+        __m128 vy = _mm_load_ps(p->velocity[1] + i);
+        __m128 vz = _mm_load_ps(p->velocity[2] + i);
+
+        //friction
+        if (use_friction)
+        {
+            __m128 len_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+            __m128 len = _mm_sqrt_ps(len_sq);
+            __m128 new_len = _mm_max_ps(_mm_sub_ps(len, _mm_mul_ps(friction, dt)), zero);
+            __m128 scale = _mm_and_ps(_mm_cmpgt_ps(len, zero), _mm_div_ps(new_len, _mm_max_ps(len, _mm_set1_ps(FLT_MIN))));
+
+            vx = _mm_mul_ps(vx, scale);
+            vy = _mm_mul_ps(vy, scale);
+            vz = _mm_mul_ps(vz, scale);
+
+            _mm_store_ps(p->velocity[0] + i, vx);
+            _mm_store_ps(p->velocity[1] + i, vy);
+            _mm_store_ps(p->velocity[2] + i, vz);
+        }
+
+        _mm_store_ps(p->position[0] + i, _mm_add_ps(_mm_load_ps(p->position[0] + i), _mm_mul_ps(vx, dt)));
+        _mm_store_ps(p->position[1] + i, _mm_add_ps(_mm_load_ps(p->position[1] + i), _mm_mul_ps(vy, dt)));
+        _mm_store_ps(p->position[2] + i, _mm_add_ps(_mm_load_ps(p->position[2] + i), _mm_mul_ps(vz, dt)));
+
+        //color lerp
+        __m128 t = _mm_min_ps(dt, one);
+        for (int k = 0; k < 4; k++)
+        {
+            __m128 c = _mm_load_ps(p->color[k] + i);
+            _mm_store_ps(p->color[k] + i, _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(end_color[k], c), t)));
+        }
+    }
+}
+
+static void RParticles_WriteInstances(ParticleJob* const p_job)
+{
+    ParticleEmitterSettings* emitter = p_job->emitter;
+    ParticleSoA* p = &emitter->particles;
+
+    dA_clear(p_job->instances);
+
+    if (!p_job->draw)
+    {
+        return;
+    }
+
+    int active_count = 0;
+    for (int i = p_job->start; i < p_job->particle_end; i++)
+    {
+        active_count += (p->active[i] != 0);
+    }
+
+    if (active_count == 0)
+    {
+        return;
+    }
+
+    float* dest = dA_emplaceBackMultiple(p_job->instances, active_count * PARTICLE_INSTANCE_FLOAT_COUNT);
+
+    if (!dest)
+    {
+        return;
+    }
+
+    vec3 up = { 0.0, 1.0, 0.0 };
+
+    //particles share the emitter basis
+    mat3 basis;
+    glm_mat4_pick3(emitter->xform, basis);
+    glm_mat3_scale(basis, emitter->scale);
+
+    for (int i = p_job->start; i < p_job->particle_end; i++)
+    {
+        if (!p->active[i])
+        {
+            continue;
+        }
+
+        //billboard to cam
+        vec3 to_camera;
+        to_camera[0] = scene.camera.position[0] - p->position[0][i];
+        to_camera[1] = scene.camera.position[1] - p->position[1][i];
+        to_camera[2] = scene.camera.position[2] - p->position[2][i];
+        glm_vec3_normalize(to_camera);
+
+        vec3 crossed;
+        glm_vec3_crossn(up, to_camera, crossed);
+
+        mat3 local;
+        glm_vec3_copy(crossed, local[0]);
+        glm_vec3_copy(up, local[1]);
+        glm_vec3_copy(to_camera, local[2]);
+
+        glm_mat3_mul(local, basis, local);
+
+        //transposed mat3x4
+        for (int r = 0; r < 3; r++)
+        {
+            dest[r * 4 + 0] = local[0][r];
+            dest[r * 4 + 1] = local[1][r];
+            dest[r * 4 + 2] = local[2][r];
+            dest[r * 4 + 3] = p->position[r][i];
+        }
+
+        dest[12] = p_job->texture_region.x;
+        dest[13] = p_job->texture_region.y;
+        dest[14] = p_job->texture_region.width;
+        dest[15] = p_job->texture_region.height;
+
+        dest[16] = p->color[0][i];
+        dest[17] = p->color[1][i];
+        dest[18] = p->color[2][i];
+        dest[19] = p->color[3][i];
+
+        dest[20] = p_job->texture_index;
+        dest[21] = 1;
+        dest[22] = 2;
+        dest[23] = 3;
+
+        dest += PARTICLE_INSTANCE_FLOAT_COUNT;
+    }
+}
+
+static void RParticles_ProcessJob(ParticleJob* const p_job)
+{
+    ParticleEmitterSettings* emitter = p_job->emitter;
+
+    RParticles_RestartPass(p_job);
+    RParticles_IntegrateVelocity(p_job);
+
+    //call collision function if provided
+    if (emitter->collision_function)
+    {
+        (*emitter->collision_function)(&emitter->particles, emitter, p_job->start, p_job->particle_end);
+    }
+
+    RParticles_IntegratePosition(p_job);
+    RParticles_WriteInstances(p_job);
+}
+
+static void RParticles_ProcessJobs()
+{
+    for (;;)
+    {
+        LONG index = InterlockedIncrement(&particle_core.next_job) - 1;
+
+        if (index >= particle_core.job_count)
+        {
+            break;
+        }
+
+        RParticles_ProcessJob(dA_at(particle_core.jobs, index));
+    }
+}
+
+static DWORD WINAPI RParticles_WorkerLoop(LPVOID p_arg)
+{
+    ParticleWorker* worker = p_arg;
+
+    for (;;)
+    {
+        WaitForSingleObject(worker->event_start, INFINITE);
+
+        if (particle_core.exit_request)
+        {
+            break;
+        }
+
+        RParticles_ProcessJobs();
+
+        SetEvent(worker->event_completed);
+    }
+
+    return 0;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Jobs
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void RParticles_BeginJobs()
+{
+    particle_core.job_count = 0;
+}
+
+void RParticles_AddEmitterJobs(ParticleEmitterSettings* const p_emitter, double p_eDelta, double p_prevTime, double p_systemTime, bool p_draw, int p_textureIndex, M_Rect2Df p_textureRegion)
+{
+    if (p_emitter->particles.count != p_emitter->particle_amount)
+    {
+        if (!RParticles_ResizeStorage(&p_emitter->particles, p_emitter->particle_amount))
+        {
+            return;
+        }
+    }
+
+    if (p_emitter->spread > 0)
+    {
+        RParticles_UpdateSpreadTable(p_emitter);
+    }
+
+    //split large emitters, so that they can be spread over multiple threads
+    for (int start = 0; start < p_emitter->particles.count; start += PARTICLE_JOB_BATCH_SIZE)
+    {
+        if (particle_core.job_count >= dA_size(particle_core.jobs))
+        {
+            ParticleJob* new_job = dA_emplaceBack(particle_core.jobs);
+
+            if (!new_job)
+            {
+                return;
+            }
+
+            new_job->instances = dA_INIT(float, 0);
+        }
+
+        ParticleJob* job = dA_at(particle_core.jobs, particle_core.job_count);
+
+        job->emitter = p_emitter;
+        job->start = start;
+        //the end is aligned to the padded capacity, so the sse loops never touch the next job's particles
+        job->end = min(start + PARTICLE_JOB_BATCH_SIZE, p_emitter->particles.capacity);
+        job->particle_end = min(job->end, p_emitter->particles.count);
+        job->e_delta = p_eDelta;
+        job->prev_time = p_prevTime;
+        job->system_time = p_systemTime;
+        job->draw = p_draw;
+        job->texture_index = p_textureIndex;
+        job->texture_region = p_textureRegion;
+        job->rng_state = Hash_id((uint32_t)p_emitter->_cycle * 7919u + (uint32_t)start + (uint32_t)(p_emitter->_time * 100000.0)) | 1;
+
+        particle_core.job_count++;
+    }
+}
+
+void RParticles_RunJobs(int p_maxWorkerThreads)
+{
+    if (particle_core.job_count <= 0)
+    {
+        return;
+    }
+
+    particle_core.next_job = 0;
+
+    int thread_count = min(p_maxWorkerThreads, particle_core.worker_count);
+    thread_count = min(thread_count, particle_core.job_count - 1);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        SetEvent(particle_core.workers[i].event_start);
+    }
+
+    //the main thread helps out
+    RParticles_ProcessJobs();
+
+    if (thread_count > 0)
+    {
+        HANDLE completed_events[PARTICLE_MAX_WORKER_THREADS];
+        for (int i = 0; i < thread_count; i++)
+        {
+            completed_events[i] = particle_core.workers[i].event_completed;
+        }
+
+        WaitForMultipleObjects(thread_count, completed_events, TRUE, INFINITE);
+    }
+}
+
+void RParticles_GatherInstances()
+{
+    for (int i = 0; i < particle_core.job_count; i++)
+    {
+        ParticleJob* job = dA_at(particle_core.jobs, i);
+
+        size_t float_count = dA_size(job->instances);
+
+        if (float_count == 0)
+        {
+            continue;
+        }
+
+        dA_emplaceBackMultipleData(drawData->particles.instance_buffer, float_count, dA_getFront(job->instances));
+        drawData->particles.instance_count += float_count / PARTICLE_INSTANCE_FLOAT_COUNT;
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Built in world collision.
+    The probe positions of a batch are gathered first
+    and looked up together with LC_World_GetBlockTypes
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void Particle_CollideWithWorld(ParticleSoA* const p_particles, ParticleEmitterSettings* const p_emitter, int p_start, int p_end)
+{
+    float probe[3][PARTICLE_COLLISION_BATCH_SIZE];
+    int indexes[PARTICLE_COLLISION_BATCH_SIZE];
+    uint8_t types[PARTICLE_COLLISION_BATCH_SIZE];
+
+    int i = p_start;
+    while (i < p_end)
+    {
+        int count = 0;
+
+        for (; i < p_end && count < PARTICLE_COLLISION_BATCH_SIZE; i++)
+        {
+            if (!p_particles->active[i] || p_particles->time[i] <= 0.2)
+            {
+                continue;
+            }
+
+            float vx = p_particles->velocity[0][i];
+            float vy = p_particles->velocity[1][i];
+            float vz = p_particles->velocity[2][i];
+
+            float len = sqrtf(vx * vx + vy * vy + vz * vz);
+            float inv_len = (len > 0) ? p_emitter->scale / len : 0.0f;
+
+            probe[0][count] = p_particles->position[0][i] + vx * inv_len;
+            probe[1][count] = p_particles->position[1][i] + vy * inv_len;
+            probe[2][count] = p_particles->position[2][i] + vz * inv_len;
+            indexes[count] = i;
+            count++;
+        }
+
+        if (count == 0)
+        {
+            continue;
+        }
+
+        LC_World_GetBlockTypes(probe[0], probe[1], probe[2], count, types);
+
+        for (int k = 0; k < count; k++)
+        {
+            if (!LC_isBlockCollidable(types[k]))
+            {
+                continue;
+            }
+
+            int index = indexes[k];
+
+            //pick the normal by comparing the particle block position against the hit block
+            int diff[3];
+            for (int a = 0; a < 3; a++)
+            {
+                diff[a] = (int)roundf(p_particles->position[a][index]) - (int)roundf(probe[a][k]);
+            }
+
+            vec3 normal;
+            glm_vec3_zero(normal);
+
+            for (int a = 0; a < 3; a++)
+            {
+                if (diff[a] != 0)
+                {
+                    normal[a] = (diff[a] > 0) ? 1 : -1;
+                    break;
+                }
+            }
+
+            float vx = p_particles->velocity[0][index];
+            float vy = p_particles->velocity[1][index];
+            float vz = p_particles->velocity[2][index];
+
+            float normal_dot = normal[0] * vx + normal[1] * vy + normal[2] * vz;
+
+            p_particles->velocity[0][index] = (vx - 2.0 * normal_dot * normal[0]) * 0.5;
+            p_particles->velocity[1][index] = (vy - 2.0 * normal_dot * normal[1]) * 0.5;
+            p_particles->velocity[2][index] = (vz - 2.0 * normal_dot * normal[2]) * 0.5;
+        }
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Benchmark. Simulates the requested amount of live
+    particles with a fixed delta and prints the timings
+    for the main thread only and for all workers
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void RParticles_Benchmark(int p_particleAmount)
+{
+    ParticleEmitterSettings emitter;
+    memset(&emitter, 0, sizeof(emitter));
+
+    glm_mat4_identity(emitter.xform);
+    glm_vec3_copy(scene.camera.position, emitter.xform[3]);
+
+    emitter.particle_amount = p_particleAmount;
+    emitter.direction[1] = 1;
+    emitter.initial_velocity = 8.0;
+    emitter.gravity = -24;
+    emitter.speed_scale = 1.0;
+    emitter.spread = 45;
+    emitter.explosiveness = 1;
+    emitter.randomness = 1.0;
+    emitter.scale = 0.1;
+    emitter.life_time = 100.0;
+    emitter.friction = 3.0;
+    emitter.emission_shape = EES__BOX;
+    emitter.emission_size[0] = 8;
+    emitter.emission_size[1] = 8;
+    emitter.emission_size[2] = 8;
+    glm_vec4_one(emitter.color);
+    glm_vec4_one(emitter.end_color);
+    emitter.collision_function = Particle_CollideWithWorld;
+
+    const double delta = 1.0 / 60.0;
+
+    double timings[2];
+
+    for (int run = 0; run < 2; run++)
+    {
+        //first run is main thread only, second uses all the workers
+        const int worker_threads = (run == 0) ? 0 : PARTICLE_MAX_WORKER_THREADS;
+
+        emitter._time = 0;
+        emitter._cycle = 0;
+        emitter.particles.count = 0;
+
+        double start_time = glfwGetTime();
+
+        for (int frame = 0; frame < PARTICLE_BENCHMARK_FRAMES; frame++)
+        {
+            double prev_time = emitter._time;
+            emitter._time += delta;
+
+            RParticles_BeginJobs();
+            RParticles_AddEmitterJobs(&emitter, delta, prev_time, emitter._time / emitter.life_time, true, 0, (M_Rect2Df) { 0, 0, 1, 1 });
+            RParticles_RunJobs(worker_threads);
+        }
+
+        timings[run] = ((glfwGetTime() - start_time) * 1000.0) / PARTICLE_BENCHMARK_FRAMES;
+    }
+
+    int live_particles = 0;
+    for (int i = 0; i < emitter.particles.count; i++)
+    {
+        live_particles += (emitter.particles.active[i] != 0);
+    }
+
+    particle_core.job_count = 0;
+
+    RParticles_FreeStorage(&emitter.particles);
+
+    Core_Printf("Particle benchmark: %i live particles, %i frames", live_particles, PARTICLE_BENCHMARK_FRAMES);
+    Core_Printf("Main thread only: %.3f ms/frame", timings[0]);
+    Core_Printf("%i worker threads: %.3f ms/frame", particle_core.worker_count, timings[1]);
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    Init and exit
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+bool RParticles_Init()
+{
+    memset(&particle_core, 0, sizeof(particle_core));
+
+    particle_core.jobs = dA_INIT(ParticleJob, 0);
+
+    //leave one core for the main thread
+    SYSTEM_INFO sys_info;
+    GetSystemInfo(&sys_info);
+
+    int thread_count = glm_clamp((int)sys_info.dwNumberOfProcessors - 1, 0, PARTICLE_MAX_WORKER_THREADS);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        ParticleWorker* worker = &particle_core.workers[i];
+
+        worker->event_start = CreateEvent(NULL, FALSE, FALSE, NULL);
+        worker->event_completed = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+        if (!worker->event_start || !worker->event_completed)
+        {
+            return false;
+        }
+
+        worker->handle = CreateThread(NULL, 0, RParticles_WorkerLoop, worker, 0, NULL);
+
+        if (!worker->handle)
+        {
+            return false;
+        }
+
+        particle_core.worker_count++;
+    }
+
+    return true;
+}
+
+void RParticles_Exit()
+{
+    particle_core.exit_request = true;
+
+    for (int i = 0; i < particle_core.worker_count; i++)
+    {
+        ParticleWorker* worker = &particle_core.workers[i];
+
+        SetEvent(worker->event_start);
+        WaitForSingleObject(worker->handle, INFINITE);
+
+        CloseHandle(worker->handle);
+        CloseHandle(worker->event_start);
+        CloseHandle(worker->event_completed);
+    }
+
+    for (int i = 0; i < dA_size(particle_core.jobs); i++)
+    {
+        ParticleJob* job = dA_at(particle_core.jobs, i);
+
+        dA_Destruct(job->instances);
+    }
+    dA_Destruct(particle_core.jobs);
+}
@@ -13,15 +13,16 @@ extern RPass_PassData* pass;
 extern R_BackendData* backend_data;
 extern R_Cvars r_cvars;
 extern R_Scene scene;
+extern R_FrameSnapshot snapshot;
 
 extern void Render_OpaqueScene(RenderPassState rpass_state);
 extern void Render_SemiOpaqueScene(RenderPassState rpass_state);
 extern void Render_Quad();
 extern void Render_Cube();
 extern void Render_SimpleScene();
-extern void Render_DrawChunkOcclusionBoxes();
 extern void Render_UI();
 extern void Render_WorldWaterChunks();
+extern void Compute_WorldChunksOcclusion();
 extern void Init_SetupGLBindingPoints();
 
 
@@ -58,16 +59,14 @@ static void Pass_shadowMap()
 
 	int splits = r_cvars.r_shadowSplits->int_value;
 
-	glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, 0, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_indexes->elements_size,
-		drawData->lc_world.shadow_sorted_chunk_indexes->data);
-
-	glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_indexes->elements_size, sizeof(int) * drawData->lc_world.shadow_sorted_chunk_transparent_indexes->elements_size,
-		drawData->lc_world.shadow_sorted_chunk_transparent_indexes->data);
-
-	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-
 	for (int i = 0; i < splits; i++)
 	{
+		//keep the cached split
+		if (!snapshot.shadow_split_render[i])
+		{
+			continue;
+		}
+
 		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pass->shadow.depth_maps, 0, i);
 		glClear(GL_DEPTH_BUFFER_BIT);
 
@@ -100,6 +99,49 @@ static void Pass_DepthPrepass()
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
 
+static void Pass_HiZ()
+{
+	//Build the max depth pyramid from the depth prepass
+	Shader_Use(&pass->general.hiz_shader);
+
+	int level_width = max(backend_data->screenSize[0] / 2, 1);
+	int level_height = max(backend_data->screenSize[1] / 2, 1);
+
+	for (int i = 0; i < pass->general.hiz_levels; i++)
+	{
+		//the first level is downsampled from the depth texture
+		if (i == 0)
+		{
+			glBindTextureUnit(0, pass->deferred.depth_texture);
+			Shader_SetInt(&pass->general.hiz_shader, HIZ_DOWNSAMPLE_UNIFORM_SOURCELEVEL, 0);
+		}
+		else
+		{
+			glBindTextureUnit(0, pass->general.hiz_texture);
+			Shader_SetInt(&pass->general.hiz_shader, HIZ_DOWNSAMPLE_UNIFORM_SOURCELEVEL, i - 1);
+		}
+		glBindImageTexture(0, pass->general.hiz_texture, i, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		Pass_DispatchScreenCompute(level_width, level_height, 8, 8);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		level_width = max(level_width / 2, 1);
+		level_height = max(level_height / 2, 1);
+	}
+
+	//Test the chunks against the pyramid
+	Compute_WorldChunksOcclusion();
+
+	//depth prepass the chunks that became visible this frame
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	Render_OpaqueScene(RPass__DEPTH_PREPASS_DISOCCLUDED);
+	Render_SemiOpaqueScene(RPass__DEPTH_PREPASS_DISOCCLUDED);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
 static void Pass_gBuffer()
 {
 	//make sure we disable blend, even if we disabled it before
@@ -309,14 +351,14 @@ static void Pass_DepthOfField()
 	Shader_Use(&pass->dof.shader);
 
 	Shader_SetFloat2(&pass->dof.shader, DOF_UNIFORM_VIEWPORTSIZE, backend_data->screenSize[0], backend_data->screenSize[1]);
-	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, scene.environment.depthOfFieldBlurScale * 64.0);
-	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_NEARBEGIN, scene.environment.depthOfFieldNearBegin);
-	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_FARBEGIN, scene.environment.depthOfFieldFarBegin);
-	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_NEAREND, scene.environment.depthOfFieldNearEnd);
-	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_FAREND, scene.environment.depthOfFieldFarEnd);
+	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, snapshot.environment.depthOfFieldBlurScale * 64.0);
+	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_NEARBEGIN, snapshot.environment.depthOfFieldNearBegin);
+	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_FARBEGIN, snapshot.environment.depthOfFieldFarBegin);
+	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_NEAREND, snapshot.environment.depthOfFieldNearEnd);
+	Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_FAREND, snapshot.environment.depthOfFieldFarEnd);
 
-	Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_NEARBLURENABLED, scene.environment.depthOfFieldNearEnabled);
-	Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_FARBLURENABLED, scene.environment.depthOfFieldFarEnabled);
+	Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_NEARBLURENABLED, snapshot.environment.depthOfFieldNearEnabled);
+	Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_FARBLURENABLED, snapshot.environment.depthOfFieldFarEnabled);
 
 	glBindTextureUnit(0, pass->deferred.depth_texture);
 	glBindImageTexture(0, pass->scene.MainSceneColorBuffer, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
@@ -348,7 +390,7 @@ static void Pass_DepthOfField()
 
 		Shader_SetFloat2(&pass->dof.shader, DOF_UNIFORM_VIEWPORTSIZE, backend_data->halfScreenSize[0], backend_data->halfScreenSize[1]);
 		Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SCALE, scale);
-		Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, scene.environment.depthOfFieldBlurScale * 64.0);
+		Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, snapshot.environment.depthOfFieldBlurScale * 64.0);
 	
 		Pass_DispatchScreenCompute(backend_data->halfScreenSize[0], backend_data->halfScreenSize[1], 8, 8);
 	}
@@ -366,7 +408,7 @@ static void Pass_DepthOfField()
 		Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_SECOND_PASS, false);
 		Shader_SetFloat2(&pass->dof.shader, DOF_UNIFORM_VIEWPORTSIZE, backend_data->screenSize[0], backend_data->screenSize[1]);
 		Shader_SetInt(&pass->dof.shader, DOF_UNIFORM_BLUR_STEPS, steps);
-		Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, scene.environment.depthOfFieldBlurScale * 64.0);
+		Shader_SetFloaty(&pass->dof.shader, DOF_UNIFORM_BLUR_SIZE, snapshot.environment.depthOfFieldBlurScale * 64.0);
 
 		Pass_DispatchScreenCompute(backend_data->screenSize[0], backend_data->screenSize[1], 8, 8);
 
@@ -414,7 +456,7 @@ static void Pass_Godrays()
 
 	Shader_SetFloat2(&pass->godray.shader, GODRAY_UNIFORM_VIEWPORTSIZE, backend_data->halfScreenSize[0], backend_data->halfScreenSize[1]);
 	Shader_SetInt(&pass->godray.shader, GODRAY_UNIFORM_MAXSTEPS, 8);
-	Shader_SetFloaty(&pass->godray.shader, GODRAY_UNIFORM_SCATTERING, scene.environment.godrayScatteringAmount);
+	Shader_SetFloaty(&pass->godray.shader, GODRAY_UNIFORM_SCATTERING, snapshot.environment.godrayScatteringAmount);
 
 	glBindTextureUnit(0, pass->general.depth_halfsize_texture);
 	glBindTextureUnit(3, pass->shadow.depth_maps);
@@ -457,7 +499,7 @@ static void Pass_Godrays()
 	Shader_Use(&pass->godray.shader);
 	
 	Shader_SetFloat2(&pass->godray.shader, GODRAY_UNIFORM_VIEWPORTSIZE, backend_data->screenSize[0], backend_data->screenSize[1]);
-	Shader_SetFloaty(&pass->godray.shader, GODRAY_UNIFORM_FOGCURVE, scene.environment.godrayFogAmount);
+	Shader_SetFloaty(&pass->godray.shader, GODRAY_UNIFORM_FOGCURVE, snapshot.environment.godrayFogAmount);
 	
 	glBindTextureUnit(0, pass->general.depth_halfsize_texture);
 	glBindTextureUnit(1, pass->deferred.depth_texture);
@@ -514,10 +556,10 @@ static void Pass_ProcessCubemap()
 
 	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_PROJ, pass->ibl.cube_proj);
 
-	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_SKYCOLOR, scene.environment.sky_color);
-	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_SKYHORIZONCOLOR, scene.environment.sky_horizon_color);
-	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_GROUNDHORIZONCOLOR, scene.environment.ground_horizon_color);
-	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_GROUNDCOLOR, scene.environment.ground_bottom_color);
+	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_SKYCOLOR, snapshot.environment.sky_color);
+	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_SKYHORIZONCOLOR, snapshot.environment.sky_horizon_color);
+	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_GROUNDHORIZONCOLOR, snapshot.environment.ground_horizon_color);
+	Shader_SetVec3(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_GROUNDCOLOR, snapshot.environment.ground_bottom_color);
 
 	for (int i = 0; i < 6; i++)
 	{
@@ -560,19 +602,19 @@ static void Pass_Skybox()
 
 	mat4 view_no_translation;
 	glm_mat4_identity(view_no_translation);
-	glm_mat3_make(scene.camera.view, view_no_translation);
+	glm_mat3_make(snapshot.view, view_no_translation);
 
-	view_no_translation[2][0] = scene.camera.view[2][0];
-	view_no_translation[2][1] = scene.camera.view[2][1];
-	view_no_translation[2][2] = scene.camera.view[2][2];
-	view_no_translation[2][3] = scene.camera.view[2][3];
+	view_no_translation[2][0] = snapshot.view[2][0];
+	view_no_translation[2][1] = snapshot.view[2][1];
+	view_no_translation[2][2] = snapshot.view[2][2];
+	view_no_translation[2][3] = snapshot.view[2][3];
 
 	Shader_ResetDefines(&pass->ibl.cubemap_shader);
 	Shader_SetDefine(&pass->ibl.cubemap_shader, CUBEMAP_DEFINE_RENDER_SKYBOX_PASS, true);
 
 	Shader_Use(&pass->ibl.cubemap_shader);
 
-	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_PROJ, scene.camera.proj);
+	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_PROJ, snapshot.proj);
 	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_VIEW, view_no_translation);
 
 	glBindTextureUnit(1, pass->ibl.envCubemapTexture);
@@ -624,7 +666,7 @@ static void Pass_Water()
 static void Pass_WaterPrePass()
 {
 	//only bother rendering if we have any water chunks in frustrum
-	if (scene.cull_data.lc_world.water_in_frustrum <= 0)
+	if (snapshot.lc_water_in_frustrum <= 0)
 	{
 		return;
 	}
@@ -655,19 +697,19 @@ static void Pass_WaterPrePass()
 	//Render skybox
 	mat4 view_no_translation;
 	glm_mat4_identity(view_no_translation);
-	glm_mat3_make(pass->water.reflection_view_matrix, view_no_translation);
+	glm_mat3_make(snapshot.reflection_view_matrix, view_no_translation);
 
-	view_no_translation[2][0] = pass->water.reflection_view_matrix[2][0];
-	view_no_translation[2][1] = pass->water.reflection_view_matrix[2][1];
-	view_no_translation[2][2] = pass->water.reflection_view_matrix[2][2];
-	view_no_translation[2][3] = pass->water.reflection_view_matrix[2][3];
+	view_no_translation[2][0] = snapshot.reflection_view_matrix[2][0];
+	view_no_translation[2][1] = snapshot.reflection_view_matrix[2][1];
+	view_no_translation[2][2] = snapshot.reflection_view_matrix[2][2];
+	view_no_translation[2][3] = snapshot.reflection_view_matrix[2][3];
 
 	Shader_ResetDefines(&pass->ibl.cubemap_shader);
 	Shader_SetDefine(&pass->ibl.cubemap_shader, CUBEMAP_DEFINE_RENDER_SKYBOX_PASS, true);
 
 	Shader_Use(&pass->ibl.cubemap_shader);
 
-	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_PROJ, scene.camera.proj);
+	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_PROJ, snapshot.proj);
 	Shader_SetMat4(&pass->ibl.cubemap_shader, CUBEMAP_UNIFORM_VIEW, view_no_translation);
 
 	glBindTextureUnit(1, pass->ibl.envCubemapTexture);
@@ -706,26 +748,6 @@ static void Pass_WaterPrePass()
 	Pass_DispatchScreenCompute(pass->water.reflection_size[0], pass->water.reflection_size[1], 8, 8);
 }
 
-static void Pass_OcclussionBoxes()
-{
-	Shader_Use(&pass->lc.occlusion_box_shader);
-
-	glDisable(GL_CULL_FACE); //always disable cull face, causes lots of issues otherwise
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(GL_FALSE);
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(-1, -1);
-
-	Render_DrawChunkOcclusionBoxes();
-
-	glEnable(GL_CULL_FACE);
-	glDepthMask(GL_TRUE);
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-	glDisable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(0, 0);
-}
-
 static void Pass_SimpleGeoPass()
 {
 	Render_SimpleScene();
@@ -759,7 +781,7 @@ static void Pass_PostProcess()
 		Shader_SetDefine(&pass->post.post_process_shader, POST_PROCESS_DEFINE_USE_REINHARD_TONEMAP, r_cvars.r_TonemapMode->int_value == 0);
 		Shader_SetDefine(&pass->post.post_process_shader, POST_PROCESS_DEFINE_USE_UNCHARTED2_TONEMAP, r_cvars.r_TonemapMode->int_value == 1);
 		Shader_SetDefine(&pass->post.post_process_shader, POST_PROCESS_DEFINE_USE_ACES_TONEMAP, r_cvars.r_TonemapMode->int_value == 2);
-		Shader_SetDefine(&pass->post.post_process_shader, POST_PROCESS_DEFINE_USE_FOG, scene.environment.depthFogEnabled || scene.environment.heightFogEnabled);
+		Shader_SetDefine(&pass->post.post_process_shader, POST_PROCESS_DEFINE_USE_FOG, snapshot.environment.depthFogEnabled || snapshot.environment.heightFogEnabled);
 
 		Shader_Use(&pass->post.post_process_shader);
 		
@@ -770,17 +792,17 @@ static void Pass_PostProcess()
 		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_GAMMA, r_cvars.r_Gamma->float_value);
 		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_EXPOSURE, r_cvars.r_Exposure->float_value);
 
-		Shader_SetInt(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGENABLED, scene.environment.heightFogEnabled);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGMIN, scene.environment.heightFogMin);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGMAX, scene.environment.heightFogMax);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGCURVE, scene.environment.heightFogCurve);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGDENSITY, scene.environment.heightFogDensity);
+		Shader_SetInt(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGENABLED, snapshot.environment.heightFogEnabled);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGMIN, snapshot.environment.heightFogMin);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGMAX, snapshot.environment.heightFogMax);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGCURVE, snapshot.environment.heightFogCurve);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_HEIGHTFOGDENSITY, snapshot.environment.heightFogDensity);
 		
-		Shader_SetInt(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGENABLED, scene.environment.depthFogEnabled);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGBEGIN, scene.environment.depthFogBegin);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGEND, scene.environment.depthFogEnd);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGCURVE, scene.environment.depthFogCurve);
-		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGDENSITY, scene.environment.depthFogDensity);
+		Shader_SetInt(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGENABLED, snapshot.environment.depthFogEnabled);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGBEGIN, snapshot.environment.depthFogBegin);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGEND, snapshot.environment.depthFogEnd);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGCURVE, snapshot.environment.depthFogCurve);
+		Shader_SetFloaty(&pass->post.post_process_shader, POST_PROCESS_UNIFORM_DEPTHFOGDENSITY, snapshot.environment.depthFogDensity);
 	}
 
 	glDisable(GL_DEPTH_TEST);
@@ -814,6 +836,9 @@ void Pass_Main()
 	//depth prepass opaques and semi opaques
 	Pass_DepthPrepass();
 
+	//occlusion cull against the depth prepass, and depth prepass the disoccluded chunks
+	Pass_HiZ();
+
 	///Render all opaque and semi opaque objects into g buffers
 	Pass_gBuffer();
 	
@@ -845,9 +870,6 @@ void Pass_Main()
 	//Render skybox
 	Pass_Skybox();
 
-	//Render boxes for oclussion culling
-	Pass_OcclussionBoxes();
-
 	//Water render prepass stuff
 	Pass_WaterPrePass();
 
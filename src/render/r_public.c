@@ -17,6 +17,7 @@ extern R_Scene scene;
 
 extern void Render_Cube();
 extern void Render_Quad();
+extern void RParticles_FreeStorage(ParticleSoA* const p_particles);
 
 static const vec4 DEFAULT_COLOR = { 1.0, 1.0, 1.0, 1.0 };
 
@@ -610,11 +611,38 @@ ParticleEmitterSettings* Particle_RegisterEmitter()
 
 	ParticleEmitterSettings* emitter = node->value;
 
-	emitter->particles = dA_INIT(ParticleCpu, 0);
+	memset(&emitter->particles, 0, sizeof(ParticleSoA));
 
 	return emitter;
 }
 
+void Particle_RemoveEmitter(ParticleEmitterSettings* p_emitter)
+{
+	FL_Node* prev_node = NULL;
+	FL_Node* node = storage.particle_emitter_clients->next;
+
+	while (node)
+	{
+		if (node->value == p_emitter)
+		{
+			RParticles_FreeStorage(&p_emitter->particles);
+
+			if (prev_node)
+			{
+				FL_eraseAfterNode(storage.particle_emitter_clients, prev_node);
+			}
+			else
+			{
+				FL_popFront(storage.particle_emitter_clients);
+			}
+			return;
+		}
+
+		prev_node = node;
+		node = node->next;
+	}
+}
+
 void Particle_MarkUpdate(ParticleEmitterSettings* p_emitter)
 {
 	//storage.particle_update_queue[storage.particle_update_index] = p_emitter;
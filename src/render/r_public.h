@@ -158,6 +158,7 @@ typedef enum
     EMITTER_SETTINGS_FLAG__LOOP_ANIMATION = 1 << 1,
     EMITTER_SETTINGS_FLAG__CAST_SHADOWS = 1 << 2,
     EMITTER_SETTINGS_FLAG__ANIMATION = 1 << 3,
+    EMITTER_SETTINGS_FLAG__COLLISION = 1 << 4,
 } EmitterSettingsFlags;
 
 typedef enum
@@ -168,6 +169,7 @@ typedef enum
     EES__MAX_EMSHAPE
 } EmitterEmissionShape;
 
+//Gpu particle. Must match GL struct
 typedef struct
 {
     mat4 xform;
@@ -176,17 +178,26 @@ typedef struct
     unsigned local_index;
     unsigned emitter_index;
     vec4 color;
+    float time;
+    unsigned active;
 } Particle;
+//Cpu particles stored as structure of arrays. The arrays are 16 byte aligned and
+//padded to a multiple of 4, so they can be processed in sse batches
 typedef struct
 {
-    mat4 xform;
-    vec3 velocity;
-    vec4 color;
-
-    float time;
-
-    bool active;
-} ParticleCpu;
+    float* position[3];
+    float* velocity[3];
+    float* color[4];
+    float* time;
+    float* local_delta;
+    uint32_t* active;
+
+    int count;
+    int capacity;
+
+    void* _block;
+} ParticleSoA;
+//Must match GL struct
 typedef struct
 {
     mat4 xform;
@@ -244,10 +255,20 @@ typedef struct
 
     unsigned h_frames;
     unsigned v_frames;
+
+    float flatness;
+    unsigned particle_offset;
+
+    vec4 texture_region;
 } ParticleEmitterGL;
 
-typedef void (*ParticleCollision_fun)(ParticleCpu* const particle, struct ParticleEmitterSettings* const emitter, float local_delta);
-typedef struct
+#define PARTICLE_SPREAD_TABLE_SIZE 64
+
+struct ParticleEmitterSettings;
+
+//Called with a range of particles, so that the world lookups can be batched
+typedef void (*ParticleCollision_fun)(ParticleSoA* const particles, struct ParticleEmitterSettings* const emitter, int start, int end);
+typedef struct ParticleEmitterSettings
 {
     mat4 xform;
 
@@ -305,10 +326,18 @@ typedef struct
 
     bool _queue_update;
 
+    float _spread_table[PARTICLE_SPREAD_TABLE_SIZE][2]; //precomputed cos and sin pairs
+    float _spread_table_spread;
+    float _spread_table_flatness;
+    bool _spread_table_valid;
+
+    int _gpu_offset; //offset into the gpu particle buffer
+    int _gpu_amount;
+
     ParticleCollision_fun collision_function;
 
     R_Texture* texture;
-    dynamic_array* particles;
+    ParticleSoA particles;
 } ParticleEmitterSettings;
 
 
@@ -317,6 +346,7 @@ void Particle_RemoveEmitter(ParticleEmitterSettings* p_emitter);
 void Particle_MarkUpdate(ParticleEmitterSettings* p_emitter);
 void Particle_Emit(ParticleEmitterSettings* p_emitter);
 void Particle_EmitTransformed(ParticleEmitterSettings* p_emitter, vec3 direction, vec3 origin);
+void Particle_CollideWithWorld(ParticleSoA* const p_particles, ParticleEmitterSettings* const p_emitter, int p_start, int p_end);
 void Particle_Pause();
 void Particle_Stop();
 
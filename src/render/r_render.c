@@ -17,12 +17,14 @@ extern RPass_PassData* pass;
 extern R_Cvars r_cvars;
 extern R_StorageBuffers storage;
 extern R_Scene scene;
+extern R_Metrics metrics;
+extern R_FrameSnapshot snapshot;
 
 static void Render_ScreenQuadBatch()
 {
     RDraw_ScreenQuadData* data = &drawData->screen_quad;
 
-    if (data->vertices_count == 0)
+    if (snapshot.screen_quad_indices_count == 0)
     {
         return;
     }
@@ -32,12 +34,12 @@ static void Render_ScreenQuadBatch()
     //bind texture units
     for (int i = 0; i < 32; i++)
     {
-        if (data->tex_array[i] == 0)
+        if (snapshot.screen_quad_textures[i] == 0)
         {
             break;
         }
 
-        unsigned texture_index = data->tex_array[i];
+        unsigned texture_index = snapshot.screen_quad_textures[i];
 
         glBindTextureUnit(i, texture_index);
     }
@@ -45,18 +47,14 @@ static void Render_ScreenQuadBatch()
     Shader_SetMat4(&pass->scene.screen_shader, SCREEN_SHADER_UNIFORM_PROJECTION, data->ortho);
 
     glBindVertexArray(data->vao);
-    glDrawElements(GL_TRIANGLES, data->indices_count, GL_UNSIGNED_INT, 0);
-
-    data->vertices_count = 0;
-    data->indices_count = 0;
-    data->tex_index = 0;
+    glDrawElements(GL_TRIANGLES, snapshot.screen_quad_indices_count, GL_UNSIGNED_INT, 0);
 }
 
 static void Render_LineBatch()
 {
     RDraw_LineData* data = &drawData->lines;
 
-    if (data->vertices_count == 0)
+    if (snapshot.line_vertices_count == 0)
     {
         return;
     }
@@ -68,32 +66,32 @@ static void Render_LineBatch()
     Shader_Use(&pass->scene.shader_3d_forward);
 
     glBindVertexArray(data->vao);
-    glDrawArrays(GL_LINES, 0, data->vertices_count);
+    glDrawArrays(GL_LINES, 0, snapshot.line_vertices_count);
 }
 
 static void Render_TriangleBatch()
 {
     RDraw_TriangleData* data = &drawData->triangle;
 
-    if (data->vertices_count == 0)
+    if (snapshot.triangle_vertices_count == 0)
         return;
 
     return;
 
    // glUseProgram(pass->general.triangle_3d_shader);
 
-    glBindTextures(0, 32, data->texture_ids);
+    glBindTextures(0, 32, snapshot.triangle_textures);
 
     glEnable(GL_BLEND);
     glBindVertexArray(data->vao);
-    glDrawArrays(GL_TRIANGLES, 0, data->vertices_count);
+    glDrawArrays(GL_TRIANGLES, 0, snapshot.triangle_vertices_count);
 }
 
 static void Render_CubeInstances()
 {
     RDraw_CubeData* data = &drawData->cube;
 
-    if (data->vertices_buffer->elements_size == 0)
+    if (snapshot.cube_instance_count == 0)
     {
         return;
     }
@@ -112,9 +110,9 @@ static void Render_CubeInstances()
     glDisable(GL_CULL_FACE);
     glBindVertexArray(drawData->cube.vao);
     
-    glBindTextures(0, data->texture_index, data->texture_ids);
+    glBindTextures(0, snapshot.cube_texture_count, snapshot.cube_textures);
 
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, drawData->cube.instance_count);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, snapshot.cube_instance_count);
 
     glEnable(GL_CULL_FACE);
 }
@@ -124,14 +122,24 @@ static void Render_Particles()
     RDraw_ParticleData* data = &drawData->particles;
 
     //nothing to draw?
-    if (data->instance_count <= 0)
+    if (snapshot.particle_instance_count <= 0 && !snapshot.gpu_particles_enabled)
     {
         return;
     }
-    glBindTextures(0, drawData->particles.texture_index, drawData->particles.texture_ids);
+    glBindTextures(0, snapshot.particle_texture_count, snapshot.particle_textures);
 
-    glBindVertexArray(data->vao);
-    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, data->instance_count);
+    if (snapshot.particle_instance_count > 0)
+    {
+        glBindVertexArray(data->vao);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, snapshot.particle_instance_count);
+    }
+    if (snapshot.gpu_particles_enabled)
+    {
+        //instance count is written by the particle compute shader
+        glBindVertexArray(data->gpu_vao);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, data->gpu_draw_cmd_buffer);
+        glDrawArraysIndirect(GL_TRIANGLE_FAN, 0);
+    }
 }
 
 void Render_Quad()
@@ -147,13 +155,29 @@ void Render_Cube()
 }
 
 
+static void Render_WorldChunkPassList(LC_PassCullList p_list)
+{
+    //upper bound, the actual draw count is written by cull_chunks.comp
+    size_t max_draw_count = drawData->lc_world.world_render_data->draw_cmds_buffer.used_size;
+
+    if (max_draw_count == 0)
+    {
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawData->lc_world.pass_draw_cmds_buffer);
+    glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.pass_draw_counts_buffer);
+
+    glMultiDrawArraysIndirectCount(GL_TRIANGLES, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * p_list, sizeof(unsigned) * p_list, max_draw_count, 0);
+}
+
 static void Render_OpaqueWorldChunks(bool p_TextureDraw, int mode)
 {
-    if (drawData->lc_world.draw == false || !drawData->lc_world.world_render_data)
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
     {
         return;
     }
-    size_t max_chunk_render_amount = scene.cull_data.lc_world.opaque_in_frustrum;
+    size_t max_chunk_render_amount = snapshot.lc_opaque_in_frustrum;
 
     //hacky but, add little so that won't cause popups 
     if (max_chunk_render_amount > 0)
@@ -183,55 +207,101 @@ static void Render_OpaqueWorldChunks(bool p_TextureDraw, int mode)
 
             glMultiDrawArraysIndirectCount(render_mode, offset, 0, max_chunk_render_amount, 0);
 
+            //chunks that were disoccluded this frame
+            glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->occlusion_counters_buffer);
+            glMultiDrawArraysIndirectCount(render_mode, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * 3, offsetof(LC_OcclusionCounters, disoccluded_opaque), max_chunk_render_amount, 0);
+
             //kinda hacky but works(only for debugging)
             if (r_cvars.r_wireframe->int_value == 1)
             {
                 glDisable(GL_DEPTH_TEST);
+                glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->atomic_counters[0]);
                 glMultiDrawArraysIndirectCount(GL_LINES, offset, 0, max_chunk_render_amount, 0);
                 glEnable(GL_DEPTH_TEST);
             }
         }
        
     }
+    //Only the chunks that were disoccluded this frame
+    else if (mode == 6)
+    {
+        if (max_chunk_render_amount > 0)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawData->lc_world.world_render_data->draw_cmds_sorted_buffer);
+            glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->occlusion_counters_buffer);
+            glMultiDrawArraysIndirectCount(GL_TRIANGLES, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * 3, offsetof(LC_OcclusionCounters, disoccluded_opaque), max_chunk_render_amount, 0);
+        }
+    }
     //Shadow rendering
     else if (mode < 5)
     {
         int shadow_split = min(mode - 1, 3);
 
-        int* first = NULL;
-        int* count = NULL;
-        int draw_count = 0;
-
-        first = drawData->lc_world.shadow_firsts[shadow_split]->data;
-        count = drawData->lc_world.shadow_counts[shadow_split]->data;
-        draw_count = scene.cull_data.lc_world.shadow_cull_count[shadow_split];
-        if (draw_count > 0)
-        {
-            glMultiDrawArrays(GL_TRIANGLES, first, count, draw_count);
-        } 
+        Render_WorldChunkPassList(LC_PASS_CULL_LIST__SHADOW_OPAQUE + shadow_split);
     }
     //reflection pass rendering
     else if (mode == 5)
     {
-        int* first = drawData->lc_world.reflection_pass_opaque_firsts->data;
-        int* count = drawData->lc_world.reflection_pass_opaque_counts->data;
-        int draw_count = scene.cull_data.lc_world.reflection_opaque_count;
+        glBindTextureUnit(2, pass->ibl.irradianceCubemapTexture);
+        glBindTextureUnit(3, pass->ibl.envCubemapTexture);
+        glBindTextureUnit(4, pass->ibl.brdfLutTexture);
 
-        if (draw_count > 0)
-        {
-            glBindTextureUnit(2, pass->ibl.irradianceCubemapTexture);
-            glBindTextureUnit(3, pass->ibl.envCubemapTexture);
-            glBindTextureUnit(4, pass->ibl.brdfLutTexture);
+        Render_WorldChunkPassList(LC_PASS_CULL_LIST__REFLECTION_OPAQUE);
+    }
+   
+}
+
+static void Render_WorldHorizon(bool p_gbuffer)
+{
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
+    {
+        return;
+    }
+    LC_HorizonRenderData* horizon = &drawData->lc_world.world_render_data->horizon;
+
+    if (!horizon->enabled || horizon->index_count == 0)
+    {
+        return;
+    }
+
+    Shader_ResetDefines(&pass->lc.horizon_shader);
+    Shader_SetDefine(&pass->lc.horizon_shader, LC_HORIZON_DEFINE_GBUFFER_PASS, p_gbuffer);
+
+    Shader_Use(&pass->lc.horizon_shader);
 
-            glMultiDrawArrays(GL_TRIANGLES, first, count, draw_count);
+    glBindTextureUnit(0, horizon->height_texture);
+
+    if (p_gbuffer)
+    {
+        glBindTextureUnit(1, drawData->lc_world.world_render_data->texture_atlas->id);
+        glBindTextureUnit(2, drawData->lc_world.world_render_data->texture_atlas_mer->id);
+    }
+    glBindVertexArray(horizon->vao);
+
+    int origin_loc = Shader_GetUniformLocation(&pass->lc.horizon_shader, LC_HORIZON_UNIFORM_ORIGIN);
+
+    //the finer levels cut a hole into the coarser ones, so the order doesn't matter
+    for (int i = 0; i < LC_HORIZON_LEVELS; i++)
+    {
+        LC_HorizonLevel* level = &horizon->levels[i];
+
+        if (!level->ready)
+        {
+            continue;
         }
+
+        glUniform2i(origin_loc, level->origin[0], level->origin[1]);
+        Shader_SetFloaty(&pass->lc.horizon_shader, LC_HORIZON_UNIFORM_CELLSIZE, level->cell_size);
+        Shader_SetInt(&pass->lc.horizon_shader, LC_HORIZON_UNIFORM_LEVEL, i);
+        Shader_SetVec4(&pass->lc.horizon_shader, LC_HORIZON_UNIFORM_HOLEBOX, level->hole_box);
+
+        glDrawElements(GL_TRIANGLES, horizon->index_count, GL_UNSIGNED_INT, 0);
     }
-   
 }
 
 static void Render_SemiTransparentWorldChunks(bool p_TextureDraw, int mode)
 {
-    if (drawData->lc_world.draw == false || !drawData->lc_world.world_render_data)
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
     {
         return;
     }
@@ -242,7 +312,7 @@ static void Render_SemiTransparentWorldChunks(bool p_TextureDraw, int mode)
         glBindTextureUnit(2, drawData->lc_world.world_render_data->texture_atlas_mer->id);
     }
 
-    size_t max_chunk_render_amount = scene.cull_data.lc_world.transparent_in_frustrum;
+    size_t max_chunk_render_amount = snapshot.lc_transparent_in_frustrum;
 
     //hacky but, add little so that won't cause popups 
     if (max_chunk_render_amount > 0)
@@ -262,60 +332,58 @@ static void Render_SemiTransparentWorldChunks(bool p_TextureDraw, int mode)
             glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->atomic_counters[1]);
             glMultiDrawArraysIndirectCount(render_mode, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT, 0, max_chunk_render_amount, 0);
 
+            //chunks that were disoccluded this frame
+            glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->occlusion_counters_buffer);
+            glMultiDrawArraysIndirectCount(render_mode, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * 4, offsetof(LC_OcclusionCounters, disoccluded_transparent), max_chunk_render_amount, 0);
+
             //kinda hacky but works(only for debugging)
             if (r_cvars.r_wireframe->int_value == 1)
             {
                 glDisable(GL_DEPTH_TEST);
+                glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->atomic_counters[1]);
                 glMultiDrawArraysIndirectCount(GL_LINES, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT, 0, max_chunk_render_amount, 0);
                 glEnable(GL_DEPTH_TEST);
             }
         }
     }
+    //Only the chunks that were disoccluded this frame
+    else if (mode == 6)
+    {
+        if (max_chunk_render_amount > 0)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawData->lc_world.world_render_data->draw_cmds_sorted_buffer);
+            glBindBuffer(GL_PARAMETER_BUFFER, drawData->lc_world.world_render_data->occlusion_counters_buffer);
+            glMultiDrawArraysIndirectCount(GL_TRIANGLES, sizeof(DrawArraysIndirectCommand) * LC_WORLD_MAX_CHUNK_LIMIT * 4, offsetof(LC_OcclusionCounters, disoccluded_transparent), max_chunk_render_amount, 0);
+        }
+    }
     //Shadow rendering
     else if (mode < 5)
     {
         int shadow_split = min(mode - 1, 3);
 
-        int* first = NULL;
-        int* count = NULL;
-        int draw_count = 0;
-
-        first = drawData->lc_world.shadow_firsts_transparent[shadow_split]->data;
-        count = drawData->lc_world.shadow_counts_transparent[shadow_split]->data;
-        draw_count = scene.cull_data.lc_world.shadow_cull_transparent_count[shadow_split];
+        glBindTextureUnit(0, drawData->lc_world.world_render_data->texture_atlas->id);
 
-        if (draw_count > 0)
-        {
-            glBindTextureUnit(0, drawData->lc_world.world_render_data->texture_atlas->id);
-            glMultiDrawArrays(GL_TRIANGLES, first, count, draw_count);
-        }
+        Render_WorldChunkPassList(LC_PASS_CULL_LIST__SHADOW_TRANSPARENT + shadow_split);
     }
     //reflection pass rendering
     else if (mode == 5)
     {
-        int* first = drawData->lc_world.reflection_pass_transparent_firsts->data;
-        int* count = drawData->lc_world.reflection_pass_transparent_counts->data;
-        int draw_count = scene.cull_data.lc_world.reflection_transparent_count;
+        glBindTextureUnit(2, pass->ibl.irradianceCubemapTexture);
+        glBindTextureUnit(3, pass->ibl.envCubemapTexture);
+        glBindTextureUnit(4, pass->ibl.brdfLutTexture);
 
-        if (draw_count > 0)
-        {
-            glBindTextureUnit(2, pass->ibl.irradianceCubemapTexture);
-            glBindTextureUnit(3, pass->ibl.envCubemapTexture);
-            glBindTextureUnit(4, pass->ibl.brdfLutTexture);
-
-            glMultiDrawArrays(GL_TRIANGLES, first, count, draw_count);
-        }
+        Render_WorldChunkPassList(LC_PASS_CULL_LIST__REFLECTION_TRANSPARENT);
     }
 
 }
 void Render_WorldWaterChunks()
 {
-    if (drawData->lc_world.draw == false || !drawData->lc_world.world_render_data)
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
     {
         return;
     }
 
-    size_t max_chunk_render_amount = scene.cull_data.lc_world.water_in_frustrum;
+    size_t max_chunk_render_amount = snapshot.lc_water_in_frustrum;
 
     if (max_chunk_render_amount > 0)
     {
@@ -342,20 +410,6 @@ void Render_WorldWaterChunks()
     }
 }
 
-void Render_DrawChunkOcclusionBoxes()
-{
-    if (drawData->lc_world.draw == false || !drawData->lc_world.world_render_data || scene.cull_data.lc_world.total_in_frustrum_count <= 0)
-    {
-        return;
-    }
-
-    glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, 0, sizeof(int) * scene.cull_data.lc_world.total_in_frustrum_count, scene.cull_data.lc_world.frustrum_sorted_query_buffer);
-    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-
-    glBindVertexArray(resources.cubeVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 14, scene.cull_data.lc_world.total_in_frustrum_count);
-}
-
 void Render_SimpleScene()
 {   
     Render_LineBatch();
@@ -368,32 +422,232 @@ void Render_UI()
     Render_ScreenQuadBatch();
 }
 
+static void Compute_BindWorldChunkBuffers()
+{
+    LC_WorldRenderData* world_data = drawData->lc_world.world_render_data;
+
+    for (int i = 0; i < 3; i++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10 + i, world_data->atomic_counters[i]);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, world_data->chunk_data_buffer.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, world_data->draw_cmds_buffer.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, world_data->prev_in_frustrum_bitset_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, world_data->visibles_sorted_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, world_data->draw_cmds_sorted_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 24, world_data->occlusion_counters_buffer);
+
+    glBindTextureUnit(0, pass->general.hiz_texture);
+}
+
+static void Compute_ReadbackOcclusionCounters()
+{
+    LC_WorldRenderData* world_data = drawData->lc_world.world_render_data;
+
+    //copy this frame's counters and read the ones from two frames ago, so we don't stall on the gpu
+    int write_index = pass->lc.occlusion_readback_index;
+    int read_index = (write_index + 1) % 3;
+
+    if (metrics.total_render_frame_count >= 2)
+    {
+        LC_OcclusionCounters counters;
+        glGetNamedBufferSubData(pass->lc.occlusion_readback_buffers[read_index], 0, sizeof(LC_OcclusionCounters), &counters);
+
+        metrics.occlusion_culled_chunks = counters.culled_chunks;
+        metrics.occlusion_saved_draw_cmds = counters.saved_draw_cmds;
+        metrics.occlusion_disoccluded_chunks = counters.disoccluded_chunks;
+    }
+
+    glCopyNamedBufferSubData(world_data->occlusion_counters_buffer, pass->lc.occlusion_readback_buffers[write_index], 0, 0, sizeof(LC_OcclusionCounters));
+
+    pass->lc.occlusion_readback_index = read_index;
+}
+
 static void Compute_WorldChunks()
 {
-    if (drawData->lc_world.draw == false)
+    if (snapshot.draw_lc_world == false)
     {
         return;
     }
 
-    size_t chunk_amount = scene.cull_data.lc_world.total_in_frustrum_count;
+    size_t chunk_amount = snapshot.lc_total_in_frustrum;
     int num_x_groups = ceilf((float)chunk_amount / 16.0f);
 
     drawData->lc_world.world_render_data = LC_World_getRenderData();
 
+    LC_WorldRenderData* world_data = drawData->lc_world.world_render_data;
+
+    //holds last frame's second phase results
+    Compute_ReadbackOcclusionCounters();
+
+    for (int i = 0; i < 3; i++)
+    {
+        glClearNamedBufferData(world_data->atomic_counters[i], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    }
+    glClearNamedBufferData(world_data->occlusion_counters_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
     Shader_Use(&pass->lc.process_chunks_shader);
 
     Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_TOTALCHUNKAMOUNT, chunk_amount);
+    Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_PHASE, 0);
+    Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_HIZLEVELS, pass->general.hiz_levels);
 
-    for (int i = 0; i < 3; i++)
+    Compute_BindWorldChunkBuffers();
+
+    glDispatchCompute(num_x_groups, 1, 1);
+}
+
+/*
+* Second phase of the occlusion culling, called from the hi-z pass after the depth prepass.
+* Tests every chunk in frustrum against the hi-z and appends the disoccluded ones to their own lists
+*/
+void Compute_WorldChunksOcclusion()
+{
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
+    {
+        return;
+    }
+
+    size_t chunk_amount = snapshot.lc_total_in_frustrum;
+
+    if (chunk_amount == 0)
+    {
+        return;
+    }
+
+    int num_x_groups = ceilf((float)chunk_amount / 16.0f);
+
+    Shader_Use(&pass->lc.process_chunks_shader);
+
+    Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_TOTALCHUNKAMOUNT, chunk_amount);
+    Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_PHASE, 1);
+    Shader_SetInt(&pass->lc.process_chunks_shader, PROCESS_CHUNKS_UNIFORM_HIZLEVELS, pass->general.hiz_levels);
+
+    Compute_BindWorldChunkBuffers();
+
+    glDispatchCompute(num_x_groups, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+static void Compute_CullWorldChunkPasses()
+{
+    if (snapshot.draw_lc_world == false || !drawData->lc_world.world_render_data)
+    {
+        return;
+    }
+
+    LC_WorldRenderData* world_data = drawData->lc_world.world_render_data;
+
+    size_t chunk_amount = world_data->draw_cmds_buffer.used_size;
+
+    //only the splits that are not cached
+    unsigned shadow_split_mask = 0;
+
+    if (r_cvars.r_useDirShadowMapping->int_value)
+    {
+        for (int i = 0; i < r_cvars.r_shadowSplits->int_value; i++)
+        {
+            if (snapshot.shadow_split_render[i])
+            {
+                shadow_split_mask |= 1 << i;
+            }
+        }
+    }
+
+    //only bother with the reflection pass if there is a visible water chunk
+    bool cull_reflection = snapshot.lc_water_in_frustrum > 0;
+
+    //the counts are also read as the draw count, so clear them even if nothing is culled this frame
+    glClearNamedBufferData(drawData->lc_world.pass_draw_counts_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (chunk_amount == 0 || (shadow_split_mask == 0 && !cull_reflection))
+    {
+        return;
+    }
+
+    vec4 shadow_boxes[SHADOW_CASCADE_LEVELS * 2];
+    memset(shadow_boxes, 0, sizeof(shadow_boxes));
+
+    for (int i = 0; i < SHADOW_CASCADE_LEVELS; i++)
+    {
+        glm_vec3_copy(snapshot.shadow_split_boxes[i][0], shadow_boxes[i * 2]);
+        glm_vec3_copy(snapshot.shadow_split_boxes[i][1], shadow_boxes[i * 2 + 1]);
+    }
+
+    vec4 reflection_planes[6];
+    glm_frustum_planes(snapshot.reflection_projView_matrix, reflection_planes);
+
+    Shader_Use(&pass->lc.cull_chunks_shader);
+
+    Shader_SetUint(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_CHUNKAMOUNT, chunk_amount);
+    Shader_SetUint(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_SHADOWSPLITMASK, shadow_split_mask);
+    Shader_SetInt(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_CULLTRANSPARENT, r_cvars.r_allowTransparentShadows->int_value == 1);
+    Shader_SetInt(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_CULLREFLECTION, cull_reflection);
+
+    int loc = Shader_GetUniformLocation(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_SHADOWBOXES);
+
+    if (loc > -1)
+    {
+        glUniform4fv(loc, SHADOW_CASCADE_LEVELS * 2, (const float*)shadow_boxes);
+    }
+
+    loc = Shader_GetUniformLocation(&pass->lc.cull_chunks_shader, CULL_CHUNKS_UNIFORM_REFLECTIONPLANES);
+
+    if (loc > -1)
+    {
+        glUniform4fv(loc, 6, (const float*)reflection_planes);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, world_data->chunk_data_buffer.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, world_data->draw_cmds_buffer.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 22, drawData->lc_world.pass_draw_cmds_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 23, drawData->lc_world.pass_draw_counts_buffer);
+
+    int num_x_groups = ceilf((float)chunk_amount / 64.0f);
+    glDispatchCompute(num_x_groups, 1, 1);
+}
+
+void Compute_Particles()
+{
+    RDraw_ParticleData* data = &drawData->particles;
+
+    if (!data->gpu_enabled)
     {
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10 + i, drawData->lc_world.world_render_data->atomic_counters[i]);
+        return;
     }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, drawData->lc_world.world_render_data->draw_cmds_buffer.buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, drawData->lc_world.world_render_data->prev_in_frustrum_bitset_buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, drawData->lc_world.world_render_data->draw_cmds_sorted_buffer);
+    //reset the instance count, the visible particles are added to it in the shader
+    DrawArraysIndirectCommand draw_cmd;
+    memset(&draw_cmd, 0, sizeof(DrawArraysIndirectCommand));
+    draw_cmd.count = 4;
+
+    glNamedBufferSubData(data->gpu_draw_cmd_buffer, 0, sizeof(DrawArraysIndirectCommand), &draw_cmd);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
 
+    Shader_Use(&pass->particles.simulate_shader);
+
+    Shader_SetUint(&pass->particles.simulate_shader, PARTICLES_UNIFORM_PARTICLEAMOUNT, data->gpu_particle_amount);
+    Shader_SetMat4(&pass->particles.simulate_shader, PARTICLES_UNIFORM_PREVVIEWPROJECTION, data->gpu_prev_view_proj);
+
+    //depth and normals from the previous frame, used for collision
+    glBindTextureUnit(0, pass->deferred.depth_texture);
+    glBindTextureUnit(1, pass->deferred.gNormalMetal_texture);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, data->gpu_particle_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 19, data->gpu_emitter_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, data->gpu_instance_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 21, data->gpu_draw_cmd_buffer);
+
+    int num_x_groups = ceilf((float)data->gpu_particle_amount / 64.0f);
     glDispatchCompute(num_x_groups, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glm_mat4_copy(snapshot.viewProjection, data->gpu_prev_view_proj);
 }
 
 static void Compute_Meshes()
@@ -404,6 +658,7 @@ static void Compute_Meshes()
 void Compute_DispatchAll()
 {
     Compute_WorldChunks();
+    Compute_CullWorldChunkPasses();
 }
 
 void Compute_Sync()
@@ -425,10 +680,24 @@ void Render_OpaqueScene(RenderPassState rpass_state)
 
         Render_OpaqueWorldChunks(false, 0);
 
+        //terrain past the chunks
+        Render_WorldHorizon(false);
+
         //Render other opaque stuff
 
         break;
     }
+    case RPass__DEPTH_PREPASS_DISOCCLUDED:
+    {
+        Shader_ResetDefines(&pass->lc.world_shader);
+        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
+
+        Shader_Use(&pass->lc.world_shader);
+
+        Render_OpaqueWorldChunks(false, 6);
+
+        break;
+    }
     case RPass__GBUFFER:
     {
         Shader_ResetDefines(&pass->lc.world_shader);
@@ -441,6 +710,9 @@ void Render_OpaqueScene(RenderPassState rpass_state)
         //Render opaque world chunks
         Render_OpaqueWorldChunks(true, 0);
 
+        //terrain past the chunks
+        Render_WorldHorizon(true);
+
         //Render other opaque stuff
 
         break;
@@ -450,13 +722,11 @@ void Render_OpaqueScene(RenderPassState rpass_state)
         //Render opaque world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[0]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_offsets[0]);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[0]);
         
         Render_OpaqueWorldChunks(false, 1);
 
@@ -469,14 +739,12 @@ void Render_OpaqueScene(RenderPassState rpass_state)
     {
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
 
         Shader_Use(&pass->lc.world_shader);
 
         //Render opaque world chunks
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[1]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_offsets[1]);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[1]);
         Render_OpaqueWorldChunks(false, 2);
 
         //Render other opaque stuff
@@ -488,14 +756,12 @@ void Render_OpaqueScene(RenderPassState rpass_state)
         //Render opaque world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
 
         Shader_Use(&pass->lc.world_shader);
 
         //Render opaque world chunks
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[2]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_offsets[2]);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[2]);
         Render_OpaqueWorldChunks(false, 3);
 
         //Render other opaque stuff
@@ -507,14 +773,12 @@ void Render_OpaqueScene(RenderPassState rpass_state)
         //Render opaque world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
 
         Shader_Use(&pass->lc.world_shader);
 
         //Render opaque world chunks
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[3]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_offsets[3]);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[3]);
         Render_OpaqueWorldChunks(false, 4);
 
         //Render other opaque stuff
@@ -523,13 +787,7 @@ void Render_OpaqueScene(RenderPassState rpass_state)
     }
     case RPass__REFLECTION_CLIP:
     {
-        glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, 0, sizeof(int) * drawData->lc_world.reflection_pass_chunk_indexes->elements_size,
-            drawData->lc_world.reflection_pass_chunk_indexes->data);
-
-        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-
         Shader_ResetDefines(&pass->lc.world_shader);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_CLIP_DISTANCE, true);
@@ -537,8 +795,7 @@ void Render_OpaqueScene(RenderPassState rpass_state)
         
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, pass->water.reflection_projView_matrix);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, 0);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.reflection_projView_matrix);
         Shader_SetFloaty(&pass->lc.world_shader, LC_WORLD_UNIFORM_CLIPDISTANCE, -LC_WORLD_WATER_HEIGHT);
 
         Render_OpaqueWorldChunks(true, 5);
@@ -557,7 +814,6 @@ void Render_OpaqueScene(RenderPassState rpass_state)
 void Render_SemiOpaqueScene(RenderPassState rpass_state)
 {
     bool allow_particle_shadows = (r_cvars.r_allowParticleShadows->int_value == 1);
-    unsigned shadow_data_offset = dA_size(drawData->lc_world.shadow_sorted_chunk_indexes);
 
     const int MAX_PARTICLE_SHADOW_SPLITS = 1; //adjust if needed
   
@@ -592,6 +848,19 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
 
         break;
     }
+    case RPass__DEPTH_PREPASS_DISOCCLUDED:
+    {
+        Shader_ResetDefines(&pass->lc.world_shader);
+        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
+        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_SEMI_TRANSPARENT, true);
+        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
+
+        Shader_Use(&pass->lc.world_shader);
+
+        Render_SemiTransparentWorldChunks(true, 6);
+
+        break;
+    }
     case RPass__GBUFFER:
     {
         Shader_ResetDefines(&pass->lc.world_shader);
@@ -624,15 +893,13 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
     {
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_SEMI_TRANSPARENT, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[0]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_transparent_offsets[0] + shadow_data_offset);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[0]);
 
         Render_SemiTransparentWorldChunks(false, 1);
 
@@ -652,7 +919,7 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
             
             Shader_Use(&pass->scene.shader_3d_forward);
 
-            Shader_SetMat4(&pass->scene.shader_3d_forward, SCENE_3D_UNIFORM_CAMERAMATRIX, scene.scene_data.shadow_matrixes[0]);
+            Shader_SetMat4(&pass->scene.shader_3d_forward, SCENE_3D_UNIFORM_CAMERAMATRIX, snapshot.shadow_matrixes[0]);
             Render_Particles();
         }
         break;
@@ -662,15 +929,13 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
         //Render transparent world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_SEMI_TRANSPARENT, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[1]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_transparent_offsets[1] + shadow_data_offset);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[1]);
 
         Render_SemiTransparentWorldChunks(false, 2);
 
@@ -682,15 +947,13 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
         //Render transparent world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_SEMI_TRANSPARENT, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[2]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_transparent_offsets[2] + shadow_data_offset);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[2]);
 
         Render_SemiTransparentWorldChunks(false, 3);
 
@@ -703,15 +966,13 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
         //Render transparent world chunks
         Shader_ResetDefines(&pass->lc.world_shader);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_DEPTH_PASS, true);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_SEMI_TRANSPARENT, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, scene.scene_data.shadow_matrixes[3]);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.shadow_sorted_chunk_transparent_offsets[3] + shadow_data_offset);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.shadow_matrixes[3]);
 
         Render_SemiTransparentWorldChunks(false, 4);
 
@@ -721,14 +982,7 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
     }
     case RPass__REFLECTION_CLIP:
     {
-        glNamedBufferSubData(drawData->lc_world.world_render_data->visibles_sorted_buffer, sizeof(int) * drawData->lc_world.reflection_pass_chunk_indexes->elements_size, 
-            sizeof(int) * drawData->lc_world.reflection_pass_transparent_chunk_indexes->elements_size,
-            drawData->lc_world.reflection_pass_transparent_chunk_indexes->data);
-
-        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-
         Shader_ResetDefines(&pass->lc.world_shader);
-        Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_CHUNK_INDEX_USE_OFFSET, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_UNIFORM_MATRIX, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_TEXCOORDS, true);
         Shader_SetDefine(&pass->lc.world_shader, LC_WORLD_DEFINE_USE_CLIP_DISTANCE, true);
@@ -737,8 +991,7 @@ void Render_SemiOpaqueScene(RenderPassState rpass_state)
 
         Shader_Use(&pass->lc.world_shader);
 
-        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, pass->water.reflection_projView_matrix);
-        Shader_SetInt(&pass->lc.world_shader, LC_WORLD_UNIFORM_CHUNKOFFSET, drawData->lc_world.reflection_pass_chunk_indexes->elements_size);
+        Shader_SetMat4(&pass->lc.world_shader, LC_WORLD_UNIFORM_MATRIX, snapshot.reflection_projView_matrix);
         Shader_SetFloaty(&pass->lc.world_shader, LC_WORLD_UNIFORM_CLIPDISTANCE, -LC_WORLD_WATER_HEIGHT);
 
         Render_SemiTransparentWorldChunks(true, 5);
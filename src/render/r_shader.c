@@ -1,13 +1,65 @@
 #include "render/r_shader.h"
 
 #include <string.h>
+#include <Windows.h>
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 
 #include "utility/u_utility.h"
+#include "utility/dynamic_array.h"
+
+#define SHADER_CACHE_DIRECTORY "shader_cache"
+#define SHADER_CACHE_MANIFEST_PATH SHADER_CACHE_DIRECTORY "/variants.txt"
+#define SHADER_BINARY_MAGIC 0x4243534C
+#define SHADER_BINARY_VERSION 1
+
+//KHR_parallel_shader_compile, not in our glad build
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+typedef enum
+{
+	SHADER_STAGE__VERTEX,
+	SHADER_STAGE__FRAGMENT,
+	SHADER_STAGE__GEOMETRY,
+	SHADER_STAGE__COMPUTE,
+	SHADER_STAGE__MAX
+} ShaderStage;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	GLenum format;
+	GLint length;
+} ShaderBinaryHeader;
+
+typedef struct
+{
+	uint64_t shader_id;
+	uint64_t variant_key;
+} ShaderKnownVariant;
+
+typedef struct
+{
+	bool initialized;
+	bool binaries_supported;
+	bool parallel_compile;
+
+	uint64_t driver_hash;
+
+	//variants used in previous runs, loaded from the manifest
+	dynamic_array* known_variants;
+
+	ShaderStats stats;
+} ShaderCache;
 
 static RShader* s_currentActiveShader = NULL;
 static uint64_t s_currentVariantKey = 0;
 static GLuint s_currentProgramID = 0;
+static ShaderCache s_cache;
 
 
 static uint32_t Shader_HashWrapper(const void* _key)
@@ -17,6 +69,212 @@ static uint32_t Shader_HashWrapper(const void* _key)
 	return Hash_uint64(x);
 }
 
+static uint64_t Shader_HashSources(char* const p_sources[SHADER_STAGE__MAX])
+{
+	uint64_t hash = s_cache.driver_hash;
+
+	for (int i = 0; i < SHADER_STAGE__MAX; i++)
+	{
+		if (p_sources[i])
+		{
+			hash = Hash_bytes64(p_sources[i], strlen(p_sources[i]), hash);
+		}
+		//separate the stages
+		hash = Hash_bytes64(&i, sizeof(i), hash);
+	}
+
+	return hash;
+}
+
+static void Shader_CacheInit()
+{
+	if (s_cache.initialized)
+	{
+		return;
+	}
+	s_cache.initialized = true;
+	s_cache.known_variants = dA_INIT(ShaderKnownVariant, 0);
+
+	//the driver goes into every hash, so updating it invalidates the old binaries
+	const char* driver_strings[3] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+	
+	s_cache.driver_hash = HASH_BYTES64_SEED;
+	for (int i = 0; i < 3; i++)
+	{
+		if (driver_strings[i])
+		{
+			s_cache.driver_hash = Hash_bytes64(driver_strings[i], strlen(driver_strings[i]), s_cache.driver_hash);
+		}
+	}
+
+	GLint num_binary_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+	s_cache.binaries_supported = num_binary_formats > 0;
+
+	if (s_cache.binaries_supported)
+	{
+		CreateDirectoryA(SHADER_CACHE_DIRECTORY, NULL);
+	}
+
+	//let the driver compile on its own threads, so the warm up doesn't stall the main thread
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+	{
+		PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_compiler_threads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+
+		if (max_compiler_threads)
+		{
+			max_compiler_threads(0xFFFFFFFF);
+			s_cache.parallel_compile = true;
+		}
+	}
+
+	FILE* file = NULL;
+	fopen_s(&file, SHADER_CACHE_MANIFEST_PATH, "r");
+
+	if (file)
+	{
+		unsigned long long shader_id = 0;
+		unsigned long long variant_key = 0;
+
+		while (fscanf_s(file, "%llx %llx", &shader_id, &variant_key) == 2)
+		{
+			ShaderKnownVariant* known = dA_emplaceBack(s_cache.known_variants);
+			known->shader_id = shader_id;
+			known->variant_key = variant_key;
+		}
+
+		fclose(file);
+	}
+}
+
+static void Shader_RecordKnownVariant(uint64_t p_shaderId, uint64_t p_key)
+{
+	for (size_t i = 0; i < dA_size(s_cache.known_variants); i++)
+	{
+		ShaderKnownVariant* known = dA_at(s_cache.known_variants, i);
+
+		if (known->shader_id == p_shaderId && known->variant_key == p_key)
+		{
+			return;
+		}
+	}
+
+	ShaderKnownVariant* known = dA_emplaceBack(s_cache.known_variants);
+	known->shader_id = p_shaderId;
+	known->variant_key = p_key;
+
+	FILE* file = NULL;
+	fopen_s(&file, SHADER_CACHE_MANIFEST_PATH, "a");
+
+	if (file)
+	{
+		fprintf(file, "%016llx %016llx\n", (unsigned long long)p_shaderId, (unsigned long long)p_key);
+		fclose(file);
+	}
+}
+
+static void Shader_GetBinaryPath(uint64_t p_hash, char* r_path, size_t p_pathSize)
+{
+	sprintf_s(r_path, p_pathSize, SHADER_CACHE_DIRECTORY "/%016llx.bin", (unsigned long long)p_hash);
+}
+
+static unsigned Shader_LoadBinary(uint64_t p_hash)
+{
+	if (!s_cache.binaries_supported)
+	{
+		return 0;
+	}
+
+	char path[256];
+	Shader_GetBinaryPath(p_hash, path, sizeof(path));
+
+	FILE* file = NULL;
+	fopen_s(&file, path, "rb");
+
+	if (!file)
+	{
+		return 0;
+	}
+
+	unsigned program = 0;
+	ShaderBinaryHeader header;
+
+	if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == SHADER_BINARY_MAGIC && header.version == SHADER_BINARY_VERSION
+		&& header.source_hash == p_hash && header.length > 0)
+	{
+		void* binary = malloc(header.length);
+
+		if (binary && fread(binary, header.length, 1, file) == 1)
+		{
+			program = glCreateProgram();
+			glProgramBinary(program, header.format, binary, header.length);
+
+			//the driver is allowed to reject binaries, recompile from source then
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+			if (!success)
+			{
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+		if (binary)
+		{
+			free(binary);
+		}
+	}
+
+	fclose(file);
+
+	return program;
+}
+
+static void Shader_SaveBinary(uint64_t p_hash, unsigned p_program)
+{
+	if (!s_cache.binaries_supported)
+	{
+		return;
+	}
+
+	ShaderBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SHADER_BINARY_MAGIC;
+	header.version = SHADER_BINARY_VERSION;
+	header.source_hash = p_hash;
+
+	glGetProgramiv(p_program, GL_PROGRAM_BINARY_LENGTH, &header.length);
+
+	if (header.length <= 0)
+	{
+		return;
+	}
+
+	void* binary = malloc(header.length);
+
+	if (!binary)
+	{
+		return;
+	}
+
+	glGetProgramBinary(p_program, header.length, NULL, &header.format, binary);
+
+	char path[256];
+	Shader_GetBinaryPath(p_hash, path, sizeof(path));
+
+	FILE* file = NULL;
+	fopen_s(&file, path, "wb");
+
+	if (file)
+	{
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(binary, header.length, 1, file);
+		fclose(file);
+	}
+
+	free(binary);
+}
+
 static char* Shader_HandleIncludes(const char* p_srcPath, const char* p_buffer, int* p_bufferSize)
 {
 	if (!p_srcPath || !p_buffer)
@@ -242,22 +500,25 @@ static bool Shader_checkCompileErrors(unsigned int p_object, const char* p_type)
 	return true;
 }
 
-static unsigned Shader_CompileFinal(const char* vert_src, const char* frag_src, const char* geo_src, const char* comp_src)
+static unsigned Shader_CompileFinal(const char* vert_src, const char* frag_src, const char* geo_src, const char* comp_src, bool p_async)
 {
+	//in async mode nothing is queried here, so the driver can keep compiling in the background.
+	//The link status is checked when the variant is finished
 	//check if compute shader
 	if (comp_src)
 	{
 		unsigned compute_shader = glCreateShader(GL_COMPUTE_SHADER);
 		glShaderSource(compute_shader, 1, &comp_src, NULL);
 		glCompileShader(compute_shader);
-		if (!Shader_checkCompileErrors(compute_shader, "COMPUTE"))
+		if (!p_async && !Shader_checkCompileErrors(compute_shader, "COMPUTE"))
 			return 0;
 
 
 		unsigned program = glCreateProgram();
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glAttachShader(program, compute_shader);
 		glLinkProgram(program);
-		if (!Shader_checkCompileErrors(program, "PROGRAM"))
+		if (!p_async && !Shader_checkCompileErrors(program, "PROGRAM"))
 			return 0;
 
 		glDeleteShader(compute_shader);
@@ -273,14 +534,14 @@ static unsigned Shader_CompileFinal(const char* vert_src, const char* frag_src,
 		vertex_shader = glCreateShader(GL_VERTEX_SHADER);
 		glShaderSource(vertex_shader, 1, &vert_src, NULL);
 		glCompileShader(vertex_shader);
-		if (!Shader_checkCompileErrors(vertex_shader, "VERTEX"))
+		if (!p_async && !Shader_checkCompileErrors(vertex_shader, "VERTEX"))
 			return 0;
 
 		//fragment shader
 		fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 		glShaderSource(fragment_shader, 1, &frag_src, NULL);
 		glCompileShader(fragment_shader);
-		if (!Shader_checkCompileErrors(fragment_shader, "FRAGMENT"))
+		if (!p_async && !Shader_checkCompileErrors(fragment_shader, "FRAGMENT"))
 			return 0;
 
 		//geo check
@@ -289,13 +550,14 @@ static unsigned Shader_CompileFinal(const char* vert_src, const char* frag_src,
 			geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
 			glShaderSource(geometry_shader, 1, &geo_src, NULL);
 			glCompileShader(geometry_shader);
-			if (!Shader_checkCompileErrors(geometry_shader, "GEOMETRY"))
+			if (!p_async && !Shader_checkCompileErrors(geometry_shader, "GEOMETRY"))
 				return 0;
 		}
 
 		unsigned program_id;
 
 		program_id = glCreateProgram();
+		glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glAttachShader(program_id, vertex_shader);
 		glAttachShader(program_id, fragment_shader);
 
@@ -305,7 +567,7 @@ static unsigned Shader_CompileFinal(const char* vert_src, const char* frag_src,
 		}
 
 		glLinkProgram(program_id);
-		if (!Shader_checkCompileErrors(program_id, "PROGRAM"))
+		if (!p_async && !Shader_checkCompileErrors(program_id, "PROGRAM"))
 			return false;
 
 		//CLEANUP
@@ -369,11 +631,22 @@ static bool Shader_SetupUniformLocations(RShader* const shader, ShaderVariant* c
 	return true;
 }
 
-static bool Shader_CreateVariant(RShader* const shader, uint64_t key, ShaderVariant** r_variant)
+static void Shader_FreeVariantSources(char* p_sources[SHADER_STAGE__MAX])
 {
-	ShaderVariant variant;
-	variant.key = key;
-	
+	for (int i = 0; i < SHADER_STAGE__MAX; i++)
+	{
+		if (p_sources[i])
+		{
+			free(p_sources[i]);
+			p_sources[i] = NULL;
+		}
+	}
+}
+
+static bool Shader_BuildVariantSources(RShader* const shader, uint64_t key, char* r_sources[SHADER_STAGE__MAX])
+{
+	memset(r_sources, 0, sizeof(char*) * SHADER_STAGE__MAX);
+
 	unsigned char* vertex_buf = NULL;
 	unsigned char* fragment_buf = NULL;
 	unsigned char* geo_buf = NULL;
@@ -428,7 +701,6 @@ static bool Shader_CreateVariant(RShader* const shader, uint64_t key, ShaderVari
 	}
 	
 	bool include_result = false;
-	bool has_includes = false;
 
 	//setup defines
 	if (key != 0)
@@ -468,59 +740,142 @@ static bool Shader_CreateVariant(RShader* const shader, uint64_t key, ShaderVari
 					geo_buf = Shader_InsertDefines(geo_buf, shader->geo_length + 1, variant_defines, variant_index, &include_result);
 				}
 			}
-			has_includes = true;
 		}
 	}
 
-	//compile, this function will check for null ptrs
-	variant.program_id = Shader_CompileFinal(vertex_buf, fragment_buf, geo_buf, compute_buf);
-	
-	//clean up buffers
-	if (shader->is_compute && compute_buf)
+	r_sources[SHADER_STAGE__VERTEX] = vertex_buf;
+	r_sources[SHADER_STAGE__FRAGMENT] = fragment_buf;
+	r_sources[SHADER_STAGE__GEOMETRY] = geo_buf;
+	r_sources[SHADER_STAGE__COMPUTE] = compute_buf;
+
+	return true;
+}
+
+static void Shader_DestroyVariant(RShader* const shader, ShaderVariant* const variant, bool p_removeFromMap)
+{
+	if (variant->uniforms_locations)
 	{
-		free(compute_buf);
+		free(variant->uniforms_locations);
 	}
-	else
+	if (variant->program_id > 0)
 	{
-		if (vertex_buf)
-		{
-			free(vertex_buf);
-		}
-		if (fragment_buf)
-		{
-			free(fragment_buf);
-		}
-		if (geo_buf)
+		glDeleteProgram(variant->program_id);
+	}
+
+	if (p_removeFromMap)
+	{
+		uint64_t key = variant->key;
+		CHMap_Erase(&shader->variant_map, &key);
+	}
+}
+
+static bool Shader_FinishVariant(RShader* const shader, ShaderVariant* const variant)
+{
+	if (variant->pending)
+	{
+		//this will block if the driver hasn't finished compiling it yet
+		if (!Shader_checkCompileErrors(variant->program_id, "PROGRAM"))
 		{
-			free(geo_buf);
+			return false;
 		}
+		variant->pending = false;
 	}
-	
 
-	if (variant.program_id <= 0)
+	if (variant->save_binary)
 	{
-		return false;
+		Shader_SaveBinary(variant->source_hash, variant->program_id);
+		variant->save_binary = false;
 	}
 
-	variant.uniforms_locations = NULL;
 	//setup uniforms
-	if (!Shader_SetupUniformLocations(shader, &variant))
+	return Shader_SetupUniformLocations(shader, variant);
+}
+
+static bool Shader_StartVariant(RShader* const shader, uint64_t key, bool p_async, ShaderVariant** r_variant)
+{
+	char* sources[SHADER_STAGE__MAX];
+
+	if (!Shader_BuildVariantSources(shader, key, sources))
+	{
+		return false;
+	}
+
+	ShaderVariant variant;
+	memset(&variant, 0, sizeof(variant));
+	variant.key = key;
+	variant.source_hash = Shader_HashSources(sources);
+
+	//try the binary cache first
+	variant.program_id = Shader_LoadBinary(variant.source_hash);
+
+	if (variant.program_id > 0)
+	{
+		s_cache.stats.binary_hits++;
+	}
+	else
+	{
+		s_cache.stats.binary_misses++;
+
+		//compile, this function will check for null ptrs
+		variant.program_id = Shader_CompileFinal(sources[SHADER_STAGE__VERTEX], sources[SHADER_STAGE__FRAGMENT], sources[SHADER_STAGE__GEOMETRY], 
+			sources[SHADER_STAGE__COMPUTE], p_async);
+		variant.pending = p_async;
+		variant.save_binary = true;
+	}
+
+	Shader_FreeVariantSources(sources);
+
+	if (variant.program_id <= 0)
 	{
 		return false;
 	}
 
 	//insert to hashmap
-	*r_variant = (ShaderVariant*)CHMap_Insert(&shader->variant_map, &variant.key, &variant);
+	ShaderVariant* inserted = (ShaderVariant*)CHMap_Insert(&shader->variant_map, &variant.key, &variant);
+
+	if (!inserted->pending && !Shader_FinishVariant(shader, inserted))
+	{
+		Shader_DestroyVariant(shader, inserted, true);
+		return false;
+	}
+
+	*r_variant = inserted;
 
 	return true;
 }
 
+static void Shader_WarmUpKnownVariants(RShader* const shader)
+{
+	for (size_t i = 0; i < dA_size(s_cache.known_variants); i++)
+	{
+		ShaderKnownVariant* known = dA_at(s_cache.known_variants, i);
+
+		if (known->shader_id != shader->cache_id || CHMap_Find(&shader->variant_map, &known->variant_key))
+		{
+			continue;
+		}
+		//the defines might have changed since the manifest was written
+		if (shader->max_defines < 64 && (known->variant_key >> shader->max_defines) != 0)
+		{
+			continue;
+		}
+
+		ShaderVariant* variant = NULL;
+		if (Shader_StartVariant(shader, known->variant_key, true, &variant))
+		{
+			s_cache.stats.warmed_up_variants++;
+		}
+	}
+}
+
 static bool Shader_InitAndLoad(const char* vert_path, const char* frag_path, const char* geo_path, const char* comp_path, int max_defines, int max_uniforms, 
 	int max_texunits, const char** defines, const char** uniforms, const char** texunits, RShader* r_shader)
 {
 	RShader shader;
 	memset(&shader, 0, sizeof(shader));
 
+	Shader_CacheInit();
+
 	//check if compute shader
 	if (comp_path)
 	{
@@ -615,6 +970,19 @@ static bool Shader_InitAndLoad(const char* vert_path, const char* frag_path, con
 	shader.tex_unit_names = texunits;
 	shader.is_loaded = true;
 
+	const char* paths[SHADER_STAGE__MAX] = { vert_path, frag_path, geo_path, comp_path };
+	shader.cache_id = HASH_BYTES64_SEED;
+	for (int i = 0; i < SHADER_STAGE__MAX; i++)
+	{
+		if (paths[i])
+		{
+			shader.cache_id = Hash_bytes64(paths[i], strlen(paths[i]), shader.cache_id);
+		}
+	}
+
+	//start building the variants used in previous runs, they are finished when they are first used
+	Shader_WarmUpKnownVariants(&shader);
+
 	*r_shader = shader;
 
 	return true;
@@ -625,23 +993,6 @@ static ShaderVariant* Shader_FindVariant(RShader* const shader, uint64_t key)
 	return CHMap_Find(&shader->variant_map, &key);
 }
 
-static void Shader_DestroyVariant(RShader* const shader, ShaderVariant* const variant, bool p_removeFromMap)
-{
-	if (variant->uniforms_locations)
-	{
-		free(variant->uniforms_locations);
-	}
-	if (variant->program_id > 0)
-	{
-		glDeleteProgram(variant->program_id);
-	}
-
-	if (p_removeFromMap)
-	{
-		CHMap_Erase(&shader->variant_map, variant->key);
-	}
-}
-
 static void Shader_SetCurrent(RShader* const shader, ShaderVariant* const variant)
 {
 	s_currentActiveShader = shader;
@@ -657,8 +1008,12 @@ RShader Shader_PixelCreate(const char* vert_src, const char* frag_src, int max_d
 {	
 	RShader shader;
 
+	double start_time = glfwGetTime();
+
 	bool result = Shader_InitAndLoad(vert_src, frag_src, NULL, NULL, max_defines, max_uniforms, max_texunits, defines, uniforms, tex_units, &shader);
 
+	s_cache.stats.startup_time += (glfwGetTime() - start_time) * 1000.0;
+
 	if (!result)
 	{
 		memset(&shader, 0, sizeof(shader));
@@ -679,8 +1034,12 @@ RShader Shader_ComputeCreate(const char* comp_src, int max_defines, int max_unif
 {
 	RShader shader;
 
+	double start_time = glfwGetTime();
+
 	bool result = Shader_InitAndLoad(NULL, NULL, NULL, comp_src, max_defines, max_uniforms, max_texunits, defines, uniforms, tex_units, &shader);
 
+	s_cache.stats.startup_time += (glfwGetTime() - start_time) * 1000.0;
+
 	if (!result)
 	{
 		memset(&shader, 0, sizeof(shader));
@@ -733,6 +1092,62 @@ void Shader_Destruct(RShader* const shader)
 	}
 }
 
+void Shader_CacheCleanup()
+{
+	if (s_cache.known_variants)
+	{
+		dA_Destruct(s_cache.known_variants);
+	}
+	memset(&s_cache, 0, sizeof(s_cache));
+}
+
+ShaderStats Shader_GetStats()
+{
+	return s_cache.stats;
+}
+
+static ShaderVariant* Shader_GetVariant(RShader* const shader, uint64_t key)
+{
+	ShaderVariant* variant = Shader_FindVariant(shader, key);
+
+	if (variant && !variant->pending)
+	{
+		return variant;
+	}
+
+	//anything past this point stalls the frame
+	double start_time = glfwGetTime();
+
+	if (variant)
+	{
+		if (!Shader_FinishVariant(shader, variant))
+		{
+			Shader_DestroyVariant(shader, variant, true);
+			variant = NULL;
+		}
+	}
+	else
+	{
+		//compile new variant
+		if (Shader_StartVariant(shader, key, false, &variant))
+		{
+			Shader_RecordKnownVariant(shader->cache_id, key);
+		}
+		else
+		{
+			variant = NULL;
+		}
+	}
+
+	double hitch_time = (glfwGetTime() - start_time) * 1000.0;
+
+	s_cache.stats.hitch_count++;
+	s_cache.stats.last_hitch_time = hitch_time;
+	s_cache.stats.max_hitch_time = max(s_cache.stats.max_hitch_time, hitch_time);
+
+	return variant;
+}
+
 void Shader_Use(RShader* const shader)
 {
 	//if it's already active, do nothing and save a gl call
@@ -747,56 +1162,22 @@ void Shader_Use(RShader* const shader)
 		}
 	}
 
+	ShaderVariant* variant = shader->active_variant;
+
 	//do we need another variant?
-	if (shader->current_variant_key != shader->new_variant_key)
+	if (!variant || shader->current_variant_key != shader->new_variant_key)
 	{
-		//look for it in the hash map
-		ShaderVariant* variant = Shader_FindVariant(shader, shader->new_variant_key);
-		//if in hashmap, bind it
-		if (variant)
-		{
-			glUseProgram(variant->program_id);
-
-			//set as current
-			Shader_SetCurrent(shader, variant);
-		}
-		else
-		{
-			//otherwise, compile new variant
-			ShaderVariant* new_variant;
-			if (Shader_CreateVariant(shader, shader->new_variant_key, &new_variant))
-			{
-				glUseProgram(new_variant->program_id);
-
-				//set as current
-				Shader_SetCurrent(shader, new_variant);
-			}
-			
-		}
+		//look for it in the hash map, otherwise compile it
+		variant = Shader_GetVariant(shader, shader->new_variant_key);
 	}
-	else
+
+	if (variant)
 	{
-		//do we have active variant
-		if (shader->active_variant)
-		{
-			glUseProgram(shader->active_variant->program_id);
-			Shader_SetCurrent(shader, shader->active_variant);
-		}
-		else
-		{
-			//we need to create for current variant
-			ShaderVariant* current_variant;
-			if (Shader_CreateVariant(shader, shader->current_variant_key, &current_variant))
-			{
-				glUseProgram(current_variant->program_id);
+		glUseProgram(variant->program_id);
 
-				//set as current
-				Shader_SetCurrent(shader, current_variant);
-			}
-		}
-		
+		//set as current
+		Shader_SetCurrent(shader, variant);
 	}
-	
 }
 
 int Shader_GetUniformLocation(RShader* const shader, int uniform)
@@ -10,9 +10,13 @@
 typedef struct
 {
 	uint64_t key;
+	uint64_t source_hash; //hash of the final sources and the driver, names the binary in the cache
 	int* uniforms_locations;
 
 	unsigned program_id;
+
+	bool pending; //linked asynchronously, finished when it's first used
+	bool save_binary;
 } ShaderVariant;
 
 typedef struct
@@ -29,6 +33,8 @@ typedef struct
 
 	uint64_t current_variant_key;
 	uint64_t new_variant_key;
+
+	uint64_t cache_id; //hash of the source paths, identifies the shader in the variant manifest
 	
 	int max_uniforms;
 	int max_defines;
@@ -47,6 +53,18 @@ typedef struct
 
 } RShader;
 
+typedef struct
+{
+	int binary_hits;
+	int binary_misses;
+	int warmed_up_variants;
+	int hitch_count;
+
+	double startup_time; //ms spent loading shaders and starting the warm up
+	double last_hitch_time; //ms spent compiling or finishing a variant when it was first used
+	double max_hitch_time;
+} ShaderStats;
+
 RShader Shader_PixelCreate(const char* vert_src, const char* frag_src, int max_defines, int max_uniforms, int max_texunits, const char** defines, const char** uniforms, const char** tex_units, bool* r_result);
 RShader Shader_ComputeCreate(const char* comp_src, int max_defines, int max_uniforms, int max_texunits, const char** defines, const char** uniforms, const char** tex_units, bool* r_result);
 
@@ -54,6 +72,8 @@ RShader Shader_PixelCreateStatic(const char* comp_src, int max_defines, int max_
 
 
 void Shader_Destruct(RShader* const shader);
+void Shader_CacheCleanup();
+ShaderStats Shader_GetStats();
 
 void Shader_Use(RShader* const shader);
 
@@ -43,7 +43,7 @@ static unsigned nrChannelToImageFormat(int p_nrChannel)
 static unsigned char* loadTextureDataFromFile(int* r_width, int* r_height, unsigned* r_imageFormat, const char* p_path, bool p_flipOnLoad)
 {
 	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(p_flipOnLoad);
+	stbi_set_flip_vertically_on_load_thread(p_flipOnLoad);
 
 	unsigned char* data = stbi_load(p_path, &width, &height, &nrChannels, 0);
 
@@ -72,7 +72,7 @@ static unsigned char* loadTextureDataFromFile(int* r_width, int* r_height, unsig
 static float* loadTextureDataFromFileFloat(int* r_width, int* r_height, unsigned* r_imageFormat, const char* p_path, bool p_flipOnLoad)
 {
 	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(p_flipOnLoad);
+	stbi_set_flip_vertically_on_load_thread(p_flipOnLoad);
 
 	float* data = stbi_loadf(p_path, &width, &height, &nrChannels, 0);
 
@@ -217,52 +217,122 @@ R_Texture Texture_LoadFromData(unsigned char* p_data, size_t p_bufLen, M_Rect2Di
 	return texture;
 }
 
-R_Texture Texture_Load(const char* p_texturePath, M_Rect2Di* p_textureRegion)
+bool Texture_DecodeFile(const char* p_texturePath, bool p_isFloat, R_TextureData* r_data)
+{
+	memset(r_data, 0, sizeof(R_TextureData));
+
+	r_data->is_float = p_isFloat;
+
+	if (p_isFloat)
+	{
+		r_data->pixels = loadTextureDataFromFileFloat(&r_data->width, &r_data->height, &r_data->image_format, p_texturePath, true);
+	}
+	else
+	{
+		r_data->pixels = loadTextureDataFromFile(&r_data->width, &r_data->height, &r_data->image_format, p_texturePath, true);
+	}
+
+	return r_data->pixels != NULL;
+}
+
+static R_Texture genCompressedTexture(R_TextureData* const p_data)
 {
 	R_Texture texture;
-	texture.id = 0;
+	memset(&texture, 0, sizeof(R_Texture));
 
-	int width, height;
-	unsigned image_format;
+	texture.format.imageFormat = p_data->compressed_format;
+	texture.format.wrapS = GL_REPEAT;
+	texture.format.wrapT = GL_REPEAT;
+	texture.format.filterMin = GL_NEAREST;
+	texture.format.filterMax = GL_NEAREST;
 
-	unsigned char* texture_data = loadTextureDataFromFile(&width, &height, &image_format, p_texturePath, true);
+	texture.width = p_data->width;
+	texture.height = p_data->height;
 
-	if (!texture_data)
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
+	glTextureStorage2D(texture.id, p_data->mip_count, p_data->compressed_format, texture.width, texture.height);
+
+	//the mips are already built, no need for glGenerateMipmap
+	for (int i = 0; i < p_data->mip_count; i++)
+	{
+		int mip_width = glm_imax(texture.width >> i, 1);
+		int mip_height = glm_imax(texture.height >> i, 1);
+
+		glCompressedTextureSubImage2D(texture.id, i, 0, 0, mip_width, mip_height, p_data->compressed_format, p_data->mip_sizes[i], 
+			(unsigned char*)p_data->pixels + p_data->mip_offsets[i]);
+	}
+
+	glTextureParameteri(texture.id, GL_TEXTURE_MAX_LEVEL, p_data->mip_count - 1);
+	glTextureParameteri(texture.id, GL_TEXTURE_WRAP_S, texture.format.wrapS);
+	glTextureParameteri(texture.id, GL_TEXTURE_WRAP_T, texture.format.wrapT);
+	glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, texture.format.filterMin);
+	glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, texture.format.filterMax);
+
+	return texture;
+}
+
+R_Texture Texture_Upload(R_TextureData* const p_data, M_Rect2Di* p_textureRegion)
+{
+	R_Texture texture;
+	texture.id = 0;
+
+	if (!p_data->pixels)
 	{
 		return texture;
 	}
+
+	if (p_data->is_compressed)
+	{
+		return genCompressedTexture(p_data);
+	}
+
+	return genTexture(p_data->pixels, p_data->width, p_data->height, p_data->image_format, p_textureRegion, p_data->is_float);
+}
+
+void Texture_FreeData(R_TextureData* p_data)
+{
+	if (p_data->pixels)
+	{
+		if (p_data->is_compressed)
+		{
+			free(p_data->pixels);
+		}
+		else
+		{
+			stbi_image_free(p_data->pixels);
+		}
+		p_data->pixels = NULL;
+	}
+}
+
+R_Texture Texture_Load(const char* p_texturePath, M_Rect2Di* p_textureRegion)
+{
+	R_TextureData data;
 	
-	texture = genTexture(texture_data, width, height, image_format, p_textureRegion, false);
+	Texture_DecodeFile(p_texturePath, false, &data);
 
-	stbi_image_free(texture_data);
+	R_Texture texture = Texture_Upload(&data, p_textureRegion);
+
+	Texture_FreeData(&data);
 
 	return texture;
 }
 
 void Texture_Destruct(R_Texture* p_texture)
 {
-	glDeleteTextures(1, p_texture->id);
-
+	glDeleteTextures(1, &p_texture->id);
+	p_texture->id = 0;
 }
 
 R_Texture HDRTexture_Load(const char* p_texturePath, M_Rect2Di* p_textureRegion)
 {
-	R_Texture texture;
-	texture.id = 0;
+	R_TextureData data;
 
-	int width, height;
-	unsigned image_format;
-
-	float* texture_data = loadTextureDataFromFileFloat(&width, &height, &image_format, p_texturePath, true);
-
-	if (!texture_data)
-	{
-		return texture;
-	}
+	Texture_DecodeFile(p_texturePath, true, &data);
 
-	texture = genTexture(texture_data, width, height, image_format, p_textureRegion, true);
+	R_Texture texture = Texture_Upload(&data, p_textureRegion);
 
-	stbi_image_free(texture_data);
+	Texture_FreeData(&data);
 
 	return texture;
 }
@@ -24,6 +24,29 @@ typedef struct R_Texture
 	int height;
 } R_Texture;
 
+#define TEXTURE_MAX_MIPS 16
+
+//Decoded pixels that haven't been uploaded yet. Decoding doesn't touch GL, so it can run on any thread
+typedef struct R_TextureData
+{
+	void* pixels;
+	int width;
+	int height;
+	unsigned image_format;
+	bool is_float;
+
+	//block compressed textures have every mip packed into pixels
+	bool is_compressed;
+	unsigned compressed_format;
+	int mip_count;
+	int mip_offsets[TEXTURE_MAX_MIPS];
+	int mip_sizes[TEXTURE_MAX_MIPS];
+} R_TextureData;
+
+bool Texture_DecodeFile(const char* p_texturePath, bool p_isFloat, R_TextureData* r_data);
+R_Texture Texture_Upload(R_TextureData* const p_data, M_Rect2Di* p_textureRegion);
+void Texture_FreeData(R_TextureData* p_data);
+
 R_Texture Texture_LoadFromData(unsigned char* p_data, size_t p_bufLen, M_Rect2Di* p_textureRegion);
 R_Texture Texture_Load(const char* p_texturePath, M_Rect2Di* p_textureRegion);
 void Texture_Destruct(R_Texture* p_texture);
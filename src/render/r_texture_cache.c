@@ -0,0 +1,574 @@
+#include "render/r_texture_cache.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <Windows.h>
+#include <glad/glad.h>
+
+#include <stb_image/stb_image.h>
+
+#include "utility/u_utility.h"
+
+#define TEXTURE_CACHE_DIRECTORY "texture_cache"
+#define TEXTURE_CACHE_MAGIC 0x4354434C
+#define TEXTURE_CACHE_VERSION 1
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t compression;
+	uint32_t mip_count;
+	uint64_t source_hash;
+	int32_t width;
+	int32_t height;
+	int32_t mip_sizes[TEXTURE_MAX_MIPS];
+} TextureCacheHeader;
+
+typedef struct
+{
+	uint64_t lo;
+	uint64_t hi;
+	int bit;
+} BlockWriter;
+
+static const unsigned COMPRESSION_GL_FORMATS[TEXTURE_COMPRESSION__MAX] = { GL_COMPRESSED_RGBA_BPTC_UNORM, GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RED_RGTC1 };
+static const int COMPRESSION_BLOCK_SIZES[TEXTURE_COMPRESSION__MAX] = { 16, 16, 8 };
+
+//interpolation weights for 4 bit bc7 indices
+static const int BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void BlockWriter_write(BlockWriter* const p_writer, uint64_t p_value, int p_bits)
+{
+	for (int i = 0; i < p_bits; i++)
+	{
+		uint64_t bit = (p_value >> i) & 1;
+
+		if (p_writer->bit < 64)
+		{
+			p_writer->lo |= bit << p_writer->bit;
+		}
+		else
+		{
+			p_writer->hi |= bit << (p_writer->bit - 64);
+		}
+		p_writer->bit++;
+	}
+}
+
+static void TextureCache_EncodeBC4Block(const unsigned char p_values[16], unsigned char r_block[8])
+{
+	int min_value = 255;
+	int max_value = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		min_value = min(min_value, p_values[i]);
+		max_value = max(max_value, p_values[i]);
+	}
+
+	r_block[0] = max_value;
+	r_block[1] = min_value;
+
+	uint64_t indices = 0;
+
+	//with red_0 > red_1 we get the two endpoints and 6 values in between
+	if (max_value > min_value)
+	{
+		int palette[8];
+		palette[0] = max_value;
+		palette[1] = min_value;
+
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * max_value + i * min_value) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best_index = 0;
+			int best_error = INT_MAX;
+
+			for (int j = 0; j < 8; j++)
+			{
+				int error = abs(palette[j] - p_values[i]);
+
+				if (error < best_error)
+				{
+					best_error = error;
+					best_index = j;
+				}
+			}
+
+			indices |= (uint64_t)best_index << (3 * i);
+		}
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		r_block[2 + i] = (indices >> (8 * i)) & 0xFF;
+	}
+}
+
+static void TextureCache_EncodeBC7Block(const unsigned char p_pixels[16][4], unsigned char r_block[16])
+{
+	//Mode 6 only. One subset, rgba endpoints with 7 bits and a p bit each and 4 bit indices.
+	//Good enough for the small block textures, and a lot simpler than searching every mode
+	int min_color[4] = { 255, 255, 255, 255 };
+	int max_color[4] = { 0, 0, 0, 0 };
+	float mean[4] = { 0, 0, 0, 0 };
+
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			min_color[c] = min(min_color[c], p_pixels[i][c]);
+			max_color[c] = max(max_color[c], p_pixels[i][c]);
+			mean[c] += p_pixels[i][c] / 16.0f;
+		}
+	}
+
+	//use the diagonal of the bounding box, flipped per channel so it follows the widest channel
+	int main_channel = 0;
+	for (int c = 1; c < 4; c++)
+	{
+		if (max_color[c] - min_color[c] > max_color[main_channel] - min_color[main_channel])
+		{
+			main_channel = c;
+		}
+	}
+
+	int endpoints[2][4];
+	for (int c = 0; c < 4; c++)
+	{
+		float covariance = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			covariance += (p_pixels[i][c] - mean[c]) * (p_pixels[i][main_channel] - mean[main_channel]);
+		}
+
+		endpoints[0][c] = (covariance < 0) ? max_color[c] : min_color[c];
+		endpoints[1][c] = (covariance < 0) ? min_color[c] : max_color[c];
+	}
+
+	//quantize to 7 bits, keep the p bit that loses less
+	int quantized[2][4];
+	int p_bits[2];
+	for (int e = 0; e < 2; e++)
+	{
+		int best_error = INT_MAX;
+
+		for (int p = 0; p < 2; p++)
+		{
+			int values[4];
+			int error = 0;
+
+			for (int c = 0; c < 4; c++)
+			{
+				values[c] = (endpoints[e][c] - p + 1) >> 1;
+				values[c] = max(min(values[c], 127), 0);
+
+				int diff = ((values[c] << 1) | p) - endpoints[e][c];
+				error += diff * diff;
+			}
+
+			if (error < best_error)
+			{
+				best_error = error;
+				memcpy(quantized[e], values, sizeof(values));
+				p_bits[e] = p;
+			}
+		}
+	}
+
+	int palette[16][4];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int e0 = (quantized[0][c] << 1) | p_bits[0];
+			int e1 = (quantized[1][c] << 1) | p_bits[1];
+
+			palette[i][c] = ((64 - BC7_WEIGHTS_4[i]) * e0 + BC7_WEIGHTS_4[i] * e1 + 32) >> 6;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		int best_error = INT_MAX;
+
+		for (int j = 0; j < 16; j++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				int diff = palette[j][c] - p_pixels[i][c];
+				error += diff * diff;
+			}
+
+			if (error < best_error)
+			{
+				best_error = error;
+				indices[i] = j;
+			}
+		}
+	}
+
+	//the anchor index is stored with 3 bits, so its top bit has to be 0. Swap the endpoints if it isn't
+	if (indices[0] & 8)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int temp = quantized[0][c];
+			quantized[0][c] = quantized[1][c];
+			quantized[1][c] = temp;
+		}
+		int temp = p_bits[0];
+		p_bits[0] = p_bits[1];
+		p_bits[1] = temp;
+
+		for (int i = 0; i < 16; i++)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	BlockWriter writer;
+	memset(&writer, 0, sizeof(writer));
+
+	//mode 6 is six 0 bits followed by a 1
+	BlockWriter_write(&writer, 1 << 6, 7);
+
+	for (int c = 0; c < 4; c++)
+	{
+		BlockWriter_write(&writer, quantized[0][c], 7);
+		BlockWriter_write(&writer, quantized[1][c], 7);
+	}
+	BlockWriter_write(&writer, p_bits[0], 1);
+	BlockWriter_write(&writer, p_bits[1], 1);
+
+	BlockWriter_write(&writer, indices[0], 3);
+	for (int i = 1; i < 16; i++)
+	{
+		BlockWriter_write(&writer, indices[i], 4);
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		r_block[i] = (writer.lo >> (8 * i)) & 0xFF;
+		r_block[8 + i] = (writer.hi >> (8 * i)) & 0xFF;
+	}
+}
+
+static int TextureCache_getLevelSize(int p_width, int p_height, TextureCompression p_compression)
+{
+	return ((p_width + 3) / 4) * ((p_height + 3) / 4) * COMPRESSION_BLOCK_SIZES[p_compression];
+}
+
+static void TextureCache_EncodeLevel(const unsigned char* p_rgba, int p_width, int p_height, TextureCompression p_compression, unsigned char* r_dest)
+{
+	for (int block_y = 0; block_y < p_height; block_y += 4)
+	{
+		for (int block_x = 0; block_x < p_width; block_x += 4)
+		{
+			//clamp to the edge for mips that aren't a multiple of 4
+			unsigned char pixels[16][4];
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int src_x = min(block_x + x, p_width - 1);
+					int src_y = min(block_y + y, p_height - 1);
+
+					memcpy(pixels[y * 4 + x], p_rgba + (src_y * p_width + src_x) * 4, 4);
+				}
+			}
+
+			switch (p_compression)
+			{
+			case TEXTURE_COMPRESSION__BC7:
+			{
+				TextureCache_EncodeBC7Block(pixels, r_dest);
+				break;
+			}
+			case TEXTURE_COMPRESSION__BC5:
+			{
+				unsigned char red[16];
+				unsigned char green[16];
+				for (int i = 0; i < 16; i++)
+				{
+					red[i] = pixels[i][0];
+					green[i] = pixels[i][1];
+				}
+				TextureCache_EncodeBC4Block(red, r_dest);
+				TextureCache_EncodeBC4Block(green, r_dest + 8);
+				break;
+			}
+			case TEXTURE_COMPRESSION__BC4:
+			{
+				unsigned char red[16];
+				for (int i = 0; i < 16; i++)
+				{
+					red[i] = pixels[i][0];
+				}
+				TextureCache_EncodeBC4Block(red, r_dest);
+				break;
+			}
+			default:
+				break;
+			}
+
+			r_dest += COMPRESSION_BLOCK_SIZES[p_compression];
+		}
+	}
+}
+
+static unsigned char* TextureCache_Downsample(const unsigned char* p_rgba, int p_width, int p_height, int* r_width, int* r_height)
+{
+	int width = max(p_width / 2, 1);
+	int height = max(p_height / 2, 1);
+
+	unsigned char* dest = malloc(width * height * 4);
+
+	if (!dest)
+	{
+		return NULL;
+	}
+
+	//2x2 box filter, same as glGenerateMipmap
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int x0 = min(x * 2, p_width - 1);
+			int x1 = min(x * 2 + 1, p_width - 1);
+			int y0 = min(y * 2, p_height - 1);
+			int y1 = min(y * 2 + 1, p_height - 1);
+
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = p_rgba[(y0 * p_width + x0) * 4 + c] + p_rgba[(y0 * p_width + x1) * 4 + c]
+					+ p_rgba[(y1 * p_width + x0) * 4 + c] + p_rgba[(y1 * p_width + x1) * 4 + c];
+
+				dest[(y * width + x) * 4 + c] = (sum + 2) / 4;
+			}
+		}
+	}
+
+	*r_width = width;
+	*r_height = height;
+
+	return dest;
+}
+
+static bool TextureCache_HashSource(const char* p_srcPath, uint64_t* r_hash)
+{
+	int length = 0;
+	unsigned char* data = File_Parse(p_srcPath, &length);
+
+	if (!data)
+	{
+		return false;
+	}
+
+	*r_hash = Hash_bytes64(data, length, HASH_BYTES64_SEED);
+
+	free(data);
+
+	return true;
+}
+
+static void TextureCache_getCachePath(const char* p_srcPath, TextureCompression p_compression, char* r_path, size_t p_pathSize)
+{
+	uint64_t hash = Hash_bytes64(p_srcPath, strlen(p_srcPath), HASH_BYTES64_SEED);
+	hash = Hash_bytes64(&p_compression, sizeof(p_compression), hash);
+
+	sprintf_s(r_path, p_pathSize, TEXTURE_CACHE_DIRECTORY "/%016llx.ltc", (unsigned long long)hash);
+}
+
+bool TextureCache_Build(const char* p_srcPath, TextureCompression p_compression, R_TextureData* r_data)
+{
+	memset(r_data, 0, sizeof(R_TextureData));
+
+	uint64_t source_hash = 0;
+	if (!TextureCache_HashSource(p_srcPath, &source_hash))
+	{
+		printf("Failed to open texture at path %s \n", p_srcPath);
+		return false;
+	}
+
+	//same orientation as Texture_Load
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load_thread(true);
+	unsigned char* rgba = stbi_load(p_srcPath, &width, &height, &channels, 4);
+
+	if (!rgba)
+	{
+		printf("Failed to load texture. Reason: %s \n", stbi_failure_reason());
+		return false;
+	}
+
+	TextureCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.compression = p_compression;
+	header.source_hash = source_hash;
+	header.width = width;
+	header.height = height;
+
+	//full mip chain down to 1x1
+	int total_size = 0;
+	for (int mip_width = width, mip_height = height; header.mip_count < TEXTURE_MAX_MIPS; header.mip_count++)
+	{
+		r_data->mip_offsets[header.mip_count] = total_size;
+		header.mip_sizes[header.mip_count] = TextureCache_getLevelSize(mip_width, mip_height, p_compression);
+		total_size += header.mip_sizes[header.mip_count];
+
+		if (mip_width == 1 && mip_height == 1)
+		{
+			header.mip_count++;
+			break;
+		}
+		mip_width = max(mip_width / 2, 1);
+		mip_height = max(mip_height / 2, 1);
+	}
+
+	unsigned char* blocks = malloc(total_size);
+
+	if (!blocks)
+	{
+		stbi_image_free(rgba);
+		return false;
+	}
+
+	unsigned char* level = rgba;
+	int level_width = width;
+	int level_height = height;
+
+	for (int i = 0; i < header.mip_count; i++)
+	{
+		TextureCache_EncodeLevel(level, level_width, level_height, p_compression, blocks + r_data->mip_offsets[i]);
+
+		if (i + 1 < header.mip_count)
+		{
+			unsigned char* next_level = TextureCache_Downsample(level, level_width, level_height, &level_width, &level_height);
+
+			if (level != rgba)
+			{
+				free(level);
+			}
+			level = next_level;
+
+			if (!level)
+			{
+				stbi_image_free(rgba);
+				free(blocks);
+				return false;
+			}
+		}
+	}
+
+	if (level != rgba)
+	{
+		free(level);
+	}
+	stbi_image_free(rgba);
+
+	//write the cache, failing here isn't fatal, we just encode again next time
+	char cache_path[256];
+	TextureCache_getCachePath(p_srcPath, p_compression, cache_path, sizeof(cache_path));
+
+	CreateDirectoryA(TEXTURE_CACHE_DIRECTORY, NULL);
+
+	FILE* file = NULL;
+	fopen_s(&file, cache_path, "wb");
+
+	if (file)
+	{
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(blocks, total_size, 1, file);
+		fclose(file);
+	}
+	else
+	{
+		printf("Failed to write texture cache for %s \n", p_srcPath);
+	}
+
+	r_data->pixels = blocks;
+	r_data->width = width;
+	r_data->height = height;
+	r_data->is_compressed = true;
+	r_data->compressed_format = COMPRESSION_GL_FORMATS[p_compression];
+	r_data->mip_count = header.mip_count;
+	memcpy(r_data->mip_sizes, header.mip_sizes, sizeof(header.mip_sizes));
+
+	return true;
+}
+
+bool TextureCache_Load(const char* p_srcPath, TextureCompression p_compression, R_TextureData* r_data)
+{
+	memset(r_data, 0, sizeof(R_TextureData));
+
+	uint64_t source_hash = 0;
+	if (!TextureCache_HashSource(p_srcPath, &source_hash))
+	{
+		printf("Failed to open texture at path %s \n", p_srcPath);
+		return false;
+	}
+
+	char cache_path[256];
+	TextureCache_getCachePath(p_srcPath, p_compression, cache_path, sizeof(cache_path));
+
+	FILE* file = NULL;
+	fopen_s(&file, cache_path, "rb");
+
+	if (!file)
+	{
+		return TextureCache_Build(p_srcPath, p_compression, r_data);
+	}
+
+	TextureCacheHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == TEXTURE_CACHE_MAGIC && header.version == TEXTURE_CACHE_VERSION
+		&& header.compression == p_compression && header.source_hash == source_hash && header.mip_count > 0 && header.mip_count <= TEXTURE_MAX_MIPS;
+
+	unsigned char* blocks = NULL;
+
+	if (valid)
+	{
+		int total_size = 0;
+		for (int i = 0; i < header.mip_count; i++)
+		{
+			r_data->mip_offsets[i] = total_size;
+			total_size += header.mip_sizes[i];
+		}
+
+		blocks = malloc(total_size);
+		valid = blocks && fread(blocks, total_size, 1, file) == 1;
+	}
+
+	fclose(file);
+
+	//stale or broken, encode it again
+	if (!valid)
+	{
+		if (blocks)
+		{
+			free(blocks);
+		}
+		return TextureCache_Build(p_srcPath, p_compression, r_data);
+	}
+
+	r_data->pixels = blocks;
+	r_data->width = header.width;
+	r_data->height = header.height;
+	r_data->is_compressed = true;
+	r_data->compressed_format = COMPRESSION_GL_FORMATS[p_compression];
+	r_data->mip_count = header.mip_count;
+	memcpy(r_data->mip_sizes, header.mip_sizes, sizeof(header.mip_sizes));
+
+	return true;
+}
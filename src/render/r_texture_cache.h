@@ -0,0 +1,26 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+#pragma once
+
+#include <stdbool.h>
+
+#include "render/r_texture.h"
+
+/*
+	Block compressed copies of the source textures, with prebuilt mip chains.
+	The encoders run on the cpu and never touch GL, so the cache can be built headless
+	or on the resource workers. The cache is rebuilt when the source file changes
+*/
+
+typedef enum
+{
+	TEXTURE_COMPRESSION__BC7, //rgba, 8 bits per pixel
+	TEXTURE_COMPRESSION__BC5, //rg, 8 bits per pixel
+	TEXTURE_COMPRESSION__BC4, //r, 4 bits per pixel
+	TEXTURE_COMPRESSION__MAX
+} TextureCompression;
+
+bool TextureCache_Load(const char* p_srcPath, TextureCompression p_compression, R_TextureData* r_data);
+bool TextureCache_Build(const char* p_srcPath, TextureCompression p_compression, R_TextureData* r_data);
+
+#endif // !TEXTURE_CACHE_H
@@ -346,6 +346,22 @@ static const char* BOX_BLUR_TEXTURES_STR[] =
     "source_texture", 
 };
 
+// HIZ_DOWNSAMPLE SHADER SECTION 
+typedef enum 
+{
+    HIZ_DOWNSAMPLE_UNIFORM_SOURCELEVEL,
+    HIZ_DOWNSAMPLE_UNIFORM_MAX
+}HIZ_DOWNSAMPLE_SHADER_UNIFORMS; 
+
+static const char* HIZ_DOWNSAMPLE_UNIFORMS_STR[] = 
+{
+    "u_sourceLevel", 
+};
+static const char* HIZ_DOWNSAMPLE_TEXTURES_STR[] = 
+{
+    "source_texture", 
+};
+
 // BLOOM SHADER SECTION 
 typedef enum 
 {
@@ -471,7 +487,6 @@ static const char* LC_WORLD_TEXTURES_STR[] =
     "brdfLUT", 
 };
 
-// LC_OCCLUSION_BOXES SHADER SECTION 
 // LC_WATER SHADER SECTION 
 static const char* LC_WATER_TEXTURES_STR[] = 
 {
@@ -487,13 +502,77 @@ static const char* LC_WATER_TEXTURES_STR[] =
 typedef enum 
 {
     PROCESS_CHUNKS_UNIFORM_TOTALCHUNKAMOUNT,
+    PROCESS_CHUNKS_UNIFORM_PHASE,
+    PROCESS_CHUNKS_UNIFORM_HIZLEVELS,
     PROCESS_CHUNKS_UNIFORM_MAX
 }PROCESS_CHUNKS_SHADER_UNIFORMS; 
 
 static const char* PROCESS_CHUNKS_UNIFORMS_STR[] = 
 {
     "u_totalChunkAmount", 
+    "u_phase", 
+    "u_hizLevels", 
+};
+static const char* PROCESS_CHUNKS_TEXTURES_STR[] = 
+{
+    "hiz_texture", 
+};
+
+// CULL_CHUNKS SHADER SECTION 
+typedef enum 
+{
+    CULL_CHUNKS_UNIFORM_CHUNKAMOUNT,
+    CULL_CHUNKS_UNIFORM_SHADOWSPLITMASK,
+    CULL_CHUNKS_UNIFORM_SHADOWBOXES,
+    CULL_CHUNKS_UNIFORM_CULLTRANSPARENT,
+    CULL_CHUNKS_UNIFORM_CULLREFLECTION,
+    CULL_CHUNKS_UNIFORM_REFLECTIONPLANES,
+    CULL_CHUNKS_UNIFORM_MAX
+}CULL_CHUNKS_SHADER_UNIFORMS; 
+
+static const char* CULL_CHUNKS_UNIFORMS_STR[] = 
+{
+    "u_chunkAmount", 
+    "u_shadowSplitMask", 
+    "u_shadowBoxes", 
+    "u_cullTransparent", 
+    "u_cullReflection", 
+    "u_reflectionPlanes", 
+};
+// LC_HORIZON SHADER SECTION 
+typedef enum 
+{
+    LC_HORIZON_DEFINE_GBUFFER_PASS,
+    LC_HORIZON_DEFINE_MAX
+}LC_HORIZON_SHADER_DEFINES; 
+
+typedef enum 
+{
+    LC_HORIZON_UNIFORM_ORIGIN,
+    LC_HORIZON_UNIFORM_CELLSIZE,
+    LC_HORIZON_UNIFORM_LEVEL,
+    LC_HORIZON_UNIFORM_HOLEBOX,
+    LC_HORIZON_UNIFORM_MAX
+}LC_HORIZON_SHADER_UNIFORMS; 
+
+static const char* LC_HORIZON_DEFINES_STR[] = 
+{
+    "GBUFFER_PASS", 
+};
+static const char* LC_HORIZON_UNIFORMS_STR[] = 
+{
+    "u_origin", 
+    "u_cellSize", 
+    "u_level", 
+    "u_holeBox", 
 };
+static const char* LC_HORIZON_TEXTURES_STR[] = 
+{
+    "height_map", 
+    "texture_atlas", 
+    "texture_atlas_mer", 
+};
+
 // CUBEMAP SHADER SECTION 
 typedef enum 
 {
@@ -547,5 +626,24 @@ static const char* CUBEMAP_TEXTURES_STR[] =
     "night_texture", 
 };
 
+// PARTICLES SHADER SECTION 
+typedef enum 
+{
+    PARTICLES_UNIFORM_PARTICLEAMOUNT,
+    PARTICLES_UNIFORM_PREVVIEWPROJECTION,
+    PARTICLES_UNIFORM_MAX
+}PARTICLES_SHADER_UNIFORMS; 
+
+static const char* PARTICLES_UNIFORMS_STR[] = 
+{
+    "u_particleAmount", 
+    "u_prevViewProjection", 
+};
+static const char* PARTICLES_TEXTURES_STR[] = 
+{
+    "depth_texture", 
+    "normal_texture", 
+};
+
 
 #endif
\ No newline at end of file
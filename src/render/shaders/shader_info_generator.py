@@ -248,14 +248,17 @@ def write_dir_gl_headers():
     write_gl_header(file, ["screen/brdf.frag"])
     write_gl_header(file, ["screen/godray.comp"])
     write_gl_header(file, ["screen/box_blur.comp"])
+    write_gl_header(file, ["screen/hiz_downsample.comp"])
     write_gl_header(file, ["screen/bloom.frag"])
     write_gl_header(file, ["screen/screen_shader.vert", "screen/screen_shader.frag"])
     write_gl_header(file, ["screen/debug_screen.frag"])
     write_gl_header(file, ["lc_world/lc_world.vert", "lc_world/lc_world.frag"])
-    write_gl_header(file, ["lc_world/lc_occlusion_boxes.vert", "lc_world/lc_occlusion_boxes.frag"])
     write_gl_header(file, ["lc_world/lc_water.vert", "lc_world/lc_water.frag"])
     write_gl_header(file, ["lc_world/process_chunks.comp"])
+    write_gl_header(file, ["lc_world/cull_chunks.comp"])
+    write_gl_header(file, ["lc_world/lc_horizon.vert", "lc_world/lc_horizon.frag"])
     write_gl_header(file, ["cubemap/cubemap.vert", "cubemap/cubemap.frag"])
+    write_gl_header(file, ["particles/particles.comp"])
 
     file.write("\n#endif")
 
@@ -15,6 +15,7 @@ Usage
 #include <stdbool.h>
 #include <assert.h>
 #include "dynamic_array.h"
+#include "u_slab.h"
 
 typedef uint32_t(*CHMap_HashFun)(const void* _key);
 typedef int(*CHMap_CompareFun)(const void* _key, const void* _other);
@@ -33,6 +34,8 @@ typedef struct
 	bool _is_key_string;
 	bool _is_item_pooled;
 	void* _next;
+
+	Slab_Allocator _item_slab; //hash items and fixed size keys are allocated together from here
 } CHMap;
 
 #ifdef __cplusplus
@@ -75,6 +78,8 @@ typedef struct
 } _CHMap_item;
 
 #define CHM_HASHTABLE_BLOCK_ALLOCATION_SIZE 256
+#define CHM_ITEM_SLAB_MAX_ITEMS_PER_PAGE 256
+#define CHM_ITEM_HEADER_SIZE ((sizeof(_CHMap_item) + (SLAB_ALIGNMENT - 1)) & ~(size_t)(SLAB_ALIGNMENT - 1))
 static CHMap _CHMap_Init(CHMap_HashFun p_hashFun, CHMap_CompareFun p_cmpFun,size_t p_keyBitSize, size_t p_allocSize, size_t p_initReserveSize, bool p_useItemPooling)
 {
 	assert(p_allocSize > 0);
@@ -97,6 +102,9 @@ static CHMap _CHMap_Init(CHMap_HashFun p_hashFun, CHMap_CompareFun p_cmpFun,size
 		map._is_key_string = true;
 	}
 
+	//string keys have different lengths, so they are still allocated on their own
+	Slab_Init(&map._item_slab, CHM_ITEM_HEADER_SIZE + p_keyBitSize, CHM_ITEM_SLAB_MAX_ITEMS_PER_PAGE, NULL);
+
 	if (p_useItemPooling)
 	{
 		map._item_free_list = dA_INIT(unsigned, 0);
@@ -385,7 +393,7 @@ void* CHMap_Insert(CHMap* const chmap, const void* p_key, const void* p_data)
 	}
 	_CHMap_item* item = NULL;
 
-	item = malloc(sizeof(_CHMap_item));
+	item = Slab_Alloc(&chmap->_item_slab);
 
 	if (!item)
 	{
@@ -399,12 +407,12 @@ void* CHMap_Insert(CHMap* const chmap, const void* p_key, const void* p_data)
 	}
 	else
 	{
-		item->key = malloc(chmap->key_bit_size);
+		item->key = (char*)item + CHM_ITEM_HEADER_SIZE;
 	}
 
 	if (!item->key)
 	{
-		free(item);
+		Slab_Free(&chmap->_item_slab, item);
 		return NULL;
 	}
 	//copy the key data
@@ -515,12 +523,12 @@ void CHMap_Erase(CHMap* const chmap, const void* p_key)
 			//erase the item data
 			_CHMap_eraseItem(chmap, item->data_array_index);
 
-			if (item->key)
+			if (chmap->_is_key_string && item->key)
 			{
 				free(item->key);
 			}
 
-			free(item);
+			Slab_Free(&chmap->_item_slab, item);
 
 			item_found = true;
 			break;
@@ -582,16 +590,18 @@ void CHMap_Destruct(CHMap* chmap)
 	{
 		_CHMap_item* next = item->next;
 
-		if (item->key)
+		if (chmap->_is_key_string && item->key)
 		{
 			free(item->key);
 		}
 
-		free(item);
+		Slab_Free(&chmap->_item_slab, item);
 
 		item = next;
 	}
 
+	Slab_Destruct(&chmap->_item_slab);
+
 	dA_Destruct(chmap->hash_table);
 	dA_Destruct(chmap->item_data);
 
@@ -19,6 +19,20 @@ typedef struct dynamic_array
     void* data; //The raw array data
 } dynamic_array;
 
+/*
+    Allocation statistics of all dynamic arrays.
+    Updated atomically
+*/
+typedef struct dA_AllocStats
+{
+    long long alloc_count; // Total number of malloc, calloc and realloc calls
+    long long allocated_bytes; // Bytes currently allocated
+    long long peak_allocated_bytes; // Highest allocated_bytes so far
+} dA_AllocStats;
+
+//Capacity of the first allocation when growing from an empty array
+#define DYNAMIC_ARRAY_MIN_GROW_CAPACITY 8
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -60,6 +74,8 @@ extern "C" {
     extern size_t dA_capacity(const dynamic_array* p_dA);
     extern bool dA_isEmpty(const dynamic_array* p_dA);
     extern void dA_Destruct(dynamic_array* p_dA);
+    extern dA_AllocStats dA_getAllocStats();
+    extern void _dA_trackAlloc(long long p_byteDelta, bool p_countCall);
 #ifdef __cplusplus
 }
 #endif
@@ -77,6 +93,8 @@ static dynamic_array* _dA_Init(size_t p_allocSize, size_t p_initReserveSize)
     if (dA_ptr == NULL)
         return NULL;
 
+    _dA_trackAlloc(sizeof(dynamic_array), true);
+
     dA_ptr->data = NULL;
 
     //alloc the raw data
@@ -89,8 +107,10 @@ static dynamic_array* _dA_Init(size_t p_allocSize, size_t p_initReserveSize)
         {
             //clean up
             free(dA_ptr);
+            _dA_trackAlloc(-(long long)sizeof(dynamic_array), false);
             return NULL;
         }
+        _dA_trackAlloc(p_initReserveSize * p_allocSize, true);
     }
 
     //SUCCESS
@@ -116,6 +136,43 @@ This is for preventing greying out of the implementation section.
 
 #define __dA_ZERO_MEMORY(DEST, SIZEOFDATA) memset(DEST, 0, SIZEOFDATA)
 
+#include <Windows.h>
+
+static dA_AllocStats __dA_alloc_stats;
+
+/**
+_Internal: DO NOT USE!
+*/
+void _dA_trackAlloc(long long p_byteDelta, bool p_countCall)
+{
+    if (p_countCall)
+    {
+        InterlockedIncrement64(&__dA_alloc_stats.alloc_count);
+    }
+
+    LONG64 allocated_bytes = InterlockedExchangeAdd64(&__dA_alloc_stats.allocated_bytes, p_byteDelta) + p_byteDelta;
+    LONG64 peak = __dA_alloc_stats.peak_allocated_bytes;
+
+    while (allocated_bytes > peak)
+    {
+        LONG64 prev = InterlockedCompareExchange64(&__dA_alloc_stats.peak_allocated_bytes, allocated_bytes, peak);
+
+        if (prev == peak)
+        {
+            break;
+        }
+        peak = prev;
+    }
+}
+
+/**
+Returns the allocation statistics of all dynamic arrays
+*/
+dA_AllocStats dA_getAllocStats()
+{
+    return __dA_alloc_stats;
+}
+
 
 /**
 _Internal: DO NOT USE!
@@ -141,20 +198,26 @@ bool _dA_safeRealloc(dynamic_array* p_dA, size_t p_size)
         if (data)
         {
             p_dA->data = data;
+            _dA_trackAlloc(p_size, true);
         }
         return true;
     }
 
+    //the callers update the capacity after the realloc
+    const long long prev_size = p_dA->capacity * p_dA->alloc_size;
+
     p_dA->data = realloc(prev, p_size);
 
     //successfull realloc
     if (p_dA->data)
     {
+        _dA_trackAlloc((long long)p_size - prev_size, true);
         return true;
     }
 
     //Free the previous data if we failed to realloc
     free(prev);
+    _dA_trackAlloc(-prev_size, false);
 
     return false;
 }
@@ -164,21 +227,32 @@ _Internal: DO NOT USE!
 */
 bool _dA_handleAlloc(dynamic_array* p_dA, size_t p_size)
 {
-    const size_t next_element_alloc_size = p_dA->alloc_size * (p_dA->elements_size + p_size);
-    const size_t capacity_byte_size = p_dA->capacity * p_dA->alloc_size;
+    const size_t next_elements_size = p_dA->elements_size + p_size;
 
     //realloc if our capacity is lower than the new element size
-    if (next_element_alloc_size > capacity_byte_size)
+    if (next_elements_size > p_dA->capacity)
     {
-        if (_dA_safeRealloc(p_dA, next_element_alloc_size))
+        //grow geometrically, so that emplacing one by one doesn't realloc every time
+        size_t new_capacity = p_dA->capacity + (p_dA->capacity / 2);
+
+        if (new_capacity < DYNAMIC_ARRAY_MIN_GROW_CAPACITY)
+        {
+            new_capacity = DYNAMIC_ARRAY_MIN_GROW_CAPACITY;
+        }
+        if (new_capacity < next_elements_size)
+        {
+            new_capacity = next_elements_size;
+        }
+
+        if (_dA_safeRealloc(p_dA, new_capacity * p_dA->alloc_size))
         {
             //get the pointer to the last element after address
             void* last_element_after_address = (char*)p_dA->data + (p_dA->elements_size * p_dA->alloc_size);
             //init the items
             __dA_ZERO_MEMORY(last_element_after_address, p_dA->alloc_size * p_size);
 
-            p_dA->elements_size += p_size;
-            p_dA->capacity = p_dA->elements_size;
+            p_dA->elements_size = next_elements_size;
+            p_dA->capacity = new_capacity;
             return true;
         }
     }
@@ -635,8 +709,10 @@ void dA_Destruct(dynamic_array* p_dA)
     if (p_dA->data)
     {
         free(p_dA->data);
+        _dA_trackAlloc(-(long long)(p_dA->capacity * p_dA->alloc_size), false);
     }
     free(p_dA);
+    _dA_trackAlloc(-(long long)sizeof(dynamic_array), false);
 
     p_dA = NULL;
 }
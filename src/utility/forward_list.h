@@ -2,8 +2,11 @@
 #define FORWARD_LIST_H
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#include "utility/u_slab.h"
+
 typedef struct FL_Node
 {
     void* value; // The value stored;
@@ -16,20 +19,24 @@ typedef struct FL_Head
     size_t node_size; // The amount of nodes currently stored in the list;
     FL_Node* next; // First node in the list;
 
+    Slab_Allocator node_slab; // Nodes and their values are allocated together from here;
 } FL_Head;
 
+#define FL_SLAB_MAX_ITEMS_PER_PAGE 1024
+#define FL_NODE_HEADER_SIZE ((sizeof(FL_Node) + (SLAB_ALIGNMENT - 1)) & ~(size_t)(SLAB_ALIGNMENT - 1))
+
 /**
  * Init the forward list
 \param T The type of item that will be stored
 
 \return Pointer to the FL_Forward_Head
 */
-#define FL_INIT(T) _FL_Init(sizeof(T))
+#define FL_INIT(T) _FL_Init(sizeof(T), "FL " #T)
 
 /*
 Internal! DO NOT USE!
 */
-static FL_Head* _FL_Init(size_t p_allocSize)
+static inline FL_Head* _FL_Init(size_t p_allocSize, const char* p_name)
 {
     assert(p_allocSize > 0 && "Invalid item. Can't Allocate");
     
@@ -43,35 +50,38 @@ static FL_Head* _FL_Init(size_t p_allocSize)
     head_ptr->alloc_size = p_allocSize;
     head_ptr->node_size = 0;
     head_ptr->next = NULL;
+    Slab_Init(&head_ptr->node_slab, FL_NODE_HEADER_SIZE + p_allocSize, FL_SLAB_MAX_ITEMS_PER_PAGE, p_name);
     
     return head_ptr;
 }
 /*
 Internal! DO NOT USE!
 */
-static FL_Node* _FL_AllocSingleNode(FL_Head* p_head)
+static inline FL_Node* _FL_AllocSingleNode(FL_Head* p_head)
 {
     assert(p_head->alloc_size > 0 && "Alloc size not set");
 
-    FL_Node* new_node = malloc(sizeof(FL_Node));
+    FL_Node* new_node = Slab_Alloc(&p_head->node_slab);
 
     //Failed to Alloc
     if (new_node == NULL)
         return NULL;
 
-    new_node->value = calloc(1, p_head->alloc_size);
-
-    //Failed to alloc value
-    if (new_node->value == NULL)
-    {
-        free(new_node);
-        return NULL;
-    }
+    //the value lives right after the node
+    new_node->value = (char*)new_node + FL_NODE_HEADER_SIZE;
+    memset(new_node->value, 0, p_head->alloc_size);
 
     new_node->next = NULL;
 
     return new_node;
 }
+/*
+Internal! DO NOT USE!
+*/
+static inline void _FL_FreeNode(FL_Head* p_head, FL_Node* p_node)
+{
+    Slab_Free(&p_head->node_slab, p_node);
+}
 
 /**
  * Place a node in the back of the list
@@ -79,7 +89,7 @@ static FL_Node* _FL_AllocSingleNode(FL_Head* p_head)
 
 \return The emplaced node
 */
-inline FL_Node* FL_emplaceBack(FL_Head* p_head)
+static inline FL_Node* FL_emplaceBack(FL_Head* p_head)
 {
     //Add to head if its the first element
     if(p_head->next == NULL)
@@ -121,7 +131,7 @@ inline FL_Node* FL_emplaceBack(FL_Head* p_head)
 
 \return The emplaced node
 */
-inline FL_Node* FL_emplaceFront(FL_Head* p_head)
+static inline FL_Node* FL_emplaceFront(FL_Head* p_head)
 {
     assert(p_head->alloc_size > 0 && "Alloc size not set");
 
@@ -161,7 +171,7 @@ inline FL_Node* FL_emplaceFront(FL_Head* p_head)
 
 \return The inserted node
 */
-inline FL_Node* FL_insertAfterNode(FL_Head* p_head, FL_Node* p_node)
+static inline FL_Node* FL_insertAfterNode(FL_Head* p_head, FL_Node* p_node)
 {
     FL_Node* new_node = _FL_AllocSingleNode(p_head);
     
@@ -181,7 +191,7 @@ inline FL_Node* FL_insertAfterNode(FL_Head* p_head, FL_Node* p_node)
 \param p_head Pointer to the List head
 \param p_node The node to erase after
 */
-inline void FL_eraseAfterNode(FL_Head* p_head, FL_Node* p_node)
+static inline void FL_eraseAfterNode(FL_Head* p_head, FL_Node* p_node)
 {
     assert(p_node->next != NULL && "No node after p_node to erase");
 
@@ -189,8 +199,7 @@ inline void FL_eraseAfterNode(FL_Head* p_head, FL_Node* p_node)
 
     p_node->next = erase_target->next;
 
-    free(erase_target->value);
-    free(erase_target);
+    _FL_FreeNode(p_head, erase_target);
 
     p_head->node_size--;
 };
@@ -203,7 +212,7 @@ inline void FL_eraseAfterNode(FL_Head* p_head, FL_Node* p_node)
 
 \return Pointer to the first node inserted
 */
-inline FL_Node* FL_insertAfterIndex(FL_Head* p_head, size_t p_index, size_t p_amount)
+static inline FL_Node* FL_insertAfterIndex(FL_Head* p_head, size_t p_index, size_t p_amount)
 {
     assert(p_index < p_head->node_size && "Index out of bounds");
     assert(p_amount > 0 && "Amount must be higher than zero");
@@ -236,7 +245,7 @@ inline FL_Node* FL_insertAfterIndex(FL_Head* p_head, size_t p_index, size_t p_am
 \param p_index The index to erase after
 \param p_amount The amount to erase
 */
-inline void FL_eraseAfterIndex(FL_Head* p_head, size_t p_index, size_t p_amount)
+static inline void FL_eraseAfterIndex(FL_Head* p_head, size_t p_index, size_t p_amount)
 {
     assert(p_index < p_head->node_size && "Index out of bounds");
     assert(p_amount <= (p_head->node_size - p_index) && "Trying to erase more nodes than possible");
@@ -260,7 +269,7 @@ inline void FL_eraseAfterIndex(FL_Head* p_head, size_t p_index, size_t p_amount)
  * Remove the first node from the list
 \param p_head Pointer to the List head
 */
-inline void FL_popFront(FL_Head* p_head)
+static inline void FL_popFront(FL_Head* p_head)
 {
     assert(p_head->node_size > 0 && "No nodes to delete");
 
@@ -269,8 +278,7 @@ inline void FL_popFront(FL_Head* p_head)
     p_head->next = pop_target->next;
 
     //free the first and its value
-    free(pop_target->value);
-    free(pop_target);
+    _FL_FreeNode(p_head, pop_target);
 
     p_head->node_size--;
 }
@@ -278,7 +286,7 @@ inline void FL_popFront(FL_Head* p_head)
  * Remove the last node from the list
 \param p_head Pointer to the List head
 */
-inline void FL_popLast(FL_Head* p_head)
+static inline void FL_popLast(FL_Head* p_head)
 {
     assert(p_head->node_size > 0 && "No nodes to delete");
 
@@ -292,8 +300,7 @@ inline void FL_popLast(FL_Head* p_head)
     }
 
     //free the last node and its value
-    free(last_node->value);
-    free(last_node);
+    _FL_FreeNode(p_head, last_node);
 
     //set the previous node's next to null
     if(prev_node != NULL)
@@ -309,7 +316,7 @@ inline void FL_popLast(FL_Head* p_head)
 \param p_head Pointer to the List head
 \param p_targetNode The node to remove
 */
-inline void FL_remove(FL_Head* p_head, FL_Node* p_targetNode)
+static inline void FL_remove(FL_Head* p_head, FL_Node* p_targetNode)
 {
     assert(p_head->alloc_size > 0 && "Alloc size must be higher than 0");
 
@@ -350,8 +357,7 @@ inline void FL_remove(FL_Head* p_head, FL_Node* p_targetNode)
     
     
     //free the value and the node
-    free(find_node->value);
-    free(find_node);
+    _FL_FreeNode(p_head, find_node);
 
     p_head->node_size--;
 
@@ -363,7 +369,7 @@ inline void FL_remove(FL_Head* p_head, FL_Node* p_targetNode)
 \param p_head Pointer to the List head
 \param p_index Index of the node to remove
 */
-inline void FL_removeAtIndex(FL_Head* p_head, size_t p_index)
+static inline void FL_removeAtIndex(FL_Head* p_head, size_t p_index)
 {
     assert(p_head->alloc_size > 0 && "Alloc size must be higher than 0");
     assert(p_index < p_head->node_size && "Index out of bounds");
@@ -396,8 +402,7 @@ inline void FL_removeAtIndex(FL_Head* p_head, size_t p_index)
     }
     
     //free the value and the node
-    free(find_node->value);
-    free(find_node);
+    _FL_FreeNode(p_head, find_node);
 
     p_head->node_size--;
 }
@@ -408,7 +413,7 @@ inline void FL_removeAtIndex(FL_Head* p_head, size_t p_index)
 \param p_index Index of the node to find
 \return Pointer to the node
 */
-inline FL_Node* FL_at(FL_Head* p_head, size_t p_index)
+static inline FL_Node* FL_at(FL_Head* p_head, size_t p_index)
 {
     assert(p_head->alloc_size > 0 && "Alloc size must be higher than 0");
     assert(p_index < p_head->node_size && "Index out of bounds");
@@ -434,47 +439,33 @@ inline FL_Node* FL_at(FL_Head* p_head, size_t p_index)
  * Removes all nodes from the list
 \param p_head Pointer to the List head
 */
-inline void FL_clear(FL_Head* p_head)
+static inline void FL_clear(FL_Head* p_head)
 {
-    FL_Node* prev_node = NULL;
-    FL_Node* last_node = p_head->next;
-    //Delete starting from the last node
-    while(last_node != NULL)
+    FL_Node* node = p_head->next;
+
+    while(node != NULL)
     {
-        //Find the last node and the prev node before it
-        while (last_node->next != NULL)
-        {
-            prev_node = last_node;
-            last_node = last_node->next;
-        }
+        FL_Node* next = node->next;
 
-        //free the last node and its value
-        free(last_node->value);
-        free(last_node);
+        _FL_FreeNode(p_head, node);
 
-        //set the previous node's next to null
-        if(prev_node != NULL)
-            prev_node->next = NULL;
-        //otherwise the last node must belong to the head
-        else
-            p_head->next = NULL;
-        
-        p_head->node_size--;
-
-        //reset for the next loop
-        prev_node = NULL;
-        last_node = p_head->next;
+        node = next;
     }
+
+    p_head->next = NULL;
+    p_head->node_size = 0;
 }
 
 /**
  * Destroys all nodes from the list and frees the head's memory
 \param p_head Pointer to the List head
 */
-inline void FL_Destruct(FL_Head* p_head)
+static inline void FL_Destruct(FL_Head* p_head)
 {
     FL_clear(p_head);
 
+    Slab_Destruct(&p_head->node_slab);
+
     free(p_head);
 
     p_head = NULL;
@@ -0,0 +1,61 @@
+#include "utility/u_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+bool Arena_Init(Arena* const p_arena, size_t p_size)
+{
+	assert(p_size > 0 && "Invalid arena size \n");
+
+	memset(p_arena, 0, sizeof(Arena));
+
+	p_arena->data = malloc(p_size);
+
+	if (!p_arena->data)
+	{
+		return false;
+	}
+
+	p_arena->size = p_size;
+
+	return true;
+}
+
+void* Arena_Alloc(Arena* const p_arena, size_t p_size)
+{
+	//keep every allocation aligned, so any type can be stored
+	size_t offset = (p_arena->used + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+	if (p_size == 0 || offset + p_size > p_arena->size)
+	{
+		if (p_size > 0)
+		{
+			p_arena->overflow_count++;
+		}
+		return NULL;
+	}
+
+	p_arena->used = offset + p_size;
+
+	if (p_arena->used > p_arena->peak_used)
+	{
+		p_arena->peak_used = p_arena->used;
+	}
+
+	return p_arena->data + offset;
+}
+
+void Arena_Reset(Arena* const p_arena)
+{
+	p_arena->used = 0;
+}
+
+void Arena_Destruct(Arena* const p_arena)
+{
+	if (p_arena->data)
+	{
+		free(p_arena->data);
+	}
+	memset(p_arena, 0, sizeof(Arena));
+}
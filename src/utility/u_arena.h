@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+	Linear allocator. Allocations are only freed all at once with Arena_Reset.
+	Meant for transient data that lives for a single frame
+*/
+typedef struct Arena
+{
+	unsigned char* data;
+	size_t size;
+	size_t used;
+
+	size_t peak_used;
+	unsigned overflow_count; //allocations that didn't fit
+} Arena;
+
+#define ARENA_ALIGNMENT 16
+
+#define Arena_ALLOC(ARENA, T, COUNT) (T*)Arena_Alloc(ARENA, sizeof(T) * (COUNT))
+
+bool Arena_Init(Arena* const p_arena, size_t p_size);
+void* Arena_Alloc(Arena* const p_arena, size_t p_size);
+void Arena_Reset(Arena* const p_arena);
+void Arena_Destruct(Arena* const p_arena);
+
+#endif // !ARENA_H
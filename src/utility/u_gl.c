@@ -412,6 +412,28 @@ static void DRB_Assert(DynamicRenderBuffer* const drb)
 	assert(drb->buffer > 0 && "GL buffer not set");
 }
 
+//grow the modified range to cover [offset, offset + size), so the range is always a single extent
+static void DRB_MarkModified(DynamicRenderBuffer* const drb, size_t p_offset, size_t p_size)
+{
+	if (p_size == 0)
+	{
+		return;
+	}
+
+	if (drb->_modified_size == 0)
+	{
+		drb->_modified_offset = p_offset;
+		drb->_modified_size = p_size;
+		return;
+	}
+
+	size_t start = min(drb->_modified_offset, p_offset);
+	size_t end = max(drb->_modified_offset + drb->_modified_size, p_offset + p_size);
+
+	drb->_modified_offset = start;
+	drb->_modified_size = end - start;
+}
+
 DynamicRenderBuffer DRB_Create(size_t p_initReserveSize, size_t p_initItemCount, unsigned p_drbFlags)
 {	
 	assert(p_initReserveSize > 0 && "Reserve size must be bigger than 0");	
@@ -456,6 +478,10 @@ DynamicRenderBuffer DRB_Create(size_t p_initReserveSize, size_t p_initItemCount,
 	{
 		drb._free_list = dA_INIT(unsigned, 0);
 	}
+	if (p_drbFlags & DRB_FLAG__TRACK_MOVED_ITEMS)
+	{
+		drb.moved_items = dA_INIT(unsigned, 0);
+	}
 
 	drb._modified_offset = SIZE_MAX;
 
@@ -484,6 +510,10 @@ void DRB_Destruct(DynamicRenderBuffer* const drb)
 	{
 		dA_Destruct(drb->item_list);
 	}
+	if (drb->moved_items)
+	{
+		dA_Destruct(drb->moved_items);
+	}
 }
 
 unsigned DRB_EmplaceItem(DynamicRenderBuffer* const drb, size_t p_len, const void* p_data)
@@ -631,11 +661,7 @@ void DRB_ChangeData(DynamicRenderBuffer* const drb, size_t p_len, const void* p_
 				{
 					memcpy((char*)drb->_back_buffer + drb_item->offset, null_data, drb_item->count);
 
-					if (drb_item->offset < drb->_modified_offset)
-					{
-						drb->_modified_offset = drb_item->offset;
-					}
-					drb->_modified_size += drb_item->count;
+					DRB_MarkModified(drb, drb_item->offset, drb_item->count);
 				}
 				else
 				{
@@ -670,12 +696,7 @@ void DRB_ChangeData(DynamicRenderBuffer* const drb, size_t p_len, const void* p_
 				void* write_offset = (char*)drb->_back_buffer + (drb_item->offset + p_len);
 				memmove(write_offset, read_offset, size_to_move);
 
-				drb->_modified_size += size_to_move;
-
-				if (drb_item->offset < drb->_modified_offset)
-				{
-					drb->_modified_offset = drb_item->offset;
-				}
+				DRB_MarkModified(drb, drb_item->offset + p_len, size_to_move);
 			}
 			else
 			{
@@ -725,6 +746,12 @@ void DRB_ChangeData(DynamicRenderBuffer* const drb, size_t p_len, const void* p_
 				if (item->offset > drb_item->offset)
 				{
 					item->offset += to_offset;
+
+					if (drb->moved_items)
+					{
+						unsigned moved_index = i;
+						dA_emplaceBackData(drb->moved_items, &moved_index);
+					}
 				}
 			}
 		}
@@ -740,11 +767,7 @@ void DRB_ChangeData(DynamicRenderBuffer* const drb, size_t p_len, const void* p_
 		{
 			memcpy((char*)drb->_back_buffer + drb_item->offset, p_data, p_len);
 
-			if (drb_item->offset < drb->_modified_offset)
-			{
-				drb->_modified_offset = drb_item->offset;
-			}
-			drb->_modified_size += p_len;
+			DRB_MarkModified(drb, drb_item->offset, p_len);
 		}
 		//if we are mapped and the map matches, upload the data
 		else if (drb->_data_map && drb->_map_offset <= drb_item->offset && drb->_map_size >= p_len + (drb_item->offset - drb->_map_offset)
@@ -880,6 +903,21 @@ DRB_Item DRB_GetItem(DynamicRenderBuffer* const drb, unsigned p_drbItemIndex)
 	return *drb_item;
 }
 
+const void* DRB_GetItemData(DynamicRenderBuffer* const drb, unsigned p_drbItemIndex)
+{
+	DRB_Assert(drb);
+
+	//the gpu copy is never read back
+	if (!(drb->drb_flags & DRB_FLAG__USE_CPU_BACK_BUFFER) || !drb->_back_buffer)
+	{
+		return NULL;
+	}
+
+	DRB_Item item = DRB_GetItem(drb, p_drbItemIndex);
+
+	return (const char*)drb->_back_buffer + item.offset;
+}
+
 void DRB_Unmap(DynamicRenderBuffer* const drb)
 {
 	DRB_Assert(drb);
@@ -912,10 +950,217 @@ void DRB_WriteDataToGpu(DynamicRenderBuffer* const drb)
 	drb->_modified_offset = SIZE_MAX;
 }
 
+void DRB_WriteDataToGpuStaged(DynamicRenderBuffer* const drb, StagingRing* const ring)
+{
+	DRB_Assert(drb);
+	//not modified? do nothing
+	if (drb->_modified_size == 0)
+	{
+		return;
+	}
+
+	StagingRing_Upload(ring, drb->buffer, drb->_modified_offset, drb->_modified_size, (char*)drb->_back_buffer + drb->_modified_offset);
+
+	drb->_modified_size = 0;
+	drb->_modified_offset = SIZE_MAX;
+}
+
 void DRB_setResizeChunkSize(DynamicRenderBuffer* const drb, size_t p_chunkSize)
 {
 	drb->_resize_chunk_size = p_chunkSize;
 }
 
+void DRB_ClearMovedItems(DynamicRenderBuffer* const drb)
+{
+	if (drb->moved_items)
+	{
+		dA_clear(drb->moved_items);
+	}
+}
+
+
+
+
+/*
+~~~~~~~~~~~~~~~~~~
+STAGING RING
+~~~~~~~~~~~~~~~~~~
+*/
+#define STAGING_RING_ALIGNMENT 16
+
+static void StagingRing_RetireFences(StagingRing* const ring, bool p_wait)
+{
+	while (ring->fence_count > 0)
+	{
+		StagingRing_Fence* fence = &ring->fences[ring->fence_start];
+
+		GLenum result = glClientWaitSync(fence->sync, (p_wait) ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, (p_wait) ? UINT64_MAX : 0);
+
+		if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+		{
+			return;
+		}
+		glDeleteSync(fence->sync);
+
+		ring->used -= fence->bytes;
+		ring->fence_start = (ring->fence_start + 1) % STAGING_RING_MAX_FENCES;
+		ring->fence_count--;
+
+		//only wait for the oldest one
+		p_wait = false;
+	}
+}
+
+StagingRing StagingRing_Create(size_t p_size)
+{
+	StagingRing ring;
+	memset(&ring, 0, sizeof(StagingRing));
+
+	ring.size = (p_size + (STAGING_RING_ALIGNMENT - 1)) & ~(size_t)(STAGING_RING_ALIGNMENT - 1);
+
+	unsigned flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glCreateBuffers(1, &ring.buffer);
+	glNamedBufferStorage(ring.buffer, ring.size, NULL, flags);
+	ring.map = glMapNamedBufferRange(ring.buffer, 0, ring.size, flags);
+
+	assert(ring.map && "Failed to map staging ring");
+
+	return ring;
+}
+
+void StagingRing_Destruct(StagingRing* const ring)
+{
+	for (int i = 0; i < ring->fence_count; i++)
+	{
+		glDeleteSync(ring->fences[(ring->fence_start + i) % STAGING_RING_MAX_FENCES].sync);
+	}
+	if (ring->buffer > 0)
+	{
+		glUnmapNamedBuffer(ring->buffer);
+		glDeleteBuffers(1, &ring->buffer);
+	}
+
+	memset(ring, 0, sizeof(StagingRing));
+}
+
+void* StagingRing_Alloc(StagingRing* const ring, size_t p_size, size_t* r_offset)
+{
+	if (!ring->map || p_size == 0)
+	{
+		return NULL;
+	}
+
+	size_t size = (p_size + (STAGING_RING_ALIGNMENT - 1)) & ~(size_t)(STAGING_RING_ALIGNMENT - 1);
+
+	//bigger than a frame can ever use, the caller has to upload directly
+	if (size > ring->size / 2)
+	{
+		return NULL;
+	}
+
+	//the tail end is wasted when wrapping around, so account for it like a normal allocation
+	size_t skip = (ring->head + size > ring->size) ? ring->size - ring->head : 0;
+
+	if (ring->used + skip + size > ring->size)
+	{
+		StagingRing_RetireFences(ring, false);
+
+		//the gpu is still reading everything we could write into, wait for the oldest frame
+		while (ring->used + skip + size > ring->size && ring->fence_count > 0)
+		{
+			int prev_count = ring->fence_count;
+
+			StagingRing_RetireFences(ring, true);
+			ring->stall_count++;
 
+			if (ring->fence_count == prev_count)
+			{
+				break;
+			}
+		}
+
+		//everything left is from this frame
+		if (ring->used + skip + size > ring->size)
+		{
+			return NULL;
+		}
+	}
 
+	if (skip > 0)
+	{
+		ring->head = 0;
+		ring->used += skip;
+		ring->frame_bytes += skip;
+	}
+
+	*r_offset = ring->head;
+	void* ptr = ring->map + ring->head;
+
+	ring->head += size;
+	ring->used += size;
+	ring->frame_bytes += size;
+
+	if (ring->head >= ring->size)
+	{
+		ring->head = 0;
+	}
+
+	return ptr;
+}
+
+void StagingRing_Upload(StagingRing* const ring, unsigned p_dstBuffer, size_t p_dstOffset, size_t p_size, const void* p_data)
+{
+	if (p_size == 0)
+	{
+		return;
+	}
+
+	size_t src_offset = 0;
+	void* ptr = StagingRing_Alloc(ring, p_size, &src_offset);
+
+	//ring is full or the upload is too big
+	if (!ptr)
+	{
+		glNamedBufferSubData(p_dstBuffer, p_dstOffset, p_size, p_data);
+		ring->fallback_count++;
+		return;
+	}
+
+	memcpy(ptr, p_data, p_size);
+	glCopyNamedBufferSubData(ring->buffer, p_dstBuffer, src_offset, p_dstOffset, p_size);
+
+	ring->frame_copies++;
+	ring->frame_upload_bytes += p_size;
+}
+
+void StagingRing_EndFrame(StagingRing* const ring)
+{
+	ring->last_frame_copies = ring->frame_copies;
+	ring->last_frame_upload_bytes = ring->frame_upload_bytes;
+	ring->frame_copies = 0;
+	ring->frame_upload_bytes = 0;
+
+	if (ring->frame_bytes > 0)
+	{
+		//out of fence slots, the oldest frame has to be finished first
+		if (ring->fence_count == STAGING_RING_MAX_FENCES)
+		{
+			StagingRing_RetireFences(ring, true);
+			ring->stall_count++;
+		}
+	}
+
+	//if the wait failed the bytes are carried over to the next frame's fence
+	if (ring->frame_bytes > 0 && ring->fence_count < STAGING_RING_MAX_FENCES)
+	{
+		int index = (ring->fence_start + ring->fence_count) % STAGING_RING_MAX_FENCES;
+
+		ring->fences[index].sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		ring->fences[index].bytes = ring->frame_bytes;
+		ring->fence_count++;
+		ring->frame_bytes = 0;
+	}
+
+	StagingRing_RetireFences(ring, false);
+}
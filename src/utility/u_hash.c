@@ -144,3 +144,16 @@ uint32_t Hash_uint64(uint64_t x)
 
 	return v;
 }
+
+uint64_t Hash_bytes64(const void* p_data, size_t p_length, uint64_t p_hash)
+{
+	const unsigned char* bytes = p_data;
+
+	for (size_t i = 0; i < p_length; i++)
+	{
+		p_hash ^= bytes[i];
+		p_hash *= 1099511628211ULL;
+	}
+
+	return p_hash;
+}
@@ -0,0 +1,580 @@
+#include "utility/u_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+typedef bool (*Queue_TryPopFun)(void* p_queue, void* r_item);
+
+static unsigned Queue_RoundToPowerOf2(unsigned p_value)
+{
+	unsigned result = 2;
+
+	while (result < p_value)
+	{
+		result <<= 1;
+	}
+
+	return result;
+}
+
+static void Queue_WaiterInit(Queue_Waiter* const p_waiter)
+{
+	InitializeSRWLock(&p_waiter->lock);
+	InitializeConditionVariable(&p_waiter->cond);
+	p_waiter->waiters = 0;
+}
+
+/*
+* Called by the producers after an item is published.
+* The barrier pairs with the waiter count increment in Queue_WaitPop,
+* either we see the waiter or the waiter sees our item
+*/
+static void Queue_WaiterNotify(Queue_Waiter* const p_waiter)
+{
+	MemoryBarrier();
+
+	if (ReadNoFence(&p_waiter->waiters) > 0)
+	{
+		//taking the lock makes sure the waiter is already asleep
+		AcquireSRWLockExclusive(&p_waiter->lock);
+		ReleaseSRWLockExclusive(&p_waiter->lock);
+
+		WakeAllConditionVariable(&p_waiter->cond);
+	}
+}
+
+static bool Queue_WaitPop(void* p_queue, Queue_Waiter* const p_waiter, Queue_TryPopFun p_tryPop, void* r_item, DWORD p_timeoutMs)
+{
+	if (p_tryPop(p_queue, r_item))
+	{
+		return true;
+	}
+
+	bool result = true;
+
+	AcquireSRWLockExclusive(&p_waiter->lock);
+	InterlockedIncrement(&p_waiter->waiters);
+
+	while (!p_tryPop(p_queue, r_item))
+	{
+		if (!SleepConditionVariableSRW(&p_waiter->cond, &p_waiter->lock, p_timeoutMs, 0))
+		{
+			//timed out, one last try
+			result = p_tryPop(p_queue, r_item);
+			break;
+		}
+	}
+
+	InterlockedDecrement(&p_waiter->waiters);
+	ReleaseSRWLockExclusive(&p_waiter->lock);
+
+	return result;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	SPSC
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+bool SPSC_Queue_Init(SPSC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity)
+{
+	assert(p_itemSize > 0 && "Invalid item size \n");
+
+	memset(p_queue, 0, sizeof(SPSC_Queue));
+
+	p_queue->capacity = Queue_RoundToPowerOf2(p_capacity);
+	p_queue->mask = p_queue->capacity - 1;
+	p_queue->item_size = p_itemSize;
+
+	p_queue->data = malloc(p_itemSize * p_queue->capacity);
+
+	if (!p_queue->data)
+	{
+		return false;
+	}
+
+	Queue_WaiterInit(&p_queue->waiter);
+
+	return true;
+}
+
+bool SPSC_Queue_Push(SPSC_Queue* const p_queue, const void* p_item)
+{
+	//only the producer writes the tail
+	const unsigned tail = p_queue->tail;
+	const unsigned head = ReadAcquire(&p_queue->head);
+
+	if (tail - head >= p_queue->capacity)
+	{
+		return false;
+	}
+
+	memcpy(p_queue->data + (tail & p_queue->mask) * p_queue->item_size, p_item, p_queue->item_size);
+
+	//publish the item
+	WriteRelease(&p_queue->tail, tail + 1);
+
+	Queue_WaiterNotify(&p_queue->waiter);
+
+	return true;
+}
+
+bool SPSC_Queue_Pop(SPSC_Queue* const p_queue, void* r_item)
+{
+	//only the consumer writes the head
+	const unsigned head = p_queue->head;
+	const unsigned tail = ReadAcquire(&p_queue->tail);
+
+	if (head == tail)
+	{
+		return false;
+	}
+
+	if (r_item)
+	{
+		memcpy(r_item, p_queue->data + (head & p_queue->mask) * p_queue->item_size, p_queue->item_size);
+	}
+
+	//give the slot back to the producer
+	WriteRelease(&p_queue->head, head + 1);
+
+	return true;
+}
+
+static bool Queue_SPSCTryPop(void* p_queue, void* r_item)
+{
+	return SPSC_Queue_Pop(p_queue, r_item);
+}
+
+bool SPSC_Queue_PopWait(SPSC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs)
+{
+	return Queue_WaitPop(p_queue, &p_queue->waiter, Queue_SPSCTryPop, r_item, p_timeoutMs);
+}
+
+/*
+* Returns the front item without removing it or NULL if empty.
+* Consumer only, the pointer is valid until the next pop
+*/
+void* SPSC_Queue_Peek(SPSC_Queue* const p_queue)
+{
+	const unsigned head = p_queue->head;
+	const unsigned tail = ReadAcquire(&p_queue->tail);
+
+	if (head == tail)
+	{
+		return NULL;
+	}
+
+	return p_queue->data + (head & p_queue->mask) * p_queue->item_size;
+}
+
+unsigned SPSC_Queue_Size(SPSC_Queue* const p_queue)
+{
+	const unsigned head = ReadAcquire(&p_queue->head);
+	const unsigned tail = ReadAcquire(&p_queue->tail);
+
+	return tail - head;
+}
+
+void SPSC_Queue_Destruct(SPSC_Queue* const p_queue)
+{
+	if (p_queue->data)
+	{
+		free(p_queue->data);
+	}
+	memset(p_queue, 0, sizeof(SPSC_Queue));
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	MPMC
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+#define QUEUE_CELL_SEQUENCE(QUEUE, INDEX) ((volatile LONG*)((QUEUE)->cells + ((INDEX) & (QUEUE)->mask) * (QUEUE)->cell_size))
+#define QUEUE_CELL_ITEM(QUEUE, INDEX) ((QUEUE)->cells + ((INDEX) & (QUEUE)->mask) * (QUEUE)->cell_size + sizeof(long long))
+
+bool MPMC_Queue_Init(MPMC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity)
+{
+	assert(p_itemSize > 0 && "Invalid item size \n");
+
+	memset(p_queue, 0, sizeof(MPMC_Queue));
+
+	p_queue->capacity = Queue_RoundToPowerOf2(p_capacity);
+	p_queue->mask = p_queue->capacity - 1;
+	p_queue->item_size = p_itemSize;
+
+	//sequence number padded to 8 bytes, followed by the item
+	p_queue->cell_size = sizeof(long long) + ((p_itemSize + 7) & ~(size_t)7);
+
+	p_queue->cells = malloc(p_queue->cell_size * p_queue->capacity);
+
+	if (!p_queue->cells)
+	{
+		return false;
+	}
+
+	//each cell starts out free for the push with the same index
+	for (unsigned i = 0; i < p_queue->capacity; i++)
+	{
+		*QUEUE_CELL_SEQUENCE(p_queue, i) = i;
+	}
+
+	Queue_WaiterInit(&p_queue->waiter);
+
+	return true;
+}
+
+bool MPMC_Queue_Push(MPMC_Queue* const p_queue, const void* p_item)
+{
+	unsigned pos = ReadNoFence(&p_queue->tail);
+
+	for (;;)
+	{
+		const LONG sequence = ReadAcquire(QUEUE_CELL_SEQUENCE(p_queue, pos));
+		const LONG diff = sequence - (LONG)pos;
+
+		//the cell is free, try to claim it
+		if (diff == 0)
+		{
+			if ((unsigned)InterlockedCompareExchange(&p_queue->tail, pos + 1, pos) == pos)
+			{
+				break;
+			}
+			pos = ReadNoFence(&p_queue->tail);
+		}
+		//the consumers haven't freed the cell yet, full
+		else if (diff < 0)
+		{
+			return false;
+		}
+		//another producer took it
+		else
+		{
+			pos = ReadNoFence(&p_queue->tail);
+		}
+	}
+
+	memcpy(QUEUE_CELL_ITEM(p_queue, pos), p_item, p_queue->item_size);
+
+	//publish the item
+	WriteRelease(QUEUE_CELL_SEQUENCE(p_queue, pos), pos + 1);
+
+	Queue_WaiterNotify(&p_queue->waiter);
+
+	return true;
+}
+
+bool MPMC_Queue_Pop(MPMC_Queue* const p_queue, void* r_item)
+{
+	unsigned pos = ReadNoFence(&p_queue->head);
+
+	for (;;)
+	{
+		const LONG sequence = ReadAcquire(QUEUE_CELL_SEQUENCE(p_queue, pos));
+		const LONG diff = sequence - (LONG)(pos + 1);
+
+		//the cell is published, try to claim it
+		if (diff == 0)
+		{
+			if ((unsigned)InterlockedCompareExchange(&p_queue->head, pos + 1, pos) == pos)
+			{
+				break;
+			}
+			pos = ReadNoFence(&p_queue->head);
+		}
+		//nothing published yet, empty
+		else if (diff < 0)
+		{
+			return false;
+		}
+		//another consumer took it
+		else
+		{
+			pos = ReadNoFence(&p_queue->head);
+		}
+	}
+
+	if (r_item)
+	{
+		memcpy(r_item, QUEUE_CELL_ITEM(p_queue, pos), p_queue->item_size);
+	}
+
+	//free the cell for the push one lap later
+	WriteRelease(QUEUE_CELL_SEQUENCE(p_queue, pos), pos + p_queue->capacity);
+
+	return true;
+}
+
+static bool Queue_MPMCTryPop(void* p_queue, void* r_item)
+{
+	return MPMC_Queue_Pop(p_queue, r_item);
+}
+
+bool MPMC_Queue_PopWait(MPMC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs)
+{
+	return Queue_WaitPop(p_queue, &p_queue->waiter, Queue_MPMCTryPop, r_item, p_timeoutMs);
+}
+
+void MPMC_Queue_Destruct(MPMC_Queue* const p_queue)
+{
+	if (p_queue->cells)
+	{
+		free(p_queue->cells);
+	}
+	memset(p_queue, 0, sizeof(MPMC_Queue));
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	MPSC
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+bool MPSC_Queue_Init(MPSC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity)
+{
+	return MPMC_Queue_Init(p_queue, p_itemSize, p_capacity);
+}
+
+bool MPSC_Queue_Push(MPSC_Queue* const p_queue, const void* p_item)
+{
+	return MPMC_Queue_Push(p_queue, p_item);
+}
+
+bool MPSC_Queue_Pop(MPSC_Queue* const p_queue, void* r_item)
+{
+	//only the consumer writes the head
+	const unsigned pos = p_queue->head;
+
+	const LONG sequence = ReadAcquire(QUEUE_CELL_SEQUENCE(p_queue, pos));
+
+	if (sequence != (LONG)(pos + 1))
+	{
+		return false;
+	}
+
+	if (r_item)
+	{
+		memcpy(r_item, QUEUE_CELL_ITEM(p_queue, pos), p_queue->item_size);
+	}
+
+	p_queue->head = pos + 1;
+
+	//free the cell for the push one lap later
+	WriteRelease(QUEUE_CELL_SEQUENCE(p_queue, pos), pos + p_queue->capacity);
+
+	return true;
+}
+
+static bool Queue_MPSCTryPop(void* p_queue, void* r_item)
+{
+	return MPSC_Queue_Pop(p_queue, r_item);
+}
+
+bool MPSC_Queue_PopWait(MPSC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs)
+{
+	return Queue_WaitPop(p_queue, &p_queue->waiter, Queue_MPSCTryPop, r_item, p_timeoutMs);
+}
+
+void MPSC_Queue_Destruct(MPSC_Queue* const p_queue)
+{
+	MPMC_Queue_Destruct(p_queue);
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	Stress test and benchmark.
+	Producers push (producer id, sequence) pairs as fast as they can,
+	the consumers check that nothing is lost, duplicated or reordered per producer
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+#define QUEUE_BENCHMARK_MAX_THREADS 4
+#define QUEUE_BENCHMARK_CAPACITY 1024
+
+typedef enum
+{
+	QBT__SPSC,
+	QBT__MPSC,
+	QBT__MPMC,
+} QueueBenchmarkType;
+
+typedef struct
+{
+	QueueBenchmarkType type;
+	void* queue;
+	int items_per_producer;
+	int producer_count;
+	int consumer_count;
+
+	volatile LONG consumed;
+	volatile LONG errors;
+	volatile LONG64 checksum;
+} QueueBenchmark;
+
+typedef struct
+{
+	QueueBenchmark* bench;
+	int id;
+} QueueBenchmarkThread;
+
+static bool Queue_BenchmarkPush(QueueBenchmark* p_bench, uint64_t p_item)
+{
+	switch (p_bench->type)
+	{
+	case QBT__SPSC: return SPSC_Queue_Push(p_bench->queue, &p_item);
+	case QBT__MPSC: return MPSC_Queue_Push(p_bench->queue, &p_item);
+	case QBT__MPMC: return MPMC_Queue_Push(p_bench->queue, &p_item);
+	default:
+		break;
+	}
+	return false;
+}
+
+static bool Queue_BenchmarkPop(QueueBenchmark* p_bench, uint64_t* r_item)
+{
+	switch (p_bench->type)
+	{
+	case QBT__SPSC: return SPSC_Queue_PopWait(p_bench->queue, r_item, 100);
+	case QBT__MPSC: return MPSC_Queue_PopWait(p_bench->queue, r_item, 100);
+	case QBT__MPMC: return MPMC_Queue_PopWait(p_bench->queue, r_item, 100);
+	default:
+		break;
+	}
+	return false;
+}
+
+static DWORD WINAPI Queue_BenchmarkProducer(LPVOID p_arg)
+{
+	QueueBenchmarkThread* thread = p_arg;
+	QueueBenchmark* bench = thread->bench;
+
+	for (int i = 0; i < bench->items_per_producer; i++)
+	{
+		uint64_t item = ((uint64_t)thread->id << 32) | (uint64_t)i;
+
+		while (!Queue_BenchmarkPush(bench, item))
+		{
+			YieldProcessor();
+		}
+	}
+
+	return 0;
+}
+
+static DWORD WINAPI Queue_BenchmarkConsumer(LPVOID p_arg)
+{
+	QueueBenchmarkThread* thread = p_arg;
+	QueueBenchmark* bench = thread->bench;
+
+	//next expected sequence of each producer, only meaningful with a single consumer
+	int expected[QUEUE_BENCHMARK_MAX_THREADS];
+	memset(expected, 0, sizeof(expected));
+
+	const LONG total = bench->items_per_producer * bench->producer_count;
+
+	while (ReadNoFence(&bench->consumed) < total)
+	{
+		uint64_t item = 0;
+
+		if (!Queue_BenchmarkPop(bench, &item))
+		{
+			continue;
+		}
+
+		int producer = item >> 32;
+		int sequence = item & 0xFFFFFFFF;
+
+		//a corrupted item can't be used as an index
+		if (producer < 0 || producer >= bench->producer_count)
+		{
+			InterlockedIncrement(&bench->errors);
+		}
+		else
+		{
+			if (bench->consumer_count == 1 && sequence != expected[producer])
+			{
+				InterlockedIncrement(&bench->errors);
+			}
+			expected[producer] = sequence + 1;
+		}
+
+		InterlockedExchangeAdd64(&bench->checksum, sequence);
+		InterlockedIncrement(&bench->consumed);
+	}
+
+	return 0;
+}
+
+static void Queue_RunBenchmark(const char* p_name, QueueBenchmarkType p_type, void* p_queue, int p_producers, int p_consumers, int p_itemsPerProducer)
+{
+	QueueBenchmark bench;
+	memset(&bench, 0, sizeof(bench));
+
+	bench.type = p_type;
+	bench.queue = p_queue;
+	bench.items_per_producer = p_itemsPerProducer;
+	bench.producer_count = p_producers;
+	bench.consumer_count = p_consumers;
+
+	QueueBenchmarkThread thread_args[QUEUE_BENCHMARK_MAX_THREADS * 2];
+	HANDLE handles[QUEUE_BENCHMARK_MAX_THREADS * 2];
+	int thread_count = 0;
+
+	LARGE_INTEGER freq, start_time, end_time;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start_time);
+
+	for (int i = 0; i < p_consumers; i++)
+	{
+		thread_args[thread_count].bench = &bench;
+		thread_args[thread_count].id = i;
+		handles[thread_count] = CreateThread(NULL, 0, Queue_BenchmarkConsumer, &thread_args[thread_count], 0, NULL);
+		thread_count++;
+	}
+	for (int i = 0; i < p_producers; i++)
+	{
+		thread_args[thread_count].bench = &bench;
+		thread_args[thread_count].id = i;
+		handles[thread_count] = CreateThread(NULL, 0, Queue_BenchmarkProducer, &thread_args[thread_count], 0, NULL);
+		thread_count++;
+	}
+
+	WaitForMultipleObjects(thread_count, handles, TRUE, INFINITE);
+
+	QueryPerformanceCounter(&end_time);
+
+	for (int i = 0; i < thread_count; i++)
+	{
+		CloseHandle(handles[i]);
+	}
+
+	const long long total = (long long)p_itemsPerProducer * p_producers;
+	const long long expected_checksum = ((long long)p_itemsPerProducer * (p_itemsPerProducer - 1) / 2) * p_producers;
+
+	double seconds = (double)(end_time.QuadPart - start_time.QuadPart) / (double)freq.QuadPart;
+	double mitems_per_second = (seconds > 0) ? ((double)total / seconds) / 1000000.0 : 0;
+
+	bool passed = bench.errors == 0 && bench.consumed == total && bench.checksum == expected_checksum;
+
+	printf("%s %ip/%ic: %.2f M items/s, %s \n", p_name, p_producers, p_consumers, mitems_per_second, passed ? "passed" : "FAILED");
+}
+
+void Queue_Benchmark(int p_itemsPerProducer)
+{
+	SPSC_Queue spsc;
+	MPSC_Queue mpsc;
+	MPMC_Queue mpmc;
+
+	if (!SPSC_Queue_Init(&spsc, sizeof(uint64_t), QUEUE_BENCHMARK_CAPACITY)) return;
+	if (!MPSC_Queue_Init(&mpsc, sizeof(uint64_t), QUEUE_BENCHMARK_CAPACITY)) return;
+	if (!MPMC_Queue_Init(&mpmc, sizeof(uint64_t), QUEUE_BENCHMARK_CAPACITY)) return;
+
+	Queue_RunBenchmark("SPSC", QBT__SPSC, &spsc, 1, 1, p_itemsPerProducer);
+	Queue_RunBenchmark("MPSC", QBT__MPSC, &mpsc, QUEUE_BENCHMARK_MAX_THREADS, 1, p_itemsPerProducer);
+	Queue_RunBenchmark("MPMC", QBT__MPMC, &mpmc, QUEUE_BENCHMARK_MAX_THREADS, QUEUE_BENCHMARK_MAX_THREADS, p_itemsPerProducer);
+
+	SPSC_Queue_Destruct(&spsc);
+	MPSC_Queue_Destruct(&mpsc);
+	MPMC_Queue_Destruct(&mpmc);
+}
@@ -0,0 +1,91 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <Windows.h>
+
+/*
+	Bounded lock free ring buffers for handing data from one thread to another.
+	Items are copied in and out by value. The capacity is rounded up to a power of 2.
+
+	SPSC_Queue - one producer thread and one consumer thread
+	MPSC_Queue - any number of producer threads and one consumer thread
+	MPMC_Queue - any number of producer and consumer threads
+
+	Push and Pop never block, they return false when the queue is full or empty.
+	PopWait sleeps on a condition variable until an item arrives or the timeout runs out,
+	the producers only take the lock if someone is actually waiting
+*/
+
+#define QUEUE_CACHE_LINE_SIZE 64
+
+typedef struct
+{
+	SRWLOCK lock;
+	CONDITION_VARIABLE cond;
+	volatile LONG waiters;
+} Queue_Waiter;
+
+typedef struct
+{
+	unsigned char* data;
+	size_t item_size;
+	unsigned capacity;
+	unsigned mask;
+
+	//the indexes are on their own cache lines, so the producer and the consumer don't fight over them
+	char _pad0[QUEUE_CACHE_LINE_SIZE];
+	volatile LONG head; //written by the consumer
+	char _pad1[QUEUE_CACHE_LINE_SIZE - sizeof(LONG)];
+	volatile LONG tail; //written by the producer
+	char _pad2[QUEUE_CACHE_LINE_SIZE - sizeof(LONG)];
+
+	Queue_Waiter waiter;
+} SPSC_Queue;
+
+//Each cell holds a sequence number followed by the item, see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+typedef struct
+{
+	unsigned char* cells;
+	size_t item_size;
+	size_t cell_size;
+	unsigned capacity;
+	unsigned mask;
+
+	char _pad0[QUEUE_CACHE_LINE_SIZE];
+	volatile LONG head;
+	char _pad1[QUEUE_CACHE_LINE_SIZE - sizeof(LONG)];
+	volatile LONG tail;
+	char _pad2[QUEUE_CACHE_LINE_SIZE - sizeof(LONG)];
+
+	Queue_Waiter waiter;
+} MPMC_Queue;
+
+//Same cells as the MPMC queue, but the single consumer doesn't need to compete for the head
+typedef MPMC_Queue MPSC_Queue;
+
+bool SPSC_Queue_Init(SPSC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity);
+bool SPSC_Queue_Push(SPSC_Queue* const p_queue, const void* p_item);
+bool SPSC_Queue_Pop(SPSC_Queue* const p_queue, void* r_item);
+bool SPSC_Queue_PopWait(SPSC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs);
+void* SPSC_Queue_Peek(SPSC_Queue* const p_queue);
+unsigned SPSC_Queue_Size(SPSC_Queue* const p_queue);
+void SPSC_Queue_Destruct(SPSC_Queue* const p_queue);
+
+bool MPSC_Queue_Init(MPSC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity);
+bool MPSC_Queue_Push(MPSC_Queue* const p_queue, const void* p_item);
+bool MPSC_Queue_Pop(MPSC_Queue* const p_queue, void* r_item);
+bool MPSC_Queue_PopWait(MPSC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs);
+void MPSC_Queue_Destruct(MPSC_Queue* const p_queue);
+
+bool MPMC_Queue_Init(MPMC_Queue* const p_queue, size_t p_itemSize, unsigned p_capacity);
+bool MPMC_Queue_Push(MPMC_Queue* const p_queue, const void* p_item);
+bool MPMC_Queue_Pop(MPMC_Queue* const p_queue, void* r_item);
+bool MPMC_Queue_PopWait(MPMC_Queue* const p_queue, void* r_item, DWORD p_timeoutMs);
+void MPMC_Queue_Destruct(MPMC_Queue* const p_queue);
+
+void Queue_Benchmark(int p_itemsPerProducer);
+
+#endif // !QUEUE_H
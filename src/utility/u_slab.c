@@ -0,0 +1,352 @@
+#include "utility/u_slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "utility/forward_list.h"
+
+#define SLAB_FIRST_PAGE_ITEMS 16
+#define SLAB_PAGE_HEADER_SIZE ((sizeof(Slab_Page) + (SLAB_ALIGNMENT - 1)) & ~(size_t)(SLAB_ALIGNMENT - 1))
+
+static bool Slab_AddPage(Slab_Allocator* const p_slab)
+{
+	unsigned item_count = p_slab->next_page_items;
+
+	Slab_Page* page = malloc(SLAB_PAGE_HEADER_SIZE + p_slab->item_size * item_count);
+
+	if (!page)
+	{
+		return false;
+	}
+
+	page->item_count = item_count;
+	page->next = p_slab->pages;
+	p_slab->pages = page;
+	p_slab->page_count++;
+
+	p_slab->page_cursor = (unsigned char*)page + SLAB_PAGE_HEADER_SIZE;
+	p_slab->page_items_left = item_count;
+
+	//grow the pages, so small containers don't waste a lot of memory
+	if (p_slab->next_page_items < p_slab->max_items_per_page)
+	{
+		p_slab->next_page_items = min(p_slab->next_page_items * 2, p_slab->max_items_per_page);
+	}
+
+	return true;
+}
+
+static void* Slab_TakeItem(Slab_Allocator* const p_slab)
+{
+	void* item = p_slab->free_list;
+
+	if (item)
+	{
+		p_slab->free_list = *(void**)item;
+		return item;
+	}
+
+	if (p_slab->page_items_left == 0 && !Slab_AddPage(p_slab))
+	{
+		return NULL;
+	}
+
+	item = p_slab->page_cursor;
+	p_slab->page_cursor += p_slab->item_size;
+	p_slab->page_items_left--;
+
+	return item;
+}
+
+static void Slab_GiveItem(Slab_Allocator* const p_slab, void* p_item)
+{
+	*(void**)p_item = p_slab->free_list;
+	p_slab->free_list = p_item;
+}
+
+static void Slab_TrackAlloc(Slab_Allocator* const p_slab)
+{
+	LONG live = InterlockedIncrement(&p_slab->live_count);
+	LONG peak = p_slab->peak_count;
+
+	while (live > peak)
+	{
+		LONG prev = InterlockedCompareExchange(&p_slab->peak_count, live, peak);
+
+		if (prev == peak)
+		{
+			break;
+		}
+		peak = prev;
+	}
+}
+
+void Slab_Init(Slab_Allocator* const p_slab, size_t p_itemSize, unsigned p_maxItemsPerPage, const char* p_name)
+{
+	assert(p_itemSize > 0 && "Invalid item size \n");
+
+	memset(p_slab, 0, sizeof(Slab_Allocator));
+
+	//the free list is stored inside the free items
+	size_t item_size = max(p_itemSize, sizeof(void*));
+	p_slab->item_size = (item_size + (SLAB_ALIGNMENT - 1)) & ~(size_t)(SLAB_ALIGNMENT - 1);
+
+	p_slab->max_items_per_page = max(p_maxItemsPerPage, 1);
+	p_slab->next_page_items = min(SLAB_FIRST_PAGE_ITEMS, p_slab->max_items_per_page);
+	p_slab->name = p_name;
+
+	InitializeSRWLock(&p_slab->lock);
+}
+
+void* Slab_Alloc(Slab_Allocator* const p_slab)
+{
+	void* item = Slab_TakeItem(p_slab);
+
+	if (item)
+	{
+		Slab_TrackAlloc(p_slab);
+	}
+
+	return item;
+}
+
+void Slab_Free(Slab_Allocator* const p_slab, void* p_item)
+{
+	if (!p_item)
+	{
+		return;
+	}
+
+	Slab_GiveItem(p_slab, p_item);
+	InterlockedDecrement(&p_slab->live_count);
+}
+
+void Slab_Destruct(Slab_Allocator* const p_slab)
+{
+	if (p_slab->live_count > 0)
+	{
+		printf("Slab %s: %li items leaked, peak %li items in %u pages \n", p_slab->name ? p_slab->name : "(unnamed)", p_slab->live_count, p_slab->peak_count, p_slab->page_count);
+	}
+	else if (p_slab->name && p_slab->page_count > 0)
+	{
+		printf("Slab %s: peak %li items in %u pages \n", p_slab->name, p_slab->peak_count, p_slab->page_count);
+	}
+
+	Slab_Page* page = p_slab->pages;
+
+	while (page)
+	{
+		Slab_Page* next = page->next;
+		free(page);
+		page = next;
+	}
+
+	memset(p_slab, 0, sizeof(Slab_Allocator));
+}
+
+void Slab_CacheInit(Slab_Cache* const p_cache, Slab_Allocator* const p_slab)
+{
+	memset(p_cache, 0, sizeof(Slab_Cache));
+	p_cache->slab = p_slab;
+}
+
+void* Slab_CacheAlloc(Slab_Cache* const p_cache)
+{
+	//refill a whole batch at once, so the lock is rare
+	if (!p_cache->free_list)
+	{
+		Slab_Allocator* slab = p_cache->slab;
+
+		AcquireSRWLockExclusive(&slab->lock);
+		for (int i = 0; i < SLAB_CACHE_BATCH; i++)
+		{
+			void* item = Slab_TakeItem(slab);
+
+			if (!item)
+			{
+				break;
+			}
+			*(void**)item = p_cache->free_list;
+			p_cache->free_list = item;
+			p_cache->count++;
+		}
+		ReleaseSRWLockExclusive(&slab->lock);
+
+		if (!p_cache->free_list)
+		{
+			return NULL;
+		}
+	}
+
+	void* item = p_cache->free_list;
+	p_cache->free_list = *(void**)item;
+	p_cache->count--;
+
+	Slab_TrackAlloc(p_cache->slab);
+
+	return item;
+}
+
+void Slab_CacheFree(Slab_Cache* const p_cache, void* p_item)
+{
+	if (!p_item)
+	{
+		return;
+	}
+
+	*(void**)p_item = p_cache->free_list;
+	p_cache->free_list = p_item;
+	p_cache->count++;
+
+	InterlockedDecrement(&p_cache->slab->live_count);
+
+	//don't let one thread hoard everything that other threads freed into it
+	if (p_cache->count >= SLAB_CACHE_BATCH * 2)
+	{
+		Slab_Allocator* slab = p_cache->slab;
+
+		AcquireSRWLockExclusive(&slab->lock);
+		for (int i = 0; i < SLAB_CACHE_BATCH; i++)
+		{
+			void* item = p_cache->free_list;
+			p_cache->free_list = *(void**)item;
+			p_cache->count--;
+
+			Slab_GiveItem(slab, item);
+		}
+		ReleaseSRWLockExclusive(&slab->lock);
+	}
+}
+
+void Slab_CacheFlush(Slab_Cache* const p_cache)
+{
+	Slab_Allocator* slab = p_cache->slab;
+
+	AcquireSRWLockExclusive(&slab->lock);
+	while (p_cache->free_list)
+	{
+		void* item = p_cache->free_list;
+		p_cache->free_list = *(void**)item;
+
+		Slab_GiveItem(slab, item);
+	}
+	ReleaseSRWLockExclusive(&slab->lock);
+
+	p_cache->count = 0;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~
+BENCHMARK
+~~~~~~~~~~~~~~~~~~
+*/
+#define SLAB_BENCHMARK_PASSES 200
+
+//roughly the size of a physics body
+typedef struct
+{
+	uint64_t value;
+	float data[14];
+} SlabBenchmarkItem;
+
+static double Slab_BenchmarkIterate(FL_Head* p_list, uint64_t* r_sum)
+{
+	LARGE_INTEGER freq, start_time, end_time;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start_time);
+
+	uint64_t sum = 0;
+	for (int pass = 0; pass < SLAB_BENCHMARK_PASSES; pass++)
+	{
+		for (FL_Node* node = p_list->next; node; node = node->next)
+		{
+			SlabBenchmarkItem* item = node->value;
+			sum += item->value;
+		}
+	}
+
+	QueryPerformanceCounter(&end_time);
+
+	*r_sum = sum;
+
+	double ms = (double)(end_time.QuadPart - start_time.QuadPart) * 1000.0 / (double)freq.QuadPart;
+
+	return ms / SLAB_BENCHMARK_PASSES;
+}
+
+void Slab_Benchmark(int p_nodeCount)
+{
+	if (p_nodeCount <= 0)
+	{
+		return;
+	}
+
+	//the old way, a node and a value per malloc. Other allocations in between scatter them like they would be in game
+	void** junk = malloc(sizeof(void*) * p_nodeCount);
+	FL_Head malloc_list;
+	memset(&malloc_list, 0, sizeof(malloc_list));
+
+	if (!junk)
+	{
+		return;
+	}
+
+	srand(1234);
+	for (int i = 0; i < p_nodeCount; i++)
+	{
+		FL_Node* node = malloc(sizeof(FL_Node));
+		junk[i] = malloc(16 + rand() % 512);
+		SlabBenchmarkItem* item = calloc(1, sizeof(SlabBenchmarkItem));
+
+		if (!node || !item)
+		{
+			break;
+		}
+		item->value = i;
+		node->value = item;
+		node->next = malloc_list.next;
+		malloc_list.next = node;
+		malloc_list.node_size++;
+	}
+	for (int i = 0; i < p_nodeCount; i++)
+	{
+		free(junk[i]);
+	}
+	free(junk);
+
+	FL_Head* slab_list = FL_INIT(SlabBenchmarkItem);
+
+	for (int i = 0; i < p_nodeCount; i++)
+	{
+		FL_Node* node = FL_emplaceFront(slab_list);
+
+		if (!node)
+		{
+			break;
+		}
+		SlabBenchmarkItem* item = node->value;
+		item->value = i;
+	}
+
+	uint64_t malloc_sum = 0;
+	uint64_t slab_sum = 0;
+	double malloc_ms = Slab_BenchmarkIterate(&malloc_list, &malloc_sum);
+	double slab_ms = Slab_BenchmarkIterate(slab_list, &slab_sum);
+
+	printf("Slab benchmark, iterating %i nodes: malloc %.4f ms, slab %.4f ms (%.2fx), %s \n", p_nodeCount, malloc_ms, slab_ms,
+		(slab_ms > 0) ? malloc_ms / slab_ms : 0, (malloc_sum == slab_sum) ? "passed" : "FAILED");
+
+	FL_Node* node = malloc_list.next;
+	while (node)
+	{
+		FL_Node* next = node->next;
+		free(node->value);
+		free(node);
+		node = next;
+	}
+
+	FL_Destruct(slab_list);
+}
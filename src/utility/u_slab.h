@@ -0,0 +1,70 @@
+#ifndef SLAB_H
+#define SLAB_H
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <Windows.h>
+
+/*
+	Fixed size block allocator. Items are carved from contiguous pages and recycled through a free list,
+	so nodes that are allocated together stay close in memory. Pages start small and double in size up to
+	the max items per page, pages are only given back in Slab_Destruct.
+
+	Slab_Alloc and Slab_Free are not thread safe. Threads that share a slab should each use a Slab_Cache,
+	which takes items from the slab in batches and only locks when the batch runs out or overflows
+*/
+
+#define SLAB_ALIGNMENT 16
+#define SLAB_CACHE_BATCH 32
+
+typedef struct Slab_Page
+{
+	struct Slab_Page* next;
+	unsigned item_count;
+} Slab_Page;
+
+typedef struct Slab_Allocator
+{
+	const char* name; //used in the shutdown report, NULL to only report leaks
+	size_t item_size;
+	unsigned max_items_per_page;
+	unsigned next_page_items;
+
+	Slab_Page* pages;
+	void* free_list;
+
+	//items of the newest page that haven't been handed out yet
+	unsigned char* page_cursor;
+	unsigned page_items_left;
+
+	unsigned page_count;
+	volatile LONG live_count;
+	volatile LONG peak_count;
+
+	SRWLOCK lock; //only taken by the caches
+} Slab_Allocator;
+
+//Owned by a single thread
+typedef struct Slab_Cache
+{
+	Slab_Allocator* slab;
+	void* free_list;
+	unsigned count;
+} Slab_Cache;
+
+#define Slab_INIT(SLAB, T, MAX_ITEMS_PER_PAGE) Slab_Init(SLAB, sizeof(T), MAX_ITEMS_PER_PAGE, #T)
+
+void Slab_Init(Slab_Allocator* const p_slab, size_t p_itemSize, unsigned p_maxItemsPerPage, const char* p_name);
+void* Slab_Alloc(Slab_Allocator* const p_slab);
+void Slab_Free(Slab_Allocator* const p_slab, void* p_item);
+void Slab_Destruct(Slab_Allocator* const p_slab);
+
+void Slab_CacheInit(Slab_Cache* const p_cache, Slab_Allocator* const p_slab);
+void* Slab_CacheAlloc(Slab_Cache* const p_cache);
+void Slab_CacheFree(Slab_Cache* const p_cache, void* p_item);
+void Slab_CacheFlush(Slab_Cache* const p_cache); //gives every cached item back to the slab
+
+void Slab_Benchmark(int p_nodeCount);
+
+#endif // !SLAB_H
@@ -43,6 +43,9 @@ uint32_t Hash_vec3(vec3 v);
 uint32_t Hash_ivec3(ivec3 v);
 uint32_t Hash_id(uint32_t x);
 uint32_t Hash_uint64(uint64_t x);
+//FNV-1a over raw bytes, chain calls by passing the previous result as p_hash
+#define HASH_BYTES64_SEED 14695981039346656037ULL
+uint64_t Hash_bytes64(const void* p_data, size_t p_length, uint64_t p_hash);
 /*
 ~~~~~~~~~~~~~
 GL UTILITES
@@ -92,6 +95,47 @@ void* RSB_MapRange(RenderStorageBuffer* const rsb, size_t p_offset, size_t p_siz
 void* RSB_MapIndex(RenderStorageBuffer* const rsb, unsigned p_index, unsigned p_mapFlags);
 void RSB_Unmap(RenderStorageBuffer* const rsb);
 
+/*
+	Persistently mapped upload buffer. Data is written into the ring on the cpu and copied to the
+	destination buffers on the gpu, so a frame's uploads don't stall on buffers the gpu is still using.
+	Each frame is fenced, space is reused once the gpu is done with the frame
+*/
+#define STAGING_RING_MAX_FENCES 8
+
+typedef struct
+{
+	void* sync;
+	size_t bytes; //ring bytes used by the frame, including the skipped tail when wrapping
+} StagingRing_Fence;
+
+typedef struct
+{
+	unsigned buffer;
+	unsigned char* map;
+	size_t size;
+	size_t head;
+	size_t used; //bytes the gpu might still be reading
+	size_t frame_bytes; //bytes used since the last fence
+
+	StagingRing_Fence fences[STAGING_RING_MAX_FENCES];
+	int fence_start;
+	int fence_count;
+
+	//stats
+	unsigned frame_copies;
+	size_t frame_upload_bytes;
+	unsigned last_frame_copies;
+	size_t last_frame_upload_bytes;
+	unsigned stall_count;
+	unsigned fallback_count;
+} StagingRing;
+
+StagingRing StagingRing_Create(size_t p_size);
+void StagingRing_Destruct(StagingRing* const ring);
+void* StagingRing_Alloc(StagingRing* const ring, size_t p_size, size_t* r_offset);
+void StagingRing_Upload(StagingRing* const ring, unsigned p_dstBuffer, size_t p_dstOffset, size_t p_size, const void* p_data);
+void StagingRing_EndFrame(StagingRing* const ring); //fences the frame's copies and frees finished frames
+
 typedef enum
 {
 	DRB_FLAG__NONE = 0,
@@ -102,7 +146,8 @@ typedef enum
 	DRB_FLAG__PERSISTENT = 1 << 4,
 	DRB_FLAG__ALWAYS_MAP_TO_MAX_RESERVE = 1 << 5,
 	DRB_FLAG__POOLABLE = 1 << 6,
-	DRB_FLAG__POOLABLE_KEEP_DATA = 1 << 7
+	DRB_FLAG__POOLABLE_KEEP_DATA = 1 << 7,
+	DRB_FLAG__TRACK_MOVED_ITEMS = 1 << 8 //remember the indexes of items whose offset changed
 } DRB_Flags;
 
 typedef struct
@@ -118,6 +163,7 @@ typedef struct
 	unsigned buffer;
 	unsigned buffer_flags;
 	dynamic_array* item_list;
+	dynamic_array* moved_items; //item indexes moved since DRB_ClearMovedItems, can contain duplicates
 
 	//internals
 	unsigned drb_flags;
@@ -142,8 +188,11 @@ void* DRB_MapReserve(DynamicRenderBuffer* const drb, unsigned p_mapFlags);
 void* DRB_MapRange(DynamicRenderBuffer* const drb, size_t p_offset, size_t p_size, unsigned p_mapFlags);
 void* DRB_MapItem(DynamicRenderBuffer* const drb, unsigned p_drbItemIndex, unsigned p_mapFlags);
 DRB_Item DRB_GetItem(DynamicRenderBuffer* const drb, unsigned p_drbItemIndex);
+const void* DRB_GetItemData(DynamicRenderBuffer* const drb, unsigned p_drbItemIndex); //NULL without DRB_FLAG__USE_CPU_BACK_BUFFER
 void DRB_Unmap(DynamicRenderBuffer* const drb);
 void DRB_WriteDataToGpu(DynamicRenderBuffer* const drb);
+void DRB_WriteDataToGpuStaged(DynamicRenderBuffer* const drb, StagingRing* const ring);
 void DRB_setResizeChunkSize(DynamicRenderBuffer* const drb, size_t p_chunkSize);
+void DRB_ClearMovedItems(DynamicRenderBuffer* const drb);
 
 #endif
\ No newline at end of file